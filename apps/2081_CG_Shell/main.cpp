@@ -83,7 +83,7 @@ int main(int argc, char **argv)
     {
         auto bcs = SimplySupportedSquare(dofm);
         for (auto &bc : bcs) {
-            bc.apply(feSystem.getGlobalTangent(), feSystem.getGlobalResidual());
+            bc.apply(feSystem);
         }
     }
 
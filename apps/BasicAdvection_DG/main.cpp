@@ -7,14 +7,14 @@
 #include "fe_system/FESystem.hpp"
 #include "output/SimulationOutput.hpp"
 #include "time_integration/DGRK4.hpp"
+#include "time_integration/TimeStepController.hpp"
 
 using namespace yafel;
 
 template<int NSD>
 struct AdvectionPhysics
 {
-    std::vector<Eigen::PartialPivLU<Eigen::MatrixXd>> inverse_mass_matrices;
-    bool mass_constructed{false};
+    InverseMassOperator inverse_mass;
 
     static constexpr int nsd() { return NSD; }
 
@@ -46,6 +46,11 @@ struct AdvectionPhysics
         return {-1., 0.};
     };
 
+    static inline double WaveSpeed(const coordinate<> &x, double t)
+    {
+        return norm(convection_velocity(x, t));
+    }
+
     static inline double source(const coordinate<> &, double)
     {
         return 0.0;
@@ -110,7 +115,7 @@ int main()
     AdvectionPhysics<NSD> AP;
 
     double Tfinal = 1;
-    double dt = .001;
+    double cfl = 0.5;
     int output_freq = 1;
 
 
@@ -129,12 +134,15 @@ int main()
 
     simulationOutput.captureFrame(feSystem);
 
-    DGRK4 dgrk4(dt);
+    // Stable step from the element lengths and wave speeds, refreshed every 10 steps
+    DGRK4 dgrk4(0);
+    TimeStepController controller(feSystem, NSD, cfl, 10);
 
-    int NT = static_cast<int>(Tfinal / dt);
-    for (int ti = 1; ti <= NT; ++ti) {
-        std::cout << ti << " / " << NT << std::endl;
-        dgrk4.step(feSystem,AP);
+    int ti = 0;
+    while (feSystem.currentTime() < Tfinal) {
+        double dt = controller.step(dgrk4, feSystem, AP, Tfinal);
+        ++ti;
+        std::cout << ti << ": t = " << feSystem.currentTime() << " (dt = " << dt << ")" << std::endl;
 
         if (ti % output_freq == 0) {
             simulationOutput.captureFrame(feSystem);
@@ -43,6 +43,9 @@ struct LinearElasticity
 {
     static constexpr int nsd() { return NSD; }
 
+    // The quadrature point coordinates are not used
+    static constexpr bool needsXqp() { return false; }
+
     static constexpr double Youngs{200.0e9};
     static constexpr double nu{0.3};
 
@@ -110,6 +113,47 @@ struct LinearElasticity
         }
 
     }
+
+    // Kernels over batches of batchWidth() linear/quadratic elements at once (see ElementBatch)
+    static constexpr int dofPerNode() { return NSD; }
+
+    static constexpr int batchWidth() { return 4; }
+
+    template<typename Batch>
+    static void LocalResidualBatch(const Batch &B, int qpi, const typename Batch::Point &, double,
+                                   const typename Batch::LocalVector &,
+                                   typename Batch::LocalVector &R_el)
+    {
+        for (int A = 0; A < Batch::n_dofs; ++A) {
+            R_el[A] += 10 * B.shapeValue(qpi, A / NSD) * B.jxw;
+        }
+    }
+
+    template<typename Batch>
+    static void LocalTangentBatch(const Batch &B, int, const typename Batch::Point &, double,
+                                  const typename Batch::LocalVector &,
+                                  typename Batch::LocalMatrix &K_el)
+    {
+        // C_ikjl grad_A(j) grad_B(l) = lambda gA_i gB_k + mu gA_k gB_i + mu delta_ik (gA . gB)
+        for (int Anode = 0; Anode < Batch::n_nodes; ++Anode) {
+            for (int Bnode = 0; Bnode < Batch::n_nodes; ++Bnode) {
+                typename Batch::Lanes gAgB = B.grad(Anode, 0) * B.grad(Bnode, 0);
+                for (int d = 1; d < NSD; ++d) {
+                    gAgB += B.grad(Anode, d) * B.grad(Bnode, d);
+                }
+                for (int i = 0; i < NSD; ++i) {
+                    for (int k = 0; k < NSD; ++k) {
+                        typename Batch::Lanes K = lambda * B.grad(Anode, i) * B.grad(Bnode, k)
+                                                  + mu * B.grad(Anode, k) * B.grad(Bnode, i);
+                        if (i == k) {
+                            K += mu * gAgB;
+                        }
+                        K_el[(Anode * NSD + i) * Batch::n_dofs + Bnode * NSD + k] -= K * B.jxw;
+                    }
+                }
+            }
+        }
+    }
 };
 
 Eigen::VectorXd solveSystem(const Eigen::SparseMatrix<double, Eigen::RowMajor> &A, const Eigen::VectorXd &rhs)
@@ -172,7 +216,7 @@ int main()
 
     auto bcs = UniaxialTension(dofm, L, .01);
     for (auto &bc : bcs) {
-        bc.apply(feSystem.getGlobalTangent(), feSystem.getGlobalResidual());
+        bc.apply(feSystem);
     }
 
     timer.tic();
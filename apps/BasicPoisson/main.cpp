@@ -28,6 +28,10 @@ struct PoissonEquation
     static constexpr int nsd()
     { return NSD; }
 
+    // The quadrature point coordinates are not used
+    static constexpr bool needsXqp()
+    { return false; }
+
     static void
     LocalResidual(const Element &E, int qpi, coordinate<>&, double,
                   Eigen::Map<Eigen::Matrix<double, Eigen::Dynamic, 1>> &u_el,
@@ -112,7 +116,7 @@ int main()
     //DirichletBC bc1(dofm, 0.0);
     //bc1.selectByFunction([](const coordinate<> &x) { return std::abs(x(1)) < 1.0e-6; });
 
-    bc0.apply(feSystem.getGlobalTangent(), feSystem.getGlobalResidual());
+    bc0.apply(feSystem);
     //bc1.apply(feSystem.getGlobalTangent(), feSystem.getGlobalResidual());
 
     auto &U = feSystem.getSolution();
@@ -3,18 +3,48 @@
 //
 
 #include "yafel.hpp"
+#include "output/SimulationOutput.hpp"
 #include "Poisson.hpp"
 
+#include <Eigen/SparseLU>
+#include <algorithm>
+#include <iostream>
+
 using namespace yafel;
 
 int main()
 {
     constexpr int NSD = 2;
     Mesh M("mesh.msh");
+    M.buildInternalFaces();
 
-    int polyOrder = 12;
+    int polyOrder = 4;
     int dof_per_volume_node = NSD + 1;
 
     DoFManager bulk_dofm(M, DoFManager::ManagerType::DG, polyOrder, dof_per_volume_node);
+    FESystem feSystem(bulk_dofm, NSD);
+    HDGSystem hdg(feSystem, NSD);
+    Poisson<NSD> physics;
+
+    // Condense every element onto its face traces, then solve the skeleton system
+    HDGAssembly(hdg, physics);
+    std::cout << "Volume dofs: " << feSystem.getSolution().rows() << ", skeleton dofs: " << hdg.nSkeletonDofs() << std::endl;
+
+    Eigen::SparseMatrix<double> K = hdg.getGlobalTangent();
+    Eigen::SparseLU<Eigen::SparseMatrix<double>> solver;
+    solver.compute(K);
+    Eigen::VectorXd lambda = solver.solve(hdg.getGlobalResidual());
+
+    // Element interiors from the traces
+    hdg.recover(lambda);
+
+    auto const &U = feSystem.getSolution();
+    double error{0};
+    for (int i = 0; i < static_cast<int>(bulk_dofm.dof_nodes.size()); ++i) {
+        error = std::max(error, std::abs(U(i * dof_per_volume_node) - Poisson<NSD>::exact(bulk_dofm.dof_nodes[i])));
+    }
+    std::cout << "Max nodal error in u: " << error << std::endl;
 
-}
\ No newline at end of file
+    SimulationOutput simulationOutput("output", BackendType::HDF5);
+    simulationOutput.captureFrame(feSystem);
+}
@@ -35,8 +35,8 @@ int main() {
     DirichletBC bc1(dofm,1.0);
     bc1.selectByFunction([](auto x){return std::abs(x(0) - 1) < 1.0e-6;});
 
-    bc0.apply(feSystem.getGlobalTangent(), feSystem.getGlobalResidual());
-    bc1.apply(feSystem.getGlobalTangent(), feSystem.getGlobalResidual());
+    bc0.apply(feSystem);
+    bc1.apply(feSystem);
     feSystem.getSolution() = solveSystem(feSystem.getGlobalTangent(), feSystem.getGlobalResidual());
 
     SimulationOutput simulationOutput("output", BackendType::HDF5);
@@ -0,0 +1,64 @@
+#ifndef YAFEL_ASSEMBLYBACKEND_HPP
+#define YAFEL_ASSEMBLYBACKEND_HPP
+
+#include "yafel_globals.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+YAFEL_NAMESPACE_OPEN
+
+/**
+ * Parallel runtime used for the element loop of an assembly.
+ *
+ * OpenMP --> statically scheduled `omp for` within each element color
+ * TaskScheduler --> each color split into chunks that are claimed on demand by
+ *                   tasks on the global (work-stealing) TaskScheduler and by the
+ *                   calling thread, alongside any other tasks running on it
+ */
+enum class AssemblyBackend : int
+{
+    OpenMP,
+    TaskScheduler
+};
+
+
+/**
+ * \class AssemblyStatistics
+ * \brief Load balance of the last element loop, per worker thread
+ */
+struct AssemblyStatistics
+{
+    AssemblyBackend backend{AssemblyBackend::OpenMP};
+    double wall_seconds{0};
+
+    // One entry per worker (OpenMP thread, or TaskScheduler worker plus the calling thread)
+    std::vector<int> elements;
+    std::vector<int> chunks;
+    std::vector<double> busy_seconds;
+
+    inline int nWorkers() const { return static_cast<int>(busy_seconds.size()); }
+
+    // Largest over mean busy time of the workers (1 is perfect balance)
+    inline double imbalance() const
+    {
+        if (busy_seconds.empty()) {
+            return 1;
+        }
+        double total = std::accumulate(busy_seconds.begin(), busy_seconds.end(), 0.0);
+        double largest = *std::max_element(busy_seconds.begin(), busy_seconds.end());
+        return (total > 0) ? largest * nWorkers() / total : 1;
+    }
+
+    // Fraction of the wall time, summed over the workers, spent on elements
+    inline double efficiency() const
+    {
+        double total = std::accumulate(busy_seconds.begin(), busy_seconds.end(), 0.0);
+        return (wall_seconds > 0 && nWorkers() > 0) ? total / (wall_seconds * nWorkers()) : 0;
+    }
+};
+
+YAFEL_NAMESPACE_CLOSE
+
+#endif //YAFEL_ASSEMBLYBACKEND_HPP
@@ -7,6 +7,8 @@
 
 #include "yafel_globals.hpp"
 
+#include <vector>
+
 YAFEL_NAMESPACE_OPEN
 
 enum class AssemblyRequirement : int
@@ -18,6 +20,76 @@ enum class AssemblyRequirement : int
     DtDtMass
 };
 
+
+// Bit of a requirement in a requirement mask
+constexpr unsigned requirementBit(AssemblyRequirement req)
+{
+    return 1u << static_cast<int>(req);
+}
+
+// Mask of a runtime list of requirements
+inline unsigned requirementMask(const std::vector<AssemblyRequirement> &requirements)
+{
+    unsigned mask{0};
+    for (auto req : requirements) {
+        mask |= requirementBit(req);
+    }
+    return mask;
+}
+
+
+/**
+ * \class AssemblyRequirementSet
+ * \brief Compile-time set of assembly requirements, as a bit mask
+ *
+ * The assembly routines are instantiated per set, so that the work and the
+ * local buffers of requirements outside of it are removed at compile time.
+ * Usually spelled as AssemblyRequirements<AssemblyRequirement::Residual, ...>.
+ */
+template<unsigned Mask>
+struct AssemblyRequirementSet
+{
+    static constexpr unsigned mask() { return Mask; }
+
+    static constexpr bool contains(AssemblyRequirement req) { return (Mask & requirementBit(req)) != 0; }
+
+    static constexpr bool residual() { return contains(AssemblyRequirement::Residual); }
+
+    static constexpr bool tangent() { return contains(AssemblyRequirement::Tangent); }
+
+    // DtMass, or the lumped inverse (which needs the mass first)
+    static constexpr bool dtMass()
+    {
+        return contains(AssemblyRequirement::DtMass) || contains(AssemblyRequirement::LumpedDtMassInverse);
+    }
+
+    static constexpr bool lumpedDtMassInverse() { return contains(AssemblyRequirement::LumpedDtMassInverse); }
+
+    static constexpr bool dtDtMass() { return contains(AssemblyRequirement::DtDtMass); }
+
+    // Whether any global matrix is assembled
+    static constexpr bool matrix() { return tangent() || dtMass() || dtDtMass(); }
+};
+
+template<AssemblyRequirement... Requirements>
+using AssemblyRequirements = AssemblyRequirementSet<(0u | ... | requirementBit(Requirements))>;
+
+
+/**
+ * Calls func(AssemblyRequirementSet<mask & Bits>{}), selecting among the
+ * compile-time subsets of Bits. Every subset of Bits gets an instantiation of
+ * func, so Bits should only hold the requirements the caller distinguishes.
+ */
+template<unsigned Bits, unsigned Subset = Bits, typename Func>
+void dispatchRequirementSet(unsigned mask, Func &&func)
+{
+    if ((mask & Bits) == Subset) {
+        func(AssemblyRequirementSet<Subset>{});
+    } else if constexpr (Subset != 0) {
+        dispatchRequirementSet<Bits, (Subset - 1) & Bits>(mask, func);
+    }
+}
+
 YAFEL_NAMESPACE_CLOSE
 
 #endif //YAFEL_ASSEMBLYREQUIREMENT_HPP
@@ -8,110 +8,444 @@
 #include "yafel_globals.hpp"
 #include "element/Element.hpp"
 #include "element/ElementFactory.hpp"
+#include "element/ElementBatch.hpp"
+#include "element/FixedElement.hpp"
+#include "fe_system/ElementContributionCache.hpp"
 #include "fe_system/FESystem.hpp"
+#include "fe_system/SparsityPattern.hpp"
+#include "lin_alg/BCSRMatrix.hpp"
+#include "assembly/AssemblyBackend.hpp"
 #include "assembly/AssemblyRequirement.hpp"
+#include "assembly/PhysicsTraits.hpp"
+#include "utils/ElementColoring.hpp"
+#include "utils/parallel/TaskScheduler.hpp"
 
 #include <Eigen/Core>
 #include <Eigen/Dense>
 #include <Eigen/Sparse>
+#include <omp.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 YAFEL_NAMESPACE_OPEN
 
+namespace detail {
+
 /**
- *
- * \brief General-purpose Continuous-Galerkin finite element assembly
- *
- * @tparam Physics Class that defines the local element matrix/vector construction in static void methods
+ * Destination of the local contributions in CGAssembly: the value array of the
+ * global tangent (through the element positions of its sparsity pattern) and the
+ * global residual. With an element cache, contributions are recorded on the
+ * way, and for an incremental assembly replaced by their change.
  */
-template<typename Physics>
-void CGAssembly(FESystem &feSystem,
-                std::vector<AssemblyRequirement> requirements = {AssemblyRequirement::Residual,
-                                                                 AssemblyRequirement::Tangent})
+struct CGScatter
+{
+    ElementPositionMap positions;
+    double *tangent_values;
+    Eigen::VectorXd &residual_vector;
+    ElementContributionCache *cache;
+    bool incremental;
+
+    // Row-major local tangent of elnum, entry i at K[i * stride]
+    inline void tangent(int elnum, double *K, int local_dofs, int stride = 1) const
+    {
+        if (cache != nullptr) {
+            cache->exchangeTangent(elnum, K, stride, incremental);
+        }
+        const int *element_positions = positions(elnum);
+        for (int AB = 0; AB < local_dofs * local_dofs; ++AB) {
+            tangent_values[element_positions[AB]] += K[AB * stride];
+        }
+    }
+
+    // Local residual of elnum, entry A at R[A * stride] and global dof globalDof(A)
+    template<typename GlobalDof>
+    inline void residual(int elnum, double *R, int local_dofs, int stride, GlobalDof &&globalDof) const
+    {
+        if (cache != nullptr) {
+            cache->exchangeResidual(elnum, R, stride, incremental);
+        }
+        for (int A = 0; A < local_dofs; ++A) {
+            residual_vector(globalDof(A)) += R[A * stride];
+        }
+    }
+};
+
+/**
+ * Quadrature-point call of the Physics kernels: the fused LocalResidualAndTangent
+ * when both are required and the Physics has it, LocalTangent and/or LocalResidual
+ * otherwise.
+ */
+template<typename Physics, typename Requirements, typename ElementT, typename VectorT, typename MatrixT>
+inline void cg_local_kernels(const ElementT &E, int qpi, coordinate<> &xqp, double time,
+                             VectorT &local_solution, VectorT &local_residual, MatrixT &local_tangent)
+{
+    if constexpr (Requirements::tangent() && Requirements::residual()
+                  && has_fused_kernel<Physics, ElementT, VectorT, MatrixT>::value) {
+        Physics::LocalResidualAndTangent(E, qpi, xqp, time, local_solution, local_residual, local_tangent);
+    } else {
+        if constexpr (Requirements::tangent()) {
+            Physics::LocalTangent(E, qpi, xqp, time, local_solution, local_tangent);
+        }
+        if constexpr (Requirements::residual()) {
+            Physics::LocalResidual(E, qpi, xqp, time, local_solution, local_residual);
+        }
+    }
+}
+
+/**
+ * Element kernel of CGAssembly for a FixedElement: same steps as the generic
+ * element loop body, with all local storage fixed-size and on the stack.
+ * Returns false (doing nothing) if Physics cannot take the fixed-size types.
+ */
+template<typename Physics, typename Requirements, typename FE>
+bool cg_fixed_element(FE &E, int elnum, const DoFManager &dofm, const GeometryCache *geometry, double time,
+                      const Eigen::VectorXd &GlobalSolution, const CGScatter &scatter)
+{
+    if constexpr (!accepts_fixed_element<Physics, FE>::value) {
+        return false;
+    } else {
+        constexpr int dof_per_node = FE::dofPerNode();
+        const int *nodes = dofm.elements.data() + dofm.element_offsets[elnum];
+
+        typename FE::LocalVector local_solution;
+        typename FE::LocalVector local_residual;
+        typename FE::LocalMatrix local_tangent;
+        if constexpr (Requirements::residual()) {
+            local_residual.setZero();
+        }
+        if constexpr (Requirements::matrix()) {
+            local_tangent.setZero();
+        }
+        for (int A = 0; A < FE::n_dofs; ++A) {
+            local_solution(A) = GlobalSolution(nodes[A / dof_per_node] * dof_per_node + A % dof_per_node);
+        }
+
+        for (int qpi = 0; qpi < E.nQP(); ++qpi) {
+            coordinate<> xqp;
+            if constexpr (physics_needs_xqp<Physics>::value) {
+                for (int A = 0; A < FE::n_nodes; ++A) {
+                    xqp += dofm.dof_nodes[nodes[A]] * E.shapeValues[qpi](A);
+                }
+            }
+
+            E.template update<Physics::nsd()>(elnum, qpi, dofm, geometry);
+
+            cg_local_kernels<Physics, Requirements>(E, qpi, xqp, time, local_solution, local_residual,
+                                                    local_tangent);
+        }
+
+        if constexpr (Requirements::matrix()) {
+            scatter.tangent(elnum, local_tangent.data(), FE::n_dofs);
+        }
+        if constexpr (Requirements::residual()) {
+            scatter.residual(elnum, local_residual.data(), FE::n_dofs, 1, [nodes](int A) {
+                return nodes[A / dof_per_node] * dof_per_node + A % dof_per_node;
+            });
+        }
+        return true;
+    }
+}
+
+/**
+ * Batched element kernel of CGAssembly: elnums[0..nActive) (all of the type of
+ * the batch, and of one color) are evaluated together on the SIMD lanes of B,
+ * then scattered lane by lane. Returns false (doing nothing) if Physics has no
+ * batch kernels for B.
+ */
+template<typename Physics, typename Requirements, typename Batch>
+bool cg_element_batch(Batch &B, const int *elnums, int nActive, const DoFManager &dofm,
+                      const GeometryCache *geometry, double time,
+                      const Eigen::VectorXd &GlobalSolution, const CGScatter &scatter)
+{
+    if constexpr (!accepts_element_batch<Physics, Batch>::value) {
+        return false;
+    } else {
+        constexpr int dof_per_node = Batch::dofPerNode();
+        constexpr int n_dofs = Batch::n_dofs;
+
+        B.gather(elnums, nActive, dofm);
+        for (int A = 0; A < n_dofs; ++A) {
+            for (int l = 0; l < Batch::width; ++l) {
+                B.local_solution[A](l) = GlobalSolution(B.globalNodes[A / dof_per_node][l] * dof_per_node
+                                                        + A % dof_per_node);
+            }
+            if constexpr (Requirements::residual()) {
+                B.local_residual[A].setZero();
+            }
+        }
+        if constexpr (Requirements::matrix()) {
+            for (auto &K_AB : B.local_tangent) {
+                K_AB.setZero();
+            }
+        }
+
+        for (int qpi = 0; qpi < B.nQP(); ++qpi) {
+            typename Batch::Point xqp;
+            for (int i = 0; i < 3; ++i) {
+                xqp[i].setZero();
+                if constexpr (physics_needs_xqp<Physics>::value) {
+                    for (int A = 0; A < Batch::n_nodes; ++A) {
+                        xqp[i] += B.nodeCoords[A * 3 + i] * B.shapeValue(qpi, A);
+                    }
+                }
+            }
+
+            B.template update<Physics::nsd()>(qpi, dofm, geometry);
+
+            if constexpr (Requirements::tangent() && Requirements::residual()
+                          && has_fused_batch_kernel<Physics, Batch>::value) {
+                Physics::LocalResidualAndTangentBatch(B, qpi, xqp, time, B.local_solution,
+                                                      B.local_residual, B.local_tangent);
+            } else {
+                if constexpr (Requirements::tangent()) {
+                    Physics::LocalTangentBatch(B, qpi, xqp, time, B.local_solution, B.local_tangent);
+                }
+                if constexpr (Requirements::residual()) {
+                    Physics::LocalResidualBatch(B, qpi, xqp, time, B.local_solution, B.local_residual);
+                }
+            }
+        }
+
+        // Lane l of consecutive Lanes entries is strided by the batch width
+        static_assert(sizeof(typename Batch::Lanes) == Batch::width * sizeof(double),
+                      "cg_element_batch: Lanes must be unpadded");
+        for (int l = 0; l < nActive; ++l) {
+            if constexpr (Requirements::matrix()) {
+                scatter.tangent(elnums[l], &B.local_tangent[0](l), n_dofs, Batch::width);
+            }
+            if constexpr (Requirements::residual()) {
+                scatter.residual(elnums[l], &B.local_residual[0](l), n_dofs, Batch::width, [&B, l](int A) {
+                    return B.globalNodes[A / dof_per_node][l] * dof_per_node + A % dof_per_node;
+                });
+            }
+        }
+        return true;
+    }
+}
+
+/**
+ * Per-worker storage of the CGAssembly element loop: element factories, local
+ * buffers, and the load counters reported in AssemblyStatistics.
+ */
+template<int NSD, int FixedDofPerNode, int BatchWidth>
+struct CGWorkerState
+{
+    explicit CGWorkerState(const DoFManager &dofm) : EF(dofm), fixed_EF(EF), batch_EF(EF) {}
+
+    ElementFactory EF;
+    FixedElementFactory<NSD, FixedDofPerNode> fixed_EF;
+    ElementBatchFactory<NSD, FixedDofPerNode, BatchWidth> batch_EF;
+
+    std::vector<double> local_tangent_buffer;
+    std::vector<double> local_residual_buffer;
+    std::vector<double> local_solution_buffer;
+    std::vector<int> global_dof_buffer;
+
+    int elements{0};
+    int chunks{0};
+    double busy_seconds{0};
+};
+
+}//end namespace detail
+
+
+namespace detail {
+
+/**
+ * Matrix entries are scattered straight into the value array of the global
+ * tangent, using the element position maps of the FESystem's (cached) sparsity
+ * pattern for its storage. The structure is only (re)initialized if the tangent
+ * does not already have it. Returns the position maps.
+ */
+inline ElementPositionMap prepare_cg_tangent(FESystem &feSystem, Eigen::SparseMatrix<double> &GlobalTangent,
+                                             int topoDim, bool incremental)
+{
+    auto const &pattern = feSystem.getSparsityPattern(topoDim);
+    if (incremental) {
+        if (!pattern.matches(GlobalTangent)) {
+            throw std::runtime_error("CGAssemblyIncremental: the global tangent has not been assembled");
+        }
+    } else if (pattern.matches(GlobalTangent)) {
+        std::fill(GlobalTangent.valuePtr(), GlobalTangent.valuePtr() + GlobalTangent.nonZeros(), 0.0);
+    } else {
+        pattern.initializeMatrix(GlobalTangent);
+    }
+    return pattern.elementPositionMap();
+}
+
+template<int B>
+ElementPositionMap prepare_cg_tangent(FESystem &feSystem, BCSRMatrix<B> &GlobalTangent, int topoDim,
+                                      bool incremental)
+{
+    auto const &pattern = feSystem.getBlockSparsityPattern(topoDim);
+    if (pattern.blockSize() != B) {
+        throw std::runtime_error("CGAssembly: BCSRMatrix block size differs from dof_per_node");
+    }
+    if (incremental) {
+        if (!GlobalTangent.matches(pattern)) {
+            throw std::runtime_error("CGAssemblyIncremental: the global tangent has not been assembled");
+        }
+    } else if (GlobalTangent.matches(pattern)) {
+        GlobalTangent.setZero();
+    } else {
+        GlobalTangent.setPattern(pattern);
+    }
+    return pattern.elementPositionMap();
+}
+
+
+/**
+ * Body of CGAssembly and CGAssemblyIncremental for one AssemblyRequirementSet:
+ * a full assembly if changed_elements is nullptr, otherwise the replacement of
+ * the recorded contributions of those elements. The tangent goes into
+ * GlobalTangent, the FESystem's or a BCSRMatrix.
+ */
+template<typename Physics, typename Requirements, typename TangentType>
+void cg_assembly(FESystem &feSystem, TangentType &GlobalTangent, const std::vector<int> *changed_elements)
 {
 
     // Unpack the FESystem
-    auto &GlobalTangent = feSystem.getGlobalTangent();
     auto &GlobalResidual = feSystem.getGlobalResidual();
     auto &GlobalSolution = feSystem.getSolution();
     auto &dofm = feSystem.getDoFManager();
     auto dof_per_node = dofm.dof_per_node;
     constexpr int simulation_dimension = Physics::nsd();
+    constexpr int fixed_dof_per_node = detail::physics_dof_per_node<Physics>::value;
+    constexpr int batch_width = detail::physics_batch_width<Physics>::value;
     auto time = feSystem.currentTime();
 
 
-    bool assemble_tangent{false};
-    bool assemble_residual{false};
-    bool assemble_dt_mass{false};
-    bool inverse_lumped_dt_mass{false};
-    bool assemble_dtdt_mass{false};
-    for (auto req : requirements) {
-        switch (req) {
-            case AssemblyRequirement::Residual:
-                assemble_residual = true;
-                break;
-            case AssemblyRequirement::Tangent:
-                assemble_tangent = true;
-                break;
-            case AssemblyRequirement::DtMass:
-                assemble_dt_mass = true;
-                break;
-            case AssemblyRequirement::LumpedDtMassInverse:
-                assemble_dt_mass = true;
-                inverse_lumped_dt_mass = true;
-                break;
-            case AssemblyRequirement::DtDtMass:
-                assemble_dtdt_mass = true;
-                break;
+    constexpr bool assemble_residual = Requirements::residual();
+    constexpr bool assemble_matrix = Requirements::matrix();
+
+    const bool incremental = (changed_elements != nullptr);
+
+    ElementPositionMap positions;
+    if constexpr (assemble_matrix) {
+        positions = prepare_cg_tangent(feSystem, GlobalTangent, simulation_dimension, incremental);
+    }
+
+    // Local contributions of each element, recorded for later incremental assemblies
+    auto *element_cache = feSystem.getElementCache(simulation_dimension);
+    if (incremental) {
+        if (element_cache == nullptr
+            || (assemble_matrix && !element_cache->hasTangent())
+            || (assemble_residual && !element_cache->hasResidual())) {
+            throw std::runtime_error("CGAssemblyIncremental: no recorded element contributions "
+                                     "(enable the FESystem element cache and run CGAssembly first)");
+        }
+        if (element_cache->generation() != feSystem.constraintGeneration()) {
+            throw std::runtime_error("CGAssemblyIncremental: boundary conditions were applied to the assembled "
+                                     "system since the last CGAssembly (apply them to a copy)");
         }
+    } else if (element_cache != nullptr) {
+        element_cache->prepare(assemble_matrix, assemble_residual, feSystem.constraintGeneration());
     }
 
-    //shared objects
-    std::vector<Eigen::Triplet<double>> tangent_triplets;
-    int total_triplets{0};
-
-#pragma omp parallel shared(tangent_triplets, GlobalResidual, dofm)
-    {// open parallel block
-        //storage buffers
-        std::vector<double> local_tangent_buffer;
-        std::vector<double> local_residual_buffer;
-        std::vector<double> local_solution_buffer;
-        std::vector<int> global_dof_buffer;
-        Eigen::VectorXd private_residual = Eigen::VectorXd::Constant(GlobalResidual.rows(), 0.0);
-        std::vector<Eigen::Triplet<double>> local_triplets;
-
-        //Create an ElementFactory
-        ElementFactory EF;
-#pragma omp for
-        for (int elnum = 0; elnum < dofm.nCells(); ++elnum) {
+    CGScatter scatter{positions, GlobalTangent.valuePtr(), GlobalResidual, element_cache, incremental};
+
+    // Elements of one color share no dofs, so within a color every element can
+    // write its contributions straight into the global residual and tangent,
+    // whichever thread it runs on.
+    auto const &coloring = dofm.getElementColoring(simulation_dimension);
 
+    // Elements to visit, color by color: all of them, or the changed ones
+    std::vector<std::vector<int>> changed_colors;
+    std::vector<std::pair<const int *, int>> color_lists;
+    if (incremental) {
+        std::vector<char> changed(dofm.nCells(), 0);
+        for (auto e : *changed_elements) {
+            if (e < 0 || e >= dofm.nCells()) {
+                throw std::runtime_error("CGAssemblyIncremental: element number out of range");
+            }
+            changed[e] = 1;
+        }
+        changed_colors.resize(coloring.nColors());
+        for (int color = 0; color < coloring.nColors(); ++color) {
+            for (int cidx = 0; cidx < coloring.nElements(color); ++cidx) {
+                int e = coloring.elements(color)[cidx];
+                if (changed[e]) {
+                    changed_colors[color].push_back(e);
+                }
+            }
+            color_lists.emplace_back(changed_colors[color].data(), static_cast<int>(changed_colors[color].size()));
+        }
+    } else {
+        for (int color = 0; color < coloring.nColors(); ++color) {
+            color_lists.emplace_back(coloring.elements(color), coloring.nElements(color));
+        }
+    }
+
+    // Precomputed jxw and shape gradients (nullptr if disabled on the FESystem)
+    auto const *geometry = feSystem.getGeometryCache(simulation_dimension);
+
+    using WorkerState = CGWorkerState<simulation_dimension, fixed_dof_per_node, batch_width>;
+    using clock_type = std::chrono::steady_clock;
+
+    // Assemble a block of (up to batch_width) elements of one color
+    auto assemble_block = [&](WorkerState &ws, const int *block, int block_size) {
+        ws.elements += block_size;
+
+        // Blocks of one batchable element type go through the SIMD batch kernel
+        if (batch_width > 1 && dof_per_node == fixed_dof_per_node) {
+            auto et = dofm.element_types[block[0]];
+            bool uniform = std::all_of(block, block + block_size,
+                                       [&](int e) { return dofm.element_types[e] == et; });
+            if (uniform && ws.batch_EF.visit(et, [&](auto &B) {
+                return cg_element_batch<Physics, Requirements>(B, block, block_size, dofm, geometry, time,
+                                                               GlobalSolution, scatter);
+            })) {
+                return;
+            }
+        }
+
+        auto &local_tangent_buffer = ws.local_tangent_buffer;
+        auto &local_residual_buffer = ws.local_residual_buffer;
+        auto &local_solution_buffer = ws.local_solution_buffer;
+        auto &global_dof_buffer = ws.global_dof_buffer;
+
+        for (int bi = 0; bi < block_size; ++bi) {
+            int elnum = block[bi];
             auto et = dofm.element_types[elnum];
-            if (et.topoDim != simulation_dimension) {
+
+            // Element types with a compile-time sized kernel
+            if (dof_per_node == fixed_dof_per_node
+                && ws.fixed_EF.visit(et, [&](auto &FE) {
+                    return cg_fixed_element<Physics, Requirements>(FE, elnum, dofm, geometry, time,
+                                                                   GlobalSolution, scatter);
+                })) {
                 continue;
             }
 
-            auto &E = EF.getElement(et);
+            auto &E = ws.EF.getElement(et);
             dofm.getGlobalDofs(elnum, global_dof_buffer);
 
             dofm.getGlobalNodes(elnum, E.globalNodes);
 
+            // Only the buffers of the required outputs are sized and zeroed; the
+            // local solution is entirely overwritten below
             auto local_dofs = E.localMesh.nNodes() * dof_per_node;
-            if (assemble_tangent && static_cast<int>(local_tangent_buffer.size()) < local_dofs * local_dofs) {
-                local_tangent_buffer.resize(local_dofs * local_dofs, 0.0);
-            }
-            if (assemble_residual && static_cast<int>(local_residual_buffer.size()) < local_dofs) {
-                local_residual_buffer.resize(local_dofs, 0.0);
-                local_solution_buffer.resize(local_dofs, 0.0);
-            }
-
-            for (auto &x : local_tangent_buffer) {
-                x = 0;
+            if constexpr (Requirements::matrix()) {
+                if (static_cast<int>(local_tangent_buffer.size()) < local_dofs * local_dofs) {
+                    local_tangent_buffer.resize(local_dofs * local_dofs);
+                }
+                std::fill(local_tangent_buffer.begin(), local_tangent_buffer.begin() + local_dofs * local_dofs, 0.0);
             }
-            for (auto &x : local_residual_buffer) {
-                x = 0;
+            if constexpr (Requirements::residual()) {
+                if (static_cast<int>(local_residual_buffer.size()) < local_dofs) {
+                    local_residual_buffer.resize(local_dofs);
+                }
+                std::fill(local_residual_buffer.begin(), local_residual_buffer.begin() + local_dofs, 0.0);
             }
-            for (auto &x : local_solution_buffer) {
-                x = 0;
+            if (static_cast<int>(local_solution_buffer.size()) < local_dofs) {
+                local_solution_buffer.resize(local_dofs);
             }
 
             Eigen::Map<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>> local_tangent(
@@ -122,67 +456,299 @@ void CGAssembly(FESystem &feSystem,
                                                                                 local_dofs);
 
             //Fill the local solution buffer
-            for(int i=0; i<global_dof_buffer.size(); ++i) {
+            for(int i=0; i<static_cast<int>(global_dof_buffer.size()); ++i) {
                 local_solution(i) = GlobalSolution(global_dof_buffer[i]);
             }
 
             auto nqp = E.nQP();
             for (auto qpi : IRange(0, nqp)) {
                 coordinate<> xqp;
-                for(int A=0; A<E.globalNodes.size(); ++A) {
-                    xqp += dofm.dof_nodes[E.globalNodes[A]]*E.shapeValues[qpi](A);
+                if constexpr (physics_needs_xqp<Physics>::value) {
+                    for(int A=0; A<static_cast<int>(E.globalNodes.size()); ++A) {
+                        xqp += dofm.dof_nodes[E.globalNodes[A]]*E.shapeValues[qpi](A);
+                    }
                 }
 
-                E.update<Physics::nsd()>(elnum, qpi, dofm);
+                E.template update<Physics::nsd()>(elnum, qpi, dofm, geometry);
 
-                if (assemble_tangent) {
-                    Physics::LocalTangent(E, qpi, xqp, time, local_solution, local_tangent);
-                }
-                if (assemble_residual) {
-                    Physics::LocalResidual(E, qpi, xqp, time, local_solution, local_residual);
-                }
+                cg_local_kernels<Physics, Requirements>(E, qpi, xqp, time, local_solution, local_residual,
+                                                        local_tangent);
 
             }//end quadrature point loop
 
 
             //Assemble into global
-            for (auto A : IRange(0, local_dofs)) {
-                auto GA = global_dof_buffer[A];
-                if (assemble_tangent || assemble_dt_mass || assemble_dtdt_mass) {
-                    for (auto B : IRange(0, local_dofs)) {
-                        auto GB = global_dof_buffer[B];
-                        local_triplets.emplace_back(GA, GB, local_tangent(A, B));
-                    }
-                }
-                if (assemble_residual) {
-                    private_residual(GA) += local_residual(A);
-                }
+            if constexpr (Requirements::matrix()) {
+                scatter.tangent(elnum, local_tangent_buffer.data(), local_dofs);
+            }
+            if constexpr (Requirements::residual()) {
+                scatter.residual(elnum, local_residual_buffer.data(), local_dofs, 1,
+                                 [&](int A) { return global_dof_buffer[A]; });
             }
 
         }// end element loop
+    };
 
+    // Worker states, kept until the statistics are collected
+    std::vector<std::unique_ptr<WorkerState>> workers;
+    auto wall_start = clock_type::now();
 
-#pragma omp critical
-        {
-            total_triplets += static_cast<int>(local_triplets.size());
-        }//end critical block
-#pragma omp barrier
-#pragma omp single
-        {
-            tangent_triplets.reserve(total_triplets);
+    if (feSystem.getAssemblyBackend() == AssemblyBackend::TaskScheduler) {
+        // Each color is cut into chunks of whole blocks, claimed in turn by tasks
+        // on the global scheduler and by the calling thread (the last worker
+        // state). The caller works too, so the loop makes progress even while
+        // other tasks keep every scheduler worker busy; a task that only starts
+        // after all chunks are claimed returns without touching the assembly.
+        auto &scheduler = getGlobalScheduler();
+        for (int w = 0; w <= scheduler.count; ++w) {
+            workers.push_back(std::make_unique<WorkerState>(dofm));
         }
-#pragma omp barrier
-#pragma omp critical
+
+        struct ChunkCounter
         {
-            for (auto &trip : local_triplets) {
-                tangent_triplets.push_back(trip);
+            int n_chunks{0};
+            std::atomic<int> next{0};
+            std::atomic<int> done{0};
+        };
+
+        for (auto const &color_list : color_lists) {
+            const int *color_elements = color_list.first;
+            const int color_size = color_list.second;
+
+            int chunk_size = feSystem.getAssemblyChunkSize();
+            if (chunk_size <= 0) {
+                chunk_size = std::max(1, color_size / (8 * (scheduler.count + 1)));
+            }
+            chunk_size = (chunk_size + batch_width - 1) / batch_width * batch_width;
+
+            auto counter = std::make_shared<ChunkCounter>();
+            counter->n_chunks = (color_size + chunk_size - 1) / chunk_size;
+
+            auto assemble_chunk = [&](WorkerState &ws, int chunk) {
+                auto start = clock_type::now();
+                const int last = std::min((chunk + 1) * chunk_size, color_size);
+                for (int b = chunk * chunk_size; b < last; b += batch_width) {
+                    assemble_block(ws, color_elements + b, std::min(batch_width, last - b));
+                }
+                ++ws.chunks;
+                ws.busy_seconds += std::chrono::duration<double>(clock_type::now() - start).count();
+            };
+
+            const int n_tasks = std::min(scheduler.count, counter->n_chunks - 1);
+            for (int t = 0; t < n_tasks; ++t) {
+                auto task = scheduler.createTask([counter, &assemble_chunk, &workers]() {
+                    for (int chunk = counter->next++; chunk < counter->n_chunks; chunk = counter->next++) {
+                        assemble_chunk(*workers[worker_global::worker_id], chunk);
+                        ++counter->done;
+                    }
+                }).first;
+                scheduler.enqueue(task);
             }
 
-            GlobalResidual += private_residual;
+            for (int chunk = counter->next++; chunk < counter->n_chunks; chunk = counter->next++) {
+                assemble_chunk(*workers.back(), chunk);
+                ++counter->done;
+            }
+            while (counter->done < counter->n_chunks) {
+                std::this_thread::yield();
+            }
         }
-    }//end parallel block
 
-    GlobalTangent.setFromTriplets(tangent_triplets.begin(), tangent_triplets.end());
+    } else {
+#pragma omp parallel shared(dofm, color_lists, geometry, workers)
+        {// open parallel block
+#pragma omp single
+            {
+                workers.resize(omp_get_num_threads());
+            }
+            auto &ws_ptr = workers[omp_get_thread_num()];
+            ws_ptr = std::make_unique<WorkerState>(dofm);
+            auto &ws = *ws_ptr;
+
+            for (auto const &color_list : color_lists) {
+                const int *color_elements = color_list.first;
+                const int color_size = color_list.second;
+                const int n_blocks = (color_size + batch_width - 1) / batch_width;
+
+                auto start = clock_type::now();
+#pragma omp for nowait
+                for (int bidx = 0; bidx < n_blocks; ++bidx) {
+                    const int first = bidx * batch_width;
+                    assemble_block(ws, color_elements + first, std::min(batch_width, color_size - first));
+                }
+                ++ws.chunks;
+                ws.busy_seconds += std::chrono::duration<double>(clock_type::now() - start).count();
+#pragma omp barrier
+            }// end color loop
+        }//end parallel block
+    }
+
+    auto &stats = feSystem.getAssemblyStatistics();
+    stats.backend = feSystem.getAssemblyBackend();
+    stats.wall_seconds = std::chrono::duration<double>(clock_type::now() - wall_start).count();
+    stats.elements.clear();
+    stats.chunks.clear();
+    stats.busy_seconds.clear();
+    for (auto const &ws : workers) {
+        stats.elements.push_back(ws->elements);
+        stats.chunks.push_back(ws->chunks);
+        stats.busy_seconds.push_back(ws->busy_seconds);
+    }
+}
+
+/**
+ * Runtime dispatch of cg_assembly over the requirement sets it distinguishes:
+ * Residual, Tangent, and the mass requirements (which only make the global
+ * matrix be assembled), folded into DtMass.
+ */
+template<typename Physics, typename TangentType>
+void cg_assembly(FESystem &feSystem, TangentType &GlobalTangent, const std::vector<AssemblyRequirement> &requirements,
+                 const std::vector<int> *changed_elements)
+{
+    constexpr unsigned residual = requirementBit(AssemblyRequirement::Residual);
+    constexpr unsigned tangent = requirementBit(AssemblyRequirement::Tangent);
+    constexpr unsigned dt_mass = requirementBit(AssemblyRequirement::DtMass);
+
+    unsigned mask = requirementMask(requirements);
+    unsigned reduced = mask & (residual | tangent);
+    if (mask & ~(residual | tangent)) {
+        reduced |= dt_mass;
+    }
+
+    dispatchRequirementSet<residual | tangent | dt_mass>(reduced, [&](auto set) {
+        cg_assembly<Physics, decltype(set)>(feSystem, GlobalTangent, changed_elements);
+    });
+}
+
+}//end namespace detail
+
+
+/**
+ *
+ * \brief General-purpose Continuous-Galerkin finite element assembly
+ *
+ * The global tangent is assembled in place: its structure comes from the
+ * FESystem's cached SparsityPattern, so repeated calls on the same mesh only
+ * zero and refill the value array. The residual is accumulated into.
+ *
+ * With the FESystem's element cache enabled, the local contributions of every
+ * element are recorded for CGAssemblyIncremental.
+ *
+ * Elements are visited color by color (see ElementColoring), which lets each
+ * thread write directly into the global residual and tangent without atomics,
+ * critical sections or per-thread copies of the residual.
+ *
+ * Quadrature-point geometry is read from the FESystem's GeometryCache when enabled.
+ *
+ * Optional Physics members (see PhysicsTraits.hpp):
+ * `LocalResidualAndTangent(E, qpi, xqp, time, local_solution, local_residual, local_tangent)`
+ * is called instead of the two separate kernels when both are required, so that
+ * quantities shared by both (stresses, material state) are evaluated once per
+ * quadrature point; `static constexpr bool needsXqp()` returning false skips
+ * the interpolation of the quadrature point coordinates (xqp is then zero).
+ *
+ * Linear and quadratic elements with TopoDim == NSD are dispatched to
+ * compile-time sized kernels (FixedElement) when the Physics' LocalTangent and
+ * LocalResidual are templates over the element and local matrix/vector types.
+ * Those are called with fixed-size Eigen types, and get compile-time trip counts.
+ * A Physics with more than one dof per node declares it through
+ * `static constexpr int dofPerNode()`; otherwise the fixed kernels are only used
+ * when the DoFManager has one dof per node.
+ *
+ * A Physics may further declare `static constexpr int batchWidth()` (4 or 8)
+ * together with LocalTangentBatch/LocalResidualBatch kernels over an
+ * ElementBatch (and optionally a fused LocalResidualAndTangentBatch). Each
+ * color is then processed in blocks of batchWidth() elements, and a block
+ * whose elements all have one of the fixed types is evaluated with one
+ * element per SIMD lane. Blocks of mixed type fall back to the per-element
+ * kernels.
+ *
+ * The element loop runs on the backend selected on the FESystem
+ * (FESystem::setAssemblyBackend): OpenMP, or chunks of each color taken on
+ * demand by tasks on the global (work-stealing) TaskScheduler and the calling
+ * thread, which balances mixed element types and orders dynamically.
+ * The per-worker load of the loop is left in FESystem::getAssemblyStatistics().
+ *
+ * The requirements are given either at runtime, or at compile time as an
+ * AssemblyRequirementSet, e.g.
+ * `CGAssembly<Physics, AssemblyRequirements<AssemblyRequirement::Residual>>(feSystem)`.
+ * Both end up in a loop specialized for the set, without the branches and
+ * local buffers of the other requirements; the runtime form only selects it.
+ *
+ * @tparam Physics Class that defines the local element matrix/vector construction in static void methods
+ */
+template<typename Physics>
+void CGAssembly(FESystem &feSystem,
+                std::vector<AssemblyRequirement> requirements = {AssemblyRequirement::Residual,
+                                                                 AssemblyRequirement::Tangent})
+{
+    detail::cg_assembly<Physics>(feSystem, feSystem.getGlobalTangent(), requirements, nullptr);
+}
+
+template<typename Physics, typename Requirements>
+void CGAssembly(FESystem &feSystem)
+{
+    detail::cg_assembly<Physics, Requirements>(feSystem, feSystem.getGlobalTangent(), nullptr);
+}
+
+
+/**
+ * \brief CGAssembly with the tangent in a BCSRMatrix
+ *
+ * Same as CGAssembly, except that the tangent is assembled into GlobalTangent,
+ * with the structure of the FESystem's BlockSparsityPattern (B must be the
+ * DoFManager's dof_per_node), instead of into the FESystem's global tangent.
+ * The residual still goes to the FESystem.
+ */
+template<typename Physics, int B>
+void CGAssembly(FESystem &feSystem, BCSRMatrix<B> &GlobalTangent,
+                std::vector<AssemblyRequirement> requirements = {AssemblyRequirement::Residual,
+                                                                 AssemblyRequirement::Tangent})
+{
+    detail::cg_assembly<Physics>(feSystem, GlobalTangent, requirements, nullptr);
+}
+
+template<typename Physics, typename Requirements, int B>
+void CGAssembly(FESystem &feSystem, BCSRMatrix<B> &GlobalTangent)
+{
+    detail::cg_assembly<Physics, Requirements>(feSystem, GlobalTangent, nullptr);
+}
+
+
+/**
+ * \brief Re-assemble only the elements whose local contributions changed
+ *
+ * Updates an already assembled global tangent and residual in place: for each
+ * element in changedElements, the contribution recorded at its last assembly
+ * is subtracted and the new one added (and recorded). The cost is proportional
+ * to the number of changed elements rather than to the mesh size.
+ *
+ * Requires the FESystem element cache (FESystem::enableElementCache) and a
+ * preceding CGAssembly with the same requirements. Elements whose local values
+ * depend on dofs that changed (e.g. through the solution at shared nodes) must
+ * be listed as well. Everything else behaves like CGAssembly.
+ *
+ * The global tangent and residual must be left as assembled: apply boundary
+ * conditions to copies of them. DirichletBC::apply(FESystem &) modifies them in
+ * place, after which CGAssemblyIncremental throws until the next CGAssembly.
+ * (DirichletBC::apply on the FESystem's matrix and vector directly cannot be
+ * detected, and gives a wrong update.)
+ *
+ * @tparam Physics Class that defines the local element matrix/vector construction in static void methods
+ */
+template<typename Physics>
+void CGAssemblyIncremental(FESystem &feSystem,
+                           const std::vector<int> &changedElements,
+                           std::vector<AssemblyRequirement> requirements = {AssemblyRequirement::Residual,
+                                                                            AssemblyRequirement::Tangent})
+{
+    detail::cg_assembly<Physics>(feSystem, feSystem.getGlobalTangent(), requirements, &changedElements);
+}
+
+template<typename Physics, typename Requirements>
+void CGAssemblyIncremental(FESystem &feSystem, const std::vector<int> &changedElements)
+{
+    detail::cg_assembly<Physics, Requirements>(feSystem, feSystem.getGlobalTangent(), &changedElements);
 }
 
 YAFEL_NAMESPACE_CLOSE
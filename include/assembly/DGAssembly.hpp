@@ -8,190 +8,343 @@
 #include "yafel_globals.hpp"
 #include "element/ElementFactory.hpp"
 #include "fe_system/FESystem.hpp"
+#include "fe_system/InverseMassOperator.hpp"
+#include "fe_system/SparsityPattern.hpp"
 #include "assembly/AssemblyRequirement.hpp"
+#include "assembly/PhysicsTraits.hpp"
+#include "utils/DGActiveSet.hpp"
 
 #include <Eigen/Core>
 #include <Eigen/Dense>
+#include <algorithm>
+#include <stdexcept>
 #include <vector>
 
 
 YAFEL_NAMESPACE_OPEN
 
 
+namespace detail {
+
 /**
- * Assembly procedure for Discontinuous Galerkin FEM.
- * The procedure involves looping over mesh faces and
- * computing fluxes between elements.
- *
- * Designed for use with explicit time stepping,
- *
- * @tparam Physics
- * @param feSystem
- * @param requirements
+ * Numerical fluxes of a DG physics on NC-component states. A physics with
+ * Tensor<NC, 1> states (see has_component_flux) is called as is; a scalar
+ * physics, with double states, must have NC = 1.
  */
-template<typename Physics>
-void DGAssembly(FESystem &feSystem,
-                Physics &physics,
-                std::vector<AssemblyRequirement> requirements = {AssemblyRequirement::Residual})
+template<typename Physics, int NSD, int NC>
+struct dg_face_flux
+{
+    static_assert(NC == 1 || (has_component_flux<Physics, NSD, NC>::value
+                              && has_component_boundary_flux<Physics, NSD, NC>::value),
+                  "DGAssembly: a Physics with dofPerNode() > 1 needs Flux and BoundaryFlux on Tensor<NC, 1> states");
+
+    YAFEL_ALWAYS_INLINE static Tensor<NC, 1>
+    interior(const Tensor<NSD, 1> &n, const coordinate<> &x, double t,
+             const Tensor<NC, 1> &Uplus, const Tensor<NC, 1> &Uminus)
+    {
+        if constexpr (has_component_flux<Physics, NSD, NC>::value) {
+            return Physics::Flux(n, x, t, Uplus, Uminus);
+        } else {
+            return Tensor<NC, 1>(Physics::Flux(n, x, t, Uplus(0), Uminus(0)));
+        }
+    }
+
+    YAFEL_ALWAYS_INLINE static Tensor<NC, 1>
+    boundary(const Tensor<NSD, 1> &n, const coordinate<> &x, double t, const Tensor<NC, 1> &U)
+    {
+        if constexpr (has_component_boundary_flux<Physics, NSD, NC>::value) {
+            return Physics::BoundaryFlux(n, x, t, U);
+        } else {
+            return Tensor<NC, 1>(Physics::BoundaryFlux(n, x, t, U(0)));
+        }
+    }
+
+    // Whether the tangent of the face fluxes can be assembled (see has_component_flux_jacobian)
+    static constexpr bool has_jacobian = has_component_flux_jacobian<Physics, NSD, NC>::value
+                                         || (NC == 1 && has_scalar_flux_jacobian<Physics, NSD>::value);
+
+    YAFEL_ALWAYS_INLINE static void
+    interiorJacobian(const Tensor<NSD, 1> &n, const coordinate<> &x, double t,
+                     const Tensor<NC, 1> &Uplus, const Tensor<NC, 1> &Uminus,
+                     Tensor<NC, 2> &dF_dUplus, Tensor<NC, 2> &dF_dUminus)
+    {
+        if constexpr (has_component_flux_jacobian<Physics, NSD, NC>::value) {
+            Physics::FluxJacobian(n, x, t, Uplus, Uminus, dF_dUplus, dF_dUminus);
+        } else if constexpr (has_jacobian) {
+            Physics::FluxJacobian(n, x, t, Uplus(0), Uminus(0), dF_dUplus(0, 0), dF_dUminus(0, 0));
+        }
+    }
+
+    YAFEL_ALWAYS_INLINE static void
+    boundaryJacobian(const Tensor<NSD, 1> &n, const coordinate<> &x, double t, const Tensor<NC, 1> &U,
+                     Tensor<NC, 2> &dF_dU)
+    {
+        if constexpr (has_component_flux_jacobian<Physics, NSD, NC>::value) {
+            Physics::BoundaryFluxJacobian(n, x, t, U, dF_dU);
+        } else if constexpr (has_jacobian) {
+            Physics::BoundaryFluxJacobian(n, x, t, U(0), dF_dU(0, 0));
+        }
+    }
+};
+
+/**
+ * Body of DGAssembly for one AssemblyRequirementSet, on every element or,
+ * if `active` is given, on its elements only
+ */
+template<typename Physics, typename Requirements>
+void dg_assembly(FESystem &feSystem, Physics &physics, const DGActiveSet *active = nullptr)
 {
 
     constexpr int simulation_dimension = Physics::nsd();
+    constexpr int NC = physics_dof_per_node<Physics>::value;
+    using FaceFlux = dg_face_flux<Physics, simulation_dimension, NC>;
+
+    // Face states, fluxes and residuals: one row per node or quadrature point, one column per component
+    using ComponentRows = Eigen::Matrix<double, Eigen::Dynamic, NC, NC == 1 ? Eigen::ColMajor : Eigen::RowMajor>;
 
     //Unpack the FESystem
     auto &GlobalResidual = feSystem.getGlobalResidual();
     auto &GlobalSolution = feSystem.getSolution();
-    GlobalResidual *= 0;
+    if (!active) {
+        GlobalResidual *= 0;
+    }
     auto &dofm = feSystem.getDoFManager();
     auto dof_per_node = dofm.dof_per_node;
+    if (dof_per_node != NC) {
+        throw std::runtime_error("DGAssembly: DoFManager dof_per_node does not match Physics::dofPerNode()");
+    }
     double time = feSystem.currentTime();
 
-    bool assemble_tangent{false};
-    bool assemble_residual{false};
-    bool assemble_dt_mass{false};
-    bool assemble_dtdt_mass{false};
-    for (auto req : requirements) {
-        switch (req) {
-            case AssemblyRequirement::Residual:
-                assemble_residual = true;
-                break;
-            case AssemblyRequirement::Tangent:
-                assemble_tangent = true;
-                break;
-            case AssemblyRequirement::DtMass: [[fallthrough]];
-            case AssemblyRequirement::LumpedDtMassInverse:
-                assemble_dt_mass = true;
-                break;
-            case AssemblyRequirement::DtDtMass:
-                assemble_dtdt_mass = true;
-                break;
+    // Precomputed jxw and shape gradients for the element loop (nullptr if disabled)
+    auto const *geometry = feSystem.getGeometryCache(simulation_dimension);
+
+    // The tangent dR/dU goes into the block-sparse structure of the FESystem's
+    // sparsity pattern: element blocks from LocalTangent and the face fluxes,
+    // neighbor blocks from the face fluxes only
+    using LocalVectorMap = Eigen::Map<Eigen::Matrix<double, Eigen::Dynamic, 1>>;
+    using LocalMatrixMap = Eigen::Map<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>>;
+    constexpr bool has_tangent = FaceFlux::has_jacobian
+                                 && has_local_tangent<Physics, Element, LocalVectorMap, LocalMatrixMap>::value;
+    auto &GlobalTangent = feSystem.getGlobalTangent();
+    SparsityPattern const *pattern{nullptr};
+    if constexpr (Requirements::tangent()) {
+        if (!has_tangent) {
+            throw std::runtime_error("DGAssembly: the Tangent requires Physics::LocalTangent, FluxJacobian "
+                                     "and BoundaryFluxJacobian");
+        }
+        if (active) {
+            throw std::runtime_error("DGAssembly: the Tangent is only assembled on all elements");
+        }
+        pattern = &feSystem.getSparsityPattern(simulation_dimension);
+        for (auto f : IRange(0, static_cast<int>(dofm.interior_faces.size()))) {
+            if (pattern->nFacePositions(f) == 0) {
+                throw std::runtime_error("DGAssembly: the Tangent requires all faces between elements "
+                                         "of the simulation dimension");
+            }
+        }
+        if (pattern->matches(GlobalTangent)) {
+            std::fill(GlobalTangent.valuePtr(), GlobalTangent.valuePtr() + GlobalTangent.nonZeros(), 0.0);
+        } else {
+            pattern->initializeMatrix(GlobalTangent);
         }
     }
+    double *tangent_values = Requirements::tangent() ? GlobalTangent.valuePtr() : nullptr;
 
-    if (physics.mass_constructed)
-        assemble_dt_mass = false;
-    else if (assemble_dt_mass && !physics.mass_constructed) {
-        physics.inverse_mass_matrices.resize(dofm.nCells());
-        physics.mass_constructed = true;
+    // The inverse mass is only built once, on the first call that requires it
+    if constexpr (Requirements::dtMass()) {
+        if (!physics.inverse_mass.isBuilt()) {
+            physics.inverse_mass.template build<Physics>(dofm, time, geometry);
+        }
     }
 
+    // Faces of one color share no element, so within a color every face can
+    // write its fluxes straight into the global residual, whichever thread it
+    // runs on. Each element then gets its face fluxes in color order, and the
+    // residual is the same for any number of threads.
+    auto const &face_coloring = dofm.getFaceColoring();
+
+    // Normals, jacobians, points and traces of every face quadrature point
+    auto const &face_geometry = feSystem.getFaceGeometryCache(simulation_dimension);
 
-//#pragma omp parallel shared(GlobalResidual, tangent_triplets, dofm)
+    const int nColors = active ? active->nColors() : face_coloring.nColors();
+    const int nElements = active ? active->nElements() : dofm.nCells();
+
+#pragma omp parallel shared(GlobalResidual, GlobalSolution, dofm, face_coloring, face_geometry, geometry, physics, pattern)
     {
         //Define thread-local variables
 
         //storage buffers
         std::vector<double> local_tangent_buffer;
-        std::vector<double> local_dtmass_buffer;
         std::vector<double> local_residual_buffer;
         std::vector<double> local_solution_buffer;
         std::vector<int> global_dof_buffer_l;
-        std::vector<int> global_dof_buffer_r;
-        std::vector<int> left_local_nodes;
-        std::vector<int> right_local_nodes;
-        std::vector<int> face_nodes;
-        std::vector<Eigen::Triplet<double>> local_triplets;
-        Eigen::VectorXd private_residual = Eigen::VectorXd::Constant(GlobalResidual.rows(), 0.0);
-
-        // Need two different element factories because
-        // only a single Element of a given type is instantiated
-        // in either one. In order to do element boundary flux
-        // calculations, you need two separate elements simultaneously.
-        ElementFactory EF_L(dofm.dof_per_node);
-        ElementFactory EF_R(dofm.dof_per_node);
-
-
-        // Boundary Fluxes
-//#pragma omp single
-        {
-            for (int fi = 0; fi < dofm.interior_faces.size(); ++fi) {
-                auto &F = dofm.interior_faces[fi];
-                if (F.left < 0 || F.right < 0) {
-                    int el{-1};
-                    if (F.left >= 0) {
-                        el = F.left;
-                        dofm.getLeftFaceNodes(fi,face_nodes);
-                    } else {
-                        el = F.right;
-                        dofm.getRightFaceNodes(fi,face_nodes);
-                    }
-
-                    auto &E = EF_L.getElement(dofm.element_types[el]);
-                    dofm.getGlobalDofs(el, global_dof_buffer_l);
-
-                    for (int fqpi = 0; fqpi < E.nFQP(); ++fqpi) {
-                        auto nl = E.face_update<Physics::nsd()>(el, fqpi, face_nodes, dofm);
-                        coordinate<> xqp;
-                        double U{0};
-                        for (int i = 0; i < face_nodes.size(); ++i) {
-                            xqp += dofm.dof_nodes[global_dof_buffer_l[face_nodes[i]]] * E.boundaryShapeValues[fqpi](i);
-                            U += GlobalSolution(global_dof_buffer_l[face_nodes[i]]) * E.boundaryShapeValues[fqpi](i);
-                        }
-
-                        double fluxVal = Physics::BoundaryFlux(nl, xqp, time, U);
-
-                        for (int A = 0; A < face_nodes.size(); ++A) {
-                            double val = E.boundaryShapeValues[fqpi](A) * fluxVal * E.jxw;
-                            GlobalResidual(global_dof_buffer_l[face_nodes[A]]) -= val;
-                        }
+        ComponentRows trace_left, trace_right, state_left, state_right;
+        ComponentRows face_flux, weighted_flux, face_residual;
+        std::vector<Tensor<NC, 2>> jacobian_left, jacobian_right;
+
+        ElementFactory EF_L(dofm);
+
+        // Only the active and register dofs are reset: the others keep whatever they hold
+        if (active) {
+            auto const &active_dofs = active->dofs();
+            auto const &register_dofs = active->registerDofs();
+#pragma omp for
+            for (std::size_t i = 0; i < active_dofs.size(); ++i) {
+                GlobalResidual(active_dofs[i]) = 0;
+            }
+#pragma omp for
+            for (std::size_t i = 0; i < register_dofs.size(); ++i) {
+                GlobalResidual(register_dofs[i]) = 0;
+            }
+        }
 
+        // Boundary and interior face fluxes, color by color. Per face, the nodal
+        // states of each side are gathered component-contiguous, interpolated to
+        // every face quadrature point at once, and the numerical fluxes of all
+        // points are evaluated back to back before being scattered to the nodes.
+        for (int color = 0; color < nColors; ++color) {
+            const int nColorFaces = active ? active->nFaces(color) : face_coloring.nFaces(color);
+            const int *color_faces = active ? active->faces(color) : face_coloring.faces(color);
+#pragma omp for
+            for (int cidx = 0; cidx < nColorFaces; ++cidx) {
+                int fi = color_faces[cidx];
+                // Sides whose residual is written (bit 0 left, bit 1 right)
+                const unsigned char sides = active ? active->faceSides(color)[cidx] : 3;
+                const bool boundary = face_geometry.isBoundary(fi);
+                const bool collocated = face_geometry.isCollocated(fi);
+                const int n_trace = face_geometry.nTraceNodes(fi);
+                const int nfqp = face_geometry.nFaceQP(fi);
+                const int *left_trace = face_geometry.leftTrace(fi);
+                const int *right_trace = face_geometry.rightTrace(fi);
+
+                trace_left.resize(n_trace, NC);
+                trace_right.resize(n_trace, NC);
+                face_flux.resize(nfqp, NC);
+                for (int i = 0; i < n_trace; ++i) {
+                    trace_left.row(i) = GlobalSolution.template segment<NC>(left_trace[i] * NC).transpose();
+                }
+                if (!boundary) {
+                    for (int i = 0; i < n_trace; ++i) {
+                        trace_right.row(i) = GlobalSolution.template segment<NC>(right_trace[i] * NC).transpose();
                     }
+                }
 
+                // Face quadrature point q is trace node q on collocated faces: no interpolation
+                Eigen::Map<const Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>> shape(
+                        face_geometry.shapeValues(fi, 0), nfqp, n_trace);
+                if (collocated) {
+                    state_left = trace_left;
+                    state_right = trace_right;
                 } else {
+                    state_left.noalias() = shape * trace_left;
+                    if (!boundary) {
+                        state_right.noalias() = shape * trace_right;
+                    }
+                }
 
-                    int e_left = F.left;
-                    int e_right = F.right;
-
-                    dofm.getGlobalDofs(e_left, global_dof_buffer_l);
-                    dofm.getGlobalDofs(e_right, global_dof_buffer_r);
-
-                    auto &EL = EF_L.getElement(dofm.element_types[e_left]);
-                    auto &ER = EF_R.getElement(dofm.element_types[e_right]);
-
-
-                    dofm.getLeftFaceNodes(fi,left_local_nodes);
-                    dofm.getRightFaceNodes(fi,right_local_nodes);
-
-                    Eigen::VectorXd R_l = Eigen::VectorXd::Constant(left_local_nodes.size(), 0.0);
-                    Eigen::VectorXd R_r = Eigen::VectorXd::Constant(right_local_nodes.size(), 0.0);
-
-                    for (int fqpi = 0; fqpi < EL.nFQP(); ++fqpi) {
-                        auto nl = EL.face_update<Physics::nsd()>(e_left, fqpi, left_local_nodes, dofm);
-                        auto nr = ER.face_update<Physics::nsd()>(e_right, fqpi, right_local_nodes, dofm);
-
-                        coordinate<> xqp{0, 0, 0};
-                        double Uleft{0};
-                        double Uright{0};
-
-                        for (int i = 0; i < left_local_nodes.size(); ++i) {
-                            double shapeVal = EL.boundaryShapeValues[fqpi](i);
-                            xqp += dofm.dof_nodes[global_dof_buffer_l[left_local_nodes[i]]] * shapeVal;//EL.boundaryShapeValues[fqpi](i);
-                            Uleft += GlobalSolution(global_dof_buffer_l[left_local_nodes[i]]) * shapeVal;
-                            Uright += GlobalSolution(global_dof_buffer_r[right_local_nodes[i]]) * shapeVal;
+                for (int q = 0; q < nfqp; ++q) {
+                    auto nl = face_geometry.template normal<simulation_dimension>(fi, q);
+                    auto const &xqp = face_geometry.xqp(fi, q);
+                    Tensor<NC, 1> Ul, Ur, F;
+                    for (int c = 0; c < NC; ++c) {
+                        Ul(c) = state_left(q, c);
+                    }
+                    if (boundary) {
+                        F = FaceFlux::boundary(nl, xqp, time, Ul);
+                    } else {
+                        for (int c = 0; c < NC; ++c) {
+                            Ur(c) = state_right(q, c);
                         }
-
-                        double fluxVal = Physics::Flux(nl, xqp, time, Uleft, Uright);
-
-                        for (int i = 0; i < left_local_nodes.size(); ++i) {
-                            int li = left_local_nodes[i];
-                            int gli = global_dof_buffer_l[li];
-                            int ri = right_local_nodes[i];
-                            int gri = global_dof_buffer_r[ri];
-
-                            auto shapeVal = EL.boundaryShapeValues[fqpi](i);
-                            GlobalResidual(gli) -= shapeVal * fluxVal * EL.jxw;
-                            GlobalResidual(gri) += shapeVal * fluxVal * ER.jxw;
+                        F = FaceFlux::interior(nl, xqp, time, Ul, Ur);
+                    }
+                    if constexpr (Requirements::tangent() && has_tangent) {
+                        jacobian_left.resize(nfqp);
+                        jacobian_right.resize(nfqp);
+                        if (boundary) {
+                            FaceFlux::boundaryJacobian(nl, xqp, time, Ul, jacobian_left[q]);
+                        } else {
+                            FaceFlux::interiorJacobian(nl, xqp, time, Ul, Ur, jacobian_left[q], jacobian_right[q]);
                         }
                     }
+                    for (int c = 0; c < NC; ++c) {
+                        face_flux(q, c) = F(c);
+                    }
+                }
 
+                // Outflow of the left side, inflow of the right side, weighted by each side's jacobian
+                auto scatter = [&](const int *trace, double sign, auto jxw) {
+                    weighted_flux.resize(nfqp, NC);
+                    for (int q = 0; q < nfqp; ++q) {
+                        weighted_flux.row(q) = (sign * jxw(q)) * face_flux.row(q);
+                    }
+                    if (collocated) {
+                        face_residual = weighted_flux;
+                    } else {
+                        face_residual.noalias() = shape.transpose() * weighted_flux;
+                    }
+                    for (int i = 0; i < n_trace; ++i) {
+                        GlobalResidual.template segment<NC>(trace[i] * NC) += face_residual.row(i).transpose();
+                    }
+                };
+                if (boundary || (sides & 1)) {
+                    scatter(left_trace, -1.0, [&](int q) { return face_geometry.jxwLeft(fi, q); });
+                }
+                if (!boundary && (sides & 2)) {
+                    scatter(right_trace, 1.0, [&](int q) { return face_geometry.jxwRight(fi, q); });
+                }
 
+                // Derivatives of the face residuals of each side (rows) with respect to the
+                // trace states of each side (columns), scattered through the face position
+                // map of the pattern. Faces of a color share no element, so their rows are
+                // disjoint.
+                if constexpr (Requirements::tangent() && has_tangent) {
+                    const int n_face_dofs = n_trace * NC;
+                    auto scatter_tangent = [&](int face_block, double sign, auto jxw,
+                                               const std::vector<Tensor<NC, 2>> &jacobian) {
+                        const int *positions = pattern->facePositions(fi) + face_block * n_face_dofs * n_face_dofs;
+                        auto add_block = [&](int i, int j, const Tensor<NC, 2> &block) {
+                            for (int c = 0; c < NC; ++c) {
+                                for (int d = 0; d < NC; ++d) {
+                                    tangent_values[positions[(i * NC + c) * n_face_dofs + j * NC + d]]
+                                            += sign * block(c, d);
+                                }
+                            }
+                        };
+                        if (collocated) {
+                            // Face quadrature point q is trace node q: only the blocks i = j = q
+                            for (int q = 0; q < nfqp; ++q) {
+                                add_block(q, q, jxw(q) * jacobian[q]);
+                            }
+                        } else {
+                            for (int i = 0; i < n_trace; ++i) {
+                                for (int j = 0; j < n_trace; ++j) {
+                                    Tensor<NC, 2> block;
+                                    for (int q = 0; q < nfqp; ++q) {
+                                        block += (jxw(q) * shape(q, i) * shape(q, j)) * jacobian[q];
+                                    }
+                                    add_block(i, j, block);
+                                }
+                            }
+                        }
+                    };
+                    // Face blocks (left, left), (left, right), (right, left), (right, right)
+                    auto jxw_left = [&](int q) { return face_geometry.jxwLeft(fi, q); };
+                    scatter_tangent(0, -1.0, jxw_left, jacobian_left);
+                    if (!boundary) {
+                        auto jxw_right = [&](int q) { return face_geometry.jxwRight(fi, q); };
+                        scatter_tangent(1, -1.0, jxw_left, jacobian_right);
+                        scatter_tangent(2, 1.0, jxw_right, jacobian_left);
+                        scatter_tangent(3, 1.0, jxw_right, jacobian_right);
+                    }
                 }
             }
         }
 
 
-        // Element-level fluxes
-//#pragma omp for
-        for (int elnum = 0; elnum < dofm.nCells(); ++elnum) {
+        // Element-level fluxes (after the implicit barrier of the last face color)
+#pragma omp for
+        for (int el = 0; el < nElements; ++el) {
+            const int elnum = active ? active->elements()[el] : el;
 
             auto et = dofm.element_types[elnum];
             if (et.topoDim != simulation_dimension) {
@@ -200,42 +353,24 @@ void DGAssembly(FESystem &feSystem,
             auto &E = EF_L.getElement(et);
             dofm.getGlobalDofs(elnum, global_dof_buffer_l);
 
+            // The local solution and residual are entirely overwritten below;
+            // only the tangent buffer needs zeroing, if required
             auto local_dofs = E.localMesh.nNodes() * dof_per_node;
-            if (assemble_tangent && static_cast<int>(local_tangent_buffer.size()) < local_dofs * local_dofs) {
-                local_tangent_buffer.resize(local_dofs * local_dofs, 0.0);
-            }
-            if (assemble_dt_mass && static_cast<int>(local_dtmass_buffer.size()) < local_dofs * local_dofs) {
-                local_dtmass_buffer.resize(local_dofs * local_dofs, 0.0);
+            if constexpr (Requirements::tangent()) {
+                if (static_cast<int>(local_tangent_buffer.size()) < local_dofs * local_dofs) {
+                    local_tangent_buffer.resize(local_dofs * local_dofs);
+                }
+                std::fill(local_tangent_buffer.begin(), local_tangent_buffer.begin() + local_dofs * local_dofs, 0.0);
             }
-            if (assemble_residual && static_cast<int>(local_residual_buffer.size()) < local_dofs) {
-                local_residual_buffer.resize(local_dofs, 0.0);
+            if (static_cast<int>(local_residual_buffer.size()) < local_dofs) {
+                local_residual_buffer.resize(local_dofs);
             }
             if (static_cast<int>(local_solution_buffer.size()) < local_dofs) {
-                local_solution_buffer.resize(local_dofs, 0.0);
-            }
-
-            for (auto &x : local_tangent_buffer) {
-                x = 0;
-            }
-            for (auto &x : local_dtmass_buffer) {
-                x = 0;
-            }
-            for (auto &x : local_residual_buffer) {
-                x = 0;
-            }
-            for (auto &x : local_solution_buffer) {
-                x = 0;
+                local_solution_buffer.resize(local_dofs);
             }
 
             Eigen::Map<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>> local_tangent(
                     local_tangent_buffer.data(), local_dofs, local_dofs);
-            //Eigen::Map<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>> local_dt_mass(
-            //local_dtmass_buffer.data(), local_dofs, local_dofs);
-
-            Eigen::MatrixXd local_dt_mass;
-            if(assemble_dt_mass) {
-                local_dt_mass = Eigen::MatrixXd::Constant(local_dofs, local_dofs, 0.0);
-            }
 
             Eigen::Map<Eigen::Matrix<double, Eigen::Dynamic, 1>> local_residual(local_residual_buffer.data(),
                                                                                 local_dofs);
@@ -253,45 +388,33 @@ void DGAssembly(FESystem &feSystem,
             for (int qpi = 0; qpi < nqp; ++qpi) {
 
                 coordinate<> xqp;
-                for(int A=0; A<global_dof_buffer_l.size(); ++A) {
-                    xqp += dofm.dof_nodes[global_dof_buffer_l[A]]*E.shapeValues[qpi](A);
+                for (int A = 0; A < E.localMesh.nNodes(); ++A) {
+                    xqp += dofm.dof_nodes[global_dof_buffer_l[A * dof_per_node] / dof_per_node]
+                           * E.shapeValues[qpi](A);
                 }
 
-                E.update<Physics::nsd()>(elnum, qpi, dofm);
+                E.update<Physics::nsd()>(elnum, qpi, dofm, geometry);
 
-                if (assemble_tangent) {
-                    //Physics::LocalTangent(E, qpi, time, local_tangent);
+                if constexpr (Requirements::tangent() && has_tangent) {
+                    Physics::LocalTangent(E, qpi, xqp, time, local_solution, local_tangent);
                 }
-                if (assemble_residual) {
+                if constexpr (Requirements::residual()) {
                     Physics::LocalResidual(E, qpi, xqp, time, local_solution, local_residual);
                 }
-                if (assemble_dt_mass) {
-                    Physics::LocalMass(E, qpi, time, local_dt_mass);
-                }
             }
 
-            if(assemble_dt_mass){
-                Eigen::PartialPivLU<Eigen::MatrixXd> MLU(local_dt_mass);
-                //physics.inverse_mass_matrices.push_back(MLU);
-                physics.inverse_mass_matrices[elnum] = MLU;
+            //Assemble into global (the element block already holds the face terms)
+            if constexpr (Requirements::tangent()) {
+                const int *positions = pattern->elementPositions(elnum);
+                for (auto A : IRange(0, local_dofs * local_dofs)) {
+                    tangent_values[positions[A]] += local_tangent_buffer[A];
+                }
             }
-
-
-            //Invert local mass matrix and solve the local_residual
-            auto &MLU = physics.inverse_mass_matrices[elnum];
-            local_residual = MLU.solve(local_residual);
-
-            //Assemble into global
             for (auto A : IRange(0, local_dofs)) {
                 auto GA = global_dof_buffer_l[A];
-                if (assemble_tangent) {
-                    for (auto B : IRange(0, local_dofs)) {
-                        auto GB = global_dof_buffer_l[B];
-                        local_triplets.emplace_back(GA, GB, local_tangent(A, B));
-                    }
-                }
-                if (assemble_residual) {
-                    GlobalResidual(GA) += local_residual(A);
+                if constexpr (Requirements::residual()) {
+                    // local_residual started from the face fluxes of the element
+                    GlobalResidual(GA) = local_residual(A);
                 }
             }
 
@@ -301,7 +424,92 @@ void DGAssembly(FESystem &feSystem,
 
     } // end parallel block
 
+    // Time derivative of the solution: blockdiag(M)^{-1} (face fluxes + volume terms)
+    if constexpr (Requirements::dtMass() && Requirements::residual()) {
+        if (active) {
+            physics.inverse_mass.apply(GlobalResidual, active->elements());
+        } else {
+            physics.inverse_mass.apply(GlobalResidual);
+        }
+    }
+
+}
+
+}//end namespace detail
+
 
+/**
+ * Assembly procedure for Discontinuous Galerkin FEM.
+ * The procedure involves looping over mesh faces and
+ * computing fluxes between elements.
+ *
+ * Designed for use with explicit time stepping. With the Tangent required,
+ * dR/dU is also assembled into feSystem.getGlobalTangent(), in the block
+ * structure of feSystem.getSparsityPattern() (element blocks and face-neighbor
+ * blocks), for implicit and IMEX integrators (IMEXRK). The Physics then needs
+ * LocalTangent(E, qpi, x, t, U_el, K_el), with K_el = dR_el/dU_el, and the
+ * derivatives of its fluxes, FluxJacobian(n, x, t, Uplus, Uminus, dF_dUplus,
+ * dF_dUminus) and BoundaryFluxJacobian(n, x, t, U, dF_dU), into doubles or
+ * Tensor<dofPerNode(), 2> (see has_component_flux_jacobian). The tangent is
+ * never multiplied by the inverse mass.
+ *
+ * Systems of conservation laws declare their number of components with
+ * `static constexpr int dofPerNode()`, matching the DoFManager's dof_per_node.
+ * Their Flux(n, x, t, Uplus, Uminus) and BoundaryFlux(n, x, t, U) take and
+ * return Tensor<dofPerNode(), 1> states; scalar physics keep double states.
+ * Element dofs, and so the local vectors of LocalResidual and LocalMass, are
+ * node by node with the components of a node contiguous.
+ *
+ * With DtMass (or LumpedDtMassInverse) required, the residual is
+ * multiplied by the inverse of the block-diagonal mass matrix, held by
+ * the physics as an InverseMassOperator `inverse_mass` and built on the
+ * first such call. Without it, the residual is left un-inverted.
+ *
+ * The runtime requirements select a loop specialized for the
+ * AssemblyRequirementSet they form (Residual, Tangent and DtMass are
+ * distinguished); DGAssembly<Physics, Requirements>(feSystem, physics)
+ * calls it directly.
+ *
+ * @tparam Physics
+ * @param feSystem
+ * @param requirements
+ */
+template<typename Physics>
+void DGAssembly(FESystem &feSystem,
+                Physics &physics,
+                std::vector<AssemblyRequirement> requirements = {AssemblyRequirement::Residual})
+{
+    constexpr unsigned residual = requirementBit(AssemblyRequirement::Residual);
+    constexpr unsigned tangent = requirementBit(AssemblyRequirement::Tangent);
+    constexpr unsigned dt_mass = requirementBit(AssemblyRequirement::DtMass);
+
+    unsigned mask = requirementMask(requirements);
+    unsigned reduced = mask & (residual | tangent);
+    if (mask & (dt_mass | requirementBit(AssemblyRequirement::LumpedDtMassInverse))) {
+        reduced |= dt_mass;
+    }
+
+    dispatchRequirementSet<residual | tangent | dt_mass>(reduced, [&](auto set) {
+        detail::dg_assembly<Physics, decltype(set)>(feSystem, physics);
+    });
+}
+
+template<typename Physics, typename Requirements>
+void DGAssembly(FESystem &feSystem, Physics &physics)
+{
+    detail::dg_assembly<Physics, Requirements>(feSystem, physics);
+}
+
+/**
+ * DGAssembly restricted to the elements of a DGActiveSet: only their dofs of the
+ * global residual are computed, and the face fluxes of its register dofs. Fluxes
+ * across the boundary of the set use the current solution outside it, so the
+ * caller provides consistent neighbor states (see LocalTimeStepping).
+ */
+template<typename Physics, typename Requirements>
+void DGAssembly(FESystem &feSystem, Physics &physics, const DGActiveSet &active)
+{
+    detail::dg_assembly<Physics, Requirements>(feSystem, physics, &active);
 }
 
 
@@ -8,21 +8,175 @@
 #include "yafel_globals.hpp"
 #include "element/ElementFactory.hpp"
 #include "fe_system/FESystem.hpp"
+#include "fe_system/HDGSystem.hpp"
+#include "assembly/PhysicsTraits.hpp"
 
 #include <Eigen/Core>
 #include <Eigen/Dense>
+#include <stdexcept>
+#include <type_traits>
 #include <vector>
 
 YAFEL_NAMESPACE_OPEN
 
+/**
+ * Assembly procedure for Hybridizable Discontinuous Galerkin FEM, with static
+ * condensation of the element-interior unknowns onto the face traces.
+ *
+ * For every element, the physics builds the local system
+ *   [A  B] [U_e     ]   [F]
+ *   [C  D] [lambda_e] = [0]
+ * where U_e are the element's interior unknowns (the volume DoFManager's dofs,
+ * dof_per_node per node) and lambda_e the trace unknowns of its faces, and C, D
+ * are its contributions to the conservation equations of the traces. Elements
+ * are processed in parallel: each LU-factorizes its A, solves for A^{-1}[B F] in
+ * one multi-right-hand-side solve (kept in the HDGSystem for recover()), and
+ * forms its Schur complement D - C A^{-1}B and right-hand side -C A^{-1}F. These
+ * are then summed into the skeleton system, which only couples the trace dofs of
+ * interior faces. Boundary traces are prescribed by the physics.
+ *
+ * The Physics provides
+ * - nsd(), dofPerNode() (interior unknowns per node) and optionally traceDofPerNode() (default 1)
+ * - LocalVolume(E, qpi, x, t, A, F): volume integrals of A and F
+ * - LocalFace(E, fqpi, face_nodes, n, x, t, A, B, C, D): integrals over one face of
+ *   the element, after E.face_update. face_nodes are the element's local nodes on the
+ *   face, in trace order, so that E.boundaryShapeValues[fqpi](i) is the value of both
+ *   the face's trace basis function i and the volume basis function face_nodes[i]. n
+ *   is the unit normal pointing out of the element. B, C and D are the blocks of the
+ *   face's trace unknowns only, numbered i * traceDofPerNode() + component.
+ * - BoundaryTrace(x, t): the trace on boundary faces (a double, or a
+ *   Tensor<traceDofPerNode(), 1>), interpolated at the face nodes
+ *
+ * Solve the skeleton system hdg.getGlobalTangent() x = hdg.getGlobalResidual(),
+ * then call hdg.recover(x) for the interior unknowns.
+ */
 template<typename Physics>
-void HDGAssembly(FESystem &feSystem,
-                 Physics &physics)
+void HDGAssembly(HDGSystem &hdg, Physics &)
 {
+    constexpr int NSD = Physics::nsd();
+    constexpr int trace_dpn = detail::physics_trace_dof_per_node<Physics>::value;
 
+    auto &feSystem = hdg.getVolumeSystem();
+    auto &dofm = feSystem.getDoFManager();
+    const int dof_per_node = dofm.dof_per_node;
+    const double time = feSystem.currentTime();
+    if (hdg.nsdim() != NSD || hdg.traceDofPerNode() != trace_dpn
+        || dof_per_node != detail::physics_dof_per_node<Physics>::value) {
+        throw std::runtime_error("HDGAssembly: HDGSystem layout does not match the Physics");
+    }
+    auto const *geometry = feSystem.getGeometryCache(NSD);
 
+    // Prescribed traces of the boundary faces, at the face nodes
+    const int nFaces = static_cast<int>(dofm.interior_faces.size());
+    auto &trace_solution = hdg.getTraceSolution();
+#pragma omp parallel
+    {
+        std::vector<int> nodes;
+#pragma omp for
+        for (int f = 0; f < nFaces; ++f) {
+            if (!hdg.isBoundaryFace(f)) {
+                continue;
+            }
+            auto const &F = dofm.interior_faces[f];
+            const int e = F.left >= 0 ? F.left : F.right;
+            if (!hdg.isCondensed(e)) {
+                continue;
+            }
+            int i{0};
+            while (hdg.elementFace(e, i) != f) {
+                ++i;
+            }
+            dofm.getGlobalNodes(e, nodes);
+            const int *face_nodes = hdg.elementFaceNodes(e, i);
+            for (int a = 0; a < hdg.nFaceNodes(f); ++a) {
+                auto g = Physics::BoundaryTrace(dofm.dof_nodes[nodes[face_nodes[a]]], time);
+                for (int c = 0; c < trace_dpn; ++c) {
+                    if constexpr (std::is_arithmetic<decltype(g)>::value) {
+                        trace_solution(hdg.faceDofOffset(f) + a * trace_dpn + c) = g;
+                    } else {
+                        trace_solution(hdg.faceDofOffset(f) + a * trace_dpn + c) = g(c);
+                    }
+                }
+            }
+        }
+    }
 
+    // Local systems and their condensation, element by element
+#pragma omp parallel
+    {
+        ElementFactory EF(dofm);
+        std::vector<int> nodes;
+        std::vector<int> face_nodes;
+        Eigen::MatrixXd A, BF, C, D;
+        Eigen::PartialPivLU<Eigen::MatrixXd> lu;
 
+#pragma omp for schedule(dynamic, 16)
+        for (int e = 0; e < dofm.nCells(); ++e) {
+            if (!hdg.isCondensed(e)) {
+                continue;
+            }
+            auto &E = EF.getElement(dofm.element_types[e]);
+            dofm.getGlobalNodes(e, nodes);
+            const int n_nodes = static_cast<int>(nodes.size());
+            const int n_interior = n_nodes * dof_per_node;
+            const int n_trace = hdg.nElementTraceDofs(e);
+
+            // B and F side by side, for a single solve
+            A.setZero(n_interior, n_interior);
+            BF.setZero(n_interior, n_trace + 1);
+            C.setZero(n_trace, n_interior);
+            D.setZero(n_trace, n_trace);
+            auto B = BF.leftCols(n_trace);
+            auto Fe = BF.col(n_trace);
+
+            for (int qpi = 0; qpi < E.nQP(); ++qpi) {
+                E.update<NSD>(e, qpi, dofm, geometry);
+                coordinate<> x;
+                for (int A_ = 0; A_ < n_nodes; ++A_) {
+                    x += dofm.dof_nodes[nodes[A_]] * E.shapeValues[qpi](A_);
+                }
+                Physics::LocalVolume(E, qpi, x, time, A, Fe);
+            }
+
+            for (int i = 0; i < hdg.nElementFaces(e); ++i) {
+                const int f = hdg.elementFace(e, i);
+                const int nf = hdg.nFaceNodes(f);
+                const int *fn = hdg.elementFaceNodes(e, i);
+                face_nodes.assign(fn, fn + nf);
+                const int offset = hdg.elementFaceDofOffset(e, i);
+
+                // The trace order is that of the face's left element (the only one of a
+                // boundary face), for which face_update gives the outward normal; the
+                // right element gets it reversed
+                auto const &F = dofm.interior_faces[f];
+                const double orientation = (F.left >= 0 && F.left != e) ? -1.0 : 1.0;
+                auto Bf = B.middleCols(offset, nf * trace_dpn);
+                auto Cf = C.middleRows(offset, nf * trace_dpn);
+                auto Df = D.block(offset, offset, nf * trace_dpn, nf * trace_dpn);
+
+                for (int fqpi = 0; fqpi < E.nFQP(); ++fqpi) {
+                    Tensor<NSD, 1> n = orientation * E.face_update<NSD>(e, fqpi, face_nodes, dofm);
+                    coordinate<> x;
+                    for (int a = 0; a < nf; ++a) {
+                        x += dofm.dof_nodes[nodes[face_nodes[a]]] * E.boundaryShapeValues[fqpi](a);
+                    }
+                    Physics::LocalFace(E, fqpi, face_nodes, n, x, time, A, Bf, Cf, Df);
+                }
+            }
+
+            // Condense: A^{-1}[B F], then D - C A^{-1}B and -C A^{-1}F
+            lu.compute(A);
+            Eigen::Map<Eigen::MatrixXd> op(hdg.condensedOperator(e), n_interior, n_trace + 1);
+            op.noalias() = lu.solve(BF);
+            Eigen::Map<Eigen::MatrixXd> K(hdg.localTangent(e), n_trace, n_trace);
+            Eigen::Map<Eigen::VectorXd> r(hdg.localResidual(e), n_trace);
+            K = D;
+            K.noalias() -= C * op.leftCols(n_trace);
+            r.noalias() = -C * op.col(n_trace);
+        }
+    }
+
+    hdg.assembleSkeleton();
 }
 
 
@@ -0,0 +1,521 @@
+#ifndef YAFEL_MATRIXFREEOPERATOR_HPP
+#define YAFEL_MATRIXFREEOPERATOR_HPP
+
+#include "yafel_globals.hpp"
+#include "yafel_typedefs.hpp"
+#include "element/TensorProductBasis1D.hpp"
+#include "utils/DoFManager.hpp"
+#include "utils/ElementColoring.hpp"
+
+#include <Eigen/Core>
+#include <Eigen/Sparse>
+#include <stdexcept>
+#include <vector>
+
+YAFEL_NAMESPACE_OPEN
+template<typename Physics>
+class MatrixFreeOperator;
+YAFEL_NAMESPACE_CLOSE
+
+namespace Eigen {
+namespace internal {
+// Lets Eigen's iterative solvers treat the operator like a sparse matrix
+template<typename Physics>
+struct traits<yafel::MatrixFreeOperator<Physics>> : public traits<Eigen::SparseMatrix<double>>
+{
+};
+}
+}
+
+YAFEL_NAMESPACE_OPEN
+
+/**
+ * \class MatrixFreeOperator
+ * \brief Matrix-free application of a CG operator on quad/hex (TensorProduct) meshes
+ *
+ * Computes y = A*x element by element, without forming element or global matrices.
+ * Values and gradients at the quadrature points are obtained by sum factorization
+ * over the 1D basis (TensorProductBasis1D): one 1D contraction per direction to
+ * interpolate to the quadrature points, then one per direction with the collocation
+ * derivative. Integration against the test functions applies the transposes in
+ * reverse. For order p this costs O(p^(NSD+1)) per element instead of the
+ * O(p^(2*NSD)) of a dense local tangent, and stores only the per-quadrature-point
+ * geometry (inverse-transpose Jacobian, detJ x weight and coordinates).
+ *
+ * The Physics describes a linear scalar operator pointwise, in place of
+ * LocalTangent:
+ *
+ *     static constexpr int nsd();
+ *     static void PointwiseOperator(const coordinate<> &xqp, double time,
+ *                                   double u, const Tensor<NSD,1> &grad_u,
+ *                                   double &s, Tensor<NSD,1> &flux);
+ *
+ * which defines the weak form  (A u, v) = sum_qp (s*v + flux . grad_v) * jxw.
+ * (A Laplacian sets flux = grad_u and s = 0.)
+ *
+ * The operator is an Eigen::EigenBase, so it can be used as the "matrix" in
+ * LinearSolve with the EigenConjugateGradientTag/EigenBICGSTABTag (which then use a
+ * Jacobi preconditioner built from diagonal()). DirichletBC::apply accepts it as it
+ * does the assembled tangent.
+ *
+ * Requires dof_per_node == 1 and that every element of dimension NSD is a
+ * TensorProduct element of the DoFManager's polyOrder.
+ */
+template<typename Physics>
+class MatrixFreeOperator : public Eigen::EigenBase<MatrixFreeOperator<Physics>>
+{
+public:
+    static constexpr int NSD = Physics::nsd();
+
+    using Scalar = double;
+    using RealScalar = double;
+    using StorageIndex = int;
+    enum
+    {
+        ColsAtCompileTime = Eigen::Dynamic,
+        MaxColsAtCompileTime = Eigen::Dynamic,
+        IsRowMajor = false
+    };
+
+    MatrixFreeOperator(const DoFManager &dofm, int quadratureOrderMultiplier = 2);
+
+    inline Eigen::Index rows() const { return n_dofs; }
+
+    inline Eigen::Index cols() const { return n_dofs; }
+
+    template<typename Rhs>
+    Eigen::Product<MatrixFreeOperator, Rhs, Eigen::AliasFreeProduct> operator*(const Eigen::MatrixBase<Rhs> &x) const
+    {
+        return Eigen::Product<MatrixFreeOperator, Rhs, Eigen::AliasFreeProduct>(*this, x.derived());
+    }
+
+    /**
+     * y = A*x. Constrained dofs act as rows/columns of the identity, as in an
+     * assembled tangent after DirichletBC::apply.
+     */
+    void apply(const Eigen::VectorXd &x, Eigen::VectorXd &y) const;
+
+    /**
+     * Diagonal of A (computed on first use and cached until the constraints or the
+     * time change)
+     */
+    const Eigen::VectorXd &diagonal() const;
+
+    /**
+     * Treat the given dofs as constrained (see apply)
+     */
+    void addConstrainedDofs(const std::vector<int> &dofs);
+
+    inline const std::vector<int> &getConstrainedDofs() const { return constrained_dofs; }
+
+    inline auto &getDoFManager() const { return dofm; }
+
+    inline void setTime(double t)
+    {
+        time = t;
+        diagonal_valid = false;
+    }
+
+    inline double currentTime() const noexcept { return time; }
+
+private:
+    const DoFManager &dofm;
+    TensorProductBasis1D basis;
+    int n_dofs;
+    int n_local_nodes;
+    int n_local_qp;
+    double time;
+
+    // Per-element slot into the geometry arrays (-1 for elements of lower dimension)
+    std::vector<int> element_slot;
+
+    // Geometry at each (slot, qp): inverse-transpose Jacobian (row-major NSD x NSD),
+    // detJ times quadrature weight, and physical coordinates
+    std::vector<double> qp_JinvT;
+    std::vector<double> qp_jxw;
+    std::vector<coordinate<>> qp_coords;
+
+    std::vector<int> constrained_dofs;
+    std::vector<char> constrained_mask;
+
+    mutable Eigen::VectorXd diagonal_values;
+    mutable bool diagonal_valid;
+
+    // Sum factorization kernels on one element. `scratch` holds at least 2*max(n,m)^NSD
+    void interpolate(const double *u, double *uq, double *scratch) const;
+
+    void gradient(const double *uq, double *grad) const;
+
+    void integrate(double *r, const double *grad, double *v, double *scratch) const;
+
+    void compute_geometry();
+};
+
+
+template<typename Physics>
+MatrixFreeOperator<Physics>::MatrixFreeOperator(const DoFManager &dofm_, int quadratureOrderMultiplier)
+        : dofm(dofm_),
+          basis(dofm_.polyOrder, quadratureOrderMultiplier),
+          n_dofs(dofm_.nNodes() * dofm_.dof_per_node),
+          n_local_nodes(1),
+          n_local_qp(1),
+          time(0),
+          constrained_mask(n_dofs, 0),
+          diagonal_valid(false)
+{
+    static_assert(NSD == 2 || NSD == 3, "MatrixFreeOperator: NSD must be 2 or 3");
+    if (dofm.dof_per_node != 1) {
+        throw std::runtime_error("MatrixFreeOperator: only dof_per_node == 1 is supported");
+    }
+
+    for (int d = 0; d < NSD; ++d) {
+        n_local_nodes *= basis.nNodes();
+        n_local_qp *= basis.nQP();
+    }
+
+    int n_slots{0};
+    element_slot.assign(dofm.nCells(), -1);
+    for (int e = 0; e < dofm.nCells(); ++e) {
+        auto et = dofm.element_types[e];
+        if (et.topoDim != NSD) {
+            continue;
+        }
+        if (et.elementTopology != ElementTopology::TensorProduct || et.polyOrder != dofm.polyOrder) {
+            throw std::runtime_error("MatrixFreeOperator: requires TensorProduct elements of a single order");
+        }
+        element_slot[e] = n_slots++;
+    }
+
+    compute_geometry();
+}
+
+
+template<typename Physics>
+void MatrixFreeOperator<Physics>::interpolate(const double *u, double *uq, double *scratch) const
+{
+    const int n = basis.nNodes();
+    const int m = basis.nQP();
+    const int buffer_size = n_local_qp > n_local_nodes ? n_local_qp : n_local_nodes;
+
+    // extents go from n to m, one direction at a time
+    const double *src = u;
+    int pre = 1;
+    int post = n_local_nodes / n;
+    for (int d = 0; d < NSD; ++d) {
+        double *dst = (d == NSD - 1) ? uq : scratch + (d % 2) * buffer_size;
+        TensorProductBasis1D::contract<false>(basis.values.data(), n, 1, m, n, pre, post, src, dst);
+        src = dst;
+        pre *= m;
+        post /= n;
+    }
+}
+
+
+template<typename Physics>
+void MatrixFreeOperator<Physics>::gradient(const double *uq, double *grad) const
+{
+    const int m = basis.nQP();
+    int pre = 1;
+    int post = n_local_qp / m;
+    for (int d = 0; d < NSD; ++d) {
+        TensorProductBasis1D::contract<false>(basis.collocationDerivatives.data(), m, 1, m, m, pre, post,
+                                              uq, grad + d * n_local_qp);
+        pre *= m;
+        post /= m;
+    }
+}
+
+
+template<typename Physics>
+void MatrixFreeOperator<Physics>::integrate(double *r, const double *grad, double *v, double *scratch) const
+{
+    const int n = basis.nNodes();
+    const int m = basis.nQP();
+    const int buffer_size = n_local_qp > n_local_nodes ? n_local_qp : n_local_nodes;
+
+    // Transpose of gradient(), accumulated into r
+    int pre = 1;
+    int post = n_local_qp / m;
+    for (int d = 0; d < NSD; ++d) {
+        TensorProductBasis1D::contract<true>(basis.collocationDerivatives.data(), 1, m, m, m, pre, post,
+                                             grad + d * n_local_qp, r);
+        pre *= m;
+        post /= m;
+    }
+
+    // Transpose of interpolate(): extents go from m back to n
+    const double *src = r;
+    pre = 1;
+    post = n_local_qp / m;
+    for (int d = 0; d < NSD; ++d) {
+        double *dst = (d == NSD - 1) ? v : scratch + (d % 2) * buffer_size;
+        TensorProductBasis1D::contract<false>(basis.values.data(), 1, n, n, m, pre, post, src, dst);
+        src = dst;
+        pre *= n;
+        post /= m;
+    }
+}
+
+
+template<typename Physics>
+void MatrixFreeOperator<Physics>::compute_geometry()
+{
+    int n_slots{0};
+    for (auto s : element_slot) {
+        n_slots += (s >= 0);
+    }
+    qp_JinvT.resize(n_slots * n_local_qp * NSD * NSD);
+    qp_jxw.resize(n_slots * n_local_qp);
+    qp_coords.resize(n_slots * n_local_qp);
+
+    const int m = basis.nQP();
+
+#pragma omp parallel
+    {
+        std::vector<double> x(n_local_nodes);
+        std::vector<double> xq(NSD * n_local_qp);
+        std::vector<double> dxq(NSD * NSD * n_local_qp);
+        std::vector<double> scratch(2 * (n_local_qp > n_local_nodes ? n_local_qp : n_local_nodes));
+
+#pragma omp for
+        for (int e = 0; e < dofm.nCells(); ++e) {
+            int slot = element_slot[e];
+            if (slot < 0) {
+                continue;
+            }
+            const int *nodes = dofm.elements.data() + dofm.element_offsets[e];
+
+            // Jacobian(i, d) = d x_i / d xi_d, by interpolating each coordinate field
+            for (int i = 0; i < NSD; ++i) {
+                for (int A = 0; A < n_local_nodes; ++A) {
+                    x[A] = dofm.dof_nodes[nodes[A]](i);
+                }
+                interpolate(x.data(), &xq[i * n_local_qp], scratch.data());
+                gradient(&xq[i * n_local_qp], &dxq[i * NSD * n_local_qp]);
+            }
+
+            for (int q = 0; q < n_local_qp; ++q) {
+                Tensor<NSD, 2> Jacobian;
+                coordinate<> xqp;
+                for (int i = 0; i < NSD; ++i) {
+                    xqp(i) = xq[i * n_local_qp + q];
+                    for (int d = 0; d < NSD; ++d) {
+                        Jacobian(i, d) = dxq[(i * NSD + d) * n_local_qp + q];
+                    }
+                }
+
+                double w = 1;
+                for (int d = 0, qd = q; d < NSD; ++d, qd /= m) {
+                    w *= basis.qp_weights[qd % m];
+                }
+
+                int idx = slot * n_local_qp + q;
+                Tensor<NSD, 2> Jinv = inverse(Jacobian);
+                Tensor<NSD, 2> JinvT = transpose(Jinv);
+                for (int i = 0; i < NSD; ++i) {
+                    for (int j = 0; j < NSD; ++j) {
+                        qp_JinvT[idx * NSD * NSD + i * NSD + j] = JinvT(i, j);
+                    }
+                }
+                qp_jxw[idx] = determinant(Jacobian) * w;
+                qp_coords[idx] = xqp;
+            }
+        }
+    }
+}
+
+
+template<typename Physics>
+void MatrixFreeOperator<Physics>::apply(const Eigen::VectorXd &x, Eigen::VectorXd &y) const
+{
+    if (y.rows() != n_dofs) {
+        y.resize(n_dofs);
+    }
+    y.setZero();
+
+    // Elements of one color share no dofs, so each thread scatters directly into y
+    auto const &coloring = dofm.getElementColoring(NSD);
+    const double t = time;
+
+#pragma omp parallel shared(x, y, coloring)
+    {
+        const int buffer_size = n_local_qp > n_local_nodes ? n_local_qp : n_local_nodes;
+        std::vector<double> u(n_local_nodes);
+        std::vector<double> v(n_local_nodes);
+        std::vector<double> uq(n_local_qp);
+        std::vector<double> grad(NSD * n_local_qp);
+        std::vector<double> scratch(2 * buffer_size);
+
+        for (int color = 0; color < coloring.nColors(); ++color) {
+            const int *color_elements = coloring.elements(color);
+#pragma omp for
+            for (int cidx = 0; cidx < coloring.nElements(color); ++cidx) {
+                int elnum = color_elements[cidx];
+                int slot = element_slot[elnum];
+                const int *nodes = dofm.elements.data() + dofm.element_offsets[elnum];
+
+                for (int A = 0; A < n_local_nodes; ++A) {
+                    u[A] = constrained_mask[nodes[A]] ? 0.0 : x(nodes[A]);
+                }
+
+                interpolate(u.data(), uq.data(), scratch.data());
+                gradient(uq.data(), grad.data());
+
+                // Pointwise physics. uq is overwritten with the test-function value
+                // coefficient and grad with the gradient coefficient (in parameter space).
+                for (int q = 0; q < n_local_qp; ++q) {
+                    int idx = slot * n_local_qp + q;
+                    const double *JinvT = &qp_JinvT[idx * NSD * NSD];
+                    double jxw = qp_jxw[idx];
+
+                    Tensor<NSD, 1> grad_u;
+                    for (int i = 0; i < NSD; ++i) {
+                        for (int d = 0; d < NSD; ++d) {
+                            grad_u(i) += JinvT[i * NSD + d] * grad[d * n_local_qp + q];
+                        }
+                    }
+
+                    double s{0};
+                    Tensor<NSD, 1> flux;
+                    Physics::PointwiseOperator(qp_coords[idx], t, uq[q], grad_u, s, flux);
+
+                    uq[q] = s * jxw;
+                    for (int d = 0; d < NSD; ++d) {
+                        double g{0};
+                        for (int i = 0; i < NSD; ++i) {
+                            g += JinvT[i * NSD + d] * flux(i);
+                        }
+                        grad[d * n_local_qp + q] = g * jxw;
+                    }
+                }
+
+                integrate(uq.data(), grad.data(), v.data(), scratch.data());
+
+                for (int A = 0; A < n_local_nodes; ++A) {
+                    if (!constrained_mask[nodes[A]]) {
+                        y(nodes[A]) += v[A];
+                    }
+                }
+            }// end element loop (implicit barrier before the next color)
+        }// end color loop
+    }//end parallel block
+
+    for (auto c : constrained_dofs) {
+        y(c) = x(c);
+    }
+}
+
+
+template<typename Physics>
+const Eigen::VectorXd &MatrixFreeOperator<Physics>::diagonal() const
+{
+    if (diagonal_valid) {
+        return diagonal_values;
+    }
+
+    diagonal_values = Eigen::VectorXd::Zero(n_dofs);
+    auto const &coloring = dofm.getElementColoring(NSD);
+    const int n = basis.nNodes();
+    const int m = basis.nQP();
+    const double t = time;
+
+    // Each diagonal entry applies the physics to a single shape function, evaluated
+    // at the quadrature points through the 1D factors
+#pragma omp parallel shared(coloring)
+    {
+        std::vector<double> local_diagonal(n_local_nodes);
+
+        for (int color = 0; color < coloring.nColors(); ++color) {
+            const int *color_elements = coloring.elements(color);
+#pragma omp for
+            for (int cidx = 0; cidx < coloring.nElements(color); ++cidx) {
+                int elnum = color_elements[cidx];
+                int slot = element_slot[elnum];
+                const int *nodes = dofm.elements.data() + dofm.element_offsets[elnum];
+
+                for (int A = 0; A < n_local_nodes; ++A) {
+                    local_diagonal[A] = 0;
+                }
+
+                for (int q = 0; q < n_local_qp; ++q) {
+                    int idx = slot * n_local_qp + q;
+                    const double *JinvT = &qp_JinvT[idx * NSD * NSD];
+
+                    for (int A = 0; A < n_local_nodes; ++A) {
+                        double value{1};
+                        Tensor<NSD, 1> grad_xi(1.0);
+                        for (int d = 0, qd = q, Ad = A; d < NSD; ++d, qd /= m, Ad /= n) {
+                            for (int k = 0; k < NSD; ++k) {
+                                grad_xi(k) *= (k == d) ? basis.derivatives(qd % m, Ad % n)
+                                                       : basis.values(qd % m, Ad % n);
+                            }
+                            value *= basis.values(qd % m, Ad % n);
+                        }
+                        Tensor<NSD, 1> grad_phi;
+                        for (int i = 0; i < NSD; ++i) {
+                            for (int d = 0; d < NSD; ++d) {
+                                grad_phi(i) += JinvT[i * NSD + d] * grad_xi(d);
+                            }
+                        }
+
+                        double s{0};
+                        Tensor<NSD, 1> flux;
+                        Physics::PointwiseOperator(qp_coords[idx], t, value, grad_phi, s, flux);
+                        local_diagonal[A] += (s * value + dot(flux, grad_phi)) * qp_jxw[idx];
+                    }
+                }
+
+                for (int A = 0; A < n_local_nodes; ++A) {
+                    diagonal_values(nodes[A]) += local_diagonal[A];
+                }
+            }// end element loop
+        }// end color loop
+    }//end parallel block
+
+    for (auto c : constrained_dofs) {
+        diagonal_values(c) = 1;
+    }
+    diagonal_valid = true;
+    return diagonal_values;
+}
+
+
+template<typename Physics>
+void MatrixFreeOperator<Physics>::addConstrainedDofs(const std::vector<int> &dofs)
+{
+    for (auto c : dofs) {
+        if (!constrained_mask[c]) {
+            constrained_mask[c] = 1;
+            constrained_dofs.push_back(c);
+        }
+    }
+    diagonal_valid = false;
+}
+
+YAFEL_NAMESPACE_CLOSE
+
+
+namespace Eigen {
+namespace internal {
+// y += alpha*A*x for the products formed by MatrixFreeOperator::operator*
+template<typename Physics, typename Rhs>
+struct generic_product_impl<yafel::MatrixFreeOperator<Physics>, Rhs, SparseShape, DenseShape, GemvProduct>
+        : generic_product_impl_base<yafel::MatrixFreeOperator<Physics>, Rhs,
+                generic_product_impl<yafel::MatrixFreeOperator<Physics>, Rhs>>
+{
+    using Scalar = typename Product<yafel::MatrixFreeOperator<Physics>, Rhs>::Scalar;
+
+    template<typename Dest>
+    static void scaleAndAddTo(Dest &dst, const yafel::MatrixFreeOperator<Physics> &lhs, const Rhs &rhs,
+                              const Scalar &alpha)
+    {
+        Eigen::VectorXd x = rhs;
+        Eigen::VectorXd y;
+        lhs.apply(x, y);
+        dst.noalias() += alpha * y;
+    }
+};
+}
+}
+
+#endif //YAFEL_MATRIXFREEOPERATOR_HPP
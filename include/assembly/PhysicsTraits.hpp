@@ -0,0 +1,251 @@
+#ifndef YAFEL_PHYSICSTRAITS_HPP
+#define YAFEL_PHYSICSTRAITS_HPP
+
+#include "yafel_globals.hpp"
+#include "yafel_typedefs.hpp"
+
+#include <type_traits>
+#include <utility>
+
+YAFEL_NAMESPACE_OPEN
+
+/**
+ * \file
+ *
+ * Compile-time detection of the optional parts of a Physics class, used by the
+ * assembly routines to pick their element kernels. Everything here is opt-in:
+ * a Physics that only provides nsd(), LocalTangent and LocalResidual gets the
+ * defaults.
+ */
+
+namespace detail {
+
+// Whether T is a Physics class at all (declares nsd())
+template<typename T, typename = void>
+struct is_physics : std::false_type
+{
+};
+
+template<typename T>
+struct is_physics<T, std::void_t<decltype(T::nsd())>> : std::true_type
+{
+};
+
+// Physics::dofPerNode() if the physics declares it, 1 otherwise
+template<typename Physics, typename = void>
+struct physics_dof_per_node : std::integral_constant<int, 1>
+{
+};
+
+template<typename Physics>
+struct physics_dof_per_node<Physics, std::void_t<decltype(Physics::dofPerNode())>>
+        : std::integral_constant<int, Physics::dofPerNode()>
+{
+};
+
+// Physics::traceDofPerNode() if the (HDG) physics declares it, 1 otherwise
+template<typename Physics, typename = void>
+struct physics_trace_dof_per_node : std::integral_constant<int, 1>
+{
+};
+
+template<typename Physics>
+struct physics_trace_dof_per_node<Physics, std::void_t<decltype(Physics::traceDofPerNode())>>
+        : std::integral_constant<int, Physics::traceDofPerNode()>
+{
+};
+
+// Whether the local kernels of Physics accept the fixed-size element FE and its local types
+template<typename Physics, typename FE, typename = void>
+struct accepts_fixed_element : std::false_type
+{
+};
+
+template<typename Physics, typename FE>
+struct accepts_fixed_element<Physics, FE, std::void_t<
+        decltype(Physics::LocalTangent(std::declval<const FE &>(), 0, std::declval<coordinate<> &>(), 0.0,
+                                       std::declval<typename FE::LocalVector &>(),
+                                       std::declval<typename FE::LocalMatrix &>())),
+        decltype(Physics::LocalResidual(std::declval<const FE &>(), 0, std::declval<coordinate<> &>(), 0.0,
+                                        std::declval<typename FE::LocalVector &>(),
+                                        std::declval<typename FE::LocalVector &>()))>>
+        : std::true_type
+{
+};
+
+// Physics::batchWidth() if the physics opts in to cross-element batches, 1 otherwise
+template<typename Physics, typename = void>
+struct physics_batch_width : std::integral_constant<int, 1>
+{
+};
+
+template<typename Physics>
+struct physics_batch_width<Physics, std::void_t<decltype(Physics::batchWidth())>>
+        : std::integral_constant<int, Physics::batchWidth()>
+{
+};
+
+// Whether Physics has LocalTangentBatch/LocalResidualBatch kernels for the ElementBatch type B
+template<typename Physics, typename B, typename = void>
+struct accepts_element_batch : std::false_type
+{
+};
+
+template<typename Physics, typename B>
+struct accepts_element_batch<Physics, B, std::void_t<
+        decltype(Physics::LocalTangentBatch(std::declval<const B &>(), 0, std::declval<const typename B::Point &>(),
+                                            0.0, std::declval<const typename B::LocalVector &>(),
+                                            std::declval<typename B::LocalMatrix &>())),
+        decltype(Physics::LocalResidualBatch(std::declval<const B &>(), 0, std::declval<const typename B::Point &>(),
+                                             0.0, std::declval<const typename B::LocalVector &>(),
+                                             std::declval<typename B::LocalVector &>()))>>
+        : std::true_type
+{
+};
+
+// Physics::needsXqp() if the physics declares it, true otherwise (xqp is interpolated)
+template<typename Physics, typename = void>
+struct physics_needs_xqp : std::true_type
+{
+};
+
+template<typename Physics>
+struct physics_needs_xqp<Physics, std::void_t<decltype(Physics::needsXqp())>>
+        : std::integral_constant<bool, Physics::needsXqp()>
+{
+};
+
+// Whether Physics has a fused LocalResidualAndTangent for element type E, local vector V and local matrix M
+template<typename Physics, typename E, typename V, typename M, typename = void>
+struct has_fused_kernel : std::false_type
+{
+};
+
+template<typename Physics, typename E, typename V, typename M>
+struct has_fused_kernel<Physics, E, V, M, std::void_t<
+        decltype(Physics::LocalResidualAndTangent(std::declval<const E &>(), 0, std::declval<coordinate<> &>(), 0.0,
+                                                  std::declval<V &>(), std::declval<V &>(),
+                                                  std::declval<M &>()))>>
+        : std::true_type
+{
+};
+
+// Whether Physics has a fused LocalResidualAndTangentBatch for the ElementBatch type B
+template<typename Physics, typename B, typename = void>
+struct has_fused_batch_kernel : std::false_type
+{
+};
+
+template<typename Physics, typename B>
+struct has_fused_batch_kernel<Physics, B, std::void_t<
+        decltype(Physics::LocalResidualAndTangentBatch(std::declval<const B &>(), 0,
+                                                       std::declval<const typename B::Point &>(), 0.0,
+                                                       std::declval<const typename B::LocalVector &>(),
+                                                       std::declval<typename B::LocalVector &>(),
+                                                       std::declval<typename B::LocalMatrix &>()))>>
+        : std::true_type
+{
+};
+
+// Whether Physics::Flux takes and returns NC-component states, Tensor<NC, 1>
+// (otherwise a scalar DG physics, with double states)
+template<typename Physics, int NSD, int NC, typename = void>
+struct has_component_flux : std::false_type
+{
+};
+
+template<typename Physics, int NSD, int NC>
+struct has_component_flux<Physics, NSD, NC, std::enable_if_t<std::is_same<
+        std::decay_t<decltype(Physics::Flux(std::declval<Tensor<NSD, 1>>(), std::declval<coordinate<>>(), 0.0,
+                                            std::declval<const Tensor<NC, 1> &>(),
+                                            std::declval<const Tensor<NC, 1> &>()))>,
+        Tensor<NC, 1>>::value>>
+        : std::true_type
+{
+};
+
+// Whether Physics::BoundaryFlux takes and returns NC-component states
+template<typename Physics, int NSD, int NC, typename = void>
+struct has_component_boundary_flux : std::false_type
+{
+};
+
+template<typename Physics, int NSD, int NC>
+struct has_component_boundary_flux<Physics, NSD, NC, std::enable_if_t<std::is_same<
+        std::decay_t<decltype(Physics::BoundaryFlux(std::declval<Tensor<NSD, 1>>(), std::declval<coordinate<>>(),
+                                                    0.0, std::declval<const Tensor<NC, 1> &>()))>,
+        Tensor<NC, 1>>::value>>
+        : std::true_type
+{
+};
+
+// Whether Physics has LocalTangent for element type E, local vector V and local matrix M
+template<typename Physics, typename E, typename V, typename M, typename = void>
+struct has_local_tangent : std::false_type
+{
+};
+
+template<typename Physics, typename E, typename V, typename M>
+struct has_local_tangent<Physics, E, V, M, std::void_t<
+        decltype(Physics::LocalTangent(std::declval<const E &>(), 0, std::declval<coordinate<> &>(), 0.0,
+                                       std::declval<V &>(), std::declval<M &>()))>>
+        : std::true_type
+{
+};
+
+// Whether Physics has the flux derivatives of NC-component states, FluxJacobian(n, x, t, Uplus,
+// Uminus, dF_dUplus, dF_dUminus) and BoundaryFluxJacobian(n, x, t, U, dF_dU), into Tensor<NC, 2>
+template<typename Physics, int NSD, int NC, typename = void>
+struct has_component_flux_jacobian : std::false_type
+{
+};
+
+template<typename Physics, int NSD, int NC>
+struct has_component_flux_jacobian<Physics, NSD, NC, std::void_t<
+        decltype(Physics::FluxJacobian(std::declval<Tensor<NSD, 1>>(), std::declval<coordinate<>>(), 0.0,
+                                       std::declval<const Tensor<NC, 1> &>(),
+                                       std::declval<const Tensor<NC, 1> &>(),
+                                       std::declval<Tensor<NC, 2> &>(), std::declval<Tensor<NC, 2> &>())),
+        decltype(Physics::BoundaryFluxJacobian(std::declval<Tensor<NSD, 1>>(), std::declval<coordinate<>>(), 0.0,
+                                               std::declval<const Tensor<NC, 1> &>(),
+                                               std::declval<Tensor<NC, 2> &>()))>>
+        : std::true_type
+{
+};
+
+// The same for a scalar DG physics, with double states and derivatives
+template<typename Physics, int NSD, typename = void>
+struct has_scalar_flux_jacobian : std::false_type
+{
+};
+
+template<typename Physics, int NSD>
+struct has_scalar_flux_jacobian<Physics, NSD, std::void_t<
+        decltype(Physics::FluxJacobian(std::declval<Tensor<NSD, 1>>(), std::declval<coordinate<>>(), 0.0, 0.0, 0.0,
+                                       std::declval<double &>(), std::declval<double &>())),
+        decltype(Physics::BoundaryFluxJacobian(std::declval<Tensor<NSD, 1>>(), std::declval<coordinate<>>(), 0.0,
+                                               0.0, std::declval<double &>()))>>
+        : std::true_type
+{
+};
+
+// Whether Physics::WaveSpeed takes the NC-component state at a point, WaveSpeed(x, t, U) with a
+// Tensor<NC, 1> U (otherwise the wave speed only depends on the position, WaveSpeed(x, t))
+template<typename Physics, int NC, typename = void>
+struct has_state_wave_speed : std::false_type
+{
+};
+
+template<typename Physics, int NC>
+struct has_state_wave_speed<Physics, NC, std::enable_if_t<std::is_convertible<
+        decltype(Physics::WaveSpeed(std::declval<const coordinate<> &>(), 0.0,
+                                    std::declval<const Tensor<NC, 1> &>())), double>::value>>
+        : std::true_type
+{
+};
+
+}//end namespace detail
+
+YAFEL_NAMESPACE_CLOSE
+
+#endif //YAFEL_PHYSICSTRAITS_HPP
@@ -43,99 +43,114 @@ void ZZGradientRecovery(FESystem &fesystem)
     //Temporary assertion. Need to generalize
     assert(dofm.polyOrder == 1 && "ZZ Recovery currently only intended for P=1 elements");
 
-    ElementFactory EF;
-
     std::vector<std::set<int>> adjacent_elements(dofm.nNodes());
 
-    // Build node-element patch adjacency
-    std::vector<int> node_container;
-    std::vector<int> dof_container;
-
-    for (int elnum = 0; elnum < dofm.nCells(); ++elnum) {
-        dofm.getGlobalNodes(elnum, node_container);
-        for (auto n : node_container) {
-            adjacent_elements[n].insert(elnum);
+    // Build node-element patch adjacency. Only elements of dimension NSD contribute to
+    // a patch; within one color they share no nodes, so the inserts do not race.
+    auto const &coloring = dofm.getElementColoring(NSD);
+#pragma omp parallel shared(adjacent_elements, coloring)
+    {
+        std::vector<int> node_container;
+        for (int color = 0; color < coloring.nColors(); ++color) {
+            const int *color_elements = coloring.elements(color);
+#pragma omp for
+            for (int cidx = 0; cidx < coloring.nElements(color); ++cidx) {
+                int elnum = color_elements[cidx];
+                dofm.getGlobalNodes(elnum, node_container);
+                for (auto n : node_container) {
+                    adjacent_elements[n].insert(elnum);
+                }
+            }
         }
     }
 
 
 
-    // Loop over nodes
-    for (int nodeNum = 0; nodeNum < dofm.nNodes(); ++nodeNum) {
+    // Loop over nodes. Each patch fit is independent.
+    auto const *geometry = fesystem.getGeometryCache(NSD);
+#pragma omp parallel shared(adjacent_elements, SolutionGradient, geometry)
+    {
+        ElementFactory EF(dofm);
+        std::vector<int> node_container;
+        std::vector<int> dof_container;
 
-        auto const &adj_elems = adjacent_elements[nodeNum];
-        int num_sample_points{0};
-        int num_basis_funcs{0};
-        for (auto e : adj_elems) {
-            auto et = dofm.element_types[e];
-            if (et.topoDim != NSD) {
-                continue;
-            }
-            num_sample_points += EF.getElement(et).nQP();
-        }
+#pragma omp for
+        for (int nodeNum = 0; nodeNum < dofm.nNodes(); ++nodeNum) {
 
-        if (NSD == 2) {
-            num_basis_funcs = 3;
-        } else if (NSD == 3) {
-            num_basis_funcs = 4;
-        }
+            auto const &adj_elems = adjacent_elements[nodeNum];
+            int num_sample_points{0};
+            int num_basis_funcs{0};
+            for (auto e : adj_elems) {
+                auto et = dofm.element_types[e];
+                if (et.topoDim != NSD) {
+                    continue;
+                }
+                num_sample_points += EF.getElement(et).nQP();
+            }
 
-        //Build system: P*a = b, where P contains polynomial entries for a least-squares fit of patch values
-        // EG: P = [1 x y] for 2d linear elements
-        Eigen::MatrixXd P(num_sample_points, num_basis_funcs);
-        Eigen::MatrixXd b(num_sample_points, NSD);
-        int idx{0};
-        for (auto e : adj_elems) {
-
-            //auto dofpn = dofm.dof_per_node;
-            auto et = dofm.element_types[e];
-            if (et.topoDim != NSD) {
-                continue;
+            if (NSD == 2) {
+                num_basis_funcs = 3;
+            } else if (NSD == 3) {
+                num_basis_funcs = 4;
             }
-            auto &E = EF.getElement(et);
-            dofm.getGlobalNodes(e, node_container);
-            dofm.getGlobalDofs(e, dof_container);
 
-            for (int qpi = 0; qpi < E.nQP(); ++qpi) {
+            //Build system: P*a = b, where P contains polynomial entries for a least-squares fit of patch values
+            // EG: P = [1 x y] for 2d linear elements
+            Eigen::MatrixXd P(num_sample_points, num_basis_funcs);
+            Eigen::MatrixXd b(num_sample_points, NSD);
+            int idx{0};
+            for (auto e : adj_elems) {
+
+                //auto dofpn = dofm.dof_per_node;
+                auto et = dofm.element_types[e];
+                if (et.topoDim != NSD) {
+                    continue;
+                }
+                auto &E = EF.getElement(et);
+                dofm.getGlobalNodes(e, node_container);
+                dofm.getGlobalDofs(e, dof_container);
 
-                coordinate<> xqp;
-                E.update<NSD>(e, qpi, dofm);
-                Tensor<NSD,1,double> field_grad(0);
+                for (int qpi = 0; qpi < E.nQP(); ++qpi) {
 
+                    coordinate<> xqp;
+                    E.update<NSD>(e, qpi, dofm, geometry);
+                    Tensor<NSD,1,double> field_grad(0);
 
-                //compute point location and field gradient
-                for (int A = 0; A < E.localMesh.nNodes(); ++A) {
-                    xqp += E.shapeValues[qpi](A) * dofm.dof_nodes[node_container[A]];
-                    field_grad += Solution(dof_container[A])*make_TensorMap<NSD,1>(&E.shapeGrad(A,0));
-                }
 
-                P(idx, 0) = 1;
-                for (int i = 0; i < NSD; ++i) {
-                    P(idx, i + 1) = xqp(i);
-                    b(idx,i) = field_grad(i);
+                    //compute point location and field gradient
+                    for (int A = 0; A < E.localMesh.nNodes(); ++A) {
+                        xqp += E.shapeValues[qpi](A) * dofm.dof_nodes[node_container[A]];
+                        field_grad += Solution(dof_container[A])*make_TensorMap<NSD,1>(&E.shapeGrad(A,0));
+                    }
+
+                    P(idx, 0) = 1;
+                    for (int i = 0; i < NSD; ++i) {
+                        P(idx, i + 1) = xqp(i);
+                        b(idx,i) = field_grad(i);
+                    }
+
+                    ++idx;
                 }
+            }//end adj_elems loop
 
-                ++idx;
-            }
-        }//end adj_elems loop
 
+            Eigen::MatrixXd a = P.colPivHouseholderQr().solve(b);;
 
-        Eigen::MatrixXd a = P.colPivHouseholderQr().solve(b);;
+            // Recover gradF(x_n) = P(x_n)*a
+            auto x_n = dofm.dof_nodes[nodeNum];
+            Eigen::MatrixXd Pn(1,num_basis_funcs);
+            Pn(0,0) = 1;
+            for(int i=0; i<NSD; ++i) {
+                Pn(0,i+1) = x_n(i);
+            }
 
-        // Recover gradF(x_n) = P(x_n)*a
-        auto x_n = dofm.dof_nodes[nodeNum];
-        Eigen::MatrixXd Pn(1,num_basis_funcs);
-        Pn(0,0) = 1;
-        for(int i=0; i<NSD; ++i) {
-            Pn(0,i+1) = x_n(i);
-        }
+            Eigen::MatrixXd recovered_grad = Pn*a;
 
-        Eigen::MatrixXd recovered_grad = Pn*a;
+            for(int i=0; i<NSD; ++i) {
+                SolutionGradient(nodeNum,i) = recovered_grad(0,i);
+            }
 
-        for(int i=0; i<NSD; ++i) {
-            SolutionGradient(nodeNum,i) = recovered_grad(0,i);
         }
-
     }
 
 }
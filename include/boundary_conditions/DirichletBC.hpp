@@ -12,10 +12,19 @@
 #include <Eigen/Sparse>
 #include <vector>
 #include <functional>
+#include <stdexcept>
 #include <type_traits>
 
 YAFEL_NAMESPACE_OPEN
 
+template<typename Physics>
+class MatrixFreeOperator;
+
+template<int B>
+class BCSRMatrix;
+
+class FESystem;
+
 /**
  * \brief Class to represent (and apply) a dirichlet boundary condition.
  *
@@ -36,6 +45,18 @@ public:
             typename=typename std::enable_if<RCMajor == Eigen::ColMajor || RCMajor == Eigen::RowMajor>::type>
     void apply(Eigen::SparseMatrix<double, RCMajor> &A, Eigen::VectorXd &rhs, double time = 0.0);
 
+    // Same as above, for a matrix-free operator: the bc dofs become constrained dofs of A
+    template<typename Physics>
+    void apply(MatrixFreeOperator<Physics> &A, Eigen::VectorXd &rhs, double time = 0.0);
+
+    // Same as above, for a block matrix with one B x B block per node pair (B = dof_per_node)
+    template<int B>
+    void apply(BCSRMatrix<B> &A, Eigen::VectorXd &rhs, double time = 0.0);
+
+    // Same as above, in place on the FESystem's global tangent and residual, which is
+    // recorded on it: CGAssemblyIncremental cannot update them until the next CGAssembly
+    void apply(FESystem &feSystem, double time = 0.0);
+
     void selectByRegionID(int region_id);
 
     template<typename Lambda>
@@ -89,6 +110,71 @@ void DirichletBC::selectByFunction(Lambda &&func)
 }
 
 
+template<typename Physics>
+void DirichletBC::apply(MatrixFreeOperator<Physics> &A, Eigen::VectorXd &rhs, double time)
+{
+    Eigen::VectorXd bc_values = Eigen::VectorXd::Constant(dofm.dof_per_node * dofm.dof_nodes.size(), 0.0);
+    std::vector<int> bc_dofs;
+    bc_dofs.reserve(bc_nodes.size());
+    for (auto n : bc_nodes) {
+        int dof = n * dofm.dof_per_node + component;
+        bc_values(dof) = value_func(dofm.dof_nodes[n], time);
+        bc_dofs.push_back(dof);
+    }
+
+    rhs -= A * bc_values;
+
+    A.addConstrainedDofs(bc_dofs);
+    for (auto dof : bc_dofs) {
+        rhs(dof) = bc_values(dof);
+    }
+}
+
+
+template<int B>
+void DirichletBC::apply(BCSRMatrix<B> &A, Eigen::VectorXd &rhs, double time)
+{
+    if (dofm.dof_per_node != B) {
+        throw std::runtime_error("DirichletBC: BCSRMatrix block size differs from dof_per_node");
+    }
+
+    Eigen::VectorXd bc_values = Eigen::VectorXd::Constant(dofm.dof_per_node * dofm.dof_nodes.size(), 0.0);
+    std::vector<bool> bc_mask(dofm.dof_nodes.size() * dofm.dof_per_node, false);
+    for (auto n : bc_nodes) {
+        bc_mask[n * dofm.dof_per_node + component] = true;
+        bc_values(n * dofm.dof_per_node + component) = value_func(dofm.dof_nodes[n], time);
+    }
+
+    Eigen::VectorXd A_bc;
+    A.apply(bc_values, A_bc);
+    rhs -= A_bc;
+
+    // Block rows are independent, and rhs(r) is only written from the block row of r
+    auto const &block_row_ptr = A.blockRowPtr();
+    auto const &block_col_index = A.blockColIndex();
+#pragma omp parallel for
+    for (int br = 0; br < A.nBlockRows(); ++br) {
+        for (auto k : IRange(block_row_ptr[br], block_row_ptr[br + 1])) {
+            const int bc = block_col_index[k];
+            auto block = A.block(k);
+            for (int j = 0; j < B; ++j) {
+                const int c = bc * B + j;
+                for (int i = 0; i < B; ++i) {
+                    const int r = br * B + i;
+                    if (bc_mask[r] || bc_mask[c]) {
+                        block(i, j) = 0;
+                        if (r == c) {
+                            rhs(r) = bc_values(c);
+                            block(i, j) = 1;
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+
 YAFEL_NAMESPACE_CLOSE
 
 #endif //YAFEL_DIRICHLETBC_HPP
@@ -11,8 +11,11 @@
 #include "mesh/Mesh.hpp"
 #include "quadrature/QuadratureRule.hpp"
 #include "utils/DoFManager.hpp"
+#include "fe_system/GeometryCache.hpp"
 
 #include <Eigen/Core>
+#include <algorithm>
+#include <stdexcept>
 #include <vector>
 
 YAFEL_NAMESPACE_OPEN
@@ -24,7 +27,8 @@ class Element
 {
 
 public:
-    Element(ElementType et = {ElementTopology::None, 0, 0}, int dofPerNode = 1, int quadratureOrderMultiplier = 2);
+    Element(ElementType et = {ElementTopology::None, 0, 0}, int dofPerNode = 1, int quadratureOrderMultiplier = 2,
+            QuadratureRule::QuadratureType quadratureType = QuadratureRule::QuadratureType::GAUSS_LEGENDRE);
 
     // Struct that holds element type
     ElementType elementType;
@@ -41,6 +45,11 @@ public:
     //Defaults to 2 because is useful for Galerkin FEM
     int quadratureOrderMultiplier;
 
+    //GAUSS_LOBATTO collocates the volume and face quadrature of tensor-product
+    //elements with their (Lobatto) nodes: p+1 points per direction, whatever the
+    //multiplier. Simplices always use their GAUSS_LEGENDRE-type rules.
+    QuadratureRule::QuadratureType quadratureType;
+
     // Shape function values and gradients (in parameter space)
     std::vector<Eigen::VectorXd> shapeValues;
     std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>> shapeGradXi;
@@ -63,6 +72,11 @@ public:
     template<int NSD>
     void update(int elnum, int qpi, const DoFManager &dofm);
 
+    // Same as above, but read from the geometry cache if it holds this element.
+    // Falls back to update(elnum, qpi, dofm) otherwise (or if geometry is null).
+    template<int NSD>
+    void update(int elnum, int qpi, const DoFManager &dofm, const GeometryCache *geometry);
+
     // update element values at a face quadrature
     // Returns the surface normal vector at that point
     //template<int NSD>
@@ -84,6 +98,14 @@ public:
     //Get number of face/boundary quadrature points (per face)
     inline int nFQP() const { return static_cast<int>(boundaryQuadratureRule.weights.size()); }
 
+    //Quadrature point qpi is node qpi (and face quadrature point i is face node i):
+    //shape values are unit vectors, and the mass matrix is diagonal
+    inline bool isCollocated() const
+    {
+        return quadratureType == QuadratureRule::QuadratureType::GAUSS_LOBATTO
+               && elementType.elementTopology == ElementTopology::TensorProduct;
+    }
+
 
 private:
     void make_simplex();
@@ -148,6 +170,30 @@ void Element::update(int elnum, int qpi, const DoFManager &dofm)
 
 }
 
+template<int NSD>
+void Element::update(int elnum, int qpi, const DoFManager &dofm, const GeometryCache *geometry)
+{
+    if (geometry == nullptr || !geometry->contains(elnum)) {
+        update<NSD>(elnum, qpi, dofm);
+        return;
+    }
+
+    if (geometry->quadratureType() != quadratureType
+        || geometry->quadratureOrderMultiplier() != quadratureOrderMultiplier) {
+        throw std::runtime_error("Element::update: the GeometryCache uses a different quadrature rule");
+    }
+
+    dofm.getGlobalNodes(elnum, globalNodes);
+
+    if (shapeGrad.rows() != static_cast<Eigen::Index>(globalNodes.size()) || shapeGrad.cols() != NSD) {
+        shapeGrad.resize(globalNodes.size(), NSD);
+    }
+
+    jxw = geometry->jxw(elnum, qpi);
+    const double *cached_grad = geometry->shapeGrad(elnum, qpi);
+    std::copy(cached_grad, cached_grad + shapeGrad.size(), shapeGrad.data());
+}
+
 template<int NSD>
 Tensor<NSD, 1> Element::face_update(int elnum, int fqpi, const std::vector<int> &local_fnodes, const DoFManager &dofm)
 {
@@ -0,0 +1,220 @@
+#ifndef YAFEL_ELEMENTBATCH_HPP
+#define YAFEL_ELEMENTBATCH_HPP
+
+#include "yafel_globals.hpp"
+#include "yafel_typedefs.hpp"
+#include "element/FixedElement.hpp"
+#include "fe_system/GeometryCache.hpp"
+#include "utils/DoFManager.hpp"
+
+#include <Eigen/Core>
+#include <array>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+
+YAFEL_NAMESPACE_OPEN
+
+/**
+ * \class ElementBatch
+ * \brief Width elements of one fixed type, evaluated together on SIMD lanes
+ *
+ * Structure-of-arrays counterpart of FixedElement: every per-element quantity
+ * (node coordinates, jxw, shape gradients, local solution/residual/tangent
+ * entries) is a Lanes array holding that quantity for each element of the
+ * batch, so that arithmetic on it runs across elements in vector registers.
+ * Reference quantities (shapeValues, quadrature weights) are shared by all
+ * lanes and read from the underlying FixedElement.
+ *
+ * Local vectors are indexed like the local vectors of CGAssembly
+ * (A * dofPerNode + comp), and the local matrix is row-major (A * n_dofs + B).
+ *
+ * A batch may be partially filled (nActive < Width); the unused lanes repeat
+ * the last active element and are ignored when scattering.
+ */
+template<typename FE, int Width>
+class ElementBatch
+{
+public:
+    static constexpr int width = Width;
+    static constexpr int topoDim = FE::topoDim;
+    static constexpr int n_nodes = FE::n_nodes;
+    static constexpr int n_dofs = FE::n_dofs;
+
+    using FixedElementType = FE;
+    using Lanes = Eigen::Array<double, Width, 1>;
+    using Point = std::array<Lanes, 3>;
+    using LocalVector = std::array<Lanes, n_dofs>;
+    using LocalMatrix = std::array<Lanes, n_dofs * n_dofs>;
+
+    explicit ElementBatch(const FE &fe) : reference(fe) {}
+
+    inline static constexpr int dofPerNode() { return FE::dofPerNode(); }
+
+    inline int nQP() const { return reference.nQP(); }
+
+    // Reference shape function value of node A at a quadrature point (the same on all lanes)
+    inline double shapeValue(int qpi, int A) const { return reference.shapeValues[qpi](A); }
+
+    // Physical shape function gradient of node A in direction d, per lane
+    inline const Lanes &grad(int A, int d) const { return shapeGrad[A * topoDim + d]; }
+
+    // Load the elements elnums[0..nActive) into the lanes
+    void gather(const int *elnums, int nActive, const DoFManager &dofm);
+
+    // update lane values at a quadrature point (NSD must equal topoDim)
+    template<int NSD>
+    void update(int qpi, const DoFManager &dofm, const GeometryCache *geometry = nullptr);
+
+    const FE &reference;
+    int nActive{0};
+    std::array<int, Width> elements;
+    std::array<std::array<int, Width>, n_nodes> globalNodes;
+    std::array<Lanes, n_nodes * 3> nodeCoords;
+
+    //Lane data at a quadrature point
+    std::array<Lanes, n_nodes * topoDim> shapeGrad;
+    Lanes jxw;
+
+    //Local work storage, one local system per lane
+    LocalVector local_solution;
+    LocalVector local_residual;
+    LocalMatrix local_tangent;
+};
+
+
+template<typename FE, int Width>
+void ElementBatch<FE, Width>::gather(const int *elnums, int nActive, const DoFManager &dofm)
+{
+    this->nActive = nActive;
+    for (int l = 0; l < Width; ++l) {
+        elements[l] = elnums[l < nActive ? l : nActive - 1];
+        const int *nodes = dofm.elements.data() + dofm.element_offsets[elements[l]];
+        for (int A = 0; A < n_nodes; ++A) {
+            globalNodes[A][l] = nodes[A];
+            auto const &x = dofm.dof_nodes[nodes[A]];
+            for (int i = 0; i < 3; ++i) {
+                nodeCoords[A * 3 + i](l) = x(i);
+            }
+        }
+    }
+}
+
+
+template<typename FE, int Width>
+template<int NSD>
+void ElementBatch<FE, Width>::update(int qpi, const DoFManager &, const GeometryCache *geometry)
+{
+    static_assert(NSD == topoDim, "ElementBatch::update: only NSD == TopoDim is supported");
+    static_assert(NSD == 2 || NSD == 3, "ElementBatch::update: NSD must be 2 or 3");
+
+    bool cached = (geometry != nullptr);
+    for (int l = 0; cached && l < Width; ++l) {
+        cached = geometry->contains(elements[l]);
+    }
+    if (cached) {
+        for (int l = 0; l < Width; ++l) {
+            jxw(l) = geometry->jxw(elements[l], qpi);
+            const double *g = geometry->shapeGrad(elements[l], qpi);
+            for (int k = 0; k < n_nodes * NSD; ++k) {
+                shapeGrad[k](l) = g[k];
+            }
+        }
+        return;
+    }
+
+    auto const &gradXi = reference.shapeGradXi[qpi];
+
+    // J(i,j) = sum_A x_A(i) dN_A/dxi_j
+    std::array<Lanes, NSD * NSD> J;
+    for (auto &Jij : J) {
+        Jij.setZero();
+    }
+    for (int A = 0; A < n_nodes; ++A) {
+        for (int i = 0; i < NSD; ++i) {
+            for (int j = 0; j < NSD; ++j) {
+                J[i * NSD + j] += nodeCoords[A * 3 + i] * gradXi(A, j);
+            }
+        }
+    }
+
+    // Jinv = adj(J) / det(J)
+    std::array<Lanes, NSD * NSD> Jinv;
+    Lanes det;
+    if constexpr (NSD == 2) {
+        det = J[0] * J[3] - J[1] * J[2];
+        Jinv[0] = J[3];
+        Jinv[1] = -J[1];
+        Jinv[2] = -J[2];
+        Jinv[3] = J[0];
+    } else {
+        Jinv[0] = J[4] * J[8] - J[5] * J[7];
+        Jinv[1] = J[2] * J[7] - J[1] * J[8];
+        Jinv[2] = J[1] * J[5] - J[2] * J[4];
+        Jinv[3] = J[5] * J[6] - J[3] * J[8];
+        Jinv[4] = J[0] * J[8] - J[2] * J[6];
+        Jinv[5] = J[2] * J[3] - J[0] * J[5];
+        Jinv[6] = J[3] * J[7] - J[4] * J[6];
+        Jinv[7] = J[1] * J[6] - J[0] * J[7];
+        Jinv[8] = J[0] * J[4] - J[1] * J[3];
+        det = J[0] * Jinv[0] + J[1] * Jinv[3] + J[2] * Jinv[6];
+    }
+    Lanes invdet = det.inverse();
+    for (auto &Jinv_ij : Jinv) {
+        Jinv_ij *= invdet;
+    }
+
+    jxw = det * reference.weights[qpi];
+
+    // shapeGrad(A,d) = sum_j dN_A/dxi_j Jinv(j,d)
+    for (int A = 0; A < n_nodes; ++A) {
+        for (int d = 0; d < NSD; ++d) {
+            Lanes g = gradXi(A, 0) * Jinv[d];
+            for (int j = 1; j < NSD; ++j) {
+                g += gradXi(A, j) * Jinv[j * NSD + d];
+            }
+            shapeGrad[A * NSD + d] = g;
+        }
+    }
+}
+
+
+/**
+ * \class ElementBatchFactory
+ * \brief Per-thread ElementBatch for each of the FixedElement types
+ *
+ * visit(et, func) calls func(batch) with the ElementBatch over the
+ * FixedElement of type et (see FixedElementFactory for the covered types),
+ * and returns its result; it returns false for any other element type.
+ */
+template<int NSD, int DofPerNode, int Width>
+class ElementBatchFactory
+{
+public:
+    explicit ElementBatchFactory(ElementFactory &EF) : fixed_EF(EF) {}
+
+    template<typename Func>
+    bool visit(ElementType et, Func &&func)
+    {
+        return fixed_EF.visit(et, [this, &func](auto &fe) {
+            using Batch = ElementBatch<std::decay_t<decltype(fe)>, Width>;
+            auto &batch = std::get<std::unique_ptr<Batch>>(batches);
+            if (!batch) {
+                batch = std::make_unique<Batch>(fe);
+            }
+            return func(*batch);
+        });
+    }
+
+private:
+    FixedElementFactory<NSD, DofPerNode> fixed_EF;
+    std::tuple<std::unique_ptr<ElementBatch<FixedElement<ElementTopology::Simplex, NSD, 1, DofPerNode>, Width>>,
+            std::unique_ptr<ElementBatch<FixedElement<ElementTopology::Simplex, NSD, 2, DofPerNode>, Width>>,
+            std::unique_ptr<ElementBatch<FixedElement<ElementTopology::TensorProduct, NSD, 1, DofPerNode>, Width>>,
+            std::unique_ptr<ElementBatch<FixedElement<ElementTopology::TensorProduct, NSD, 2, DofPerNode>, Width>>>
+            batches;
+};
+
+YAFEL_NAMESPACE_CLOSE
+
+#endif //YAFEL_ELEMENTBATCH_HPP
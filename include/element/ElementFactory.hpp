@@ -19,7 +19,11 @@ class ElementFactory
 {
 
 public:
-    ElementFactory(int dof_per_node = 1, int quadratureOrderMultiplier = 2);
+    ElementFactory(int dof_per_node = 1, int quadratureOrderMultiplier = 2,
+                   QuadratureRule::QuadratureType quadratureType = QuadratureRule::QuadratureType::GAUSS_LEGENDRE);
+
+    // Elements with the dofs per node and the quadrature type of a DoFManager
+    explicit ElementFactory(const DoFManager &dofm, int quadratureOrderMultiplier = 2);
 
     Element &getElement(ElementType elementType);
 
@@ -28,6 +32,7 @@ public:
 private:
     int dof_per_node;
     int quadratureOrderMultiplier;
+    QuadratureRule::QuadratureType quadratureType;
     std::map<ElementType, Element> element_container;
 
 };
@@ -51,6 +51,11 @@ struct ElementType
         return std::make_tuple(elementTopology, topoDim, polyOrder)
                < std::make_tuple(rhs.elementTopology, rhs.topoDim, rhs.polyOrder);
     }
+
+    inline bool operator==(const ElementType &rhs) const
+    {
+        return elementTopology == rhs.elementTopology && topoDim == rhs.topoDim && polyOrder == rhs.polyOrder;
+    }
 };
 
 YAFEL_NAMESPACE_CLOSE
@@ -0,0 +1,228 @@
+#ifndef YAFEL_FIXEDELEMENT_HPP
+#define YAFEL_FIXEDELEMENT_HPP
+
+#include "yafel_globals.hpp"
+#include "yafel_typedefs.hpp"
+#include "element/Element.hpp"
+#include "element/ElementFactory.hpp"
+#include "element/ElementType.hpp"
+#include "fe_system/GeometryCache.hpp"
+#include "utils/DoFManager.hpp"
+
+#include <Eigen/Core>
+#include <Eigen/StdVector>
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+YAFEL_NAMESPACE_OPEN
+
+/**
+ * \class FixedElement
+ * \brief Element with compile-time sizes, for one fixed ElementType
+ *
+ * Holds the same reference data and quadrature-point values as Element
+ * (shapeValues, shapeGradXi, shapeGrad, jxw, globalNodes), copied from the
+ * Element of the same type, but in fixed-size Eigen storage. Physics kernels
+ * written generically over the element type (and the local matrix/vector types)
+ * get compile-time trip counts when called with a FixedElement, so local
+ * tangent construction can be fully unrolled and vectorized.
+ *
+ * The local vectors and matrices that go with the element are provided as
+ * LocalVector (n_dofs x 1) and LocalMatrix (n_dofs x n_dofs, row-major like the
+ * local tangent buffer of CGAssembly).
+ */
+template<ElementTopology Topology, int TopoDim, int PolyOrder, int DofPerNode = 1>
+class FixedElement
+{
+public:
+    static constexpr ElementTopology topology = Topology;
+    static constexpr int topoDim = TopoDim;
+    static constexpr int polyOrder = PolyOrder;
+
+    static constexpr int n_nodes = (Topology == ElementTopology::TensorProduct || TopoDim == 1)
+                                   ? (TopoDim == 1 ? PolyOrder + 1
+                                                   : TopoDim == 2 ? (PolyOrder + 1) * (PolyOrder + 1)
+                                                                  : (PolyOrder + 1) * (PolyOrder + 1) * (PolyOrder + 1))
+                                   : (TopoDim == 2 ? (PolyOrder + 1) * (PolyOrder + 2) / 2
+                                                   : (PolyOrder + 1) * (PolyOrder + 2) * (PolyOrder + 3) / 6);
+    static constexpr int n_dofs = n_nodes * DofPerNode;
+
+    using ValueVector = Eigen::Matrix<double, n_nodes, 1>;
+    using GradMatrix = Eigen::Matrix<double, n_nodes, TopoDim, (TopoDim == 1 ? Eigen::ColMajor : Eigen::RowMajor)>;
+    using LocalVector = Eigen::Matrix<double, n_dofs, 1>;
+    using LocalMatrix = Eigen::Matrix<double, n_dofs, n_dofs, Eigen::RowMajor>;
+
+    explicit FixedElement(const Element &E);
+
+    inline ElementType elementType() const { return ElementType(Topology, TopoDim, PolyOrder); }
+
+    inline static constexpr int dofPerNode() { return DofPerNode; }
+
+    inline static constexpr int getNode(int dof) { return dof / DofPerNode; }
+
+    inline static constexpr int getComp(int dof) { return dof % DofPerNode; }
+
+    inline int nQP() const { return static_cast<int>(weights.size()); }
+
+    // update element values at a quadrature point (NSD must equal TopoDim)
+    template<int NSD>
+    void update(int elnum, int qpi, const DoFManager &dofm, const GeometryCache *geometry = nullptr);
+
+    std::vector<double> weights;
+    std::vector<ValueVector, Eigen::aligned_allocator<ValueVector>> shapeValues;
+    std::vector<GradMatrix, Eigen::aligned_allocator<GradMatrix>> shapeGradXi;
+
+    //Element data at a quadrature point
+    GradMatrix shapeGrad;
+    double jxw;
+    std::array<int, n_nodes> globalNodes;
+};
+
+
+template<ElementTopology Topology, int TopoDim, int PolyOrder, int DofPerNode>
+FixedElement<Topology, TopoDim, PolyOrder, DofPerNode>::FixedElement(const Element &E)
+        : weights(E.quadratureRule.weights),
+          shapeValues(E.nQP()),
+          shapeGradXi(E.nQP()),
+          shapeGrad(GradMatrix::Zero()),
+          jxw(0),
+          globalNodes()
+{
+    if (E.elementType.elementTopology != Topology
+        || E.elementType.topoDim != TopoDim
+        || E.elementType.polyOrder != PolyOrder
+        || E.localMesh.nNodes() != n_nodes) {
+        throw std::runtime_error("FixedElement: Element does not match the fixed element type");
+    }
+
+    for (int qpi = 0; qpi < E.nQP(); ++qpi) {
+        shapeValues[qpi] = E.shapeValues[qpi];
+        for (int A = 0; A < n_nodes; ++A) {
+            for (int j = 0; j < TopoDim; ++j) {
+                shapeGradXi[qpi](A, j) = E.shapeGradXi[qpi](A, j);
+            }
+        }
+    }
+}
+
+
+template<ElementTopology Topology, int TopoDim, int PolyOrder, int DofPerNode>
+template<int NSD>
+void FixedElement<Topology, TopoDim, PolyOrder, DofPerNode>::update(int elnum, int qpi, const DoFManager &dofm,
+                                                                    const GeometryCache *geometry)
+{
+    static_assert(NSD == TopoDim, "FixedElement::update: only NSD == TopoDim is supported");
+
+    const int *nodes = dofm.elements.data() + dofm.element_offsets[elnum];
+    std::copy(nodes, nodes + n_nodes, globalNodes.begin());
+
+    if (geometry != nullptr && geometry->contains(elnum)) {
+        jxw = geometry->jxw(elnum, qpi);
+        std::copy(geometry->shapeGrad(elnum, qpi), geometry->shapeGrad(elnum, qpi) + n_nodes * NSD,
+                  shapeGrad.data());
+        return;
+    }
+
+    Tensor<NSD, 2> Jacobian(0);
+    for (int A = 0; A < n_nodes; ++A) {
+        auto const &x = dofm.dof_nodes[globalNodes[A]];
+        for (int i = 0; i < NSD; ++i) {
+            for (int j = 0; j < NSD; ++j) {
+                Jacobian(i, j) += x(i) * shapeGradXi[qpi](A, j);
+            }
+        }
+    }
+
+    jxw = determinant(Jacobian) * weights[qpi];
+    Tensor<NSD, 2> Jinv = inverse(Jacobian);
+
+    // shapeGrad = shapeGradXi * Jinv, i.e. each row is JinvT * (row of shapeGradXi)
+    for (int A = 0; A < n_nodes; ++A) {
+        for (int d = 0; d < NSD; ++d) {
+            double g{0};
+            for (int j = 0; j < NSD; ++j) {
+                g += shapeGradXi[qpi](A, j) * Jinv(j, d);
+            }
+            shapeGrad(A, d) = g;
+        }
+    }
+}
+
+
+/**
+ * \class FixedElementFactory
+ * \brief Per-thread set of the FixedElements that have compile-time kernels
+ *
+ * Covers the linear and quadratic simplices and tensor product elements of
+ * dimension NSD (Tri3/Tri6/Quad4/Quad9 for NSD = 2, Tet4/Tet10/Hex8/Hex27 for
+ * NSD = 3). visit(et, func) calls func(FE) with the FixedElement of type et,
+ * built on first use from EF, and returns its result; it returns false without
+ * calling func for any other element type.
+ */
+template<int NSD, int DofPerNode>
+class FixedElementFactory
+{
+public:
+    explicit FixedElementFactory(ElementFactory &EF) : EF(EF) {}
+
+    template<typename Func>
+    bool visit(ElementType et, Func &&func);
+
+private:
+    template<typename FE, typename Func>
+    bool call(std::unique_ptr<FE> &fe, ElementType et, Func &func)
+    {
+        if (!fe) {
+            fe = std::make_unique<FE>(EF.getElement(et));
+        }
+        return func(*fe);
+    }
+
+    ElementFactory &EF;
+    std::unique_ptr<FixedElement<ElementTopology::Simplex, NSD, 1, DofPerNode>> simplex_1;
+    std::unique_ptr<FixedElement<ElementTopology::Simplex, NSD, 2, DofPerNode>> simplex_2;
+    std::unique_ptr<FixedElement<ElementTopology::TensorProduct, NSD, 1, DofPerNode>> tensor_product_1;
+    std::unique_ptr<FixedElement<ElementTopology::TensorProduct, NSD, 2, DofPerNode>> tensor_product_2;
+};
+
+
+template<int NSD, int DofPerNode>
+template<typename Func>
+bool FixedElementFactory<NSD, DofPerNode>::visit(ElementType et, Func &&func)
+{
+    if constexpr (NSD < 2) {
+        return false;
+    } else {
+        if (et.topoDim != NSD) {
+            return false;
+        }
+
+        if (et.elementTopology == ElementTopology::Simplex) {
+            switch (et.polyOrder) {
+                case 1:
+                    return call(simplex_1, et, func);
+                case 2:
+                    return call(simplex_2, et, func);
+                default:
+                    return false;
+            }
+        } else if (et.elementTopology == ElementTopology::TensorProduct) {
+            switch (et.polyOrder) {
+                case 1:
+                    return call(tensor_product_1, et, func);
+                case 2:
+                    return call(tensor_product_2, et, func);
+                default:
+                    return false;
+            }
+        }
+        return false;
+    }
+}
+
+YAFEL_NAMESPACE_CLOSE
+
+#endif //YAFEL_FIXEDELEMENT_HPP
@@ -0,0 +1,94 @@
+#ifndef YAFEL_TENSORPRODUCTBASIS1D_HPP
+#define YAFEL_TENSORPRODUCTBASIS1D_HPP
+
+#include "yafel_globals.hpp"
+#include <Eigen/Core>
+#include <vector>
+
+YAFEL_NAMESPACE_OPEN
+
+/**
+ * \class TensorProductBasis1D
+ * \brief 1D factors of the quad/hex (TensorProduct) elements, for sum factorization
+ *
+ * The local nodes of a tensor product element are the tensor product of the
+ * p+1 Gauss-Lobatto points, numbered lexicographically with xi_0 fastest, and
+ * its quadrature rule is the tensor product of a 1D Gauss-Legendre rule
+ * (see make_tensorproduct_element.cpp). Shape functions and their gradients at
+ * the quadrature points therefore factor into the 1D matrices held here:
+ *
+ *   - values(q, a):      Lagrange polynomial a (through the nodes) at quadrature point q
+ *   - derivatives(q, a): its derivative at quadrature point q
+ *   - collocationDerivatives(q, r): derivative of the Lagrange polynomial through the
+ *     quadrature points, r, at quadrature point q. Differentiates a field that is
+ *     already interpolated to the quadrature points.
+ */
+class TensorProductBasis1D
+{
+public:
+    using MatrixType = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+
+    /**
+     * @param polyOrder Interpolation order of the element
+     * @param quadratureOrderMultiplier Same meaning as in Element: the rule integrates
+     *        polynomials of order quadratureOrderMultiplier*polyOrder exactly
+     */
+    TensorProductBasis1D(int polyOrder, int quadratureOrderMultiplier = 2);
+
+    inline int nNodes() const { return static_cast<int>(nodes.size()); }
+
+    inline int nQP() const { return static_cast<int>(qp_nodes.size()); }
+
+    /**
+     * Contract one direction of a tensor with a matrix.
+     *
+     * `in` is a dense tensor of rank (dir + 1 + ...) stored with direction 0 fastest,
+     * viewed as (post x nb x pre): `pre` is the product of the extents before `dir`
+     * and `post` the product of those after it. Writes (or adds, if Add) into `out`,
+     * viewed as (post x na x pre):
+     *
+     *   out(k, a, i) = sum_b M(a, b) in(k, b, i),   M(a, b) = M_data[a*sa + b*sb]
+     *
+     * Passing swapped strides (sa, sb) contracts with the transpose of M.
+     */
+    template<bool Add>
+    static void contract(const double *M_data, int sa, int sb, int na, int nb,
+                         int pre, int post, const double *in, double *out);
+
+    std::vector<double> nodes;
+    std::vector<double> qp_nodes;
+    std::vector<double> qp_weights;
+
+    MatrixType values;
+    MatrixType derivatives;
+    MatrixType collocationDerivatives;
+};
+
+
+template<bool Add>
+void TensorProductBasis1D::contract(const double *M_data, int sa, int sb, int na, int nb,
+                                    int pre, int post, const double *in, double *out)
+{
+    for (int k = 0; k < post; ++k) {
+        const double *in_k = in + k * nb * pre;
+        for (int a = 0; a < na; ++a) {
+            double *o = out + (k * na + a) * pre;
+            if (!Add) {
+                for (int i = 0; i < pre; ++i) {
+                    o[i] = 0;
+                }
+            }
+            for (int b = 0; b < nb; ++b) {
+                const double m = M_data[a * sa + b * sb];
+                const double *in_kb = in_k + b * pre;
+                for (int i = 0; i < pre; ++i) {
+                    o[i] += m * in_kb[i];
+                }
+            }
+        }
+    }
+}
+
+YAFEL_NAMESPACE_CLOSE
+
+#endif //YAFEL_TENSORPRODUCTBASIS1D_HPP
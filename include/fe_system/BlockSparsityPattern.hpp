@@ -0,0 +1,73 @@
+#ifndef YAFEL_BLOCKSPARSITYPATTERN_HPP
+#define YAFEL_BLOCKSPARSITYPATTERN_HPP
+
+#include "yafel_globals.hpp"
+#include "fe_system/SparsityPattern.hpp"
+#include "utils/DoFManager.hpp"
+
+#include <vector>
+
+YAFEL_NAMESPACE_OPEN
+
+/**
+ * \class BlockSparsityPattern
+ * \brief Block compressed-row structure of the global tangent, one block per coupled node pair
+ *
+ * The node-level counterpart of SparsityPattern, for BCSRMatrix: the block size is
+ * the DoFManager's dof_per_node, block row/column n holds the dofs of node n, and
+ * nodes are coupled when they share an element of dimension topoDim. Only the
+ * column index of each block is stored, instead of one row (or column) index per
+ * scalar entry.
+ *
+ * Blocks are stored column-major, one after the other in the value array, and the
+ * element position maps send entry (A,B) of the row-major local tangent to its
+ * place in that array, as SparsityPattern's do for Eigen::SparseMatrix. CGAssembly
+ * scatters through either.
+ */
+class BlockSparsityPattern
+{
+public:
+    BlockSparsityPattern(const DoFManager &dofm, int topoDim);
+
+    // Position in the value array of block (block_row, block_col), or -1 if it is not in the structure
+    int blockPosition(int block_row, int block_col) const;
+
+    inline const std::vector<int> &blockRowPtr() const { return block_row_ptr; }
+
+    inline const std::vector<int> &blockColIndex() const { return block_col_index; }
+
+    inline const int *elementPositions(int elnum) const
+    {
+        return element_positions.data() + element_position_offsets[elnum];
+    }
+
+    inline ElementPositionMap elementPositionMap() const
+    {
+        return {element_positions.data(), element_position_offsets.data()};
+    }
+
+    inline int blockSize() const { return block_size; }
+
+    inline int nBlockRows() const { return n_nodes; }
+
+    inline int nBlocks() const { return static_cast<int>(block_col_index.size()); }
+
+    inline int rows() const { return n_nodes * block_size; }
+
+    inline int topoDim() const { return topo_dim; }
+
+private:
+    int n_nodes;
+    int block_size;
+    int topo_dim;
+
+    std::vector<int> block_row_ptr;
+    std::vector<int> block_col_index;
+
+    std::vector<int> element_position_offsets;
+    std::vector<int> element_positions;
+};
+
+YAFEL_NAMESPACE_CLOSE
+
+#endif //YAFEL_BLOCKSPARSITYPATTERN_HPP
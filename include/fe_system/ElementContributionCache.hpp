@@ -0,0 +1,84 @@
+#ifndef YAFEL_ELEMENTCONTRIBUTIONCACHE_HPP
+#define YAFEL_ELEMENTCONTRIBUTIONCACHE_HPP
+
+#include "yafel_globals.hpp"
+#include "utils/DoFManager.hpp"
+
+#include <cstddef>
+#include <vector>
+
+YAFEL_NAMESPACE_OPEN
+
+/**
+ * \class ElementContributionCache
+ * \brief The local tangent and residual last scattered by each element
+ *
+ * Filled by CGAssembly, element by element, when enabled on the FESystem
+ * (FESystem::enableElementCache). CGAssemblyIncremental then replaces the
+ * contributions of a set of changed elements in the assembled global system:
+ * exchange*() stores the new local values and turns them into the difference
+ * to the recorded ones, which is what gets scattered.
+ *
+ * Values are stored in double precision, or in single precision to halve the
+ * memory; in that case every incremental update leaves a rounding error of
+ * order 1e-7 relative to the element contributions in the global system.
+ */
+class ElementContributionCache
+{
+public:
+    enum class Storage : int
+    {
+        Double,
+        Single
+    };
+
+    ElementContributionCache(const DoFManager &dofm, int topoDim, Storage storage = Storage::Double);
+
+    /**
+     * (Re)allocate for the given contributions; recorded values are discarded.
+     * generation is the FESystem::constraintGeneration() of the assembly that records them.
+     */
+    void prepare(bool tangent, bool residual, long generation);
+
+    inline bool hasTangent() const { return has_tangent; }
+
+    inline bool hasResidual() const { return has_residual; }
+
+    inline long generation() const { return system_generation; }
+
+    inline int topoDim() const { return topo_dim; }
+
+    inline Storage storage() const { return storage_type; }
+
+    // Bytes held by the recorded values
+    std::size_t memoryUsage() const;
+
+    /**
+     * Record the row-major local tangent of elnum, whose entry i is K[i * stride].
+     * If subtract, K is replaced by K minus the previously recorded tangent.
+     */
+    void exchangeTangent(int elnum, double *K, int stride, bool subtract);
+
+    // Same as exchangeTangent, for the local residual
+    void exchangeResidual(int elnum, double *R, int stride, bool subtract);
+
+private:
+    int topo_dim;
+    Storage storage_type;
+    bool has_tangent{false};
+    bool has_residual{false};
+    long system_generation{0};
+
+    // Per element: first entry of its local tangent and residual (element e spans [e, e+1))
+    std::vector<std::size_t> tangent_offsets;
+    std::vector<std::size_t> residual_offsets;
+
+    std::vector<double> tangent_double;
+    std::vector<double> residual_double;
+    std::vector<float> tangent_single;
+    std::vector<float> residual_single;
+};
+
+YAFEL_NAMESPACE_CLOSE
+
+#endif //YAFEL_ELEMENTCONTRIBUTIONCACHE_HPP
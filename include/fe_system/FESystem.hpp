@@ -6,8 +6,16 @@
 #define YAFEL_FESYSTEM_HPP
 
 #include "yafel_globals.hpp"
+#include "assembly/AssemblyBackend.hpp"
 #include "utils/DoFManager.hpp"
+#include "fe_system/BlockSparsityPattern.hpp"
+#include "fe_system/SparsityPattern.hpp"
+#include "fe_system/ElementContributionCache.hpp"
+#include "fe_system/FaceGeometryCache.hpp"
+#include "fe_system/GeometryCache.hpp"
+#include "utils/LazyCache.hpp"
 #include <Eigen/Sparse>
+#include <memory>
 
 YAFEL_NAMESPACE_OPEN
 
@@ -20,7 +28,14 @@ class FESystem
 
 public:
     inline FESystem(DoFManager &dofm, int dim = 0)
-            : dofm(dofm), simulation_dimension(dim), time(0)
+            : dofm(dofm),
+              geometry_cache_budget(GeometryCache::default_memory_budget),
+              assembly_backend(AssemblyBackend::OpenMP),
+              assembly_chunk_size(0),
+              element_cache_enabled(false),
+              element_cache_storage(ElementContributionCache::Storage::Double),
+              simulation_dimension(dim),
+              time(0)
     {
         int ndofs = dofm.dof_nodes.size() * dofm.dof_per_node;
         global_residual = Eigen::VectorXd::Constant(ndofs, 0.0);
@@ -38,6 +53,122 @@ public:
 
     inline auto &getDoFManager() { return dofm; }
 
+    /**
+     * Get the sparsity pattern of the global tangent for elements of dimension topoDim.
+     * It is built from the DoFManager on first use and reused by subsequent assemblies.
+     * This and the other caches below keep one object per topoDim and are thread-safe.
+     */
+    inline SparsityPattern const &getSparsityPattern(int topoDim)
+    {
+        return sparsity_patterns.get(topoDim, [&]() { return std::make_unique<SparsityPattern>(dofm, topoDim); });
+    }
+
+    /**
+     * Get the node-block sparsity pattern (for a BCSRMatrix tangent) for elements
+     * of dimension topoDim. Built on first use, like getSparsityPattern().
+     */
+    inline BlockSparsityPattern const &getBlockSparsityPattern(int topoDim)
+    {
+        return block_sparsity_patterns.get(topoDim, [&]() {
+            return std::make_unique<BlockSparsityPattern>(dofm, topoDim);
+        });
+    }
+
+    /**
+     * Get the quadrature-point geometry of the elements of dimension topoDim, for
+     * Element::update. Built on first use and reused by subsequent element loops.
+     * Returns nullptr if caching is disabled (a budget of 0 bytes).
+     */
+    inline GeometryCache const *getGeometryCache(int topoDim)
+    {
+        if (geometry_cache_budget == 0) {
+            return nullptr;
+        }
+        return &geometry_caches.get(topoDim, [&]() {
+            return std::make_unique<GeometryCache>(dofm, topoDim, geometry_cache_budget);
+        });
+    }
+
+    /**
+     * Set the memory budget (bytes) of the geometry cache. Elements beyond it are
+     * evaluated on the fly; 0 disables the cache. Also discards the current
+     * element and face caches, so call it again if the mesh nodes move.
+     */
+    inline void setGeometryCacheBudget(std::size_t bytes)
+    {
+        geometry_cache_budget = bytes;
+        geometry_caches.reset();
+        face_geometry_caches.reset();
+    }
+
+    /**
+     * Get the face quadrature-point geometry and traces of the DoFManager's
+     * faces in nsd spatial dimensions, for the DG face loops. Built on first use.
+     */
+    inline FaceGeometryCache const &getFaceGeometryCache(int nsd)
+    {
+        return face_geometry_caches.get(nsd, [&]() { return std::make_unique<FaceGeometryCache>(dofm, nsd); });
+    }
+
+    /**
+     * Keep the local tangent/residual of every element at each CGAssembly, which
+     * CGAssemblyIncremental needs. Discards any recorded contributions.
+     */
+    inline void enableElementCache(ElementContributionCache::Storage storage
+                                   = ElementContributionCache::Storage::Double)
+    {
+        element_cache_enabled = true;
+        element_cache_storage = storage;
+        element_caches.reset();
+    }
+
+    inline void disableElementCache()
+    {
+        element_cache_enabled = false;
+        element_caches.reset();
+    }
+
+    /**
+     * Get the element contribution cache for elements of dimension topoDim.
+     * Returns nullptr if it is not enabled.
+     */
+    inline ElementContributionCache *getElementCache(int topoDim)
+    {
+        if (!element_cache_enabled) {
+            return nullptr;
+        }
+        return &element_caches.get(topoDim, [&]() {
+            return std::make_unique<ElementContributionCache>(dofm, topoDim, element_cache_storage);
+        });
+    }
+
+    /**
+     * Select the parallel runtime of the assembly element loops. For the
+     * TaskScheduler backend, chunkSize is the number of elements per task
+     * (0 picks one from the color size and the number of workers).
+     */
+    inline void setAssemblyBackend(AssemblyBackend backend, int chunkSize = 0)
+    {
+        assembly_backend = backend;
+        assembly_chunk_size = chunkSize;
+    }
+
+    inline AssemblyBackend getAssemblyBackend() const { return assembly_backend; }
+
+    inline int getAssemblyChunkSize() const { return assembly_chunk_size; }
+
+    /**
+     * Number of times the global tangent and residual were modified in place
+     * outside of assembly, by DirichletBC::apply(FESystem &). CGAssemblyIncremental
+     * only updates a system left as its last CGAssembly assembled it.
+     */
+    inline long constraintGeneration() const { return constraint_generation; }
+
+    inline void markConstrained() { ++constraint_generation; }
+
+    // Per-worker load of the last assembly on this system
+    inline auto &getAssemblyStatistics() { return assembly_statistics; }
+
     inline auto &getDimension() { return simulation_dimension; }
 
     inline auto &currentTime() { return time; }
@@ -50,6 +181,18 @@ protected:
     Eigen::VectorXd global_residual;
     Eigen::VectorXd solution_vector;
     Eigen::Matrix<double,Eigen::Dynamic,Eigen::Dynamic, Eigen::RowMajor> solution_gradient;
+    LazyCache<SparsityPattern> sparsity_patterns;
+    LazyCache<BlockSparsityPattern> block_sparsity_patterns;
+    LazyCache<GeometryCache> geometry_caches;
+    LazyCache<FaceGeometryCache> face_geometry_caches;
+    std::size_t geometry_cache_budget;
+    AssemblyBackend assembly_backend;
+    int assembly_chunk_size;
+    AssemblyStatistics assembly_statistics;
+    LazyCache<ElementContributionCache> element_caches;
+    bool element_cache_enabled;
+    ElementContributionCache::Storage element_cache_storage;
+    long constraint_generation{0};
 
     int simulation_dimension;
     double time;
@@ -0,0 +1,103 @@
+#ifndef YAFEL_FACEGEOMETRYCACHE_HPP
+#define YAFEL_FACEGEOMETRYCACHE_HPP
+
+#include "yafel_globals.hpp"
+#include "yafel_typedefs.hpp"
+#include "utils/DoFManager.hpp"
+
+#include <cstddef>
+#include <vector>
+
+YAFEL_NAMESPACE_OPEN
+
+/**
+ * \class FaceGeometryCache
+ * \brief Precomputed quadrature-point geometry and traces of the faces of a fixed mesh
+ *
+ * For every face of DoFManager::interior_faces and every face quadrature point,
+ * stores what Element::face_update computes on the two sides (the unit normal,
+ * and the surface jacobian times the weight of each side), the physical point,
+ * and the face shape function values. Per face, the left and right traces list
+ * the global nodes of the face, in matching order. All arrays are flat and
+ * packed face by face, so face loops stream through them without allocating.
+ *
+ * Boundary faces are stored as seen from their only element, which takes the
+ * left slot whichever side of the CellFace it is on: the normal points out of
+ * it, and the right trace and jacobian repeat the left ones.
+ *
+ * The cache is only valid as long as the DoFManager's nodes do not move.
+ * Obtain through FESystem::getFaceGeometryCache so that it is built once.
+ */
+class FaceGeometryCache
+{
+public:
+    FaceGeometryCache(const DoFManager &dofm, int nsd, int quadratureOrderMultiplier = 2);
+
+    inline int nFaces() const { return static_cast<int>(face_qp_offsets.size()) - 1; }
+
+    inline int nFaceQP(int face) const { return face_qp_offsets[face + 1] - face_qp_offsets[face]; }
+
+    inline bool isBoundary(int face) const { return boundary[face] != 0; }
+
+    // Face quadrature point i is trace node i (collocated Lobatto elements): the
+    // shape values are the identity, and traces are read without interpolation
+    inline bool isCollocated(int face) const { return collocated[face] != 0; }
+
+    // Unit normal, pointing from the left to the right element
+    template<int NSD>
+    inline Tensor<NSD, 1> normal(int face, int fqpi) const
+    {
+        const double *n = normals.data() + std::size_t(face_qp_offsets[face] + fqpi) * nsd;
+        Tensor<NSD, 1> N;
+        for (int i = 0; i < NSD; ++i) {
+            N(i) = n[i];
+        }
+        return N;
+    }
+
+    inline double jxwLeft(int face, int fqpi) const { return jxw_left[face_qp_offsets[face] + fqpi]; }
+
+    inline double jxwRight(int face, int fqpi) const { return jxw_right[face_qp_offsets[face] + fqpi]; }
+
+    inline const coordinate<> &xqp(int face, int fqpi) const { return points[face_qp_offsets[face] + fqpi]; }
+
+    inline int nTraceNodes(int face) const { return trace_offsets[face + 1] - trace_offsets[face]; }
+
+    inline const int *leftTrace(int face) const { return left_trace.data() + trace_offsets[face]; }
+
+    inline const int *rightTrace(int face) const { return right_trace.data() + trace_offsets[face]; }
+
+    // Values of the nTraceNodes(face) face shape functions at a face quadrature point
+    inline const double *shapeValues(int face, int fqpi) const
+    {
+        return shape_values.data() + shape_offsets[face] + std::size_t(fqpi) * nTraceNodes(face);
+    }
+
+    inline int nsdim() const { return nsd; }
+
+    // Bytes held by the cached values
+    std::size_t memoryUsage() const;
+
+private:
+    int nsd;
+
+    std::vector<int> face_qp_offsets;
+    std::vector<int> trace_offsets;
+    std::vector<char> boundary;
+    std::vector<char> collocated;
+
+    std::vector<double> normals;
+    std::vector<double> jxw_left;
+    std::vector<double> jxw_right;
+    std::vector<coordinate<>> points;
+    std::vector<int> left_trace;
+    std::vector<int> right_trace;
+
+    // Shape values are shared by the faces of one element type; per face, the first entry of its table
+    std::vector<std::size_t> shape_offsets;
+    std::vector<double> shape_values;
+};
+
+YAFEL_NAMESPACE_CLOSE
+
+#endif //YAFEL_FACEGEOMETRYCACHE_HPP
@@ -0,0 +1,84 @@
+#ifndef YAFEL_GEOMETRYCACHE_HPP
+#define YAFEL_GEOMETRYCACHE_HPP
+
+#include "yafel_globals.hpp"
+#include "quadrature/QuadratureRule.hpp"
+#include "utils/DoFManager.hpp"
+
+#include <cstddef>
+#include <vector>
+
+YAFEL_NAMESPACE_OPEN
+
+/**
+ * \class GeometryCache
+ * \brief Precomputed quadrature-point geometry of a fixed mesh
+ *
+ * For every element of the given topological dimension, stores detJ times the
+ * quadrature weight and the physical shape function gradients at each
+ * quadrature point: exactly what Element::update computes. The two quantities
+ * are kept in separate contiguous arrays, element by element and quadrature
+ * point by quadrature point; the gradients at one point are a row-major
+ * (nodes x topoDim) block, the layout of Element::shapeGrad.
+ *
+ * The quadrature is the DoFManager's quadratureType, and Element::update rejects
+ * an element built with another rule (or order multiplier).
+ *
+ * Elements are cached in order until the memory budget (in bytes) is used up.
+ * The remaining elements are not cached (contains() is false), and
+ * Element::update evaluates them on the fly as before.
+ *
+ * The cache is only valid as long as the DoFManager's nodes do not move.
+ * Obtain through FESystem::getGeometryCache so that it is built once.
+ */
+class GeometryCache
+{
+public:
+    static constexpr std::size_t default_memory_budget = std::size_t(512) << 20;
+
+    GeometryCache(const DoFManager &dofm, int topoDim,
+                  std::size_t memoryBudget = default_memory_budget,
+                  int quadratureOrderMultiplier = 2);
+
+    inline bool contains(int elnum) const { return qp_offsets[elnum] >= 0; }
+
+    inline double jxw(int elnum, int qpi) const { return jxw_values[qp_offsets[elnum] + qpi]; }
+
+    inline const double *shapeGrad(int elnum, int qpi) const
+    {
+        return shape_grad_values.data() + grad_offsets[elnum] + std::size_t(qpi) * grad_strides[elnum];
+    }
+
+    inline int topoDim() const { return topo_dim; }
+
+    inline QuadratureRule::QuadratureType quadratureType() const { return quadrature_type; }
+
+    inline int quadratureOrderMultiplier() const { return quadrature_order_multiplier; }
+
+    inline int nCachedElements() const { return n_cached; }
+
+    // Bytes held by the cached values
+    inline std::size_t memoryUsage() const
+    {
+        return sizeof(double) * (jxw_values.size() + shape_grad_values.size());
+    }
+
+private:
+    int topo_dim;
+    int n_cached;
+    QuadratureRule::QuadratureType quadrature_type;
+    int quadrature_order_multiplier;
+
+    // Per element: first qp in jxw_values (-1 if not cached), first entry in
+    // shape_grad_values, and the size of its per-qp gradient block
+    std::vector<int> qp_offsets;
+    std::vector<std::size_t> grad_offsets;
+    std::vector<int> grad_strides;
+
+    std::vector<double> jxw_values;
+    std::vector<double> shape_grad_values;
+};
+
+YAFEL_NAMESPACE_CLOSE
+
+#endif //YAFEL_GEOMETRYCACHE_HPP
@@ -0,0 +1,155 @@
+#ifndef YAFEL_HDGSYSTEM_HPP
+#define YAFEL_HDGSYSTEM_HPP
+
+#include "yafel_globals.hpp"
+#include "fe_system/FESystem.hpp"
+#include "utils/DoFManager.hpp"
+
+#include <Eigen/Core>
+#include <Eigen/Sparse>
+#include <cstddef>
+#include <vector>
+
+YAFEL_NAMESPACE_OPEN
+
+/**
+ * \class HDGSystem
+ * \brief Face-trace (skeleton) unknowns and statically condensed system of an HDG discretization
+ *
+ * The element-interior unknowns live in a DG FESystem (its DoFManager must have
+ * faces, with dof_per_node interior unknowns per node). Every face of the
+ * DoFManager carries trace unknowns on its nodes, traceDofPerNode() per node, in
+ * the order of the face's left trace. Trace dofs of interior faces come first and
+ * are the unknowns of the global (skeleton) system; the trace dofs of boundary
+ * faces follow, and hold prescribed values.
+ *
+ * HDGAssembly condenses every element onto its trace unknowns, keeping for each
+ * element A^{-1}B and A^{-1}F, and assembles the skeleton system
+ * getGlobalTangent() x = getGlobalResidual(). recover(x) then computes the
+ * interior unknowns of every element, in parallel, into the volume FESystem's
+ * solution.
+ *
+ * Element e sees its faces in increasing face order; on each face, its trace
+ * unknowns follow the face's trace order, and elementFaceNodes gives the local
+ * nodes of e on that face, in the same order.
+ */
+class HDGSystem
+{
+public:
+    HDGSystem(FESystem &volumeSystem, int nsd, int trace_dof_per_node = 1);
+
+    inline FESystem &getVolumeSystem() { return volume_system; }
+
+    inline const DoFManager &getDoFManager() const { return dofm; }
+
+    inline int nsdim() const { return nsd; }
+
+    inline int traceDofPerNode() const { return trace_dof_per_node; }
+
+    // Size of the skeleton system: the trace dofs of interior faces
+    inline int nSkeletonDofs() const { return n_skeleton_dofs; }
+
+    // All trace dofs, boundary faces included
+    inline int nTraceDofs() const { return static_cast<int>(trace_solution.rows()); }
+
+    inline bool isBoundaryDof(int trace_dof) const { return trace_dof >= n_skeleton_dofs; }
+
+    // First trace dof of face f
+    inline int faceDofOffset(int f) const { return face_dof_offsets[f]; }
+
+    inline int nFaceNodes(int f) const { return dofm.face_offsets[f + 1] - dofm.face_offsets[f]; }
+
+    inline bool isBoundaryFace(int f) const
+    {
+        return dofm.interior_faces[f].left < 0 || dofm.interior_faces[f].right < 0;
+    }
+
+    // Elements that get condensed: those of dimension nsd
+    inline bool isCondensed(int e) const { return element_face_offsets[e + 1] > element_face_offsets[e]; }
+
+    inline int nElementFaces(int e) const { return element_face_offsets[e + 1] - element_face_offsets[e]; }
+
+    inline int elementFace(int e, int i) const { return element_faces[element_face_offsets[e] + i]; }
+
+    // Local nodes of element e on its i-th face, in the face's trace order
+    inline const int *elementFaceNodes(int e, int i) const
+    {
+        return element_face_nodes.data() + element_face_node_offsets[element_face_offsets[e] + i];
+    }
+
+    // Trace dofs of element e, face after face, and their number
+    inline int nElementTraceDofs(int e) const { return trace_dof_offsets[e + 1] - trace_dof_offsets[e]; }
+
+    inline const int *elementTraceDofs(int e) const { return element_trace_dofs.data() + trace_dof_offsets[e]; }
+
+    // Local trace dof of element e where its i-th face starts
+    inline int elementFaceDofOffset(int e, int i) const
+    {
+        return element_face_dof_offsets[element_face_offsets[e] + i];
+    }
+
+    /**
+     * Condensed operator of element e, nInterior x (nElementTraceDofs(e) + 1) and
+     * column-major: A^{-1}B, then A^{-1}F as the last column
+     */
+    inline double *condensedOperator(int e) { return condensed.data() + condensed_offsets[e]; }
+
+    // Local skeleton matrix D - C A^{-1}B of element e (column-major) and right-hand side -C A^{-1}F
+    inline double *localTangent(int e) { return local_tangents.data() + local_tangent_offsets[e]; }
+
+    inline double *localResidual(int e) { return local_residuals.data() + trace_dof_offsets[e]; }
+
+    inline auto &getGlobalTangent() { return global_tangent; }
+
+    inline auto &getGlobalResidual() { return global_residual; }
+
+    // Values of all trace dofs: the skeleton solution, then the prescribed boundary values
+    inline auto &getTraceSolution() { return trace_solution; }
+
+    /**
+     * Sum the local skeleton matrices and right-hand sides into the global system,
+     * row by row in parallel, moving the boundary trace values to the right-hand side
+     */
+    void assembleSkeleton();
+
+    /**
+     * Store the skeleton solution and compute the interior unknowns of every element,
+     * U_e = A^{-1}F - A^{-1}B lambda_e, into the volume FESystem's solution
+     */
+    void recover(const Eigen::VectorXd &skeleton_solution);
+
+    // Bytes held by the condensed operators and local skeleton matrices
+    std::size_t memoryUsage() const;
+
+private:
+    FESystem &volume_system;
+    const DoFManager &dofm;
+    int nsd;
+    int trace_dof_per_node;
+    int n_skeleton_dofs;
+
+    std::vector<int> face_dof_offsets;
+
+    std::vector<int> element_face_offsets;
+    std::vector<int> element_faces;
+    std::vector<int> element_face_node_offsets;
+    std::vector<int> element_face_nodes;
+    std::vector<int> element_face_dof_offsets;
+
+    std::vector<int> trace_dof_offsets;
+    std::vector<int> element_trace_dofs;
+
+    std::vector<std::size_t> condensed_offsets;
+    std::vector<double> condensed;
+    std::vector<std::size_t> local_tangent_offsets;
+    std::vector<double> local_tangents;
+    std::vector<double> local_residuals;
+
+    Eigen::SparseMatrix<double, Eigen::RowMajor> global_tangent;
+    Eigen::VectorXd global_residual;
+    Eigen::VectorXd trace_solution;
+};
+
+YAFEL_NAMESPACE_CLOSE
+
+#endif //YAFEL_HDGSYSTEM_HPP
@@ -0,0 +1,149 @@
+#ifndef YAFEL_INVERSEMASSOPERATOR_HPP
+#define YAFEL_INVERSEMASSOPERATOR_HPP
+
+#include "yafel_globals.hpp"
+#include "element/ElementFactory.hpp"
+#include "element/ElementType.hpp"
+#include "fe_system/GeometryCache.hpp"
+#include "utils/DoFManager.hpp"
+
+#include <Eigen/Core>
+#include <cstddef>
+#include <vector>
+
+YAFEL_NAMESPACE_OPEN
+
+/**
+ * \class InverseMassOperator
+ * \brief Block-diagonal inverse of a DG mass matrix, applied to all elements at once
+ *
+ * Built from the local mass matrices of a Physics (Physics::LocalMass). A
+ * diagonal mass matrix (collocated Lobatto elements) is stored as the inverse
+ * of its diagonal. Otherwise, an element whose mass matrix is a scalar multiple
+ * of the first one of its
+ * ElementType (affine elements, with a constant density) stores only that
+ * scalar: the inverse of the reference mass matrix is kept once per type.
+ * The other elements (curved, or with varying coefficients) store an explicit
+ * dense inverse, contiguously.
+ *
+ * apply() multiplies the element blocks of a global vector by the inverses:
+ * the scaled elements of each type in chunks of chunk_size columns, gathered
+ * into one matrix and multiplied by the reference inverse (one small GEMM per
+ * chunk), the dense ones with one matrix-vector product each, and the diagonal
+ * ones entry by entry. Chunks are fixed
+ * at build time, so the result does not depend on the number of threads.
+ */
+class InverseMassOperator
+{
+public:
+    static constexpr int chunk_size = 64;
+
+    // Relative distance to a multiple of the reference mass under which an element is scaled
+    static constexpr double affine_tolerance = 1.0e-12;
+
+    /**
+     * Compute the local mass matrices of the elements of dimension Physics::nsd(),
+     * through Physics::LocalMass(E, qpi, time, M_el), and factor them.
+     */
+    template<typename Physics>
+    void build(const DoFManager &dofm, double time = 0, const GeometryCache *geometry = nullptr);
+
+    inline bool isBuilt() const { return built; }
+
+    // In place: x_e <- M_e^{-1} x_e on the dofs of every element
+    void apply(Eigen::VectorXd &x) const;
+
+    // In place, on the dofs of the listed elements only (one matrix-vector product each)
+    void apply(Eigen::VectorXd &x, const std::vector<int> &elements) const;
+
+    // Elements stored as a scalar times a reference inverse, and with a dense inverse
+    inline int nScaledElements() const { return n_scaled; }
+
+    inline int nDenseElements() const { return n_dense; }
+
+    inline int nDiagonalElements() const { return static_cast<int>(diagonal_elements.size()); }
+
+    // Bytes held by the inverses, scales and dof lists
+    std::size_t memoryUsage() const;
+
+private:
+    void clear(const DoFManager &dofm);
+
+    // Record the mass matrix M of element elnum (of type et), with global dofs `dofs`
+    void addElement(int elnum, ElementType et, const std::vector<int> &dofs, const Eigen::MatrixXd &M);
+
+    // Invert the reference mass matrices, and cut the scaled elements into chunks
+    void finalize();
+
+    struct ReferenceType
+    {
+        ElementType type;
+        Eigen::MatrixXd mass;
+        Eigen::MatrixXd inverse;
+        std::vector<int> elements;
+    };
+
+    struct Chunk
+    {
+        int reference;
+        int first;
+        int count;
+    };
+
+    bool built{false};
+    int n_scaled{0};
+    int n_dense{0};
+
+    // Global dofs of element e are dofs[dof_offsets[e]] ... dofs[dof_offsets[e+1] - 1]
+    std::vector<int> dof_offsets;
+    std::vector<int> dofs;
+
+    std::vector<ReferenceType> references;
+    std::vector<double> scales;
+    std::vector<Chunk> chunks;
+
+    // Per element: its reference type (scaled), or its index in dense_elements (dense), else -1
+    std::vector<int> element_reference;
+    std::vector<int> element_dense;
+
+    std::vector<int> dense_elements;
+    std::vector<std::size_t> dense_offsets;
+    std::vector<double> dense_inverses;
+
+    // Per element: the first of its inverse diagonal entries (diagonal), else -1
+    std::vector<int> element_diagonal;
+    std::vector<int> diagonal_elements;
+    std::vector<double> diagonal_inverses;
+};
+
+
+template<typename Physics>
+void InverseMassOperator::build(const DoFManager &dofm, double time, const GeometryCache *geometry)
+{
+    constexpr int NSD = Physics::nsd();
+    clear(dofm);
+
+    ElementFactory EF(dofm);
+    std::vector<int> element_dofs;
+    Eigen::MatrixXd M;
+    for (int elnum = 0; elnum < dofm.nCells(); ++elnum) {
+        auto et = dofm.element_types[elnum];
+        if (et.topoDim != NSD) {
+            continue;
+        }
+        auto &E = EF.getElement(et);
+        dofm.getGlobalDofs(elnum, element_dofs);
+        const int n = static_cast<int>(element_dofs.size());
+        M.setZero(n, n);
+        for (int qpi = 0; qpi < E.nQP(); ++qpi) {
+            E.update<NSD>(elnum, qpi, dofm, geometry);
+            Physics::LocalMass(E, qpi, time, M);
+        }
+        addElement(elnum, et, element_dofs, M);
+    }
+    finalize();
+}
+
+YAFEL_NAMESPACE_CLOSE
+
+#endif //YAFEL_INVERSEMASSOPERATOR_HPP
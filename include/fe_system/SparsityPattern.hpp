@@ -0,0 +1,123 @@
+#ifndef YAFEL_SPARSITYPATTERN_HPP
+#define YAFEL_SPARSITYPATTERN_HPP
+
+#include "yafel_globals.hpp"
+#include "utils/DoFManager.hpp"
+
+#include <Eigen/Sparse>
+#include <vector>
+
+YAFEL_NAMESPACE_OPEN
+
+/**
+ * Element position maps of a sparsity pattern: entry (A,B) of the row-major local
+ * tangent of element elnum goes to values[map(elnum)[A*n_local_dofs + B]]
+ */
+struct ElementPositionMap
+{
+    const int *positions{nullptr};
+    const int *offsets{nullptr};
+
+    inline const int *operator()(int elnum) const { return positions + offsets[elnum]; }
+};
+
+
+/**
+ * \class SparsityPattern
+ * \brief Compressed-column structure of the global tangent matrix.
+ *
+ * Built once from the element-dof connectivity of a DoFManager, considering
+ * only elements with the given topological dimension (the same elements that
+ * CGAssembly visits). Alongside the structure, a position map is stored for
+ * every element: entry (A,B) of the row-major local tangent is added into
+ * valuePtr()[elementPositions(elnum)[A*n_local_dofs + B]] of any matrix that
+ * was initialized from this pattern.
+ *
+ * For a DG DoFManager, the dofs of face neighbors are coupled as well: the
+ * matrix is block-sparse, with the dense block of every element and one block
+ * per neighbor, where DGAssembly writes the face-coupling terms of its tangent.
+ * For that, every face of interior_faces also gets a position map, over the
+ * (trace dofs x trace dofs) blocks of its sides (see facePositions()).
+ *
+ * This lets repeated assemblies on a fixed mesh scatter local matrices
+ * directly into a preallocated Eigen::SparseMatrix, without building,
+ * sorting and compressing a vector of triplets every time.
+ */
+class SparsityPattern
+{
+public:
+    using matrix_type = Eigen::SparseMatrix<double, Eigen::ColMajor>;
+
+    SparsityPattern(const DoFManager &dofm, int topoDim);
+
+    /**
+     * Resize A and copy this structure into it. All values are set to zero.
+     */
+    void initializeMatrix(matrix_type &A) const;
+
+    /**
+     * Check whether A is compressed and has exactly this structure,
+     * i.e. whether the element position maps are valid for A.valuePtr().
+     */
+    bool matches(const matrix_type &A) const;
+
+    // Index of entry (row, col) in the value array, or -1 if it is not in the structure
+    int position(int row, int col) const;
+
+    inline const int *elementPositions(int elnum) const
+    {
+        return element_positions.data() + element_position_offsets[elnum];
+    }
+
+    inline ElementPositionMap elementPositionMap() const
+    {
+        return {element_positions.data(), element_position_offsets.data()};
+    }
+
+    inline int nElementPositions(int elnum) const
+    {
+        return element_position_offsets[elnum + 1] - element_position_offsets[elnum];
+    }
+
+    /**
+     * Position map of DG face fnum: with n = dof_per_node times the trace nodes of a side
+     * (DoFManager::getFaceTraces), the row-major n x n blocks (left, left), (left, right),
+     * (right, left) and (right, right) one after the other; only (left, left) for a
+     * boundary face. Empty for a CG DoFManager, or if a side is not of dimension topoDim.
+     */
+    inline const int *facePositions(int fnum) const
+    {
+        return face_positions.data() + face_position_offsets[fnum];
+    }
+
+    inline int nFacePositions(int fnum) const
+    {
+        return face_position_offsets[fnum + 1] - face_position_offsets[fnum];
+    }
+
+    inline int rows() const { return n_dofs; }
+
+    inline int nonZeros() const { return static_cast<int>(inner_index.size()); }
+
+    inline int topoDim() const { return topo_dim; }
+
+private:
+    int n_dofs;
+    int topo_dim;
+
+    // Compressed-column structure (same layout as Eigen's outer/inner index arrays)
+    std::vector<int> outer_index;
+    std::vector<int> inner_index;
+
+    // Per-element maps from local (A,B) entries into the value array
+    std::vector<int> element_position_offsets;
+    std::vector<int> element_positions;
+
+    // Per-face maps from the trace blocks into the value array (DG only)
+    std::vector<int> face_position_offsets;
+    std::vector<int> face_positions;
+};
+
+YAFEL_NAMESPACE_CLOSE
+
+#endif //YAFEL_SPARSITYPATTERN_HPP
@@ -7,9 +7,15 @@
 
 #include "yafel_globals.hpp"
 
+#include "lin_alg/linear_solvers/solvers/AMGPreconditioner.hpp"
+#include "lin_alg/linear_solvers/solvers/BCSRSolvers.hpp"
+#include "lin_alg/linear_solvers/solvers/CachedSolvers.hpp"
 #include "lin_alg/linear_solvers/solvers/EigenConjugateGradient.hpp"
 #include "lin_alg/linear_solvers/solvers/EigenBICGSTAB.hpp"
 #include "lin_alg/linear_solvers/solvers/EigenCholesky.hpp"
+#include "lin_alg/linear_solvers/solvers/MatrixFreeSolvers.hpp"
+#include "lin_alg/linear_solvers/solvers/ParallelKrylov.hpp"
+#include "lin_alg/linear_solvers/solvers/PMultigrid.hpp"
 #include "lin_alg/linear_solvers/solvers/VCLConjugateGradient.hpp"
 
 #include <cassert>
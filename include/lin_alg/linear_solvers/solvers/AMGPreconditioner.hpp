@@ -0,0 +1,247 @@
+#ifndef YAFEL_AMGPRECONDITIONER_HPP
+#define YAFEL_AMGPRECONDITIONER_HPP
+
+#include "yafel_globals.hpp"
+#include "yafel_typedefs.hpp"
+
+#include <Eigen/Core>
+#include <Eigen/Dense>
+#include <Eigen/IterativeLinearSolvers>
+#include <Eigen/SparseCore>
+#include <vector>
+
+YAFEL_NAMESPACE_OPEN
+
+namespace LinearSolve {
+
+/**
+ * Parameters of the smoothed aggregation hierarchy
+ */
+struct AMGOptions
+{
+    // Coarsening stops at this many levels, or when a level has at most coarse_size rows
+    int max_levels{10};
+    int coarse_size{500};
+
+    // Node j is a strong neighbor of node i if |A_ij| >= theta sqrt(|A_ii| |A_jj|) (block Frobenius norms)
+    double strength_threshold{0.08};
+
+    // P = (I - omega / rho(D^{-1}A) D^{-1}A) T, with T the tentative prolongator
+    double prolongation_damping{4.0 / 3.0};
+
+    // Damped Jacobi sweeps, weight smoother_damping / rho(D^{-1}A), before and after the coarse correction
+    double smoother_damping{4.0 / 3.0};
+    int pre_smooth{2};
+    int post_smooth{2};
+};
+
+
+/**
+ * \class AMGPreconditioner
+ * \brief Smoothed aggregation algebraic multigrid, applied as one V-cycle
+ *
+ * Setup (compute/factorize) builds the hierarchy of a symmetric positive definite
+ * matrix: the nodes (groups of blockSize() consecutive dofs, the DoFManager's
+ * dof_per_node) are aggregated along strong connections, the near-nullspace is
+ * restricted to every aggregate and orthonormalized (QR) into the tentative
+ * prolongator, which one damped Jacobi step smooths, and the coarse matrix is the
+ * Galerkin product R A P with R = P^T. Nodes without strong neighbors (rows of
+ * Dirichlet conditions) are left to the smoother. The coarsest level is factored
+ * densely.
+ *
+ * The near-nullspace defaults to the constant of each component. For elasticity
+ * (dof_per_node = NSD), setNearNullspace(rigidBodyModes(dofm.dof_nodes, NSD), NSD)
+ * gives the rigid body modes instead, and the coarse levels have one dof per mode
+ * and aggregate.
+ *
+ * solve() runs one V-cycle from a zero guess. Smoothing, residuals and transfers
+ * are row-parallel loops on the global TaskScheduler, with fixed blocks: the
+ * result does not depend on the number of threads. Its work vectors are shared,
+ * so one preconditioner is not applied concurrently.
+ *
+ * The class has Eigen's preconditioner interface; AMGConjugateGradientTag keeps
+ * one across solves, so that the setup is reused.
+ */
+class AMGPreconditioner
+{
+public:
+    using matrix_type = Eigen::SparseMatrix<double, Eigen::RowMajor>;
+
+    AMGPreconditioner() = default;
+
+    template<typename MatType>
+    explicit AMGPreconditioner(const MatType &A) { compute(A); }
+
+    inline void setOptions(const AMGOptions &new_options) { options = new_options; }
+
+    inline const AMGOptions &getOptions() const { return options; }
+
+    // Dofs per node, without an explicit near-nullspace (each component's constant is used)
+    void setBlockSize(int dof_per_node);
+
+    // Near-nullspace modes (one per column) of a matrix with dof_per_node dofs per node
+    void setNearNullspace(const Eigen::MatrixXd &modes, int dof_per_node);
+
+    /**
+     * The 3 (nsd = 2) or 6 (nsd = 3) rigid body modes of a vector field with nsd
+     * components per node, node-major (as DoFManager numbers dofs)
+     */
+    static Eigen::MatrixXd rigidBodyModes(const std::vector<coordinate<>> &nodes, int nsd);
+
+    template<typename MatType>
+    AMGPreconditioner &analyzePattern(const MatType &) { return *this; }
+
+    template<typename MatType>
+    AMGPreconditioner &factorize(const MatType &A)
+    {
+        setup(matrix_type(A));
+        return *this;
+    }
+
+    template<typename MatType>
+    AMGPreconditioner &compute(const MatType &A) { return factorize(A); }
+
+    template<typename Rhs>
+    Eigen::VectorXd solve(const Eigen::MatrixBase<Rhs> &b) const
+    {
+        Eigen::VectorXd x;
+        apply(b, x);
+        return x;
+    }
+
+    // x = V-cycle applied to b
+    void apply(const Eigen::VectorXd &b, Eigen::VectorXd &x) const;
+
+    inline Eigen::ComputationInfo info() const { return computed ? Eigen::Success : Eigen::InvalidInput; }
+
+    inline bool isComputed() const { return computed; }
+
+    inline Eigen::Index rows() const { return levels.empty() ? 0 : levels[0].A.rows(); }
+
+    inline Eigen::Index cols() const { return rows(); }
+
+    inline int blockSize() const { return block_size; }
+
+    inline int nLevels() const { return static_cast<int>(levels.size()); }
+
+    inline const matrix_type &levelMatrix(int level) const { return levels[level].A; }
+
+    // Nonzeros of all levels over the nonzeros of the fine matrix
+    double operatorComplexity() const;
+
+private:
+    struct Level
+    {
+        matrix_type A;
+        matrix_type P;
+        matrix_type R;
+        Eigen::VectorXd inverse_diagonal;
+        double jacobi_weight{1.0};
+
+        // V-cycle work vectors
+        mutable Eigen::VectorXd x, b, r, tmp;
+    };
+
+    void setup(matrix_type A);
+
+    void cycle(int level) const;
+
+    void smooth(const Level &L, int sweeps) const;
+
+    AMGOptions options;
+    int block_size{1};
+    Eigen::MatrixXd near_nullspace;
+
+    bool computed{false};
+    std::vector<Level> levels;
+    Eigen::PartialPivLU<Eigen::MatrixXd> coarse_solver;
+};
+
+
+/**
+ * Tag type to dispatch Eigen's Conjugate Gradient, preconditioned by smoothed
+ * aggregation AMG. Each solve sets up the hierarchy according to the Reuse mode:
+ * - Reuse::None (default): every solve rebuilds it from A, for matrices whose
+ *   values change between solves (Newton iterations);
+ * - Reuse::Hierarchy: solves reuse it until amg.compute(A) is called again (or the
+ *   size of A changes), for fixed matrices or to deliberately lag the setup.
+ */
+struct AMGConjugateGradientTag
+{
+    enum class Reuse
+    {
+        None,
+        Hierarchy
+    };
+
+    AMGPreconditioner amg;
+    Reuse reuse{Reuse::None};
+
+    // Relative residual at which CG stops
+    double tolerance{1e-12};
+
+    // Iterations and relative residual of the last solve
+    int iterations{0};
+    double error{0};
+};
+
+namespace detail {
+
+/**
+ * Preconditioner type for Eigen's solvers that applies an AMGPreconditioner owned
+ * elsewhere, and sets it up on every compute() unless reuse is on (then only if it
+ * was not yet, or for a different size)
+ */
+class AMGPreconditionerRef
+{
+public:
+    inline void bind(AMGPreconditioner &preconditioner, bool reuse_hierarchy)
+    {
+        amg = &preconditioner;
+        reuse = reuse_hierarchy;
+    }
+
+    template<typename MatType>
+    AMGPreconditionerRef &analyzePattern(const MatType &) { return *this; }
+
+    template<typename MatType>
+    AMGPreconditionerRef &factorize(const MatType &A)
+    {
+        if (!reuse || !amg->isComputed() || amg->rows() != A.rows()) {
+            amg->compute(A);
+        }
+        return *this;
+    }
+
+    template<typename MatType>
+    AMGPreconditionerRef &compute(const MatType &A) { return factorize(A); }
+
+    template<typename Rhs>
+    Eigen::VectorXd solve(const Eigen::MatrixBase<Rhs> &b) const { return amg->solve(b); }
+
+    inline Eigen::ComputationInfo info() const { return amg->info(); }
+
+private:
+    AMGPreconditioner *amg{nullptr};
+    bool reuse{false};
+};
+
+template<typename MatrixType, typename VectorType>
+void solve_impl(VectorType &result, MatrixType const &A, VectorType const &b, AMGConjugateGradientTag &tag)
+{
+    Eigen::ConjugateGradient<MatrixType, Eigen::Lower | Eigen::Upper, AMGPreconditionerRef> solver;
+    solver.preconditioner().bind(tag.amg, tag.reuse == AMGConjugateGradientTag::Reuse::Hierarchy);
+    solver.setTolerance(tag.tolerance);
+    solver.compute(A);
+    result = solver.solveWithGuess(b, result);
+    tag.iterations = static_cast<int>(solver.iterations());
+    tag.error = solver.error();
+};
+
+}//end namespace detail
+
+}//end namespace LinearSolve
+
+YAFEL_NAMESPACE_CLOSE
+
+#endif //YAFEL_AMGPRECONDITIONER_HPP
@@ -0,0 +1,63 @@
+#ifndef YAFEL_BCSRSOLVERS_HPP
+#define YAFEL_BCSRSOLVERS_HPP
+
+#include "yafel_globals.hpp"
+#include "lin_alg/BCSRMatrix.hpp"
+#include "lin_alg/linear_solvers/solvers/EigenConjugateGradient.hpp"
+#include "lin_alg/linear_solvers/solvers/EigenBICGSTAB.hpp"
+#include "lin_alg/linear_solvers/solvers/MatrixFreeSolvers.hpp"
+#include "lin_alg/linear_solvers/solvers/ParallelKrylov.hpp"
+
+#include <Eigen/Core>
+#include <Eigen/IterativeLinearSolvers>
+
+YAFEL_NAMESPACE_OPEN
+
+namespace LinearSolve {
+
+namespace detail {
+
+// Overloads of the Eigen iterative solver tags for BCSRMatrix: the products run
+// on the blocks, with a Jacobi preconditioner from A.diagonal()
+template<int B, typename VectorType>
+void solve_impl(VectorType &result, BCSRMatrix<B> const &A, VectorType const &b, EigenConjugateGradientTag)
+{
+    Eigen::ConjugateGradient<BCSRMatrix<B>, Eigen::Upper | Eigen::Lower, MatrixFreeJacobiPreconditioner> solver;
+    solver.compute(A);
+    result = solver.solveWithGuess(b, result);
+};
+
+template<int B, typename VectorType>
+void solve_impl(VectorType &result, BCSRMatrix<B> const &A, VectorType const &b, EigenBICGSTABTag &)
+{
+    Eigen::BiCGSTAB<BCSRMatrix<B>, MatrixFreeJacobiPreconditioner> solver;
+    solver.compute(A);
+    result = solver.solveWithGuess(b, result);
+};
+
+// The parallel Krylov solvers work on their own CSR copy, made from the scalar form
+template<int B, typename VectorType>
+void solve_impl(VectorType &result, BCSRMatrix<B> const &A, VectorType const &b, ParallelConjugateGradientTag &tag)
+{
+    parallel_solve_impl(result, ParallelCSRMatrix(A.toSparse()), b, tag);
+};
+
+template<int B, typename VectorType>
+void solve_impl(VectorType &result, BCSRMatrix<B> const &A, VectorType const &b, ParallelBICGSTABTag &tag)
+{
+    parallel_solve_impl(result, ParallelCSRMatrix(A.toSparse()), b, tag);
+};
+
+template<int B, typename VectorType>
+void solve_impl(VectorType &result, BCSRMatrix<B> const &A, VectorType const &b, ParallelGMRESTag &tag)
+{
+    parallel_solve_impl(result, ParallelCSRMatrix(A.toSparse()), b, tag);
+};
+
+}//end namespace detail
+
+}//end namespace LinearSolve
+
+YAFEL_NAMESPACE_CLOSE
+
+#endif //YAFEL_BCSRSOLVERS_HPP
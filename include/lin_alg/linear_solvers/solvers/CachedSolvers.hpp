@@ -0,0 +1,199 @@
+#ifndef YAFEL_CACHEDSOLVERS_HPP
+#define YAFEL_CACHEDSOLVERS_HPP
+
+#include "yafel_globals.hpp"
+
+#include <Eigen/IterativeLinearSolvers>
+#include <Eigen/SparseCholesky>
+#include <Eigen/SparseCore>
+#include <Eigen/SparseLU>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+
+YAFEL_NAMESPACE_OPEN
+
+namespace LinearSolve {
+
+namespace detail {
+
+// Rows, columns and a hash of the stored entries' positions of a sparse matrix
+struct PatternKey
+{
+    Eigen::Index rows{-1};
+    Eigen::Index cols{-1};
+    Eigen::Index nonZeros{-1};
+    std::uint64_t hash{0};
+
+    template<typename MatrixType>
+    static PatternKey of(const MatrixType &A)
+    {
+        PatternKey key{A.rows(), A.cols(), A.nonZeros(), 14695981039346656037ull};
+        auto mix = [&key](std::uint64_t v) {
+            key.hash ^= v;
+            key.hash *= 1099511628211ull;
+        };
+        for (Eigen::Index j = 0; j < A.outerSize(); ++j) {
+            for (typename MatrixType::InnerIterator it(A, j); it; ++it) {
+                mix(static_cast<std::uint64_t>(it.index()));
+            }
+            mix(~std::uint64_t(0));
+        }
+        return key;
+    }
+
+    inline bool operator==(const PatternKey &rhs) const
+    {
+        return rows == rhs.rows && cols == rhs.cols && nonZeros == rhs.nonZeros && hash == rhs.hash;
+    }
+
+    inline bool operator!=(const PatternKey &rhs) const { return !(*this == rhs); }
+};
+
+}//end namespace detail
+
+
+/**
+ * \class CachedSolverTag
+ * \brief Stateful tag type that keeps an Eigen sparse solver between solves
+ *
+ * The plain tags build a new solver on every LinearSolve::solve, which redoes the
+ * ordering and symbolic analysis and the numeric factorization (or preconditioner)
+ * each time. This tag keeps them, keyed on the sparsity pattern of the matrix:
+ *
+ * - refactor(A) runs the numeric factorization (or preconditioner setup) of A, and
+ *   the symbolic analysis only if the pattern differs from the last analyzed one;
+ * - solve(b, x) solves with the current factorization (x is the initial guess of
+ *   the iterative solvers).
+ *
+ * LinearSolve::solve calls refactor(A) first according to the Reuse mode:
+ * - Reuse::Pattern (default): every solve refactors, reusing the symbolic analysis,
+ *   for matrices whose values change between solves (Newton iterations);
+ * - Reuse::Factorization: solves reuse the factorization until refactor() is
+ *   called again, for fixed matrices (linear time stepping) or modified Newton.
+ * Both refactor from scratch when the pattern changes, or (for the iterative
+ * solvers, which keep a reference to A) when A's storage moved.
+ *
+ * The solver is any Eigen sparse solver on Eigen::SparseMatrix<double>, available
+ * through solver() to set tolerances and the like; the aliases below cover the
+ * usual ones.
+ */
+template<typename Solver>
+class CachedSolverTag
+{
+public:
+    using solver_type = Solver;
+    using matrix_type = typename Solver::MatrixType;
+
+    enum class Reuse
+    {
+        Pattern,
+        Factorization
+    };
+
+    explicit CachedSolverTag(Reuse reuse = Reuse::Pattern) : reuse(reuse) {}
+
+    inline void setReuse(Reuse new_reuse) { reuse = new_reuse; }
+
+    inline Reuse getReuse() const { return reuse; }
+
+    void refactor(const matrix_type &A)
+    {
+        auto key = detail::PatternKey::of(A);
+        if (!analyzed || key != pattern) {
+            eigen_solver.analyzePattern(A);
+            pattern = key;
+            analyzed = true;
+            ++n_analyses;
+        }
+        eigen_solver.factorize(A);
+        if (eigen_solver.info() != Eigen::Success) {
+            factored = false;
+            throw std::runtime_error("CachedSolverTag: factorization failed");
+        }
+        values = A.valuePtr();
+        factored = true;
+        ++n_factorizations;
+    }
+
+    // Refactor A if the reuse mode, or a change of A, requires it
+    void update(const matrix_type &A)
+    {
+        if (reuse == Reuse::Pattern || !factored || (iterative && values != A.valuePtr())
+            || detail::PatternKey::of(A) != pattern) {
+            refactor(A);
+        }
+    }
+
+    template<typename VectorType>
+    void solve(const VectorType &b, VectorType &x) const
+    {
+        if (!factored) {
+            throw std::runtime_error("CachedSolverTag: solve() before refactor()");
+        }
+        if constexpr (iterative) {
+            x = eigen_solver.solveWithGuess(b, x);
+        } else {
+            x = eigen_solver.solve(b);
+        }
+    }
+
+    // Forget the analysis and factorization
+    inline void invalidate()
+    {
+        analyzed = false;
+        factored = false;
+    }
+
+    inline Solver &solver() { return eigen_solver; }
+
+    inline const Solver &solver() const { return eigen_solver; }
+
+    inline bool isFactored() const { return factored; }
+
+    // Symbolic analyses and numeric factorizations done so far
+    inline int nAnalyses() const { return n_analyses; }
+
+    inline int nFactorizations() const { return n_factorizations; }
+
+private:
+    static constexpr bool iterative = std::is_base_of<Eigen::IterativeSolverBase<Solver>, Solver>::value;
+
+    Reuse reuse;
+    Solver eigen_solver;
+    detail::PatternKey pattern;
+    const double *values{nullptr};
+    bool analyzed{false};
+    bool factored{false};
+    int n_analyses{0};
+    int n_factorizations{0};
+};
+
+using CachedCholeskyLLTTag = CachedSolverTag<Eigen::SimplicialLLT<Eigen::SparseMatrix<double>>>;
+using CachedCholeskyLDLTTag = CachedSolverTag<Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>>>;
+using CachedSparseLUTag = CachedSolverTag<Eigen::SparseLU<Eigen::SparseMatrix<double>>>;
+using CachedConjugateGradientTag = CachedSolverTag<
+        Eigen::ConjugateGradient<Eigen::SparseMatrix<double>, Eigen::Lower | Eigen::Upper>>;
+using CachedBICGSTABTag = CachedSolverTag<Eigen::BiCGSTAB<Eigen::SparseMatrix<double>>>;
+using CachedBICGSTABILUTTag = CachedSolverTag<
+        Eigen::BiCGSTAB<Eigen::SparseMatrix<double>, Eigen::IncompleteLUT<double>>>;
+
+namespace detail {
+
+template<typename MatrixType, typename VectorType, typename Solver>
+void solve_impl(VectorType &result, MatrixType const &A, VectorType const &b, CachedSolverTag<Solver> &tag)
+{
+    // No conversion: the iterative solvers keep a reference to A
+    static_assert(std::is_same<MatrixType, typename CachedSolverTag<Solver>::matrix_type>::value,
+                  "CachedSolverTag: matrix type differs from the solver's");
+    tag.update(A);
+    tag.solve(b, result);
+};
+
+}//end namespace detail
+
+}//end namespace LinearSolve
+
+YAFEL_NAMESPACE_CLOSE
+
+#endif //YAFEL_CACHEDSOLVERS_HPP
@@ -25,9 +25,9 @@ struct EigenCholeskyLDLT
 
 namespace detail {
 
-template<typename S, int O>
-constexpr auto getUpLo(const Eigen::SparseMatrix<S,O>&) {
-    if constexpr(O == Eigen::RowMajor) {
+template<typename MatrixType>
+constexpr int getUpLo() {
+    if constexpr(MatrixType::IsRowMajor) {
         return Eigen::Upper;
     }
     else {
@@ -38,7 +38,7 @@ constexpr auto getUpLo(const Eigen::SparseMatrix<S,O>&) {
 template<typename MatrixType, typename VectorType>
 void solve_impl(VectorType &result, MatrixType const &A, VectorType const &b, EigenCholeskyLLT)
 {
-    constexpr int UpLo = getUpLo(A);
+    constexpr int UpLo = getUpLo<MatrixType>();
 
     Eigen::SimplicialLLT<MatrixType, UpLo> solver;
     solver.compute(A);
@@ -58,16 +58,16 @@ void solve_impl(VectorType &result, MatrixType const &A, VectorType const &b, Ei
 template<typename MatrixType, typename VectorType>
 void solve_impl(VectorType &result, MatrixType const &A, VectorType const &b, EigenCholeskyLDLT)
 {
-    constexpr auto UpLo = getUpLo(A);
+    constexpr int UpLo = getUpLo<MatrixType>();
 
     Eigen::SimplicialLDLT<MatrixType, UpLo> solver;
     solver.compute(A);
     if(solver.info() != Eigen::Success) {
         if(solver.info() == Eigen::NumericalIssue) {
-            throw std::runtime_error("Eigen::SimplicialLLT failure: NumericalIssue");
+            throw std::runtime_error("Eigen::SimplicialLDLT failure: NumericalIssue");
         }
         else {
-            throw std::runtime_error("Eigen::SimplicialLLT failure: Unknown");
+            throw std::runtime_error("Eigen::SimplicialLDLT failure: Unknown");
         }
 
     }
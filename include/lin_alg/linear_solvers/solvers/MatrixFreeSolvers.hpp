@@ -0,0 +1,89 @@
+#ifndef YAFEL_MATRIXFREESOLVERS_HPP
+#define YAFEL_MATRIXFREESOLVERS_HPP
+
+#include "yafel_globals.hpp"
+#include "lin_alg/linear_solvers/solvers/EigenConjugateGradient.hpp"
+#include "lin_alg/linear_solvers/solvers/EigenBICGSTAB.hpp"
+
+#include <Eigen/Core>
+#include <Eigen/IterativeLinearSolvers>
+
+YAFEL_NAMESPACE_OPEN
+
+template<typename Physics>
+class MatrixFreeOperator;
+
+namespace LinearSolve {
+
+/**
+ * Jacobi preconditioner for Eigen's iterative solvers that only needs
+ * A.diagonal(), so that it works on matrix-free operators
+ * (Eigen::DiagonalPreconditioner iterates over the stored entries of A).
+ */
+class MatrixFreeJacobiPreconditioner
+{
+public:
+    MatrixFreeJacobiPreconditioner() : inverse_diagonal() {}
+
+    template<typename MatType>
+    explicit MatrixFreeJacobiPreconditioner(const MatType &A) { compute(A); }
+
+    inline Eigen::Index rows() const { return inverse_diagonal.rows(); }
+
+    inline Eigen::Index cols() const { return inverse_diagonal.rows(); }
+
+    template<typename MatType>
+    MatrixFreeJacobiPreconditioner &analyzePattern(const MatType &) { return *this; }
+
+    template<typename MatType>
+    MatrixFreeJacobiPreconditioner &factorize(const MatType &A)
+    {
+        inverse_diagonal = A.diagonal().cwiseInverse();
+        return *this;
+    }
+
+    template<typename MatType>
+    MatrixFreeJacobiPreconditioner &compute(const MatType &A) { return factorize(A); }
+
+    template<typename Rhs>
+    Eigen::VectorXd solve(const Eigen::MatrixBase<Rhs> &b) const
+    {
+        return inverse_diagonal.cwiseProduct(b);
+    }
+
+    inline Eigen::ComputationInfo info() { return Eigen::Success; }
+
+private:
+    Eigen::VectorXd inverse_diagonal;
+};
+
+
+namespace detail {
+
+// Overloads of the Eigen iterative solver tags for MatrixFreeOperator
+template<typename Physics, typename VectorType>
+void solve_impl(VectorType &result, MatrixFreeOperator<Physics> const &A, VectorType const &b,
+                EigenConjugateGradientTag)
+{
+    Eigen::ConjugateGradient<MatrixFreeOperator<Physics>, Eigen::Upper | Eigen::Lower,
+            MatrixFreeJacobiPreconditioner> solver;
+    solver.compute(A);
+    result = solver.solveWithGuess(b, result);
+};
+
+template<typename Physics, typename VectorType>
+void solve_impl(VectorType &result, MatrixFreeOperator<Physics> const &A, VectorType const &b,
+                EigenBICGSTABTag &)
+{
+    Eigen::BiCGSTAB<MatrixFreeOperator<Physics>, MatrixFreeJacobiPreconditioner> solver;
+    solver.compute(A);
+    result = solver.solveWithGuess(b, result);
+};
+
+}//end namespace detail
+
+}//end namespace LinearSolve
+
+YAFEL_NAMESPACE_CLOSE
+
+#endif //YAFEL_MATRIXFREESOLVERS_HPP
@@ -0,0 +1,367 @@
+#ifndef YAFEL_PMULTIGRID_HPP
+#define YAFEL_PMULTIGRID_HPP
+
+#include "yafel_globals.hpp"
+#include "yafel_typedefs.hpp"
+#include "assembly/CGAssembly.hpp"
+#include "assembly/MatrixFreeOperator.hpp"
+#include "fe_system/FESystem.hpp"
+#include "lin_alg/linear_solvers/solvers/AMGPreconditioner.hpp"
+#include "mesh/Mesh.hpp"
+#include "utils/DoFManager.hpp"
+
+#include <Eigen/Core>
+#include <Eigen/IterativeLinearSolvers>
+#include <Eigen/SparseCholesky>
+#include <Eigen/SparseCore>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+YAFEL_NAMESPACE_OPEN
+
+namespace LinearSolve {
+
+/**
+ * Parameters of the p-multigrid V-cycle
+ */
+struct PMultigridOptions
+{
+    enum class CoarseSolver
+    {
+        Direct, // sparse Cholesky of the p = 1 matrix
+        AMG     // one smoothed aggregation V-cycle on the p = 1 matrix
+    };
+
+    // Chebyshev smoothing of degree chebyshev_degree (1 is damped Jacobi), before and
+    // after the coarse correction, on the eigenvalues of D^{-1}A in
+    // [lambda_max / smoothing_range, lambda_max]
+    int chebyshev_degree{4};
+    double smoothing_range{15.0};
+
+    CoarseSolver coarse_solver{CoarseSolver::Direct};
+};
+
+
+namespace detail {
+
+/**
+ * CGAssembly physics for the local tangent of a MatrixFreeOperator physics: the
+ * weak form of PointwiseOperator, with the shape functions as trial functions
+ */
+template<typename Physics>
+struct PointwiseTangent
+{
+    static constexpr int NSD = Physics::nsd();
+
+    static constexpr int nsd() { return NSD; }
+
+    template<typename ElementT, typename PointT, typename VectorT>
+    static void LocalResidual(const ElementT &, int, PointT &, double, VectorT &, VectorT &)
+    {}
+
+    template<typename ElementT, typename PointT, typename VectorT, typename MatrixT>
+    static void LocalTangent(const ElementT &E, int qpi, PointT &xqp, double time, VectorT &, MatrixT &K_el)
+    {
+        auto const &N = E.shapeValues[qpi];
+        const int n = static_cast<int>(N.rows());
+        Tensor<NSD, 1> grad_u, flux;
+        double s;
+        for (int b = 0; b < n; ++b) {
+            for (int d = 0; d < NSD; ++d) {
+                grad_u(d) = E.shapeGrad(b, d);
+            }
+            Physics::PointwiseOperator(xqp, time, N(b), grad_u, s, flux);
+            for (int a = 0; a < n; ++a) {
+                double value = s * N(a);
+                for (int d = 0; d < NSD; ++d) {
+                    value += flux(d) * E.shapeGrad(a, d);
+                }
+                K_el(a, b) += value * E.jxw;
+            }
+        }
+    }
+};
+
+}//end namespace detail
+
+
+/**
+ * \class PMultigrid
+ * \brief Geometric p-multigrid on the polynomial orders of a CG DoFManager
+ *
+ * The hierarchy has the orders p, p/2, ..., 1 of the fine DoFManager, each level
+ * a DoFManager of its order on the same Mesh. The prolongation from order q to
+ * order p interpolates: its rows are the order-q shape functions of every element
+ * at the order-p local nodes (exact for the order-q space, on any element type).
+ * Restriction is its transpose.
+ *
+ * Levels are smoothed with Chebyshev polynomials in D^{-1}A, with the largest
+ * eigenvalue estimated by power iterations; the p = 1 level is solved with a sparse
+ * Cholesky factorization or one AMG V-cycle (PMultigridOptions::coarse_solver).
+ *
+ * compute() sets the hierarchy up for
+ * - an assembled matrix: the coarse matrices are Galerkin products R A P;
+ * - a MatrixFreeOperator<Physics>: the levels of order > 1 are MatrixFreeOperators
+ *   of the same Physics, and the p = 1 level is assembled from PointwiseOperator
+ *   by CGAssembly. The operator is referenced, not copied: keep it alive.
+ *
+ * Dirichlet nodes are selected once with constrainByFunction, as for DirichletBC:
+ * the dofs of the selected nodes of every level are rows/columns of the identity
+ * (as DirichletBC::apply leaves the fine operator), and the transfers skip them.
+ *
+ * solve() applies one symmetric V-cycle from a zero guess, so PMultigrid can
+ * precondition CG: see PMultigridConjugateGradientTag.
+ */
+class PMultigrid
+{
+public:
+    using matrix_type = Eigen::SparseMatrix<double, Eigen::RowMajor>;
+
+    PMultigrid(const Mesh &M, const DoFManager &dofm);
+
+    inline void setOptions(const PMultigridOptions &new_options)
+    {
+        options = new_options;
+        computed = false;
+    }
+
+    inline const PMultigridOptions &getOptions() const { return options; }
+
+    // Constrain the nodes x of every level with func(x) true
+    template<typename Lambda>
+    void constrainByFunction(Lambda &&func);
+
+    template<typename Derived>
+    PMultigrid &compute(const Eigen::SparseMatrixBase<Derived> &A)
+    {
+        setupAssembled(matrix_type(A.derived()));
+        return *this;
+    }
+
+    template<typename Physics>
+    PMultigrid &compute(const MatrixFreeOperator<Physics> &A);
+
+    template<typename Rhs>
+    Eigen::VectorXd solve(const Eigen::MatrixBase<Rhs> &b) const
+    {
+        Eigen::VectorXd x;
+        apply(b, x);
+        return x;
+    }
+
+    // x = V-cycle applied to b
+    void apply(const Eigen::VectorXd &b, Eigen::VectorXd &x) const;
+
+    inline Eigen::ComputationInfo info() const { return computed ? Eigen::Success : Eigen::InvalidInput; }
+
+    inline bool isComputed() const { return computed; }
+
+    inline Eigen::Index rows() const { return n_dofs(0); }
+
+    inline Eigen::Index cols() const { return rows(); }
+
+    inline int nLevels() const { return static_cast<int>(levels.size()); }
+
+    inline int levelOrder(int level) const { return levels[level].dofm->polyOrder; }
+
+    inline const DoFManager &levelDoFManager(int level) const { return *levels[level].dofm; }
+
+    // Interpolation from level + 1 to level
+    inline const matrix_type &prolongation(int level) const { return levels[level].P; }
+
+private:
+    struct Level
+    {
+        const DoFManager *dofm{nullptr};
+        std::unique_ptr<DoFManager> owned_dofm;
+        std::vector<char> constrained;
+
+        // y = A x, and the assembled A if the level has one
+        std::function<void(const Eigen::VectorXd &, Eigen::VectorXd &)> op;
+        matrix_type A;
+        Eigen::VectorXd inverse_diagonal;
+        double lambda_max{1.0};
+
+        // From the next coarser level, and back
+        matrix_type P;
+        matrix_type R;
+
+        // V-cycle work vectors
+        mutable Eigen::VectorXd x, b, r, d;
+    };
+
+    inline Eigen::Index n_dofs(int level) const
+    {
+        return levels.empty() ? 0 : Eigen::Index(levels[level].dofm->nNodes()) * levels[level].dofm->dof_per_node;
+    }
+
+    void buildTransfers();
+
+    // Level matrix with its constrained rows and columns replaced by the identity
+    void setAssembled(int level, matrix_type A);
+
+    void setupAssembled(matrix_type A);
+
+    // Diagonals, eigenvalue estimates, work vectors and the coarse solver
+    void finishSetup();
+
+    void cycle(int level) const;
+
+    void smooth(const Level &L, bool zero_guess) const;
+
+    PMultigridOptions options;
+    std::vector<Level> levels;
+    bool computed{false};
+
+    Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>> coarse_cholesky;
+    AMGPreconditioner coarse_amg;
+};
+
+
+template<typename Lambda>
+void PMultigrid::constrainByFunction(Lambda &&func)
+{
+    for (auto &L : levels) {
+        const int dpn = L.dofm->dof_per_node;
+        for (int i = 0; i < L.dofm->nNodes(); ++i) {
+            if (func(L.dofm->dof_nodes[i])) {
+                std::fill(L.constrained.begin() + i * dpn, L.constrained.begin() + (i + 1) * dpn, 1);
+            }
+        }
+    }
+    buildTransfers();
+    computed = false;
+}
+
+
+template<typename Physics>
+PMultigrid &PMultigrid::compute(const MatrixFreeOperator<Physics> &A)
+{
+    constexpr int NSD = Physics::nsd();
+    computed = false;
+    if (A.rows() != rows()) {
+        throw std::runtime_error("PMultigrid: operator and DoFManager sizes differ");
+    }
+    if (nLevels() < 2) {
+        throw std::runtime_error("PMultigrid: a matrix-free fine level needs polyOrder > 1");
+    }
+
+    levels[0].op = [&A](const Eigen::VectorXd &x, Eigen::VectorXd &y) { A.apply(x, y); };
+    levels[0].inverse_diagonal = A.diagonal().cwiseInverse();
+    for (int l = 1; l < nLevels(); ++l) {
+        auto &L = levels[l];
+        if (L.dofm->polyOrder > 1) {
+            auto op = std::make_shared<MatrixFreeOperator<Physics>>(*L.dofm);
+            op->setTime(A.currentTime());
+            std::vector<int> constrained_dofs;
+            for (int i = 0; i < static_cast<int>(L.constrained.size()); ++i) {
+                if (L.constrained[i]) {
+                    constrained_dofs.push_back(i);
+                }
+            }
+            op->addConstrainedDofs(constrained_dofs);
+            L.op = [op](const Eigen::VectorXd &x, Eigen::VectorXd &y) { op->apply(x, y); };
+            L.inverse_diagonal = op->diagonal().cwiseInverse();
+        } else {
+            FESystem feSystem(*L.owned_dofm, NSD);
+            feSystem.currentTime() = A.currentTime();
+            CGAssembly<detail::PointwiseTangent<Physics>>(feSystem, {AssemblyRequirement::Tangent});
+            setAssembled(l, matrix_type(feSystem.getGlobalTangent()));
+        }
+    }
+    finishSetup();
+    return *this;
+}
+
+
+/**
+ * Tag type to dispatch Eigen's Conjugate Gradient, preconditioned by p-multigrid.
+ * The tag refers to a PMultigrid, set up by each solve according to the Reuse mode:
+ * - Reuse::None (default): every solve sets it up from A, for operators whose
+ *   values change between solves (Newton iterations);
+ * - Reuse::Hierarchy: solves reuse the setup until pmg.compute(A) is called again
+ *   (or the size of A changes), for fixed operators.
+ */
+struct PMultigridConjugateGradientTag
+{
+    enum class Reuse
+    {
+        None,
+        Hierarchy
+    };
+
+    PMultigrid &pmg;
+
+    // Relative residual at which CG stops
+    double tolerance{1e-12};
+
+    Reuse reuse{Reuse::None};
+
+    // Iterations and relative residual of the last solve
+    int iterations{0};
+    double error{0};
+};
+
+namespace detail {
+
+/**
+ * Preconditioner type for Eigen's solvers that applies a PMultigrid owned
+ * elsewhere, and sets it up on every compute() unless reuse is on (then only if it
+ * was not yet, or for a different size)
+ */
+class PMultigridRef
+{
+public:
+    inline void bind(PMultigrid &preconditioner, bool reuse_hierarchy)
+    {
+        pmg = &preconditioner;
+        reuse = reuse_hierarchy;
+    }
+
+    template<typename MatType>
+    PMultigridRef &analyzePattern(const MatType &) { return *this; }
+
+    template<typename MatType>
+    PMultigridRef &factorize(const MatType &A)
+    {
+        if (!reuse || !pmg->isComputed() || pmg->rows() != A.rows()) {
+            pmg->compute(A);
+        }
+        return *this;
+    }
+
+    template<typename MatType>
+    PMultigridRef &compute(const MatType &A) { return factorize(A); }
+
+    template<typename Rhs>
+    Eigen::VectorXd solve(const Eigen::MatrixBase<Rhs> &b) const { return pmg->solve(b); }
+
+    inline Eigen::ComputationInfo info() const { return pmg->info(); }
+
+private:
+    PMultigrid *pmg{nullptr};
+    bool reuse{false};
+};
+
+template<typename MatrixType, typename VectorType>
+void solve_impl(VectorType &result, MatrixType const &A, VectorType const &b, PMultigridConjugateGradientTag &tag)
+{
+    Eigen::ConjugateGradient<MatrixType, Eigen::Lower | Eigen::Upper, PMultigridRef> solver;
+    solver.preconditioner().bind(tag.pmg, tag.reuse == PMultigridConjugateGradientTag::Reuse::Hierarchy);
+    solver.setTolerance(tag.tolerance);
+    solver.compute(A);
+    result = solver.solveWithGuess(b, result);
+    tag.iterations = static_cast<int>(solver.iterations());
+    tag.error = solver.error();
+};
+
+}//end namespace detail
+
+}//end namespace LinearSolve
+
+YAFEL_NAMESPACE_CLOSE
+
+#endif //YAFEL_PMULTIGRID_HPP
@@ -0,0 +1,259 @@
+#ifndef YAFEL_PARALLELKRYLOV_HPP
+#define YAFEL_PARALLELKRYLOV_HPP
+
+#include "yafel_globals.hpp"
+#include "yafel_config.hpp"
+#include "utils/parallel/ReductionVariable.hpp"
+#include "utils/parallel/TaskScheduler.hpp"
+#include "utils/parallel/wait_all.hpp"
+
+#include <Eigen/Core>
+#include <Eigen/SparseCore>
+#include <future>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+YAFEL_NAMESPACE_OPEN
+
+namespace LinearSolve {
+
+/**
+ * \class ParallelCSRMatrix
+ * \brief CSR copy of a sparse matrix, with the vector kernels of the parallel Krylov solvers
+ *
+ * The rows are split into contiguous blocks of about the same number of nonzeros,
+ * one per core (fewer for small matrices), and every kernel runs the blocks as
+ * tasks on getGlobalScheduler(). The CSR arrays, the inverse diagonal and the
+ * vectors from vector() are allocated uninitialized and first written by the blocks
+ * that read them afterwards, so on a NUMA machine their pages are spread over the
+ * nodes of the workers instead of all landing on the node of the calling thread.
+ * (The scheduler does not pin blocks to workers, so this is placement, not strict
+ * affinity.)
+ *
+ * Reductions sum one partial per block, in block order: for a given partition the
+ * results do not depend on the scheduling, and repeated solves are bitwise equal.
+ *
+ * Vectors passed to the kernels must not alias unless stated.
+ */
+class ParallelCSRMatrix
+{
+public:
+    using matrix_type = Eigen::SparseMatrix<double, Eigen::RowMajor>;
+    using index_type = matrix_type::StorageIndex;
+
+    ParallelCSRMatrix() = default;
+
+    // nBlocks = 0: one block per core, of at least a few thousand nonzeros
+    explicit ParallelCSRMatrix(const matrix_type &A, int nBlocks = 0) { assign(A, nBlocks); }
+
+    template<typename Derived>
+    explicit ParallelCSRMatrix(const Eigen::SparseMatrixBase<Derived> &A, int nBlocks = 0)
+    {
+        assign(matrix_type(A.derived()), nBlocks);
+    }
+
+    void assign(const matrix_type &A, int nBlocks = 0);
+
+    inline Eigen::Index rows() const { return n_rows; }
+
+    inline Eigen::Index cols() const { return n_cols; }
+
+    inline Eigen::Index nonZeros() const { return row_ptr.size() ? row_ptr(n_rows) : 0; }
+
+    inline int nBlocks() const { return static_cast<int>(block_start.size()) - 1; }
+
+    // First row of block k (and, for k = nBlocks(), rows())
+    inline Eigen::Index blockStart(int k) const { return block_start[k]; }
+
+    // Inverse of the diagonal, with 1 in place of zero diagonal entries
+    inline const Eigen::VectorXd &inverseDiagonal() const { return inverse_diagonal; }
+
+    // Zero vector of size rows(), first touched block by block
+    Eigen::VectorXd vector() const;
+
+    // f(k, begin, end) for every block k of rows [begin, end): one task per block on
+    // the global scheduler, except the first, run by the calling thread
+    template<typename F>
+    void forBlocks(F &&f) const
+    {
+        const int n = nBlocks();
+        if (n > 1) {
+            auto &scheduler = getGlobalScheduler();
+            std::vector<std::future<void>> futs;
+            futs.reserve(n - 1);
+            for (int k = 1; k < n; ++k) {
+                auto [task, fut] = scheduler.createTask([this, &f, k]() {
+                    f(k, block_start[k], block_start[k + 1]);
+                });
+                scheduler.enqueue(task);
+                futs.push_back(std::move(fut));
+            }
+            f(0, block_start[0], block_start[1]);
+            wait_all(futs);
+        } else if (n == 1) {
+            f(0, block_start[0], block_start[1]);
+        }
+    }
+
+    // Sum over the blocks of f(begin, end), in block order
+    template<typename F, typename T = double>
+    T reduceBlocks(F &&f, const T &zero = T(0)) const
+    {
+        struct r_struct
+        {
+            T val;
+        };
+        std::vector<ReductionVariable<r_struct>> S(nBlocks(), r_struct{zero});
+        forBlocks([&](int k, Eigen::Index begin, Eigen::Index end) { S[k].val = f(begin, end); });
+
+        T total = zero;
+        for (auto &s : S) {
+            total += s.val;
+        }
+        return total;
+    }
+
+    // y[begin, end) = (A x)[begin, end)
+    inline void multiplyRows(const Eigen::VectorXd &x, Eigen::VectorXd &y, Eigen::Index begin, Eigen::Index end) const
+    {
+        const double *v = values.data();
+        const index_type *c = col_index.data();
+        for (Eigen::Index i = begin; i < end; ++i) {
+            double sum{0};
+            for (index_type k = row_ptr(i); k < row_ptr(i + 1); ++k) {
+                sum += v[k] * x(c[k]);
+            }
+            y(i) = sum;
+        }
+    }
+
+    // y = A x
+    void multiply(const Eigen::VectorXd &x, Eigen::VectorXd &y) const;
+
+    // y = A x, and returns w.y
+    double multiplyDot(const Eigen::VectorXd &x, Eigen::VectorXd &y, const Eigen::VectorXd &w) const;
+
+    // r = b - A x, and returns r.r
+    double residual(const Eigen::VectorXd &b, const Eigen::VectorXd &x, Eigen::VectorXd &r) const;
+
+    // y += a x, and returns y.y
+    double axpyNorm(double a, const Eigen::VectorXd &x, Eigen::VectorXd &y) const;
+
+    double dot(const Eigen::VectorXd &x, const Eigen::VectorXd &y) const;
+
+    double norm(const Eigen::VectorXd &x) const;
+
+private:
+    Eigen::Index n_rows{0};
+    Eigen::Index n_cols{0};
+    std::vector<Eigen::Index> block_start{0};
+
+    Eigen::Matrix<index_type, Eigen::Dynamic, 1> row_ptr;
+    Eigen::Matrix<index_type, Eigen::Dynamic, 1> col_index;
+    Eigen::VectorXd values;
+    Eigen::VectorXd inverse_diagonal;
+};
+
+
+/**
+ * Tag types to dispatch the parallel Krylov solvers on a ParallelCSRMatrix, all
+ * Jacobi preconditioned (right preconditioning for BiCGSTAB and GMRES, so the
+ * stopping test is on the true residual). The solvers stop at
+ * ||b - Ax|| <= tolerance ||b||, or after max_iterations (-1: 2 rows()).
+ *
+ * A matrix of another type is copied into a ParallelCSRMatrix on every solve;
+ * pass a ParallelCSRMatrix as the matrix to keep the copy between solves.
+ */
+struct ParallelConjugateGradientTag
+{
+    double tolerance{1e-12};
+    int max_iterations{-1};
+
+    // Iterations and relative residual of the last solve
+    int iterations{0};
+    double error{0};
+};
+
+struct ParallelBICGSTABTag
+{
+    double tolerance{1e-12};
+    int max_iterations{-1};
+
+    // Iterations and relative residual of the last solve
+    int iterations{0};
+    double error{0};
+};
+
+/**
+ * GMRES restarts every `restart` iterations, and orthogonalizes with two passes of
+ * classical Gram-Schmidt: each pass is one fused sweep of all the dot products,
+ * instead of one reduction per basis vector as in modified Gram-Schmidt.
+ */
+struct ParallelGMRESTag
+{
+    double tolerance{1e-12};
+    int max_iterations{-1};
+    int restart{30};
+
+    // Iterations and relative residual of the last solve
+    int iterations{0};
+    double error{0};
+};
+
+namespace detail {
+
+void parallel_solve(const ParallelCSRMatrix &A, const Eigen::VectorXd &b, Eigen::VectorXd &x,
+                    ParallelConjugateGradientTag &tag);
+
+void parallel_solve(const ParallelCSRMatrix &A, const Eigen::VectorXd &b, Eigen::VectorXd &x,
+                    ParallelBICGSTABTag &tag);
+
+void parallel_solve(const ParallelCSRMatrix &A, const Eigen::VectorXd &b, Eigen::VectorXd &x,
+                    ParallelGMRESTag &tag);
+
+template<typename MatrixType, typename VectorType, typename TagType>
+void parallel_solve_impl(VectorType &result, MatrixType const &A, VectorType const &b, TagType &tag)
+{
+    auto run = [&](const ParallelCSRMatrix &P) {
+        if constexpr (std::is_same<VectorType, Eigen::VectorXd>::value) {
+            parallel_solve(P, b, result, tag);
+        } else {
+            Eigen::VectorXd x = result;
+            parallel_solve(P, Eigen::VectorXd(b), x, tag);
+            result = x;
+        }
+    };
+
+    if constexpr (std::is_same<MatrixType, ParallelCSRMatrix>::value) {
+        run(A);
+    } else {
+        run(ParallelCSRMatrix(A));
+    }
+};
+
+template<typename MatrixType, typename VectorType>
+void solve_impl(VectorType &result, MatrixType const &A, VectorType const &b, ParallelConjugateGradientTag &tag)
+{
+    parallel_solve_impl(result, A, b, tag);
+};
+
+template<typename MatrixType, typename VectorType>
+void solve_impl(VectorType &result, MatrixType const &A, VectorType const &b, ParallelBICGSTABTag &tag)
+{
+    parallel_solve_impl(result, A, b, tag);
+};
+
+template<typename MatrixType, typename VectorType>
+void solve_impl(VectorType &result, MatrixType const &A, VectorType const &b, ParallelGMRESTag &tag)
+{
+    parallel_solve_impl(result, A, b, tag);
+};
+
+}//end namespace detail
+
+}//end namespace LinearSolve
+
+YAFEL_NAMESPACE_CLOSE
+
+#endif //YAFEL_PARALLELKRYLOV_HPP
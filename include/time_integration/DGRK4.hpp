@@ -7,8 +7,9 @@
 
 #include "yafel_globals.hpp"
 #include "fe_system/FESystem.hpp"
-#include "assembly/DGAssembly.hpp"
-#include <Eigen/Dense>
+#include "time_integration/ExplicitRK.hpp"
+#include "utils/parallel/parassign.hpp"
+#include <Eigen/Core>
 
 YAFEL_NAMESPACE_OPEN
 
@@ -17,60 +18,65 @@ YAFEL_NAMESPACE_OPEN
  * \brief Class to perform RK4 integration,
  * designed for use with explicit DG methods (which provide M^{-1}*R quickly)
  *
- * Consider creating a base timestepping class that provides an interface like:
- * - initialize()
- * - step()
+ * Besides the solution, keeps U0 and an accumulator for the final combination,
+ * which each stage updates together with the next stage's solution.
+ * See ExplicitRK for the interface shared with LowStorageRK, SSPRK3 and SSPRK54.
  */
-class DGRK4
+class DGRK4 : public ExplicitRK
 {
 
 public:
-    DGRK4() = delete; //need to supply a timestep
-    DGRK4(double dt);
+    explicit DGRK4(double dt);
 
+    static constexpr int nStages() { return 4; }
+
+    static constexpr int order() { return 4; }
 
     template<typename Physics>
     void step(FESystem &feSystem, Physics &P)
     {
-        auto U0 = feSystem.getSolution();
+        auto &U = feSystem.getSolution();
+        U0.resize(U.rows());
+        Acc.resize(U.rows());
+        parassign(U0, U);
         double time0 = feSystem.currentTime();
-        DGAssembly(feSystem, P,
-                   {AssemblyRequirement::Residual,
-                    AssemblyRequirement::DtMass});
-        auto k1 = feSystem.getGlobalResidual();
-
-
-        feSystem.getSolution() = U0 + (dt / 2) * k1;
-        feSystem.currentTime() = time0 + dt / 2;
-        DGAssembly(feSystem, P,
-                   {AssemblyRequirement::Residual,
-                    AssemblyRequirement::DtMass});
-        auto k2 = feSystem.getGlobalResidual();
-
-        feSystem.getSolution() = U0 + (dt / 2) * k2;
-        feSystem.currentTime() = time0 + dt / 2;
-        DGAssembly(feSystem, P,
-                   {AssemblyRequirement::Residual,
-                    AssemblyRequirement::DtMass});
-
-        auto k3 = feSystem.getGlobalResidual();
-
-
-        feSystem.getSolution() = U0 + dt * k3;
-        feSystem.currentTime() = time0 + dt;
-        DGAssembly(feSystem, P,
-                   {AssemblyRequirement::Residual,
-                    AssemblyRequirement::DtMass});
-        auto k4 = feSystem.getGlobalResidual();
-
-        feSystem.getSolution() = U0 + (dt / 6) * k1 + (dt / 3) * k2 + (dt / 3) * k3 + (dt / 6) * k4;
+        const double h = dt;
+
+        // Weight of each stage in the final combination, and of its derivative in the next stage
+        constexpr double b[] = {1.0 / 6, 1.0 / 3, 1.0 / 3, 1.0 / 6};
+        constexpr double a[] = {0.5, 0.5, 1.0};
+        const double t[] = {time0, time0 + dt / 2, time0 + dt / 2, time0 + dt};
+
+        {
+            auto const &k1 = stage(feSystem, P, t[0]);
+            detail::rk_update(U.rows(), [&, h](Eigen::Index i) {
+                Acc(i) = U0(i) + b[0] * h * k1(i);
+                U(i) = U0(i) + a[0] * h * k1(i);
+            });
+        }
+        for (int s = 1; s < 3; ++s) {
+            auto const &k = stage(feSystem, P, t[s]);
+            const double bs = b[s];
+            const double as = a[s];
+            detail::rk_update(U.rows(), [&, h, bs, as](Eigen::Index i) {
+                Acc(i) += bs * h * k(i);
+                U(i) = U0(i) + as * h * k(i);
+            });
+        }
+        {
+            auto const &k4 = stage(feSystem, P, t[3]);
+            detail::rk_update(U.rows(), [&, h](Eigen::Index i) {
+                U(i) = Acc(i) + b[3] * h * k4(i);
+            });
+        }
 
         feSystem.currentTime() = time0 + dt;
     }
 
 
 private:
-    double dt;
+    Eigen::VectorXd U0;
+    Eigen::VectorXd Acc;
 
 };
 
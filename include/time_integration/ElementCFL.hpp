@@ -0,0 +1,123 @@
+#ifndef YAFEL_ELEMENTCFL_HPP
+#define YAFEL_ELEMENTCFL_HPP
+
+#include "yafel_globals.hpp"
+#include "fe_system/FESystem.hpp"
+#include "assembly/PhysicsTraits.hpp"
+#include <Eigen/Core>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+YAFEL_NAMESPACE_OPEN
+
+/**
+ * Characteristic length of every element of dimension nsd: 2 nsd |V_e| / |dV_e|,
+ * which is the side of a square or cube, and twice the inradius of a simplex.
+ * Other elements get an infinite length.
+ */
+std::vector<double> elementLengths(FESystem &feSystem, int nsd);
+
+
+namespace detail {
+
+// Largest Physics::WaveSpeed over the nodes of element elnum, from the state U if the physics uses it
+template<typename Physics>
+double element_wave_speed(const DoFManager &dofm, const Eigen::VectorXd &U, int elnum, double time,
+                          std::vector<int> &nodes)
+{
+    constexpr int NC = physics_dof_per_node<Physics>::value;
+    dofm.getGlobalNodes(elnum, nodes);
+    double speed{0};
+    for (int n : nodes) {
+        if constexpr (has_state_wave_speed<Physics, NC>::value) {
+            Tensor<NC, 1> Un;
+            for (int c = 0; c < NC; ++c) {
+                Un(c) = U(n * NC + c);
+            }
+            speed = std::max(speed, static_cast<double>(Physics::WaveSpeed(dofm.dof_nodes[n], time, Un)));
+        } else {
+            speed = std::max(speed, static_cast<double>(Physics::WaveSpeed(dofm.dof_nodes[n], time)));
+        }
+    }
+    return speed;
+}
+
+// cfl h / ((2p + 1) speed), infinite without a wave speed
+inline double element_time_step(double cfl, double h, int polyOrder, double speed)
+{
+    return (speed > 0) ? cfl * h / ((2 * polyOrder + 1) * speed) : std::numeric_limits<double>::infinity();
+}
+
+} // end namespace detail
+
+
+/**
+ * Stable explicit time step of every element of dimension Physics::nsd(),
+ *   dt_e = cfl h_e / ((2p + 1) s_e),
+ * with h_e from elementLengths and s_e the largest wave speed over the nodes of
+ * the element, at the FESystem's current time and solution. The physics provides
+ * either WaveSpeed(x, t), or WaveSpeed(x, t, U) with the Tensor<dofPerNode(), 1>
+ * state U of the node. Elements without a wave speed, or of another dimension,
+ * get an infinite step.
+ */
+template<typename Physics>
+std::vector<double> elementTimeSteps(FESystem &feSystem, double cfl)
+{
+    auto &dofm = feSystem.getDoFManager();
+    auto const &U = feSystem.getSolution();
+    const double time = feSystem.currentTime();
+    std::vector<double> dt = elementLengths(feSystem, Physics::nsd());
+
+#pragma omp parallel
+    {
+        std::vector<int> nodes;
+#pragma omp for
+        for (int elnum = 0; elnum < dofm.nCells(); ++elnum) {
+            if (dofm.element_types[elnum].topoDim != Physics::nsd()) {
+                continue;
+            }
+            const double speed = detail::element_wave_speed<Physics>(dofm, U, elnum, time, nodes);
+            dt[elnum] = detail::element_time_step(cfl, dt[elnum], dofm.element_types[elnum].polyOrder, speed);
+        }
+    }
+    return dt;
+}
+
+
+/**
+ * Smallest of the elementTimeSteps, reduced in parallel without storing them,
+ * given the elementLengths of the (fixed) mesh
+ */
+template<typename Physics>
+double stableTimeStep(FESystem &feSystem, const std::vector<double> &lengths, double cfl)
+{
+    auto &dofm = feSystem.getDoFManager();
+    auto const &U = feSystem.getSolution();
+    const double time = feSystem.currentTime();
+    if (static_cast<int>(lengths.size()) != dofm.nCells()) {
+        throw std::runtime_error("stableTimeStep: need one length per element");
+    }
+
+    double dt_min = std::numeric_limits<double>::infinity();
+#pragma omp parallel reduction(min : dt_min)
+    {
+        std::vector<int> nodes;
+#pragma omp for
+        for (int elnum = 0; elnum < dofm.nCells(); ++elnum) {
+            if (dofm.element_types[elnum].topoDim != Physics::nsd() || !std::isfinite(lengths[elnum])) {
+                continue;
+            }
+            const double speed = detail::element_wave_speed<Physics>(dofm, U, elnum, time, nodes);
+            dt_min = std::min(dt_min, detail::element_time_step(cfl, lengths[elnum],
+                                                                dofm.element_types[elnum].polyOrder, speed));
+        }
+    }
+    return dt_min;
+}
+
+YAFEL_NAMESPACE_CLOSE
+
+#endif //YAFEL_ELEMENTCFL_HPP
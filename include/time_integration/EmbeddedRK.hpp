@@ -0,0 +1,127 @@
+#ifndef YAFEL_EMBEDDEDRK_HPP
+#define YAFEL_EMBEDDEDRK_HPP
+
+#include "yafel_globals.hpp"
+#include "fe_system/FESystem.hpp"
+#include "time_integration/ExplicitRK.hpp"
+#include "utils/parallel/parassign.hpp"
+#include <Eigen/Core>
+
+YAFEL_NAMESPACE_OPEN
+
+/**
+ * \class BogackiShampine23
+ * \brief Embedded 3(2) Runge-Kutta pair of Bogacki and Shampine, for error-controlled steps
+ *
+ * step() advances the solution with the 3rd-order weights, and measures the
+ * difference to the embedded 2nd-order solution in the weighted RMS norm
+ *   errorNorm() = sqrt(mean_i (e_i / (atol + rtol max(|U0_i|, |U_i|)))^2),
+ * so that a step is acceptable if errorNorm() <= 1. reject() restores the
+ * solution and time from before the step (see TimeStepController::adaptiveStep).
+ *
+ * The last stage is the derivative at the new solution (first same as last): it
+ * is kept, and reused as the first stage of the next step if that starts from
+ * the same time and solution, which costs a comparison instead of an assembly.
+ * Besides the solution, keeps U0, the error accumulator, the last stage and the
+ * solution it was evaluated at.
+ */
+class BogackiShampine23 : public ExplicitRK
+{
+public:
+    explicit BogackiShampine23(double dt, double rtol = 1e-4, double atol = 1e-6);
+
+    static constexpr int nStages() { return 4; }
+
+    static constexpr int order() { return 3; }
+
+    // Order of the embedded solution, which sets the step size exponent 1/(embeddedOrder() + 1)
+    static constexpr int embeddedOrder() { return 2; }
+
+    template<typename Physics>
+    void step(FESystem &feSystem, Physics &physics)
+    {
+        auto &U = feSystem.getSolution();
+        U0.resize(U.rows());
+        Err.resize(U.rows());
+        parassign(U0, U);
+        time0 = feSystem.currentTime();
+        const double h = dt;
+
+        // k1, from the previous step if it ended here
+        const bool reuse = fsal_valid && time0 == fsal_time && U_fsal.rows() == U.rows() && U_fsal == U;
+        K_fsal.resize(U.rows());
+        U_fsal.resize(U.rows());
+        fsal_valid = false;
+        {
+            auto const &k1 = reuse ? static_cast<const Eigen::VectorXd &>(K_fsal) : stage(feSystem, physics, time0);
+            detail::rk_update(U.rows(), [&, h](Eigen::Index i) {
+                const double k = k1(i);
+                K_fsal(i) = k;
+                Err(i) = -5.0 / 72 * h * k;
+                U(i) = U0(i) + 0.5 * h * k;
+            });
+        }
+        {
+            auto const &k2 = stage(feSystem, physics, time0 + dt / 2);
+            detail::rk_update(U.rows(), [&, h](Eigen::Index i) {
+                Err(i) += 1.0 / 12 * h * k2(i);
+                K_fsal(i) = U0(i) + 2.0 / 9 * h * K_fsal(i) + 1.0 / 3 * h * k2(i);
+                U(i) = U0(i) + 0.75 * h * k2(i);
+            });
+        }
+        {
+            auto const &k3 = stage(feSystem, physics, time0 + 0.75 * dt);
+            detail::rk_update(U.rows(), [&, h](Eigen::Index i) {
+                Err(i) += 1.0 / 9 * h * k3(i);
+                U(i) = K_fsal(i) + 4.0 / 9 * h * k3(i);
+            });
+        }
+        {
+            auto const &k4 = stage(feSystem, physics, time0 + dt);
+            detail::rk_update(U.rows(), [&, h](Eigen::Index i) {
+                Err(i) -= 1.0 / 8 * h * k4(i);
+                K_fsal(i) = k4(i);
+                U_fsal(i) = U(i);
+            });
+        }
+
+        feSystem.currentTime() = time0 + dt;
+        fsal_time = feSystem.currentTime();
+        fsal_valid = true;
+        error_norm = weighted_error_norm(U);
+    }
+
+    // Weighted RMS norm of the local error estimate of the last step
+    inline double errorNorm() const { return error_norm; }
+
+    // Undo the last step: restore the solution and time it started from
+    void reject(FESystem &feSystem);
+
+    inline void setTolerances(double new_rtol, double new_atol)
+    {
+        rtol = new_rtol;
+        atol = new_atol;
+    }
+
+private:
+    double weighted_error_norm(const Eigen::VectorXd &U) const;
+
+    double rtol;
+    double atol;
+    double error_norm{0};
+    double time0{0};
+
+    Eigen::VectorXd U0;
+    Eigen::VectorXd Err;
+
+    // Last stage of the previous step and the solution it was evaluated at. During a step,
+    // K_fsal holds k1 until the second stage, which turns it into U0 + h (2/9 k1 + 1/3 k2).
+    Eigen::VectorXd K_fsal;
+    Eigen::VectorXd U_fsal;
+    double fsal_time{0};
+    bool fsal_valid{false};
+};
+
+YAFEL_NAMESPACE_CLOSE
+
+#endif //YAFEL_EMBEDDEDRK_HPP
@@ -0,0 +1,74 @@
+#ifndef YAFEL_EXPLICITRK_HPP
+#define YAFEL_EXPLICITRK_HPP
+
+#include "yafel_globals.hpp"
+#include "fe_system/FESystem.hpp"
+#include "assembly/DGAssembly.hpp"
+#include "utils/parallel/TaskScheduler.hpp"
+#include "utils/parallel/parfor.hpp"
+#include <Eigen/Core>
+
+YAFEL_NAMESPACE_OPEN
+
+/**
+ * \class ExplicitRK
+ * \brief Common part of the explicit Runge-Kutta integrators for DG
+ *
+ * Every integrator provides
+ * - ExplicitRK(double dt)
+ * - template<typename Physics> void step(FESystem &feSystem, Physics &physics),
+ *   which advances feSystem.getSolution() and feSystem.currentTime() by dt
+ * - nStages() and order()
+ *
+ * Stages evaluate M^{-1}R through DGAssembly with Residual and DtMass, into the
+ * FESystem's global residual, and update their registers in place with fused
+ * parallel loops (see detail::rk_update).
+ */
+class ExplicitRK
+{
+public:
+    ExplicitRK() = delete; //need to supply a timestep
+    explicit ExplicitRK(double dt) : dt(dt) {}
+
+    inline double timeStep() const { return dt; }
+
+    inline void setTimeStep(double new_dt) { dt = new_dt; }
+
+protected:
+    /**
+     * Evaluate the time derivative of the current solution at time t, and
+     * return it (the FESystem's global residual)
+     */
+    template<typename Physics>
+    Eigen::VectorXd &stage(FESystem &feSystem, Physics &physics, double t)
+    {
+        using Requirements = AssemblyRequirements<AssemblyRequirement::Residual, AssemblyRequirement::DtMass>;
+        feSystem.currentTime() = t;
+        DGAssembly<Physics, Requirements>(feSystem, physics);
+        return feSystem.getGlobalResidual();
+    }
+
+    double dt;
+};
+
+
+namespace detail {
+
+/**
+ * Run update(i) for every entry of vectors of length n, in blocks on the global
+ * scheduler (like parassign): update fuses all the register updates of one stage,
+ * so that each entry is read and written once.
+ */
+template<typename Lambda>
+void rk_update(Eigen::Index n, Lambda &&update, std::size_t chunkSize = 1024)
+{
+    parfor(0, static_cast<std::size_t>(n), [&update](std::size_t i) {
+        update(static_cast<Eigen::Index>(i));
+    }, getGlobalScheduler(), chunkSize);
+}
+
+} // end namespace detail
+
+YAFEL_NAMESPACE_CLOSE
+
+#endif //YAFEL_EXPLICITRK_HPP
@@ -0,0 +1,274 @@
+#ifndef YAFEL_IMEXRK_HPP
+#define YAFEL_IMEXRK_HPP
+
+#include "yafel_globals.hpp"
+#include "assembly/DGAssembly.hpp"
+#include "assembly/PhysicsTraits.hpp"
+#include "element/ElementFactory.hpp"
+#include "fe_system/FESystem.hpp"
+#include "lin_alg/linear_solvers/solvers/CachedSolvers.hpp"
+#include "lin_alg/linear_solvers/solvers/EigenBICGSTAB.hpp"
+#include "lin_alg/linear_solvers/solvers/EigenCholesky.hpp"
+#include "lin_alg/linear_solvers/solvers/EigenConjugateGradient.hpp"
+#include "time_integration/ExplicitRK.hpp"
+#include <Eigen/Core>
+#include <Eigen/Sparse>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+YAFEL_NAMESPACE_OPEN
+
+/**
+ * \class IMEXRK
+ * \brief Implicit-explicit (and diagonally implicit) Runge-Kutta integrators for DG
+ *
+ * The semi-discrete system M dU/dt = R_E(U, t) + R_I(U, t) is split into an
+ * explicit part R_E, the residual of one Physics, and an implicit part R_I, the
+ * residual of another (both as assembled by DGAssembly, without the inverse
+ * mass). Stage i solves
+ *   M U_i - dt a_ii R_I(U_i) = M U_n + dt sum_{j<i} (ahat_ij R_E(U_j) + a_ij R_I(U_j))
+ * by Newton iterations, starting from the previous stage: each assembles R_I and
+ * its tangent K (DGAssembly with Residual and Tangent) and solves
+ * (M - dt a_ii K) dU = rhs with a LinearSolve solver tag. One iteration (the
+ * default) is exact for linear implicit terms. The mass matrix M is assembled
+ * once, on the first step, from the implicit Physics' LocalMass, in the same
+ * block-sparse structure as K.
+ *
+ * The schemes are the stiffly accurate ARS schemes of Ascher, Ruuth and Spiteri,
+ * whose last stage is the new solution:
+ * - ARS111: forward-backward Euler, first order
+ * - ARS222: two implicit stages (L-stable), second order
+ * - ARS443: four implicit stages (L-stable), third order
+ *
+ * step(feSystem, explicitPhysics, implicitPhysics) advances the split system;
+ * step(feSystem, physics) treats all of it implicitly (the implicit tableau
+ * alone, a DIRK scheme), and fits TimeStepController::step. The solver is a
+ * template argument, e.g. step<LinearSolve::EigenBICGSTABTag>(...) (the default).
+ * Both also take a solver tag as last argument instead, which then lives across
+ * stages and steps: a LinearSolve::CachedSolverTag keeps its symbolic analysis,
+ * and with Reuse::Factorization its factorization, which is exact for linear
+ * implicit terms at a fixed dt (all the ARS stages share a_ii).
+ */
+class IMEXRK
+{
+public:
+    enum class Scheme
+    {
+        ARS111,
+        ARS222,
+        ARS443
+    };
+
+    IMEXRK() = delete; //need to supply a timestep
+    explicit IMEXRK(double dt, Scheme scheme = Scheme::ARS222);
+
+    inline double timeStep() const { return dt; }
+
+    inline void setTimeStep(double new_dt) { dt = new_dt; }
+
+    inline int nStages() const { return static_cast<int>(c.size()); }
+
+    inline int order() const { return scheme_order; }
+
+    // Newton iterations per implicit stage (more than one for nonlinear implicit terms)
+    void setNewtonIterations(int iterations);
+
+    template<typename SolverTag = LinearSolve::EigenBICGSTABTag, typename ExplicitPhysics, typename ImplicitPhysics,
+            typename = std::enable_if_t<detail::is_physics<ImplicitPhysics>::value>>
+    void step(FESystem &feSystem, ExplicitPhysics &explicitPhysics, ImplicitPhysics &implicitPhysics)
+    {
+        SolverTag tag;
+        advance<true>(feSystem, explicitPhysics, implicitPhysics, tag);
+    }
+
+    template<typename SolverTag = LinearSolve::EigenBICGSTABTag, typename Physics>
+    void step(FESystem &feSystem, Physics &physics)
+    {
+        SolverTag tag;
+        advance<false>(feSystem, physics, physics, tag);
+    }
+
+    template<typename ExplicitPhysics, typename ImplicitPhysics, typename SolverTag>
+    void step(FESystem &feSystem, ExplicitPhysics &explicitPhysics, ImplicitPhysics &implicitPhysics, SolverTag &tag)
+    {
+        advance<true>(feSystem, explicitPhysics, implicitPhysics, tag);
+    }
+
+    template<typename Physics, typename SolverTag,
+            typename = std::enable_if_t<!detail::is_physics<SolverTag>::value>>
+    void step(FESystem &feSystem, Physics &physics, SolverTag &tag)
+    {
+        advance<false>(feSystem, physics, physics, tag);
+    }
+
+    // The mass matrix of the last step (assembled on the first one)
+    inline const Eigen::SparseMatrix<double> &massMatrix() const { return M; }
+
+private:
+    // Butcher coefficients of stage i on stage j < i (explicit) and j <= i (implicit)
+    inline double aExplicit(int i, int j) const { return A_explicit[i * nStages() + j]; }
+
+    inline double aImplicit(int i, int j) const { return A_implicit[i * nStages() + j]; }
+
+    template<typename Physics>
+    void buildMass(FESystem &feSystem);
+
+    template<bool split, typename ExplicitPhysics, typename ImplicitPhysics, typename SolverTag>
+    void advance(FESystem &feSystem, ExplicitPhysics &explicitPhysics, ImplicitPhysics &implicitPhysics,
+                 SolverTag &tag);
+
+    double dt;
+    std::vector<double> A_explicit;
+    std::vector<double> A_implicit;
+    std::vector<double> c;
+    int scheme_order;
+    int newton_iterations{1};
+
+    Eigen::SparseMatrix<double> M;
+    Eigen::SparseMatrix<double> S;
+
+    // Stage residuals of both parts, and work vectors
+    std::vector<Eigen::VectorXd> R_explicit;
+    std::vector<Eigen::VectorXd> R_implicit;
+    Eigen::VectorXd U0, known, rhs, dU;
+};
+
+
+template<typename Physics>
+void IMEXRK::buildMass(FESystem &feSystem)
+{
+    constexpr int NSD = Physics::nsd();
+    auto &dofm = feSystem.getDoFManager();
+    auto const &pattern = feSystem.getSparsityPattern(NSD);
+    auto const *geometry = feSystem.getGeometryCache(NSD);
+    const double time = feSystem.currentTime();
+    pattern.initializeMatrix(M);
+
+    // Element blocks only, each written by one thread
+#pragma omp parallel
+    {
+        ElementFactory EF(dofm);
+        Eigen::MatrixXd M_el;
+        std::vector<int> element_dofs;
+#pragma omp for schedule(dynamic, 16)
+        for (int elnum = 0; elnum < dofm.nCells(); ++elnum) {
+            auto et = dofm.element_types[elnum];
+            if (et.topoDim != NSD) {
+                continue;
+            }
+            auto &E = EF.getElement(et);
+            dofm.getGlobalDofs(elnum, element_dofs);
+            const int n = static_cast<int>(element_dofs.size());
+            M_el.setZero(n, n);
+            for (int qpi = 0; qpi < E.nQP(); ++qpi) {
+                E.update<NSD>(elnum, qpi, dofm, geometry);
+                Physics::LocalMass(E, qpi, time, M_el);
+            }
+            const int *positions = pattern.elementPositions(elnum);
+            for (int A = 0; A < n; ++A) {
+                for (int B = 0; B < n; ++B) {
+                    M.valuePtr()[positions[A * n + B]] = M_el(A, B);
+                }
+            }
+        }
+    }
+}
+
+
+template<bool split, typename ExplicitPhysics, typename ImplicitPhysics, typename SolverTag>
+void IMEXRK::advance(FESystem &feSystem, ExplicitPhysics &explicitPhysics, ImplicitPhysics &implicitPhysics,
+                     SolverTag &tag)
+{
+    using Residual = AssemblyRequirements<AssemblyRequirement::Residual>;
+    using ResidualAndTangent = AssemblyRequirements<AssemblyRequirement::Residual, AssemblyRequirement::Tangent>;
+
+    auto &U = feSystem.getSolution();
+    auto &R = feSystem.getGlobalResidual();
+    auto &K = feSystem.getGlobalTangent();
+    const Eigen::Index n = U.rows();
+    const double t0 = feSystem.currentTime();
+    const int s = nStages();
+    if (M.rows() != n) {
+        buildMass<ImplicitPhysics>(feSystem);
+    }
+
+    U0 = U;
+    R_explicit.resize(s);
+    R_implicit.resize(s);
+
+    for (int i = 0; i < s; ++i) {
+        const double ti = t0 + c[i] * dt;
+        const double h = dt * aImplicit(i, i);
+
+        if (i > 0) {
+            // Known part of the stage equation: M U_n + dt sum_{j<i} (ahat_ij R_E,j + a_ij R_I,j)
+            known.noalias() = M * U0;
+            for (int j = 0; j < i; ++j) {
+                const double we = split ? dt * aExplicit(i, j) : 0.0;
+                const double wi = dt * aImplicit(i, j);
+                if (we == 0 && wi == 0) {
+                    continue;
+                }
+                auto const &RE = R_explicit[j];
+                auto const &RI = R_implicit[j];
+                detail::rk_update(n, [&, we, wi](Eigen::Index k) {
+                    known(k) += (we != 0 ? we * RE(k) : 0.0) + (wi != 0 ? wi * RI(k) : 0.0);
+                });
+            }
+
+            // Newton on M U - h R_I(U) = known, from the previous stage
+            feSystem.currentTime() = ti;
+            for (int it = 0; it < newton_iterations; ++it) {
+                DGAssembly<ImplicitPhysics, ResidualAndTangent>(feSystem, implicitPhysics);
+                S = K;
+                if (S.nonZeros() != M.nonZeros()) {
+                    throw std::runtime_error("IMEXRK: tangent and mass matrix structures differ");
+                }
+                const double *m = M.valuePtr();
+                double *sv = S.valuePtr();
+                for (Eigen::Index k = 0; k < S.nonZeros(); ++k) {
+                    sv[k] = m[k] - h * sv[k];
+                }
+                rhs.noalias() = known - M * U;
+                rhs += h * R;
+                dU.setZero(n);
+                LinearSolve::detail::solve_impl(dU, S, rhs, tag);
+                U += dU;
+            }
+
+            // R_I(U_i) from the stage equation itself, rather than one more assembly
+            if (i < s - 1) {
+                R_implicit[i].noalias() = M * U;
+                R_implicit[i] -= known;
+                R_implicit[i] /= h;
+            }
+        } else if (i < s - 1) {
+            // First stage, U_0 = U_n: explicit in both parts
+            bool needed = false;
+            for (int j = 1; j < s; ++j) {
+                needed = needed || aImplicit(j, 0) != 0;
+            }
+            if (needed) {
+                feSystem.currentTime() = ti;
+                DGAssembly<ImplicitPhysics, Residual>(feSystem, implicitPhysics);
+                R_implicit[0] = R;
+            } else {
+                R_implicit[0].setZero(n);
+            }
+        }
+
+        if (split && i < s - 1) {
+            feSystem.currentTime() = ti;
+            DGAssembly<ExplicitPhysics, Residual>(feSystem, explicitPhysics);
+            R_explicit[i] = R;
+        }
+    }
+
+    // Stiffly accurate: the last stage is the new solution
+    feSystem.currentTime() = t0 + dt;
+}
+
+YAFEL_NAMESPACE_CLOSE
+
+#endif //YAFEL_IMEXRK_HPP
@@ -0,0 +1,209 @@
+#ifndef YAFEL_LOCALTIMESTEPPING_HPP
+#define YAFEL_LOCALTIMESTEPPING_HPP
+
+#include "yafel_globals.hpp"
+#include "time_integration/ExplicitRK.hpp"
+#include "utils/DGActiveSet.hpp"
+#include <Eigen/Core>
+#include <vector>
+
+YAFEL_NAMESPACE_OPEN
+
+/**
+ * \class LocalTimeStepping
+ * \brief Multirate explicit DG integrator with power-of-two time-step levels
+ *
+ * Every element is put on a level l, advanced with the step dt_0 2^l, where dt_0
+ * is the smallest stable element step: l is the largest level whose step does not
+ * exceed the element's own step (from elementTimeSteps, say), lowered until face
+ * neighbors differ by at most one level. timeStep() is the step of the coarsest
+ * level, by which step() advances the whole solution.
+ *
+ * Each level takes Heun (SSP-RK2) steps, recursively, coarsest first: a level
+ * evaluates its derivative K1 at the start of its step, lets the next finer level
+ * take two half steps, then evaluates K2 at the end of its step from the Euler
+ * predictor U + dt K1, and sets U + dt/2 (K1 + K2). Level interfaces are coupled
+ * through DGAssembly on the level's DGActiveSet: each face flux is evaluated with
+ * both sides at the same time, the finer side being exact (it has been advanced)
+ * and the coarser side the Euler predictor of its current step. The scheme is
+ * second order; with a single level it is Heun's method.
+ *
+ * The faces between levels l and l+1 are only evaluated by level l, which also
+ * writes their coarse side to a flux register: the coarse element is updated
+ * with the same flux values, integrated with the weights of the fine stages, as
+ * the fine element. The total mass (and any quantity whose test function is
+ * constant per element) is conserved to rounding, as with a single rate. The
+ * first fine evaluation of a coarse step has both sides at the coarse step
+ * start, and completes the coarse K1 used by the predictors.
+ *
+ * The work per coarse step is proportional to the sum over levels of the level's
+ * element count times its number of steps, instead of the element count times the
+ * number of steps of the finest level.
+ */
+class LocalTimeStepping : public ExplicitRK
+{
+public:
+    /**
+     * @param dofm DG DoFManager (with its internal faces built)
+     * @param element_dt stable time step of every element; elements with an infinite
+     *        step (no wave speed, or not of the simulation dimension) go on the coarsest
+     *        level of the elements with a finite step
+     * @param maxLevels largest number of levels
+     */
+    LocalTimeStepping(const DoFManager &dofm, const std::vector<double> &element_dt, int maxLevels = 8);
+
+    static constexpr int order() { return 2; }
+
+    inline int nLevels() const { return static_cast<int>(levels.size()); }
+
+    inline int level(int elnum) const { return element_level[elnum]; }
+
+    inline const DGActiveSet &levelSet(int l) const { return levels[l]; }
+
+    // Step of level l (timeStep() for the coarsest level)
+    inline double levelTimeStep(int l) const { return dt / (1 << (nLevels() - 1 - l)); }
+
+    // Element residual evaluations performed so far
+    inline long elementEvaluations() const { return evaluations; }
+
+    template<typename Physics>
+    void step(FESystem &feSystem, Physics &physics)
+    {
+        auto &U = feSystem.getSolution();
+        U_start.resize(U.rows());
+        K1.resize(U.rows());
+        if (flux_register.rows() != U.rows()) {
+            flux_register.setZero(U.rows());
+        }
+        double time0 = feSystem.currentTime();
+
+        advance(feSystem, physics, nLevels() - 1, time0, false);
+
+        feSystem.currentTime() = time0 + dt;
+    }
+
+private:
+    // One Heun step of level l from time t, with two steps of each finer level inside;
+    // `first` if it starts the current step of level l+1
+    template<typename Physics>
+    void advance(FESystem &feSystem, Physics &physics, int l, double t, bool first)
+    {
+        auto &U = feSystem.getSolution();
+        auto const &dofs = levels[l].dofs();
+        const double h = levelTimeStep(l);
+        const Eigen::Index n = static_cast<Eigen::Index>(dofs.size());
+
+        {
+            auto const &R = evaluate(feSystem, physics, l, t);
+            detail::rk_update(n, [&](Eigen::Index k) {
+                const int d = dofs[k];
+                U_start(d) = U(d);
+                K1(d) = R(d);
+            });
+            level_start[l] = t;
+            collect(feSystem, physics, l, first);
+        }
+
+        if (l > 0) {
+            advance(feSystem, physics, l - 1, t, true);
+            advance(feSystem, physics, l - 1, t + h / 2, false);
+        }
+
+        detail::rk_update(n, [&, h](Eigen::Index k) {
+            const int d = dofs[k];
+            U(d) = U_start(d) + h * K1(d);
+        });
+        {
+            auto const &R = evaluate(feSystem, physics, l, t + h);
+            detail::rk_update(n, [&, h](Eigen::Index k) {
+                const int d = dofs[k];
+                U(d) = U_start(d) + (h / 2) * (K1(d) + R(d));
+            });
+            collect(feSystem, physics, l, false);
+        }
+
+        // The faces with level l-1, from the register
+        if (l > 0) {
+            auto const &halo = coarse_halo[l - 1];
+            physics.inverse_mass.apply(flux_register, coarse_halo_elements[l - 1]);
+            detail::rk_update(static_cast<Eigen::Index>(halo.size()), [&](Eigen::Index k) {
+                const int d = halo[k];
+                U(d) += flux_register(d);
+                flux_register(d) = 0;
+            });
+        }
+    }
+
+    // Adds the coarse side fluxes of the last evaluation of level l to the register of
+    // level l+1, with the weight h/2 of a Heun stage of level l. On the first one of a
+    // coarse step, they also complete the coarse K1, which therefore holds them with
+    // the weight h of the coarse step h_c = 2h, and the register takes h/2 - h instead.
+    template<typename Physics>
+    void collect(FESystem &feSystem, Physics &physics, int l, bool first)
+    {
+        if (l + 1 == nLevels()) {
+            return;
+        }
+        auto &R = feSystem.getGlobalResidual();
+        auto const &halo = coarse_halo[l];
+        const Eigen::Index n = static_cast<Eigen::Index>(halo.size());
+        const double h = levelTimeStep(l);
+        const double weight = first ? -h / 2 : h / 2;
+        detail::rk_update(n, [&, weight](Eigen::Index k) {
+            const int d = halo[k];
+            flux_register(d) += weight * R(d);
+        });
+        if (first) {
+            physics.inverse_mass.apply(R, coarse_halo_elements[l]);
+            detail::rk_update(n, [&](Eigen::Index k) {
+                const int d = halo[k];
+                K1(d) += R(d);
+            });
+        }
+    }
+
+    // M^{-1}R of the elements of level l at time t, with the coarser neighbors predicted at t,
+    // and the coarse side fluxes of the faces with level l+1 (without inverse mass)
+    template<typename Physics>
+    Eigen::VectorXd &evaluate(FESystem &feSystem, Physics &physics, int l, double t)
+    {
+        using Requirements = AssemblyRequirements<AssemblyRequirement::Residual, AssemblyRequirement::DtMass>;
+        if (l + 1 < nLevels()) {
+            auto &U = feSystem.getSolution();
+            auto const &halo = coarse_halo[l];
+            const double tau = t - level_start[l + 1];
+            detail::rk_update(static_cast<Eigen::Index>(halo.size()), [&, tau](Eigen::Index k) {
+                const int d = halo[k];
+                U(d) = U_start(d) + tau * K1(d);
+            });
+        }
+
+        feSystem.currentTime() = t;
+        DGAssembly<Physics, Requirements>(feSystem, physics, levels[l]);
+        evaluations += levels[l].nElements();
+        return feSystem.getGlobalResidual();
+    }
+
+    std::vector<int> element_level;
+    std::vector<DGActiveSet> levels;
+
+    // Per level l: the level l+1 elements sharing a face with a level l element, and their dofs
+    std::vector<std::vector<int>> coarse_halo_elements;
+    std::vector<std::vector<int>> coarse_halo;
+
+    // Per level: the start time of its current step
+    std::vector<double> level_start;
+
+    // Per dof: the solution at the start of the current step of its level, and K1
+    Eigen::VectorXd U_start;
+    Eigen::VectorXd K1;
+
+    // Per dof of a coarse halo: its faces with the finer level, integrated over the coarse step
+    Eigen::VectorXd flux_register;
+
+    long evaluations{0};
+};
+
+YAFEL_NAMESPACE_CLOSE
+
+#endif //YAFEL_LOCALTIMESTEPPING_HPP
@@ -0,0 +1,79 @@
+#ifndef YAFEL_LOWSTORAGERK_HPP
+#define YAFEL_LOWSTORAGERK_HPP
+
+#include "yafel_globals.hpp"
+#include "time_integration/ExplicitRK.hpp"
+#include <Eigen/Core>
+#include <vector>
+
+YAFEL_NAMESPACE_OPEN
+
+/**
+ * \class LowStorageRK
+ * \brief 2N-storage explicit Runge-Kutta integrator (Williamson form)
+ *
+ * Each stage i computes
+ *   dU <- A_i dU + dt M^{-1}R(U, t0 + c_i dt)
+ *   U  <- U + B_i dU
+ * so that the solution and one register dU are the only vectors kept across stages.
+ *
+ * Schemes:
+ * - Williamson3: Williamson's 3-stage, 3rd-order scheme
+ * - CarpenterKennedy4: Carpenter and Kennedy's 5-stage, 4th-order scheme
+ */
+class LowStorageRK : public ExplicitRK
+{
+public:
+    enum class Scheme
+    {
+        Williamson3,
+        CarpenterKennedy4
+    };
+
+    explicit LowStorageRK(double dt, Scheme scheme = Scheme::CarpenterKennedy4);
+
+    inline int nStages() const { return static_cast<int>(A.size()); }
+
+    inline int order() const { return scheme_order; }
+
+    template<typename Physics>
+    void step(FESystem &feSystem, Physics &physics)
+    {
+        auto &U = feSystem.getSolution();
+        dU.resize(U.rows());
+        double time0 = feSystem.currentTime();
+
+        for (int i = 0; i < nStages(); ++i) {
+            auto const &R = stage(feSystem, physics, time0 + c[i] * dt);
+            const double a = A[i];
+            const double b = B[i];
+            const double h = dt;
+            if (i == 0) {
+                // dU holds the previous step: do not scale it, it may hold anything
+                detail::rk_update(U.rows(), [&, b, h](Eigen::Index k) {
+                    dU(k) = h * R(k);
+                    U(k) += b * dU(k);
+                });
+            } else {
+                detail::rk_update(U.rows(), [&, a, b, h](Eigen::Index k) {
+                    dU(k) = a * dU(k) + h * R(k);
+                    U(k) += b * dU(k);
+                });
+            }
+        }
+
+        feSystem.currentTime() = time0 + dt;
+    }
+
+private:
+    std::vector<double> A;
+    std::vector<double> B;
+    std::vector<double> c;
+    int scheme_order;
+
+    Eigen::VectorXd dU;
+};
+
+YAFEL_NAMESPACE_CLOSE
+
+#endif //YAFEL_LOWSTORAGERK_HPP
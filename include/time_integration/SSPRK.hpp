@@ -0,0 +1,138 @@
+#ifndef YAFEL_SSPRK_HPP
+#define YAFEL_SSPRK_HPP
+
+#include "yafel_globals.hpp"
+#include "time_integration/ExplicitRK.hpp"
+#include "utils/parallel/parassign.hpp"
+#include <Eigen/Core>
+
+YAFEL_NAMESPACE_OPEN
+
+/**
+ * \class SSPRK3
+ * \brief Strong-stability-preserving 3-stage, 3rd-order Runge-Kutta (Shu-Osher form)
+ *
+ *   U1 = U0 + dt L(U0)
+ *   U2 = 3/4 U0 + 1/4 (U1 + dt L(U1))
+ *   U  = 1/3 U0 + 2/3 (U2 + dt L(U2))
+ *
+ * Each stage overwrites the solution in place; U0 is the only other register.
+ */
+class SSPRK3 : public ExplicitRK
+{
+public:
+    explicit SSPRK3(double dt) : ExplicitRK(dt) {}
+
+    static constexpr int nStages() { return 3; }
+
+    static constexpr int order() { return 3; }
+
+    template<typename Physics>
+    void step(FESystem &feSystem, Physics &physics)
+    {
+        auto &U = feSystem.getSolution();
+        U0.resize(U.rows());
+        parassign(U0, U);
+        double time0 = feSystem.currentTime();
+        const double h = dt;
+
+        // Stage weight of U0, and time of each stage
+        constexpr double alpha[] = {0.0, 3.0 / 4.0, 1.0 / 3.0};
+        const double t[] = {time0, time0 + dt, time0 + dt / 2};
+
+        for (int i = 0; i < nStages(); ++i) {
+            auto const &R = stage(feSystem, physics, t[i]);
+            const double a = alpha[i];
+            detail::rk_update(U.rows(), [&, a, h](Eigen::Index k) {
+                U(k) = a * U0(k) + (1 - a) * (U(k) + h * R(k));
+            });
+        }
+
+        feSystem.currentTime() = time0 + dt;
+    }
+
+private:
+    Eigen::VectorXd U0;
+};
+
+
+/**
+ * \class SSPRK54
+ * \brief Strong-stability-preserving 5-stage, 4th-order Runge-Kutta of Spiteri and Ruuth
+ *
+ * In Shu-Osher form, the last stage combines U2, U3, L(U3), U4 and L(U4). Its
+ * U2 and U3 terms are accumulated into a register Q as soon as they are known,
+ * so the method keeps U0 and Q besides the solution.
+ */
+class SSPRK54 : public ExplicitRK
+{
+public:
+    explicit SSPRK54(double dt) : ExplicitRK(dt) {}
+
+    static constexpr int nStages() { return 5; }
+
+    static constexpr int order() { return 4; }
+
+    template<typename Physics>
+    void step(FESystem &feSystem, Physics &physics)
+    {
+        auto &U = feSystem.getSolution();
+        U0.resize(U.rows());
+        parassign(U0, U);
+        Q.resize(U.rows());
+        double time0 = feSystem.currentTime();
+        const double h = dt;
+
+        // U1 = U0 + 0.391752226571890 dt L(U0)
+        {
+            auto const &R = stage(feSystem, physics, time0);
+            detail::rk_update(U.rows(), [&, h](Eigen::Index k) {
+                U(k) += 0.391752226571890 * h * R(k);
+            });
+        }
+
+        // U2 = 0.444370493651235 U0 + 0.555629506348765 U1 + 0.368410593050371 dt L(U1)
+        {
+            auto const &R = stage(feSystem, physics, time0 + 0.391752226571890 * dt);
+            detail::rk_update(U.rows(), [&, h](Eigen::Index k) {
+                U(k) = 0.444370493651235 * U0(k) + 0.555629506348765 * U(k) + 0.368410593050371 * h * R(k);
+                Q(k) = 0.517231671970585 * U(k);
+            });
+        }
+
+        // U3 = 0.620101851488403 U0 + 0.379898148511597 U2 + 0.251891774271694 dt L(U2)
+        {
+            auto const &R = stage(feSystem, physics, time0 + 0.586079689311540 * dt);
+            detail::rk_update(U.rows(), [&, h](Eigen::Index k) {
+                U(k) = 0.620101851488403 * U0(k) + 0.379898148511597 * U(k) + 0.251891774271694 * h * R(k);
+            });
+        }
+
+        // U4 = 0.178079954393132 U0 + 0.821920045606868 U3 + 0.544974750228521 dt L(U3)
+        {
+            auto const &R = stage(feSystem, physics, time0 + 0.474542363121400 * dt);
+            detail::rk_update(U.rows(), [&, h](Eigen::Index k) {
+                Q(k) += 0.096059710526147 * U(k) + 0.063692468666290 * h * R(k);
+                U(k) = 0.178079954393132 * U0(k) + 0.821920045606868 * U(k) + 0.544974750228521 * h * R(k);
+            });
+        }
+
+        // U = Q + 0.386708617503269 U4 + 0.226007483236906 dt L(U4)
+        {
+            auto const &R = stage(feSystem, physics, time0 + 0.935010630967653 * dt);
+            detail::rk_update(U.rows(), [&, h](Eigen::Index k) {
+                U(k) = Q(k) + 0.386708617503269 * U(k) + 0.226007483236906 * h * R(k);
+            });
+        }
+
+        feSystem.currentTime() = time0 + dt;
+    }
+
+private:
+    Eigen::VectorXd U0;
+    Eigen::VectorXd Q;
+};
+
+YAFEL_NAMESPACE_CLOSE
+
+#endif //YAFEL_SSPRK_HPP
@@ -0,0 +1,143 @@
+#ifndef YAFEL_TIMESTEPCONTROLLER_HPP
+#define YAFEL_TIMESTEPCONTROLLER_HPP
+
+#include "yafel_globals.hpp"
+#include "fe_system/FESystem.hpp"
+#include "time_integration/ElementCFL.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+YAFEL_NAMESPACE_OPEN
+
+/**
+ * \class TimeStepController
+ * \brief Chooses the time step of the explicit integrators (DGRK4, LowStorageRK, SSPRK3, ...)
+ *
+ * The stable step is the smallest element step cfl h_e / ((2p + 1) s_e) of
+ * elementTimeSteps. The element lengths h_e are computed once, at construction,
+ * and the wave speeds s_e at the current state, reduced in parallel to the global
+ * step every `interval` steps. In between, the last reduced step is reused.
+ *
+ * step() sets the integrator's step to the stable one (cut to land on t_end, and
+ * to at most the maximum step) before advancing. adaptiveStep() drives an
+ * embedded pair (BogackiShampine23) instead: the step follows the local error
+ * estimate, with rejected steps retried, and is still capped by the stable step.
+ */
+class TimeStepController
+{
+public:
+    TimeStepController(FESystem &feSystem, int nsd, double cfl, int interval = 1);
+
+    /**
+     * Stable step at the FESystem's current time and solution, recomputed if
+     * `interval` steps were taken since the last reduction (or none was done)
+     */
+    template<typename Physics>
+    double timeStep(FESystem &feSystem)
+    {
+        if (steps_since_update < 0 || steps_since_update >= interval) {
+            stable_dt = stableTimeStep<Physics>(feSystem, lengths, cfl);
+            steps_since_update = 0;
+            if (!(stable_dt > 0)) {
+                throw std::runtime_error("TimeStepController: no positive stable time step");
+            }
+        }
+        return std::min(stable_dt, max_dt);
+    }
+
+    /**
+     * Advance the integrator by one stable step, or up to t_end if it comes first.
+     * Returns the step taken.
+     */
+    template<typename Integrator, typename Physics>
+    double step(Integrator &integrator, FESystem &feSystem, Physics &physics,
+                double t_end = std::numeric_limits<double>::infinity())
+    {
+        const double t0 = feSystem.currentTime();
+        const double h = clip(timeStep<Physics>(feSystem), t0, t_end);
+        integrator.setTimeStep(h);
+        integrator.step(feSystem, physics);
+        land(feSystem, t0, h, t_end);
+        ++steps_since_update;
+        return h;
+    }
+
+    /**
+     * Advance an embedded integrator by one accepted step, and propose the next one
+     * as its time step. The step starts from the integrator's time step (its
+     * proposal from the previous call), capped by the stable step and t_end.
+     * Rejected attempts are undone and retried with a smaller step. Returns the
+     * step taken.
+     */
+    template<typename EmbeddedIntegrator, typename Physics>
+    double adaptiveStep(EmbeddedIntegrator &integrator, FESystem &feSystem, Physics &physics,
+                        double t_end = std::numeric_limits<double>::infinity())
+    {
+        constexpr double exponent = -1.0 / (EmbeddedIntegrator::embeddedOrder() + 1);
+        const double t0 = feSystem.currentTime();
+        const double dt_stable = timeStep<Physics>(feSystem);
+        double h = clip(std::min(integrator.timeStep(), dt_stable), t0, t_end);
+
+        while (true) {
+            integrator.setTimeStep(h);
+            integrator.step(feSystem, physics);
+            const double err = integrator.errorNorm();
+            const double factor = err > 0 ? std::clamp(safety * std::pow(err, exponent), min_factor, max_factor)
+                                          : max_factor;
+            if (err <= 1) {
+                land(feSystem, t0, h, t_end);
+                ++n_accepted;
+                ++steps_since_update;
+                integrator.setTimeStep(std::min(h * factor, std::min(dt_stable, max_dt)));
+                return h;
+            }
+
+            integrator.reject(feSystem);
+            ++n_rejected;
+            h *= std::min(factor, 0.9);
+            if (h <= 1e-14 * std::max(1.0, std::abs(feSystem.currentTime()))) {
+                throw std::runtime_error("TimeStepController: step size underflow in adaptiveStep");
+            }
+        }
+    }
+
+    // Upper bound of the step, whatever the stability limit
+    inline void setMaxTimeStep(double dt) { max_dt = dt; }
+
+    // Step size changes of adaptiveStep: the factor safety * err^(-1/(q+1)) is kept in [min_factor, max_factor]
+    void setStepFactors(double safety, double min_factor, double max_factor);
+
+    inline const std::vector<double> &elementLengths() const { return lengths; }
+
+    inline int nAccepted() const { return n_accepted; }
+
+    inline int nRejected() const { return n_rejected; }
+
+private:
+    // Shorten h to land on t_end, without leaving a last step much shorter than the others
+    static double clip(double h, double t, double t_end);
+
+    // A step of h from t0 that was cut to reach t_end ends exactly there, not an ulp away
+    static void land(FESystem &feSystem, double t0, double h, double t_end);
+
+    std::vector<double> lengths;
+    double cfl;
+    int interval;
+
+    double stable_dt{0};
+    int steps_since_update{-1};
+    double max_dt{std::numeric_limits<double>::infinity()};
+
+    double safety{0.9};
+    double min_factor{0.2};
+    double max_factor{5.0};
+    int n_accepted{0};
+    int n_rejected{0};
+};
+
+YAFEL_NAMESPACE_CLOSE
+
+#endif //YAFEL_TIMESTEPCONTROLLER_HPP
@@ -0,0 +1,67 @@
+#ifndef YAFEL_DGACTIVESET_HPP
+#define YAFEL_DGACTIVESET_HPP
+
+#include "yafel_globals.hpp"
+#include <vector>
+
+YAFEL_NAMESPACE_OPEN
+
+class DoFManager;
+
+/**
+ * \class DGActiveSet
+ * \brief A subset of the elements of a DG DoFManager, with the faces that touch it
+ *
+ * DGAssembly restricted to an active set computes the residual of these elements
+ * only: their volume terms, and the fluxes of every face with at least one side
+ * in the set, evaluated from the current solution on both sides. Fluxes are only
+ * written to the active sides, and only the active dofs of the residual are set.
+ *
+ * Two optional lists of inactive elements change this. The
+ * faces between a `registered` element and the set are also written to the
+ * registered side: its dofs of the residual (registerDofs()) receive these face
+ * fluxes only, without volume terms or inverse mass, as a flux register. The
+ * faces between a `skipped` element and the set are left out, on both sides.
+ *
+ * Faces are grouped by the colors of DoFManager::getFaceColoring, in the same
+ * order, so the restricted residual is as reproducible as the full one.
+ * Sides follow the FaceGeometryCache convention: the left slot is the left
+ * element, or the only element of a boundary face.
+ */
+class DGActiveSet
+{
+public:
+    DGActiveSet(const DoFManager &dofm, std::vector<int> elements, const std::vector<int> &registered = {},
+                const std::vector<int> &skipped = {});
+
+    inline int nElements() const { return static_cast<int>(active_elements.size()); }
+
+    inline const std::vector<int> &elements() const { return active_elements; }
+
+    // Global dofs of the active elements
+    inline const std::vector<int> &dofs() const { return active_dofs; }
+
+    // Global dofs of the registered elements
+    inline const std::vector<int> &registerDofs() const { return register_dofs; }
+
+    inline int nColors() const { return static_cast<int>(color_offsets.size()) - 1; }
+
+    inline int nFaces(int color) const { return color_offsets[color + 1] - color_offsets[color]; }
+
+    inline const int *faces(int color) const { return color_faces.data() + color_offsets[color]; }
+
+    // Per face of faces(color): bit 0 if the left slot is written, bit 1 if the right one is
+    inline const unsigned char *faceSides(int color) const { return face_sides.data() + color_offsets[color]; }
+
+private:
+    std::vector<int> active_elements;
+    std::vector<int> active_dofs;
+    std::vector<int> register_dofs;
+    std::vector<int> color_offsets;
+    std::vector<int> color_faces;
+    std::vector<unsigned char> face_sides;
+};
+
+YAFEL_NAMESPACE_CLOSE
+
+#endif //YAFEL_DGACTIVESET_HPP
@@ -5,6 +5,11 @@
 #include "yafel_typedefs.hpp"
 #include "mesh/Mesh.hpp"
 #include "element/ElementType.hpp"
+#include "quadrature/QuadratureRule.hpp"
+#include "utils/ElementColoring.hpp"
+#include "utils/FaceColoring.hpp"
+#include "utils/LazyCache.hpp"
+#include <memory>
 #include <vector>
 
 
@@ -42,6 +47,12 @@ public:
         getLocalFaceNodes(fnum, container, face_right_local_nodes);
     }
 
+    /**
+     * Global nodes of interior_faces[fnum] on each side, in face node order (the
+     * traces of the DG face loops). A boundary face has its element on both sides.
+     */
+    void getFaceTraces(int fnum, std::vector<int> &left, std::vector<int> &right) const;
+
 
     ElementType CellType_to_ElementType(CellType ct, int polyOrder) const;
 
@@ -49,8 +60,27 @@ public:
 
     inline int nNodes() const { return static_cast<int>(dof_nodes.size()); }
 
+    /**
+     * Get a coloring of the elements of dimension topoDim such that no two
+     * elements of the same color share a node. Computed on first use and cached
+     * per topoDim (the colorings of other dimensions stay valid); thread-safe.
+     */
+    ElementColoring const &getElementColoring(int topoDim) const;
+
+    /**
+     * Get a coloring of interior_faces such that no two faces of the same
+     * color share an element. Computed on first use and cached; thread-safe.
+     */
+    FaceColoring const &getFaceColoring() const;
+
     int dof_per_node;
     int polyOrder;
+
+    // Quadrature of the elements built through ElementFactory(dofm), including the
+    // FESystem caches and DG assembly. GAUSS_LOBATTO selects the collocated
+    // spectral-element mode of tensor-product elements (see Element::isCollocated).
+    // Set it before the first assembly: the caches keep the rule they were built with.
+    QuadratureRule::QuadratureType quadratureType{QuadratureRule::QuadratureType::GAUSS_LEGENDRE};
     ManagerType managerType;
     std::vector<coordinate<>> dof_nodes;
     std::vector<int> element_offsets;
@@ -69,6 +99,10 @@ public:
     std::vector<int> mesh_corner_idxs;
     std::vector<int> mesh_corner_offsets;
 private:
+    // One coloring per topological dimension, and the face coloring
+    mutable LazyCache<ElementColoring> element_colorings;
+    mutable LazyCache<FaceColoring, 1> face_coloring;
+
     void make_cg_dofs(const Mesh &M);
 
     void make_dg_dofs(const Mesh &M);
@@ -0,0 +1,54 @@
+#ifndef YAFEL_ELEMENTCOLORING_HPP
+#define YAFEL_ELEMENTCOLORING_HPP
+
+#include "yafel_globals.hpp"
+#include <vector>
+
+YAFEL_NAMESPACE_OPEN
+
+class DoFManager;
+
+/**
+ * \class ElementColoring
+ * \brief Partition of the elements of one topological dimension into independent sets
+ *
+ * Two elements receive the same color only if they share no mesh nodes (and
+ * therefore no degrees of freedom). Element loops that scatter into global,
+ * node-indexed data can then process the elements of a single color
+ * concurrently with plain (non-atomic, non-critical) writes, as long as the
+ * colors are visited one after another:
+ *
+ *     for (int c = 0; c < coloring.nColors(); ++c) {
+ *         #pragma omp for
+ *         for (int i = 0; i < coloring.nElements(c); ++i) {
+ *             int elnum = coloring.elements(c)[i];
+ *             ...
+ *         }
+ *     }
+ *
+ * Colors are assigned greedily in element order, using the smallest color not
+ * already taken by a node-neighbor. Obtain through DoFManager::getElementColoring
+ * so that the coloring is computed once per mesh.
+ */
+class ElementColoring
+{
+public:
+    ElementColoring(const DoFManager &dofm, int topoDim);
+
+    inline int nColors() const { return static_cast<int>(color_offsets.size()) - 1; }
+
+    inline int nElements(int color) const { return color_offsets[color + 1] - color_offsets[color]; }
+
+    inline const int *elements(int color) const { return color_elements.data() + color_offsets[color]; }
+
+    inline int topoDim() const { return topo_dim; }
+
+private:
+    int topo_dim;
+    std::vector<int> color_offsets;
+    std::vector<int> color_elements;
+};
+
+YAFEL_NAMESPACE_CLOSE
+
+#endif //YAFEL_ELEMENTCOLORING_HPP
@@ -0,0 +1,45 @@
+#ifndef YAFEL_FACECOLORING_HPP
+#define YAFEL_FACECOLORING_HPP
+
+#include "yafel_globals.hpp"
+#include <vector>
+
+YAFEL_NAMESPACE_OPEN
+
+class DoFManager;
+
+/**
+ * \class FaceColoring
+ * \brief Partition of the faces of a DoFManager (interior_faces) into independent sets
+ *
+ * Two faces receive the same color only if they share no element (left or
+ * right; boundary faces have a single element). Face loops that scatter
+ * fluxes into element-indexed data, such as the DG residual, can then process
+ * the faces of a single color concurrently with plain writes, as long as the
+ * colors are visited one after another (see ElementColoring).
+ *
+ * Since every element then receives its face contributions in color order,
+ * the accumulated values do not depend on the number of threads.
+ *
+ * Colors are assigned greedily in face order. Obtain through
+ * DoFManager::getFaceColoring so that the coloring is computed once per mesh.
+ */
+class FaceColoring
+{
+public:
+    explicit FaceColoring(const DoFManager &dofm);
+
+    inline int nColors() const { return static_cast<int>(color_offsets.size()) - 1; }
+
+    inline int nFaces(int color) const { return color_offsets[color + 1] - color_offsets[color]; }
+
+    inline const int *faces(int color) const { return color_faces.data() + color_offsets[color]; }
+
+private:
+    std::vector<int> color_offsets;
+    std::vector<int> color_faces;
+};
+
+YAFEL_NAMESPACE_CLOSE
+
+#endif //YAFEL_FACECOLORING_HPP
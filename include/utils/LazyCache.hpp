@@ -0,0 +1,67 @@
+#ifndef YAFEL_LAZYCACHE_HPP
+#define YAFEL_LAZYCACHE_HPP
+
+#include "yafel_globals.hpp"
+
+#include <array>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+
+YAFEL_NAMESPACE_OPEN
+
+/**
+ * \class LazyCache
+ * \brief N derived objects, each built on first request, safe to request from several threads
+ *
+ * get(slot, build) returns the object of a slot (a topological dimension, for the
+ * DoFManager and FESystem caches), building it with build() on first use. Every
+ * slot keeps its own object, so the references handed out for one slot stay valid
+ * while others are requested, until reset(). Lookups and builds are serialized by
+ * one mutex; build() must not request from the same cache.
+ *
+ * The objects are derived data: a copy of a LazyCache starts empty.
+ */
+template<typename T, int N = 4>
+class LazyCache
+{
+public:
+    LazyCache() = default;
+
+    LazyCache(const LazyCache &) {}
+
+    LazyCache &operator=(const LazyCache &)
+    {
+        reset();
+        return *this;
+    }
+
+    template<typename Build>
+    T &get(int slot, Build &&build)
+    {
+        if (slot < 0 || slot >= N) {
+            throw std::runtime_error("LazyCache: slot out of range");
+        }
+        std::lock_guard<std::mutex> lock(mtx);
+        if (!objects[slot]) {
+            objects[slot] = build();
+        }
+        return *objects[slot];
+    }
+
+    void reset()
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        for (auto &obj : objects) {
+            obj.reset();
+        }
+    }
+
+private:
+    std::mutex mtx;
+    std::array<std::unique_ptr<T>, N> objects;
+};
+
+YAFEL_NAMESPACE_CLOSE
+
+#endif //YAFEL_LAZYCACHE_HPP
@@ -8,6 +8,7 @@
 #include "yafel_globals.hpp"
 #include "yafel_config.hpp"
 #include <type_traits>
+#include <utility>
 
 YAFEL_NAMESPACE_OPEN
 
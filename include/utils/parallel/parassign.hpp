@@ -20,7 +20,7 @@ YAFEL_NAMESPACE_OPEN
  * Warning: Assumes no aliasing of A and B.
  */
 template<typename V1, typename V2, int BLK = 4>
-auto parassign(Eigen::MatrixBase<V1> & A, Eigen::MatrixBase<V2> const& B, int chunkSize = 1024) {
+Eigen::MatrixBase<V1> &parassign(Eigen::MatrixBase<V1> & A, Eigen::MatrixBase<V2> const& B, int chunkSize = 1024) {
 
 
     if(A.rows() < 10*chunkSize) {
@@ -23,7 +23,9 @@
 // Assembly routines
 #include "assembly/CGAssembly.hpp"
 #include "assembly/DGAssembly.hpp"
+#include "assembly/HDGAssembly.hpp"
 #include "assembly/LocalSmoothingGradient.hpp"
+#include "assembly/MatrixFreeOperator.hpp"
 #include "assembly/ZZGradientRecovery.hpp"
 
 #include "boundary_conditions/DirichletBC.hpp"
@@ -54,8 +56,10 @@
 
 // Elements
 #include "element/Element.hpp"
+#include "element/ElementBatch.hpp"
 #include "element/ElementFactory.hpp"
 #include "element/ElementType.hpp"
+#include "element/FixedElement.hpp"
 #include "element/ShapeFunctionUtils.hpp"
 
 // Output
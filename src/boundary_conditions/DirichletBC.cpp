@@ -3,6 +3,7 @@
 //
 
 #include "boundary_conditions/DirichletBC.hpp"
+#include "fe_system/FESystem.hpp"
 #include <algorithm>
 
 YAFEL_NAMESPACE_OPEN
@@ -40,7 +41,9 @@ void DirichletBC::apply(Eigen::SparseMatrix<double, Eigen::RowMajor> &A, Eigen::
 
     rhs -= A * bc_values;
 
-    for (auto r : IRange(0, static_cast<int>(A.rows()))) {
+    // Rows are independent, and rhs(r) is only written from row r
+#pragma omp parallel for
+    for (int r = 0; r < static_cast<int>(A.rows()); ++r) {
         for (auto idx : IRange(row_ptr[r], row_ptr[r + 1])) {
             int c = col_ptr[idx];
 
@@ -71,7 +74,9 @@ void DirichletBC::apply(Eigen::SparseMatrix<double, Eigen::ColMajor> &A, Eigen::
 
     rhs -= A * bc_values;
 
-    for (auto c : IRange(0, static_cast<int>(A.cols()))) {
+    // Columns are independent, and rhs(c) is only written from column c
+#pragma omp parallel for
+    for (int c = 0; c < static_cast<int>(A.cols()); ++c) {
         for (auto idx : IRange(col_ptr[c], col_ptr[c + 1])) {
             int r = row_ptr[idx];
 
@@ -88,4 +93,10 @@ void DirichletBC::apply(Eigen::SparseMatrix<double, Eigen::ColMajor> &A, Eigen::
 
 }
 
+void DirichletBC::apply(FESystem &feSystem, double time)
+{
+    apply(feSystem.getGlobalTangent(), feSystem.getGlobalResidual(), time);
+    feSystem.markConstrained();
+}
+
 YAFEL_NAMESPACE_CLOSE
\ No newline at end of file
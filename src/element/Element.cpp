@@ -8,11 +8,12 @@
 
 YAFEL_NAMESPACE_OPEN
 
-Element::Element(ElementType et, int dofpn, int qrm)
+Element::Element(ElementType et, int dofpn, int qrm, QuadratureRule::QuadratureType qt)
         : elementType(et),
           localMesh(Mesh::DefinitionScheme::Explicit),
-          dof_per_node(dofpn),
-          quadratureOrderMultiplier(qrm)
+          quadratureOrderMultiplier(qrm),
+          quadratureType(qt),
+          dof_per_node(dofpn)
 {
 
     switch (et.elementTopology) {
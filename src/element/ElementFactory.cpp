@@ -7,16 +7,22 @@
 
 YAFEL_NAMESPACE_OPEN
 
-ElementFactory::ElementFactory(int dof_per_node, int quadratureOrderMultiplier)
+ElementFactory::ElementFactory(int dof_per_node, int quadratureOrderMultiplier,
+                               QuadratureRule::QuadratureType quadratureType)
         : dof_per_node(dof_per_node),
           quadratureOrderMultiplier(quadratureOrderMultiplier),
+          quadratureType(quadratureType),
           element_container()
 {}
 
+ElementFactory::ElementFactory(const DoFManager &dofm, int quadratureOrderMultiplier)
+        : ElementFactory(dofm.dof_per_node, quadratureOrderMultiplier, dofm.quadratureType)
+{}
+
 Element& ElementFactory::getElement(ElementType elementType)
 {
     if(element_container.count(elementType) == 0) {
-        auto eit = element_container.emplace(elementType, Element(elementType,dof_per_node, quadratureOrderMultiplier));
+        auto eit = element_container.emplace(elementType, Element(elementType,dof_per_node, quadratureOrderMultiplier, quadratureType));
         return (*(eit.first)).second;
     }
     else {
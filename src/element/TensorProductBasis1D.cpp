@@ -0,0 +1,54 @@
+#include "element/TensorProductBasis1D.hpp"
+#include "quadrature/QuadratureRule.hpp"
+
+YAFEL_NAMESPACE_OPEN
+
+// Lagrange polynomial a through `pts`, and its derivative, at x
+static void lagrange_1d(const std::vector<double> &pts, int a, double x, double &value, double &derivative)
+{
+    int n = static_cast<int>(pts.size());
+    value = 1;
+    derivative = 0;
+    for (int b = 0; b < n; ++b) {
+        if (b == a) {
+            continue;
+        }
+        double scale = 1.0 / (pts[a] - pts[b]);
+        derivative = derivative * (x - pts[b]) * scale + value * scale;
+        value *= (x - pts[b]) * scale;
+    }
+}
+
+TensorProductBasis1D::TensorProductBasis1D(int polyOrder, int quadratureOrderMultiplier)
+{
+    // Same 1D node and quadrature choices as Element::make_tensorProduct()
+    auto lobatto = QuadratureRule(polyOrder + 1, QuadratureRule::QuadratureType::GAUSS_LOBATTO);
+    for (auto x : lobatto.nodes) {
+        nodes.push_back(x(0));
+    }
+
+    auto qr = QuadratureRule::make_tensor_product(QuadratureRule::QuadratureType::GAUSS_LEGENDRE,
+                                                  1, quadratureOrderMultiplier * polyOrder);
+    for (auto x : qr.nodes) {
+        qp_nodes.push_back(x(0));
+    }
+    qp_weights = qr.weights;
+
+    int n = nNodes();
+    int m = nQP();
+    values.resize(m, n);
+    derivatives.resize(m, n);
+    collocationDerivatives.resize(m, m);
+
+    double dummy;
+    for (int q = 0; q < m; ++q) {
+        for (int a = 0; a < n; ++a) {
+            lagrange_1d(nodes, a, qp_nodes[q], values(q, a), derivatives(q, a));
+        }
+        for (int r = 0; r < m; ++r) {
+            lagrange_1d(qp_nodes, r, qp_nodes[q], dummy, collocationDerivatives(q, r));
+        }
+    }
+}
+
+YAFEL_NAMESPACE_CLOSE
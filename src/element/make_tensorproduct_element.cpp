@@ -124,11 +124,20 @@ void Element::make_tensorProduct()
     localMesh.setOffsets(offsets);
     localMesh.setCellTypes(cellTypes);
 
-    quadratureRule = QuadratureRule::make_tensor_product(QuadratureRule::QuadratureType::GAUSS_LEGENDRE,
-                                                         elementType.topoDim, quadratureOrderMultiplier * elementType.polyOrder);
+    if (quadratureType == QuadratureRule::QuadratureType::GAUSS_LOBATTO) {
+        // p+1 Lobatto points per direction (exact to order 2p-1), ordered as the nodes
+        quadratureRule = QuadratureRule::make_tensor_product(QuadratureRule::QuadratureType::GAUSS_LOBATTO,
+                                                             elementType.topoDim, 2 * elementType.polyOrder - 1);
 
-    boundaryQuadratureRule = QuadratureRule::make_tensor_product(QuadratureRule::QuadratureType::GAUSS_LEGENDRE,
-                                                                 elementType.topoDim-1, quadratureOrderMultiplier * elementType.polyOrder);
+        boundaryQuadratureRule = QuadratureRule::make_tensor_product(QuadratureRule::QuadratureType::GAUSS_LOBATTO,
+                                                                     elementType.topoDim-1, 2 * elementType.polyOrder - 1);
+    } else {
+        quadratureRule = QuadratureRule::make_tensor_product(QuadratureRule::QuadratureType::GAUSS_LEGENDRE,
+                                                             elementType.topoDim, quadratureOrderMultiplier * elementType.polyOrder);
+
+        boundaryQuadratureRule = QuadratureRule::make_tensor_product(QuadratureRule::QuadratureType::GAUSS_LEGENDRE,
+                                                                     elementType.topoDim-1, quadratureOrderMultiplier * elementType.polyOrder);
+    }
 
     tensor_product_shape_functions(localMesh.getGeometryNodes(),
                                    quadratureRule.nodes,
@@ -0,0 +1,140 @@
+#include "fe_system/BlockSparsityPattern.hpp"
+#include "utils/Range.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+YAFEL_NAMESPACE_OPEN
+
+BlockSparsityPattern::BlockSparsityPattern(const DoFManager &dofm, int topoDim)
+        : n_nodes(dofm.nNodes()),
+          block_size(dofm.dof_per_node),
+          topo_dim(topoDim)
+{
+    if (dofm.managerType != DoFManager::ManagerType::CG) {
+        throw std::runtime_error("BlockSparsityPattern: requires a CG DoFManager");
+    }
+    const int nCells = dofm.nCells();
+    const int bs = block_size;
+
+    auto included = [&dofm, topoDim](int elnum) {
+        return dofm.element_types[elnum].topoDim == topoDim;
+    };
+
+    auto element_nodes = [&dofm](int elnum) {
+        return IRange(dofm.element_offsets[elnum], dofm.element_offsets[elnum + 1]);
+    };
+
+    // Build node -> element adjacency in compressed format
+    std::vector<int> node_element_offsets(n_nodes + 1, 0);
+    for (auto e : IRange(0, nCells)) {
+        if (!included(e)) {
+            continue;
+        }
+        for (auto idx : element_nodes(e)) {
+            ++node_element_offsets[dofm.elements[idx] + 1];
+        }
+    }
+    for (auto n : IRange(0, n_nodes)) {
+        node_element_offsets[n + 1] += node_element_offsets[n];
+    }
+
+    std::vector<int> node_elements(node_element_offsets[n_nodes]);
+    {
+        std::vector<int> fill(node_element_offsets.begin(), node_element_offsets.end() - 1);
+        for (auto e : IRange(0, nCells)) {
+            if (!included(e)) {
+                continue;
+            }
+            for (auto idx : element_nodes(e)) {
+                node_elements[fill[dofm.elements[idx]]++] = e;
+            }
+        }
+    }
+
+    // Count the block columns of each block row (a thread-private marker array
+    // counts each node once per row), then fill and sort them
+    block_row_ptr.assign(n_nodes + 1, 0);
+#pragma omp parallel
+    {
+        std::vector<int> marker(n_nodes, -1);
+#pragma omp for
+        for (int r = 0; r < n_nodes; ++r) {
+            int count{0};
+            for (auto idx : IRange(node_element_offsets[r], node_element_offsets[r + 1])) {
+                for (auto nidx : element_nodes(node_elements[idx])) {
+                    int c = dofm.elements[nidx];
+                    if (marker[c] != r) {
+                        marker[c] = r;
+                        ++count;
+                    }
+                }
+            }
+            block_row_ptr[r + 1] = count;
+        }
+    }
+    for (auto r : IRange(0, n_nodes)) {
+        block_row_ptr[r + 1] += block_row_ptr[r];
+    }
+
+    block_col_index.resize(block_row_ptr[n_nodes]);
+#pragma omp parallel
+    {
+        std::vector<int> marker(n_nodes, -1);
+#pragma omp for
+        for (int r = 0; r < n_nodes; ++r) {
+            int pos = block_row_ptr[r];
+            for (auto idx : IRange(node_element_offsets[r], node_element_offsets[r + 1])) {
+                for (auto nidx : element_nodes(node_elements[idx])) {
+                    int c = dofm.elements[nidx];
+                    if (marker[c] != r) {
+                        marker[c] = r;
+                        block_col_index[pos++] = c;
+                    }
+                }
+            }
+            std::sort(block_col_index.begin() + block_row_ptr[r], block_col_index.begin() + block_row_ptr[r + 1]);
+        }
+    }
+
+    // Per-element position maps (row-major over the local tangent, local dof A
+    // being component A % bs of local node A / bs)
+    element_position_offsets.assign(nCells + 1, 0);
+    for (auto e : IRange(0, nCells)) {
+        int n = included(e) ? bs * (dofm.element_offsets[e + 1] - dofm.element_offsets[e]) : 0;
+        element_position_offsets[e + 1] = element_position_offsets[e] + n * n;
+    }
+    element_positions.resize(element_position_offsets[nCells]);
+
+#pragma omp parallel for
+    for (int e = 0; e < nCells; ++e) {
+        if (!included(e)) {
+            continue;
+        }
+        const int *nodes = dofm.elements.data() + dofm.element_offsets[e];
+        const int n_local_nodes = dofm.element_offsets[e + 1] - dofm.element_offsets[e];
+        const int n = bs * n_local_nodes;
+        int *positions = element_positions.data() + element_position_offsets[e];
+        for (int a = 0; a < n_local_nodes; ++a) {
+            for (int b = 0; b < n_local_nodes; ++b) {
+                const int block = blockPosition(nodes[a], nodes[b]);
+                for (int i = 0; i < bs; ++i) {
+                    for (int j = 0; j < bs; ++j) {
+                        positions[(a * bs + i) * n + b * bs + j] = (block * bs + j) * bs + i;
+                    }
+                }
+            }
+        }
+    }
+}
+
+
+int BlockSparsityPattern::blockPosition(int block_row, int block_col) const
+{
+    auto row_begin = block_col_index.begin() + block_row_ptr[block_row];
+    auto row_end = block_col_index.begin() + block_row_ptr[block_row + 1];
+    auto it = std::lower_bound(row_begin, row_end, block_col);
+    return it != row_end && *it == block_col ? static_cast<int>(std::distance(block_col_index.begin(), it)) : -1;
+}
+
+YAFEL_NAMESPACE_CLOSE
@@ -0,0 +1,85 @@
+#include "fe_system/ElementContributionCache.hpp"
+
+YAFEL_NAMESPACE_OPEN
+
+template<typename T>
+static void exchange(std::vector<T> &recorded, std::size_t first, std::size_t n,
+                     double *values, int stride, bool subtract)
+{
+    T *old_values = recorded.data() + first;
+    for (std::size_t i = 0; i < n; ++i) {
+        double v = values[i * stride];
+        if (subtract) {
+            values[i * stride] = v - static_cast<double>(old_values[i]);
+        }
+        old_values[i] = static_cast<T>(v);
+    }
+}
+
+
+ElementContributionCache::ElementContributionCache(const DoFManager &dofm, int topoDim, Storage storage)
+        : topo_dim(topoDim),
+          storage_type(storage),
+          tangent_offsets(dofm.nCells() + 1, 0),
+          residual_offsets(dofm.nCells() + 1, 0)
+{
+    for (int e = 0; e < dofm.nCells(); ++e) {
+        std::size_t local_dofs{0};
+        if (dofm.element_types[e].topoDim == topoDim) {
+            local_dofs = std::size_t(dofm.element_offsets[e + 1] - dofm.element_offsets[e]) * dofm.dof_per_node;
+        }
+        tangent_offsets[e + 1] = tangent_offsets[e] + local_dofs * local_dofs;
+        residual_offsets[e + 1] = residual_offsets[e] + local_dofs;
+    }
+}
+
+
+void ElementContributionCache::prepare(bool tangent, bool residual, long generation)
+{
+    has_tangent = tangent;
+    has_residual = residual;
+    system_generation = generation;
+
+    std::size_t n_tangent = tangent ? tangent_offsets.back() : 0;
+    std::size_t n_residual = residual ? residual_offsets.back() : 0;
+    if (storage_type == Storage::Double) {
+        tangent_double.assign(n_tangent, 0.0);
+        residual_double.assign(n_residual, 0.0);
+    } else {
+        tangent_single.assign(n_tangent, 0.0f);
+        residual_single.assign(n_residual, 0.0f);
+    }
+}
+
+
+std::size_t ElementContributionCache::memoryUsage() const
+{
+    return sizeof(double) * (tangent_double.size() + residual_double.size())
+           + sizeof(float) * (tangent_single.size() + residual_single.size());
+}
+
+
+void ElementContributionCache::exchangeTangent(int elnum, double *K, int stride, bool subtract)
+{
+    std::size_t first = tangent_offsets[elnum];
+    std::size_t n = tangent_offsets[elnum + 1] - first;
+    if (storage_type == Storage::Double) {
+        exchange(tangent_double, first, n, K, stride, subtract);
+    } else {
+        exchange(tangent_single, first, n, K, stride, subtract);
+    }
+}
+
+
+void ElementContributionCache::exchangeResidual(int elnum, double *R, int stride, bool subtract)
+{
+    std::size_t first = residual_offsets[elnum];
+    std::size_t n = residual_offsets[elnum + 1] - first;
+    if (storage_type == Storage::Double) {
+        exchange(residual_double, first, n, R, stride, subtract);
+    } else {
+        exchange(residual_single, first, n, R, stride, subtract);
+    }
+}
+
+YAFEL_NAMESPACE_CLOSE
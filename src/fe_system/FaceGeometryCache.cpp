@@ -0,0 +1,152 @@
+#include "fe_system/FaceGeometryCache.hpp"
+#include "element/ElementFactory.hpp"
+#include "utils/Range.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+
+YAFEL_NAMESPACE_OPEN
+
+template<int NSD>
+static void fill_face_geometry(const DoFManager &dofm, int quadratureOrderMultiplier,
+                               const std::vector<int> &face_qp_offsets,
+                               std::vector<double> &normals,
+                               std::vector<double> &jxw_left,
+                               std::vector<double> &jxw_right,
+                               std::vector<coordinate<>> &points)
+{
+    const int nFaces = static_cast<int>(dofm.interior_faces.size());
+#pragma omp parallel
+    {
+        // Two factories, since both sides of a face are needed at once
+        ElementFactory EF_L(1, quadratureOrderMultiplier, dofm.quadratureType);
+        ElementFactory EF_R(1, quadratureOrderMultiplier, dofm.quadratureType);
+        std::vector<int> left_local_nodes;
+        std::vector<int> right_local_nodes;
+        std::vector<int> left_nodes;
+#pragma omp for schedule(dynamic, 64)
+        for (int f = 0; f < nFaces; ++f) {
+            auto const &F = dofm.interior_faces[f];
+
+            // The left slot holds the left element, or the only one of a boundary face
+            int e_left = F.left;
+            int e_right = F.right;
+            if (e_left >= 0) {
+                dofm.getLeftFaceNodes(f, left_local_nodes);
+                dofm.getRightFaceNodes(f, right_local_nodes);
+            } else {
+                std::swap(e_left, e_right);
+                dofm.getRightFaceNodes(f, left_local_nodes);
+            }
+
+            auto &EL = EF_L.getElement(dofm.element_types[e_left]);
+            dofm.getGlobalNodes(e_left, left_nodes);
+            for (int fqpi = 0; fqpi < EL.nFQP(); ++fqpi) {
+                const int q = face_qp_offsets[f] + fqpi;
+
+                auto n = EL.face_update<NSD>(e_left, fqpi, left_local_nodes, dofm);
+                for (int i = 0; i < NSD; ++i) {
+                    normals[std::size_t(q) * NSD + i] = n(i);
+                }
+                jxw_left[q] = EL.jxw;
+
+                coordinate<> x;
+                for (int i = 0; i < static_cast<int>(left_local_nodes.size()); ++i) {
+                    x += dofm.dof_nodes[left_nodes[left_local_nodes[i]]] * EL.boundaryShapeValues[fqpi](i);
+                }
+                points[q] = x;
+
+                if (e_right >= 0) {
+                    auto &ER = EF_R.getElement(dofm.element_types[e_right]);
+                    ER.face_update<NSD>(e_right, fqpi, right_local_nodes, dofm);
+                    jxw_right[q] = ER.jxw;
+                } else {
+                    jxw_right[q] = EL.jxw;
+                }
+            }
+        }
+    }
+}
+
+
+FaceGeometryCache::FaceGeometryCache(const DoFManager &dofm, int nsd, int quadratureOrderMultiplier)
+        : nsd(nsd)
+{
+    const int nFaces = static_cast<int>(dofm.interior_faces.size());
+    face_qp_offsets.assign(nFaces + 1, 0);
+    trace_offsets.assign(nFaces + 1, 0);
+    boundary.assign(nFaces, 0);
+    collocated.assign(nFaces, 0);
+    shape_offsets.assign(nFaces, 0);
+
+    // Layout, traces, and the face shape values of each element type
+    ElementFactory EF(1, quadratureOrderMultiplier, dofm.quadratureType);
+    // Per element type: its first shape value, and whether face node i is face quadrature point i
+    std::vector<std::tuple<ElementType, std::size_t, bool>> type_tables;
+    std::vector<int> face_left, face_right;
+    for (auto f : IRange(0, nFaces)) {
+        auto const &F = dofm.interior_faces[f];
+        int e_left = F.left >= 0 ? F.left : F.right;
+        boundary[f] = (F.left < 0 || F.right < 0);
+
+        dofm.getFaceTraces(f, face_left, face_right);
+        left_trace.insert(left_trace.end(), face_left.begin(), face_left.end());
+        right_trace.insert(right_trace.end(), face_right.begin(), face_right.end());
+        trace_offsets[f + 1] = static_cast<int>(left_trace.size());
+
+        auto et = dofm.element_types[e_left];
+        auto &E = EF.getElement(et);
+        face_qp_offsets[f + 1] = face_qp_offsets[f] + E.nFQP();
+
+        auto table = std::find_if(type_tables.begin(), type_tables.end(),
+                                  [&et](auto const &t) { return std::get<0>(t) == et; });
+        if (table == type_tables.end()) {
+            const int n_trace = static_cast<int>(face_left.size());
+            bool identity = E.isCollocated() && E.nFQP() == n_trace;
+            std::size_t first = shape_values.size();
+            for (int fqpi = 0; fqpi < E.nFQP(); ++fqpi) {
+                for (int i = 0; i < n_trace; ++i) {
+                    shape_values.push_back(E.boundaryShapeValues[fqpi](i));
+                    identity = identity && std::abs(shape_values.back() - (i == fqpi ? 1 : 0)) < 1e-12;
+                }
+            }
+            type_tables.emplace_back(et, first, identity);
+            table = type_tables.end() - 1;
+        }
+        shape_offsets[f] = std::get<1>(*table);
+        collocated[f] = std::get<2>(*table);
+    }
+
+    const std::size_t nqp = face_qp_offsets[nFaces];
+    normals.resize(nqp * nsd);
+    jxw_left.resize(nqp);
+    jxw_right.resize(nqp);
+    points.resize(nqp);
+
+    switch (nsd) {
+        case 2:
+            fill_face_geometry<2>(dofm, quadratureOrderMultiplier, face_qp_offsets,
+                                  normals, jxw_left, jxw_right, points);
+            break;
+        case 3:
+            fill_face_geometry<3>(dofm, quadratureOrderMultiplier, face_qp_offsets,
+                                  normals, jxw_left, jxw_right, points);
+            break;
+        default:
+            throw std::runtime_error("FaceGeometryCache: Invalid nsd");
+    }
+}
+
+
+std::size_t FaceGeometryCache::memoryUsage() const
+{
+    return sizeof(double) * (normals.size() + jxw_left.size() + jxw_right.size() + shape_values.size())
+           + sizeof(coordinate<>) * points.size()
+           + sizeof(int) * (left_trace.size() + right_trace.size() + face_qp_offsets.size() + trace_offsets.size())
+           + sizeof(std::size_t) * shape_offsets.size() + boundary.size() + collocated.size();
+}
+
+YAFEL_NAMESPACE_CLOSE
@@ -0,0 +1,95 @@
+#include "fe_system/GeometryCache.hpp"
+#include "element/ElementFactory.hpp"
+#include "utils/Range.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+YAFEL_NAMESPACE_OPEN
+
+template<int NSD>
+static void fill_geometry(const DoFManager &dofm,
+                          int quadratureOrderMultiplier,
+                          const std::vector<int> &qp_offsets,
+                          const std::vector<std::size_t> &grad_offsets,
+                          const std::vector<int> &grad_strides,
+                          std::vector<double> &jxw_values,
+                          std::vector<double> &shape_grad_values)
+{
+#pragma omp parallel
+    {
+        ElementFactory EF(1, quadratureOrderMultiplier, dofm.quadratureType);
+#pragma omp for schedule(dynamic, 64)
+        for (int e = 0; e < dofm.nCells(); ++e) {
+            if (qp_offsets[e] < 0) {
+                continue;
+            }
+            auto &E = EF.getElement(dofm.element_types[e]);
+            for (int qpi = 0; qpi < E.nQP(); ++qpi) {
+                E.update<NSD>(e, qpi, dofm);
+                jxw_values[qp_offsets[e] + qpi] = E.jxw;
+                std::copy(E.shapeGrad.data(), E.shapeGrad.data() + grad_strides[e],
+                          shape_grad_values.begin() + grad_offsets[e] + std::size_t(qpi) * grad_strides[e]);
+            }
+        }
+    }
+}
+
+
+GeometryCache::GeometryCache(const DoFManager &dofm, int topoDim, std::size_t memoryBudget,
+                             int quadratureOrderMultiplier)
+        : topo_dim(topoDim),
+          n_cached(0),
+          quadrature_type(dofm.quadratureType),
+          quadrature_order_multiplier(quadratureOrderMultiplier),
+          qp_offsets(dofm.nCells(), -1),
+          grad_offsets(dofm.nCells(), 0),
+          grad_strides(dofm.nCells(), 0)
+{
+    // Decide which elements fit in the budget, and where their values go
+    ElementFactory EF(1, quadratureOrderMultiplier, dofm.quadratureType);
+    std::size_t n_jxw{0};
+    std::size_t n_grad{0};
+    for (auto e : IRange(0, dofm.nCells())) {
+        auto et = dofm.element_types[e];
+        if (et.topoDim != topoDim || et.elementTopology == ElementTopology::None) {
+            continue;
+        }
+
+        int nqp = EF.getElement(et).nQP();
+        int stride = (dofm.element_offsets[e + 1] - dofm.element_offsets[e]) * topoDim;
+        std::size_t bytes = sizeof(double) * (n_jxw + n_grad + std::size_t(nqp) * (1 + stride));
+        if (bytes > memoryBudget) {
+            break;
+        }
+
+        qp_offsets[e] = static_cast<int>(n_jxw);
+        grad_offsets[e] = n_grad;
+        grad_strides[e] = stride;
+        n_jxw += nqp;
+        n_grad += std::size_t(nqp) * stride;
+        ++n_cached;
+    }
+
+    jxw_values.resize(n_jxw);
+    shape_grad_values.resize(n_grad);
+
+    switch (topoDim) {
+        case 1:
+            fill_geometry<1>(dofm, quadratureOrderMultiplier, qp_offsets, grad_offsets, grad_strides,
+                             jxw_values, shape_grad_values);
+            break;
+        case 2:
+            fill_geometry<2>(dofm, quadratureOrderMultiplier, qp_offsets, grad_offsets, grad_strides,
+                             jxw_values, shape_grad_values);
+            break;
+        case 3:
+            fill_geometry<3>(dofm, quadratureOrderMultiplier, qp_offsets, grad_offsets, grad_strides,
+                             jxw_values, shape_grad_values);
+            break;
+        default:
+            throw std::runtime_error("GeometryCache: Invalid topoDim");
+    }
+}
+
+YAFEL_NAMESPACE_CLOSE
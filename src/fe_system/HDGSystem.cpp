@@ -0,0 +1,223 @@
+#include "fe_system/HDGSystem.hpp"
+#include "utils/Range.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+YAFEL_NAMESPACE_OPEN
+
+HDGSystem::HDGSystem(FESystem &volumeSystem, int nsd, int trace_dof_per_node)
+        : volume_system(volumeSystem),
+          dofm(volumeSystem.getDoFManager()),
+          nsd(nsd),
+          trace_dof_per_node(trace_dof_per_node),
+          n_skeleton_dofs(0)
+{
+    if (dofm.managerType != DoFManager::ManagerType::DG || trace_dof_per_node < 1) {
+        throw std::runtime_error("HDGSystem: need a DG DoFManager and at least one trace dof per node");
+    }
+    const int nFaces = static_cast<int>(dofm.interior_faces.size());
+    const int nCells = dofm.nCells();
+
+    // Trace dofs: interior faces first, then boundary faces
+    face_dof_offsets.assign(nFaces, 0);
+    int next{0};
+    for (int f = 0; f < nFaces; ++f) {
+        if (!isBoundaryFace(f)) {
+            face_dof_offsets[f] = next;
+            next += nFaceNodes(f) * trace_dof_per_node;
+        }
+    }
+    n_skeleton_dofs = next;
+    for (int f = 0; f < nFaces; ++f) {
+        if (isBoundaryFace(f)) {
+            face_dof_offsets[f] = next;
+            next += nFaceNodes(f) * trace_dof_per_node;
+        }
+    }
+    trace_solution = Eigen::VectorXd::Zero(next);
+
+    // Faces of every element of dimension nsd, in increasing order
+    auto condensed_element = [&](int e) { return e >= 0 && dofm.element_types[e].topoDim == nsd; };
+    element_face_offsets.assign(nCells + 1, 0);
+    for (auto const &F : dofm.interior_faces) {
+        if (condensed_element(F.left)) {
+            ++element_face_offsets[F.left + 1];
+        }
+        if (condensed_element(F.right)) {
+            ++element_face_offsets[F.right + 1];
+        }
+    }
+    for (int e = 0; e < nCells; ++e) {
+        element_face_offsets[e + 1] += element_face_offsets[e];
+    }
+    element_faces.resize(element_face_offsets[nCells]);
+    std::vector<int> cursor(element_face_offsets.begin(), element_face_offsets.end() - 1);
+    for (int f = 0; f < nFaces; ++f) {
+        auto const &F = dofm.interior_faces[f];
+        if (condensed_element(F.left)) {
+            element_faces[cursor[F.left]++] = f;
+        }
+        if (condensed_element(F.right)) {
+            element_faces[cursor[F.right]++] = f;
+        }
+    }
+
+    // Per element and face: local face nodes and trace dofs, in the face's trace order
+    element_face_node_offsets.assign(element_faces.size() + 1, 0);
+    element_face_dof_offsets.assign(element_faces.size(), 0);
+    trace_dof_offsets.assign(nCells + 1, 0);
+    condensed_offsets.assign(nCells + 1, 0);
+    local_tangent_offsets.assign(nCells + 1, 0);
+    std::vector<int> face_nodes;
+    for (int e = 0; e < nCells; ++e) {
+        int n_trace{0};
+        for (int i = 0; i < nElementFaces(e); ++i) {
+            const int slot = element_face_offsets[e] + i;
+            const int f = element_faces[slot];
+            if (dofm.interior_faces[f].left == e) {
+                dofm.getLeftFaceNodes(f, face_nodes);
+            } else {
+                dofm.getRightFaceNodes(f, face_nodes);
+            }
+            if (std::find(face_nodes.begin(), face_nodes.end(), -1) != face_nodes.end()) {
+                throw std::runtime_error("HDGSystem: unmatched face nodes");
+            }
+            element_face_nodes.insert(element_face_nodes.end(), face_nodes.begin(), face_nodes.end());
+            element_face_node_offsets[slot + 1] = static_cast<int>(element_face_nodes.size());
+
+            element_face_dof_offsets[slot] = n_trace;
+            for (int dof = 0; dof < nFaceNodes(f) * trace_dof_per_node; ++dof) {
+                element_trace_dofs.push_back(face_dof_offsets[f] + dof);
+            }
+            n_trace += nFaceNodes(f) * trace_dof_per_node;
+        }
+        trace_dof_offsets[e + 1] = static_cast<int>(element_trace_dofs.size());
+
+        const std::size_t n_interior = isCondensed(e)
+                                       ? std::size_t(dofm.element_offsets[e + 1] - dofm.element_offsets[e])
+                                         * dofm.dof_per_node : 0;
+        condensed_offsets[e + 1] = condensed_offsets[e] + n_interior * (n_trace + 1);
+        local_tangent_offsets[e + 1] = local_tangent_offsets[e] + std::size_t(n_trace) * n_trace;
+    }
+    condensed.assign(condensed_offsets[nCells], 0.0);
+    local_tangents.assign(local_tangent_offsets[nCells], 0.0);
+    local_residuals.assign(element_trace_dofs.size(), 0.0);
+
+    // Skeleton sparsity: the interior trace dofs of an element are all coupled
+    std::vector<Eigen::Triplet<double>> triplets;
+    for (int e = 0; e < nCells; ++e) {
+        const int *dofs = elementTraceDofs(e);
+        for (int a = 0; a < nElementTraceDofs(e); ++a) {
+            if (isBoundaryDof(dofs[a])) {
+                continue;
+            }
+            for (int b = 0; b < nElementTraceDofs(e); ++b) {
+                if (!isBoundaryDof(dofs[b])) {
+                    triplets.emplace_back(dofs[a], dofs[b], 0.0);
+                }
+            }
+        }
+    }
+    global_tangent.resize(n_skeleton_dofs, n_skeleton_dofs);
+    global_tangent.setFromTriplets(triplets.begin(), triplets.end());
+    global_tangent.makeCompressed();
+    global_residual = Eigen::VectorXd::Zero(n_skeleton_dofs);
+}
+
+
+void HDGSystem::assembleSkeleton()
+{
+    const int *row_ptr = global_tangent.outerIndexPtr();
+    const int *col_ptr = global_tangent.innerIndexPtr();
+    double *value_ptr = global_tangent.valuePtr();
+    std::fill(value_ptr, value_ptr + global_tangent.nonZeros(), 0.0);
+    global_residual.setZero();
+
+    // The rows of a face are only written while visiting that face, from its left
+    // element and then its right one: no races, and the same sums for any number of threads
+    const int nFaces = static_cast<int>(dofm.interior_faces.size());
+#pragma omp parallel for schedule(dynamic, 64)
+    for (int f = 0; f < nFaces; ++f) {
+        if (isBoundaryFace(f)) {
+            continue;
+        }
+        auto const &F = dofm.interior_faces[f];
+        for (int e : {F.left, F.right}) {
+            if (!isCondensed(e)) {
+                continue;
+            }
+            int i{0};
+            while (elementFace(e, i) != f) {
+                ++i;
+            }
+            const int n_trace = nElementTraceDofs(e);
+            const int *dofs = elementTraceDofs(e);
+            const double *K = localTangent(e);
+            const double *r = localResidual(e);
+            const int offset = elementFaceDofOffset(e, i);
+
+            for (int a = offset; a < offset + nFaceNodes(f) * trace_dof_per_node; ++a) {
+                const int row = dofs[a];
+                double rhs = r[a];
+                const int *row_begin = col_ptr + row_ptr[row];
+                const int *row_end = col_ptr + row_ptr[row + 1];
+                for (int b = 0; b < n_trace; ++b) {
+                    const double k = K[std::size_t(b) * n_trace + a];
+                    if (isBoundaryDof(dofs[b])) {
+                        rhs -= k * trace_solution(dofs[b]);
+                    } else {
+                        value_ptr[std::lower_bound(row_begin, row_end, dofs[b]) - col_ptr] += k;
+                    }
+                }
+                global_residual(row) += rhs;
+            }
+        }
+    }
+}
+
+
+void HDGSystem::recover(const Eigen::VectorXd &skeleton_solution)
+{
+    if (skeleton_solution.rows() != n_skeleton_dofs) {
+        throw std::runtime_error("HDGSystem::recover: wrong size of the skeleton solution");
+    }
+    trace_solution.head(n_skeleton_dofs) = skeleton_solution;
+    auto &U = volume_system.getSolution();
+
+#pragma omp parallel
+    {
+        std::vector<int> element_dofs;
+        Eigen::VectorXd lambda;
+#pragma omp for schedule(dynamic, 16)
+        for (int e = 0; e < dofm.nCells(); ++e) {
+            if (!isCondensed(e)) {
+                continue;
+            }
+            dofm.getGlobalDofs(e, element_dofs);
+            const int n_interior = static_cast<int>(element_dofs.size());
+            const int n_trace = nElementTraceDofs(e);
+            const int *dofs = elementTraceDofs(e);
+            lambda.resize(n_trace);
+            for (int a = 0; a < n_trace; ++a) {
+                lambda(a) = trace_solution(dofs[a]);
+            }
+
+            Eigen::Map<const Eigen::MatrixXd> op(condensedOperator(e), n_interior, n_trace + 1);
+            Eigen::VectorXd Ue = op.col(n_trace) - op.leftCols(n_trace) * lambda;
+            for (int i = 0; i < n_interior; ++i) {
+                U(element_dofs[i]) = Ue(i);
+            }
+        }
+    }
+}
+
+
+std::size_t HDGSystem::memoryUsage() const
+{
+    return sizeof(double) * (condensed.size() + local_tangents.size() + local_residuals.size())
+           + sizeof(int) * (element_trace_dofs.size() + element_face_nodes.size())
+           + (sizeof(double) + sizeof(int)) * global_tangent.nonZeros();
+}
+
+YAFEL_NAMESPACE_CLOSE
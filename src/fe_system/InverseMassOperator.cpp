@@ -0,0 +1,224 @@
+#include "fe_system/InverseMassOperator.hpp"
+
+#include <Eigen/Dense>
+#include <algorithm>
+
+YAFEL_NAMESPACE_OPEN
+
+void InverseMassOperator::clear(const DoFManager &dofm)
+{
+    built = false;
+    n_scaled = 0;
+    n_dense = 0;
+    dof_offsets.assign(dofm.nCells() + 1, -1);
+    dofs.clear();
+    references.clear();
+    scales.assign(dofm.nCells(), 0.0);
+    chunks.clear();
+    element_reference.assign(dofm.nCells(), -1);
+    element_dense.assign(dofm.nCells(), -1);
+    element_diagonal.assign(dofm.nCells(), -1);
+    diagonal_elements.clear();
+    diagonal_inverses.clear();
+    dense_elements.clear();
+    dense_offsets.clear();
+    dense_inverses.clear();
+}
+
+
+void InverseMassOperator::addElement(int elnum, ElementType et, const std::vector<int> &element_dofs,
+                                     const Eigen::MatrixXd &M)
+{
+    dof_offsets[elnum] = static_cast<int>(dofs.size());
+    dofs.insert(dofs.end(), element_dofs.begin(), element_dofs.end());
+
+    const double diagonal_max = M.diagonal().cwiseAbs().maxCoeff();
+    if ((M - Eigen::MatrixXd(M.diagonal().asDiagonal())).cwiseAbs().maxCoeff() <= affine_tolerance * diagonal_max) {
+        element_diagonal[elnum] = static_cast<int>(diagonal_inverses.size());
+        diagonal_elements.push_back(elnum);
+        for (int i = 0; i < M.rows(); ++i) {
+            diagonal_inverses.push_back(1.0 / M(i, i));
+        }
+        return;
+    }
+
+    auto ref = std::find_if(references.begin(), references.end(),
+                            [&et](auto const &r) { return r.type == et; });
+    if (ref == references.end()) {
+        references.push_back({et, M, Eigen::MatrixXd(), {elnum}});
+        element_reference[elnum] = static_cast<int>(references.size()) - 1;
+        scales[elnum] = 1.0;
+        ++n_scaled;
+        return;
+    }
+
+    // Best multiple of the reference mass, in the Frobenius norm
+    const Eigen::MatrixXd &R = ref->mass;
+    if (R.rows() == M.rows()) {
+        double s = M.cwiseProduct(R).sum() / R.squaredNorm();
+        if (s > 0 && (M - s * R).norm() <= affine_tolerance * M.norm()) {
+            ref->elements.push_back(elnum);
+            element_reference[elnum] = static_cast<int>(ref - references.begin());
+            scales[elnum] = 1.0 / s;
+            ++n_scaled;
+            return;
+        }
+    }
+
+    Eigen::MatrixXd Minv = Eigen::PartialPivLU<Eigen::MatrixXd>(M).inverse();
+    element_dense[elnum] = static_cast<int>(dense_elements.size());
+    dense_elements.push_back(elnum);
+    dense_offsets.push_back(dense_inverses.size());
+    dense_inverses.insert(dense_inverses.end(), Minv.data(), Minv.data() + Minv.size());
+    ++n_dense;
+}
+
+
+void InverseMassOperator::finalize()
+{
+    // Elements without dofs here (not of the simulation dimension) get empty ranges
+    const int nCells = static_cast<int>(dof_offsets.size()) - 1;
+    dof_offsets[nCells] = static_cast<int>(dofs.size());
+    for (int e = nCells - 1; e >= 0; --e) {
+        if (dof_offsets[e] < 0) {
+            dof_offsets[e] = dof_offsets[e + 1];
+        }
+    }
+
+    for (int r = 0; r < static_cast<int>(references.size()); ++r) {
+        auto &ref = references[r];
+        ref.inverse = Eigen::PartialPivLU<Eigen::MatrixXd>(ref.mass).inverse();
+        const int nElements = static_cast<int>(ref.elements.size());
+        for (int first = 0; first < nElements; first += chunk_size) {
+            chunks.push_back({r, first, std::min(chunk_size, nElements - first)});
+        }
+    }
+    built = true;
+}
+
+
+void InverseMassOperator::apply(Eigen::VectorXd &x) const
+{
+    const int nChunks = static_cast<int>(chunks.size());
+    const int nDense = static_cast<int>(dense_elements.size());
+    const int nDiagonal = static_cast<int>(diagonal_elements.size());
+
+    // Elements own disjoint dofs, so every chunk and dense element writes its own entries of x
+#pragma omp parallel shared(x)
+    {
+        Eigen::MatrixXd X, Y;
+        Eigen::VectorXd v, w;
+
+#pragma omp for schedule(dynamic) nowait
+        for (int c = 0; c < nChunks; ++c) {
+            auto const &chunk = chunks[c];
+            auto const &ref = references[chunk.reference];
+            const int n = static_cast<int>(ref.inverse.rows());
+            const int *elements = ref.elements.data() + chunk.first;
+
+            X.resize(n, chunk.count);
+            for (int j = 0; j < chunk.count; ++j) {
+                const int *d = dofs.data() + dof_offsets[elements[j]];
+                for (int i = 0; i < n; ++i) {
+                    X(i, j) = x(d[i]);
+                }
+            }
+            Y.noalias() = ref.inverse * X;
+            for (int j = 0; j < chunk.count; ++j) {
+                const int *d = dofs.data() + dof_offsets[elements[j]];
+                const double s = scales[elements[j]];
+                for (int i = 0; i < n; ++i) {
+                    x(d[i]) = s * Y(i, j);
+                }
+            }
+        }
+
+#pragma omp for schedule(dynamic, 64) nowait
+        for (int k = 0; k < nDiagonal; ++k) {
+            const int e = diagonal_elements[k];
+            const int *d = dofs.data() + dof_offsets[e];
+            const double *dinv = diagonal_inverses.data() + element_diagonal[e];
+            const int n = dof_offsets[e + 1] - dof_offsets[e];
+            for (int i = 0; i < n; ++i) {
+                x(d[i]) *= dinv[i];
+            }
+        }
+
+#pragma omp for schedule(dynamic)
+        for (int k = 0; k < nDense; ++k) {
+            const int e = dense_elements[k];
+            const int *d = dofs.data() + dof_offsets[e];
+            const int n = dof_offsets[e + 1] - dof_offsets[e];
+            Eigen::Map<const Eigen::MatrixXd> Minv(dense_inverses.data() + dense_offsets[k], n, n);
+
+            v.resize(n);
+            for (int i = 0; i < n; ++i) {
+                v(i) = x(d[i]);
+            }
+            w.noalias() = Minv * v;
+            for (int i = 0; i < n; ++i) {
+                x(d[i]) = w(i);
+            }
+        }
+    }
+}
+
+
+void InverseMassOperator::apply(Eigen::VectorXd &x, const std::vector<int> &elements) const
+{
+    const int nElements = static_cast<int>(elements.size());
+
+#pragma omp parallel shared(x)
+    {
+        Eigen::VectorXd v, w;
+
+#pragma omp for schedule(dynamic, 16)
+        for (int k = 0; k < nElements; ++k) {
+            const int e = elements[k];
+            const int *d = dofs.data() + dof_offsets[e];
+            const int n = dof_offsets[e + 1] - dof_offsets[e];
+            if (n == 0) {
+                continue;
+            }
+            if (element_diagonal[e] >= 0) {
+                const double *dinv = diagonal_inverses.data() + element_diagonal[e];
+                for (int i = 0; i < n; ++i) {
+                    x(d[i]) *= dinv[i];
+                }
+                continue;
+            }
+
+            v.resize(n);
+            for (int i = 0; i < n; ++i) {
+                v(i) = x(d[i]);
+            }
+            if (element_reference[e] >= 0) {
+                w.noalias() = references[element_reference[e]].inverse * v;
+                w *= scales[e];
+            } else {
+                const int j = element_dense[e];
+                Eigen::Map<const Eigen::MatrixXd> Minv(dense_inverses.data() + dense_offsets[j], n, n);
+                w.noalias() = Minv * v;
+            }
+            for (int i = 0; i < n; ++i) {
+                x(d[i]) = w(i);
+            }
+        }
+    }
+}
+
+
+std::size_t InverseMassOperator::memoryUsage() const
+{
+    std::size_t bytes = sizeof(int) * (dof_offsets.size() + dofs.size() + dense_elements.size()
+                                       + element_reference.size() + element_dense.size()
+                                       + element_diagonal.size() + diagonal_elements.size())
+                        + sizeof(double) * (scales.size() + dense_inverses.size() + diagonal_inverses.size())
+                        + sizeof(std::size_t) * dense_offsets.size() + sizeof(Chunk) * chunks.size();
+    for (auto const &ref : references) {
+        bytes += sizeof(double) * (ref.mass.size() + ref.inverse.size()) + sizeof(int) * ref.elements.size();
+    }
+    return bytes;
+}
+
+YAFEL_NAMESPACE_CLOSE
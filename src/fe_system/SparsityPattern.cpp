@@ -0,0 +1,236 @@
+#include "fe_system/SparsityPattern.hpp"
+#include "utils/Range.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+YAFEL_NAMESPACE_OPEN
+
+SparsityPattern::SparsityPattern(const DoFManager &dofm, int topoDim)
+        : n_dofs(dofm.nNodes() * dofm.dof_per_node),
+          topo_dim(topoDim)
+{
+    const int dof_per_node = dofm.dof_per_node;
+    const int nCells = dofm.nCells();
+
+    auto included = [&dofm, topoDim](int elnum) {
+        return dofm.element_types[elnum].topoDim == topoDim;
+    };
+
+    auto n_local_dofs = [&dofm, dof_per_node](int elnum) {
+        return dof_per_node * (dofm.element_offsets[elnum + 1] - dofm.element_offsets[elnum]);
+    };
+
+    auto local_to_global = [&dofm, dof_per_node](int elnum, int A) {
+        return dofm.elements[dofm.element_offsets[elnum] + A / dof_per_node] * dof_per_node + A % dof_per_node;
+    };
+
+    // Elements whose dofs are coupled to those of an element: itself and, for a
+    // DG DoFManager, its face neighbors (face fluxes couple the two sides)
+    std::vector<int> coupled_offsets(nCells + 1, 0);
+    std::vector<int> coupled_elements;
+    {
+        std::vector<std::vector<int>> neighbors(nCells);
+        if (dofm.managerType == DoFManager::ManagerType::DG) {
+            for (auto const &F : dofm.interior_faces) {
+                if (F.left >= 0 && F.right >= 0 && included(F.left) && included(F.right)) {
+                    neighbors[F.left].push_back(F.right);
+                    neighbors[F.right].push_back(F.left);
+                }
+            }
+        }
+        for (auto e : IRange(0, nCells)) {
+            coupled_elements.push_back(e);
+            coupled_elements.insert(coupled_elements.end(), neighbors[e].begin(), neighbors[e].end());
+            coupled_offsets[e + 1] = static_cast<int>(coupled_elements.size());
+        }
+    }
+
+    // Build dof -> element adjacency in compressed format
+    std::vector<int> dof_element_offsets(n_dofs + 1, 0);
+    for (auto e : IRange(0, nCells)) {
+        if (!included(e)) {
+            continue;
+        }
+        for (auto A : IRange(0, n_local_dofs(e))) {
+            ++dof_element_offsets[local_to_global(e, A) + 1];
+        }
+    }
+    for (auto i : IRange(0, n_dofs)) {
+        dof_element_offsets[i + 1] += dof_element_offsets[i];
+    }
+
+    std::vector<int> dof_elements(dof_element_offsets[n_dofs]);
+    {
+        std::vector<int> fill(dof_element_offsets.begin(), dof_element_offsets.end() - 1);
+        for (auto e : IRange(0, nCells)) {
+            if (!included(e)) {
+                continue;
+            }
+            for (auto A : IRange(0, n_local_dofs(e))) {
+                dof_elements[fill[local_to_global(e, A)]++] = e;
+            }
+        }
+    }
+
+    // Count the rows in each column. Neighboring elements share dofs, so a
+    // (thread-private) marker array ensures each row is counted once per column.
+    outer_index.assign(n_dofs + 1, 0);
+#pragma omp parallel
+    {
+        std::vector<int> marker(n_dofs, -1);
+#pragma omp for
+        for (int c = 0; c < n_dofs; ++c) {
+            int count{0};
+            for (auto idx : IRange(dof_element_offsets[c], dof_element_offsets[c + 1])) {
+                for (auto cidx : IRange(coupled_offsets[dof_elements[idx]], coupled_offsets[dof_elements[idx] + 1])) {
+                    int e = coupled_elements[cidx];
+                    for (auto A : IRange(0, n_local_dofs(e))) {
+                        int r = local_to_global(e, A);
+                        if (marker[r] != c) {
+                            marker[r] = c;
+                            ++count;
+                        }
+                    }
+                }
+            }
+            outer_index[c + 1] = count;
+        }
+    }
+    for (auto c : IRange(0, n_dofs)) {
+        outer_index[c + 1] += outer_index[c];
+    }
+
+    // Fill and sort the row indices of each column
+    inner_index.resize(outer_index[n_dofs]);
+#pragma omp parallel
+    {
+        std::vector<int> marker(n_dofs, -1);
+#pragma omp for
+        for (int c = 0; c < n_dofs; ++c) {
+            int pos = outer_index[c];
+            for (auto idx : IRange(dof_element_offsets[c], dof_element_offsets[c + 1])) {
+                for (auto cidx : IRange(coupled_offsets[dof_elements[idx]], coupled_offsets[dof_elements[idx] + 1])) {
+                    int e = coupled_elements[cidx];
+                    for (auto A : IRange(0, n_local_dofs(e))) {
+                        int r = local_to_global(e, A);
+                        if (marker[r] != c) {
+                            marker[r] = c;
+                            inner_index[pos++] = r;
+                        }
+                    }
+                }
+            }
+            std::sort(inner_index.begin() + outer_index[c], inner_index.begin() + outer_index[c + 1]);
+        }
+    }
+
+    // Per-element position maps (row-major over the local tangent)
+    element_position_offsets.assign(nCells + 1, 0);
+    for (auto e : IRange(0, nCells)) {
+        int n = included(e) ? n_local_dofs(e) : 0;
+        element_position_offsets[e + 1] = element_position_offsets[e] + n * n;
+    }
+    element_positions.resize(element_position_offsets[nCells]);
+
+#pragma omp parallel for
+    for (int e = 0; e < nCells; ++e) {
+        if (!included(e)) {
+            continue;
+        }
+        int n = n_local_dofs(e);
+        int *positions = element_positions.data() + element_position_offsets[e];
+        for (int A = 0; A < n; ++A) {
+            int GA = local_to_global(e, A);
+            for (int B = 0; B < n; ++B) {
+                int GB = local_to_global(e, B);
+                auto col_begin = inner_index.begin() + outer_index[GB];
+                auto col_end = inner_index.begin() + outer_index[GB + 1];
+                auto it = std::lower_bound(col_begin, col_end, GA);
+                positions[A * n + B] = static_cast<int>(std::distance(inner_index.begin(), it));
+            }
+        }
+    }
+
+    // Per-face maps of the DG face blocks (row-major over each block)
+    const int nFaces = dofm.managerType == DoFManager::ManagerType::DG
+                       ? static_cast<int>(dofm.interior_faces.size()) : 0;
+    face_position_offsets.assign(nFaces + 1, 0);
+    for (auto f : IRange(0, nFaces)) {
+        auto const &F = dofm.interior_faces[f];
+        const bool boundary = (F.left < 0 || F.right < 0);
+        const bool face_included = boundary ? included(F.left >= 0 ? F.left : F.right)
+                                            : included(F.left) && included(F.right);
+        int n_blocks{0};
+        if (face_included) {
+            n_blocks = boundary ? 1 : 4;
+        }
+        const int n = dof_per_node * (dofm.face_offsets[f + 1] - dofm.face_offsets[f]);
+        face_position_offsets[f + 1] = face_position_offsets[f] + n_blocks * n * n;
+    }
+    face_positions.resize(face_position_offsets[nFaces]);
+
+    bool face_positions_valid{true};
+#pragma omp parallel for reduction(&&:face_positions_valid)
+    for (int f = 0; f < nFaces; ++f) {
+        if (nFacePositions(f) == 0) {
+            continue;
+        }
+        std::vector<int> traces[2];
+        dofm.getFaceTraces(f, traces[0], traces[1]);
+        const int n = dof_per_node * static_cast<int>(traces[0].size());
+        const int n_blocks = nFacePositions(f) / (n * n);
+        int *positions = face_positions.data() + face_position_offsets[f];
+        for (int block = 0; block < n_blocks; ++block) {
+            auto const &rows = traces[block / 2];
+            auto const &cols = traces[block % 2];
+            for (int A = 0; A < n; ++A) {
+                for (int B = 0; B < n; ++B) {
+                    const int p = position(rows[A / dof_per_node] * dof_per_node + A % dof_per_node,
+                                           cols[B / dof_per_node] * dof_per_node + B % dof_per_node);
+                    face_positions_valid = face_positions_valid && p >= 0;
+                    positions[(block * n + A) * n + B] = p;
+                }
+            }
+        }
+    }
+    if (!face_positions_valid) {
+        throw std::runtime_error("SparsityPattern: a DG face couples dofs outside the structure");
+    }
+}
+
+
+void SparsityPattern::initializeMatrix(matrix_type &A) const
+{
+    A.resize(n_dofs, n_dofs);
+    A.resizeNonZeros(nonZeros());
+
+    std::copy(outer_index.begin(), outer_index.end(), A.outerIndexPtr());
+    std::copy(inner_index.begin(), inner_index.end(), A.innerIndexPtr());
+    std::fill(A.valuePtr(), A.valuePtr() + nonZeros(), 0.0);
+}
+
+
+int SparsityPattern::position(int row, int col) const
+{
+    auto col_begin = inner_index.begin() + outer_index[col];
+    auto col_end = inner_index.begin() + outer_index[col + 1];
+    auto it = std::lower_bound(col_begin, col_end, row);
+    return it != col_end && *it == row ? static_cast<int>(std::distance(inner_index.begin(), it)) : -1;
+}
+
+
+bool SparsityPattern::matches(const matrix_type &A) const
+{
+    if (!A.isCompressed()
+        || A.rows() != n_dofs
+        || A.cols() != n_dofs
+        || A.nonZeros() != nonZeros()) {
+        return false;
+    }
+
+    return std::equal(outer_index.begin(), outer_index.end(), A.outerIndexPtr())
+           && std::equal(inner_index.begin(), inner_index.end(), A.innerIndexPtr());
+}
+
+YAFEL_NAMESPACE_CLOSE
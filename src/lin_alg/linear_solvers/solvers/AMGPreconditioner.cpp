@@ -0,0 +1,431 @@
+#include "lin_alg/linear_solvers/solvers/AMGPreconditioner.hpp"
+#include "utils/parallel/TaskScheduler.hpp"
+#include "utils/parallel/parfor.hpp"
+
+#include <Eigen/QR>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+
+YAFEL_NAMESPACE_OPEN
+
+namespace LinearSolve {
+
+namespace {
+
+using matrix_type = AMGPreconditioner::matrix_type;
+
+// Run body(i) for every row i of n, in fixed blocks on the global scheduler
+template<typename Lambda>
+void parallel_rows(Eigen::Index n, Lambda &&body)
+{
+    parfor(0, static_cast<std::size_t>(n), [&body](std::size_t i) {
+        body(static_cast<Eigen::Index>(i));
+    }, getGlobalScheduler(), 256);
+}
+
+// y = A x, by rows
+void spmv(const matrix_type &A, const Eigen::VectorXd &x, Eigen::VectorXd &y)
+{
+    const int *outer = A.outerIndexPtr();
+    const int *inner = A.innerIndexPtr();
+    const double *values = A.valuePtr();
+    y.resize(A.rows());
+    parallel_rows(A.rows(), [&](Eigen::Index i) {
+        double sum{0};
+        for (int k = outer[i]; k < outer[i + 1]; ++k) {
+            sum += values[k] * x(inner[k]);
+        }
+        y(i) = sum;
+    });
+}
+
+// Estimate of the largest eigenvalue of D^{-1}A (A symmetric positive definite), from above
+double spectral_radius(const matrix_type &A, const Eigen::VectorXd &inverse_diagonal)
+{
+    const Eigen::Index n = A.rows();
+    Eigen::VectorXd x(n), y(n);
+    for (Eigen::Index i = 0; i < n; ++i) {
+        x(i) = 1.0 + 0.5 * std::sin(1.7 * i);
+    }
+    x.normalize();
+    double rho{0};
+    for (int it = 0; it < 15; ++it) {
+        spmv(A, x, y);
+        y.array() *= inverse_diagonal.array();
+        double norm = y.norm();
+        if (norm == 0) {
+            break;
+        }
+        rho = norm;
+        x = y / norm;
+    }
+    return 1.1 * rho;
+}
+
+/**
+ * Aggregates of the nodes (blocks of bs dofs) of A, as the aggregate of each node
+ * (-1 for nodes without strong neighbors). Returns the number of aggregates.
+ */
+int aggregate(const matrix_type &A, int bs, double theta, std::vector<int> &node_aggregate)
+{
+    const int n_nodes = static_cast<int>(A.rows()) / bs;
+    const int *outer = A.outerIndexPtr();
+    const int *inner = A.innerIndexPtr();
+    const double *values = A.valuePtr();
+
+    // Squared Frobenius norms of the node blocks, row by row
+    std::vector<int> graph_offsets(n_nodes + 1, 0);
+    std::vector<int> graph_nodes;
+    std::vector<double> graph_norms;
+    std::vector<double> diagonal(n_nodes, 0.0);
+    {
+        std::vector<std::pair<int, double>> row;
+        for (int I = 0; I < n_nodes; ++I) {
+            row.clear();
+            for (int r = I * bs; r < (I + 1) * bs; ++r) {
+                for (int k = outer[r]; k < outer[r + 1]; ++k) {
+                    row.emplace_back(inner[k] / bs, values[k] * values[k]);
+                }
+            }
+            std::sort(row.begin(), row.end(), [](auto const &a, auto const &b) { return a.first < b.first; });
+            for (std::size_t k = 0; k < row.size();) {
+                const int J = row[k].first;
+                double sum{0};
+                for (; k < row.size() && row[k].first == J; ++k) {
+                    sum += row[k].second;
+                }
+                if (J == I) {
+                    diagonal[I] = std::sqrt(sum);
+                } else {
+                    graph_nodes.push_back(J);
+                    graph_norms.push_back(std::sqrt(sum));
+                }
+            }
+            graph_offsets[I + 1] = static_cast<int>(graph_nodes.size());
+        }
+    }
+
+    // Strong neighbors
+    std::vector<int> strong_offsets(n_nodes + 1, 0);
+    std::vector<int> strong;
+    for (int I = 0; I < n_nodes; ++I) {
+        for (int k = graph_offsets[I]; k < graph_offsets[I + 1]; ++k) {
+            const int J = graph_nodes[k];
+            if (graph_norms[k] >= theta * std::sqrt(diagonal[I] * diagonal[J]) && graph_norms[k] > 0) {
+                strong.push_back(J);
+            }
+        }
+        strong_offsets[I + 1] = static_cast<int>(strong.size());
+    }
+    auto isolated = [&](int I) { return strong_offsets[I + 1] == strong_offsets[I]; };
+
+    // Phase 1: a node and its strong neighbors, if none of them is aggregated yet
+    node_aggregate.assign(n_nodes, -1);
+    int n_aggregates{0};
+    for (int I = 0; I < n_nodes; ++I) {
+        if (node_aggregate[I] >= 0 || isolated(I)) {
+            continue;
+        }
+        bool free = true;
+        for (int k = strong_offsets[I]; k < strong_offsets[I + 1] && free; ++k) {
+            free = node_aggregate[strong[k]] < 0;
+        }
+        if (free) {
+            node_aggregate[I] = n_aggregates;
+            for (int k = strong_offsets[I]; k < strong_offsets[I + 1]; ++k) {
+                node_aggregate[strong[k]] = n_aggregates;
+            }
+            ++n_aggregates;
+        }
+    }
+
+    // Phase 2: the remaining nodes join an aggregate of phase 1 they are strongly connected to
+    std::vector<int> phase1 = node_aggregate;
+    for (int I = 0; I < n_nodes; ++I) {
+        if (phase1[I] >= 0) {
+            continue;
+        }
+        for (int k = strong_offsets[I]; k < strong_offsets[I + 1]; ++k) {
+            if (phase1[strong[k]] >= 0) {
+                node_aggregate[I] = phase1[strong[k]];
+                break;
+            }
+        }
+    }
+
+    // Phase 3: what is left forms aggregates with its unaggregated strong neighbors
+    for (int I = 0; I < n_nodes; ++I) {
+        if (node_aggregate[I] >= 0 || isolated(I)) {
+            continue;
+        }
+        node_aggregate[I] = n_aggregates;
+        for (int k = strong_offsets[I]; k < strong_offsets[I + 1]; ++k) {
+            if (node_aggregate[strong[k]] < 0) {
+                node_aggregate[strong[k]] = n_aggregates;
+            }
+        }
+        ++n_aggregates;
+    }
+    return n_aggregates;
+}
+
+/**
+ * Tentative prolongator T of the aggregates, with orthonormal columns on every
+ * aggregate (k = B.cols() per aggregate), and the coarse near-nullspace Bc with T Bc = B
+ */
+void tentative_prolongator(const Eigen::MatrixXd &B, int bs, const std::vector<int> &node_aggregate,
+                           int n_aggregates, matrix_type &T, Eigen::MatrixXd &Bc)
+{
+    const int k = static_cast<int>(B.cols());
+    const int n_nodes = static_cast<int>(node_aggregate.size());
+
+    std::vector<int> offsets(n_aggregates + 1, 0);
+    for (int I = 0; I < n_nodes; ++I) {
+        if (node_aggregate[I] >= 0) {
+            ++offsets[node_aggregate[I] + 1];
+        }
+    }
+    for (int a = 0; a < n_aggregates; ++a) {
+        offsets[a + 1] += offsets[a];
+    }
+    std::vector<int> nodes(offsets[n_aggregates]);
+    {
+        std::vector<int> fill(offsets.begin(), offsets.end() - 1);
+        for (int I = 0; I < n_nodes; ++I) {
+            if (node_aggregate[I] >= 0) {
+                nodes[fill[node_aggregate[I]]++] = I;
+            }
+        }
+    }
+
+    std::vector<Eigen::Triplet<double>> triplets;
+    Bc.setZero(Eigen::Index(n_aggregates) * k, k);
+    Eigen::MatrixXd local, Q;
+    for (int a = 0; a < n_aggregates; ++a) {
+        const int m = (offsets[a + 1] - offsets[a]) * bs;
+        local.resize(m, k);
+        for (int i = 0; i < offsets[a + 1] - offsets[a]; ++i) {
+            local.middleRows(i * bs, bs) = B.middleRows(Eigen::Index(nodes[offsets[a] + i]) * bs, bs);
+        }
+        Eigen::HouseholderQR<Eigen::MatrixXd> qr(local);
+        const int q = std::min(m, k);
+        Q = qr.householderQ() * Eigen::MatrixXd::Identity(m, q);
+        Bc.block(Eigen::Index(a) * k, 0, q, k) = qr.matrixQR().topRows(q).triangularView<Eigen::Upper>();
+        for (int i = 0; i < offsets[a + 1] - offsets[a]; ++i) {
+            for (int c = 0; c < bs; ++c) {
+                for (int j = 0; j < q; ++j) {
+                    triplets.emplace_back(nodes[offsets[a] + i] * bs + c, a * k + j, Q(i * bs + c, j));
+                }
+            }
+        }
+    }
+    T.resize(B.rows(), Eigen::Index(n_aggregates) * k);
+    T.setFromTriplets(triplets.begin(), triplets.end());
+    T.makeCompressed();
+}
+
+}//end anonymous namespace
+
+
+void AMGPreconditioner::setBlockSize(int dof_per_node)
+{
+    if (dof_per_node < 1) {
+        throw std::runtime_error("AMGPreconditioner: block size must be positive");
+    }
+    block_size = dof_per_node;
+    near_nullspace.resize(0, 0);
+}
+
+
+void AMGPreconditioner::setNearNullspace(const Eigen::MatrixXd &modes, int dof_per_node)
+{
+    setBlockSize(dof_per_node);
+    near_nullspace = modes;
+}
+
+
+Eigen::MatrixXd AMGPreconditioner::rigidBodyModes(const std::vector<coordinate<>> &nodes, int nsd)
+{
+    if (nsd != 2 && nsd != 3) {
+        throw std::runtime_error("AMGPreconditioner::rigidBodyModes: nsd must be 2 or 3");
+    }
+    const int n_modes = nsd == 2 ? 3 : 6;
+    const Eigen::Index n = static_cast<Eigen::Index>(nodes.size());
+    Eigen::MatrixXd modes = Eigen::MatrixXd::Zero(n * nsd, n_modes);
+    for (Eigen::Index i = 0; i < n; ++i) {
+        auto const &x = nodes[i];
+        for (int c = 0; c < nsd; ++c) {
+            modes(i * nsd + c, c) = 1;
+        }
+        if (nsd == 2) {
+            modes(i * 2 + 0, 2) = -x(1);
+            modes(i * 2 + 1, 2) = x(0);
+        } else {
+            // Rotations about the x, y and z axes
+            modes(i * 3 + 1, 3) = -x(2);
+            modes(i * 3 + 2, 3) = x(1);
+            modes(i * 3 + 0, 4) = x(2);
+            modes(i * 3 + 2, 4) = -x(0);
+            modes(i * 3 + 0, 5) = -x(1);
+            modes(i * 3 + 1, 5) = x(0);
+        }
+    }
+    return modes;
+}
+
+
+void AMGPreconditioner::setup(matrix_type A)
+{
+    computed = false;
+    levels.clear();
+    A.makeCompressed();
+    if (A.rows() != A.cols() || A.rows() % block_size != 0) {
+        throw std::runtime_error("AMGPreconditioner: matrix is not square, or not made of whole nodes");
+    }
+
+    Eigen::MatrixXd B = near_nullspace;
+    if (B.size() == 0) {
+        B = Eigen::MatrixXd::Zero(A.rows(), block_size);
+        for (Eigen::Index i = 0; i < A.rows(); ++i) {
+            B(i, i % block_size) = 1;
+        }
+    } else if (B.rows() != A.rows()) {
+        throw std::runtime_error("AMGPreconditioner: near-nullspace and matrix sizes differ");
+    }
+    int bs = block_size;
+
+    while (true) {
+        levels.emplace_back();
+        Level &L = levels.back();
+        L.A = std::move(A);
+        const Eigen::Index n = L.A.rows();
+
+        Eigen::VectorXd diagonal = L.A.diagonal();
+        L.inverse_diagonal.resize(n);
+        for (Eigen::Index i = 0; i < n; ++i) {
+            if (!(diagonal(i) > 0)) {
+                throw std::runtime_error("AMGPreconditioner: matrix diagonal must be positive");
+            }
+            L.inverse_diagonal(i) = 1.0 / diagonal(i);
+        }
+
+        const bool coarsest = n <= options.coarse_size || nLevels() >= options.max_levels;
+        std::vector<int> node_aggregate;
+        const int n_aggregates = coarsest ? 0 : aggregate(L.A, bs, options.strength_threshold, node_aggregate);
+        if (coarsest || n_aggregates == 0 || Eigen::Index(n_aggregates) * B.cols() >= n) {
+            coarse_solver.compute(Eigen::MatrixXd(L.A));
+            break;
+        }
+
+        const double rho = spectral_radius(L.A, L.inverse_diagonal);
+        L.jacobi_weight = options.smoother_damping / rho;
+
+        // Tentative prolongator, smoothed by one damped Jacobi step
+        matrix_type T;
+        Eigen::MatrixXd Bc;
+        tentative_prolongator(B, bs, node_aggregate, n_aggregates, T, Bc);
+        matrix_type AT = L.A * T;
+        AT = (options.prolongation_damping / rho) * L.inverse_diagonal.asDiagonal() * AT;
+        L.P = T - AT;
+        L.P.makeCompressed();
+        L.R = L.P.transpose();
+        L.R.makeCompressed();
+
+        // Galerkin coarse matrix. Coarse dofs whose prolongator column vanishes
+        // (aggregates with fewer dofs than modes) are decoupled: their diagonal is set to 1.
+        matrix_type AP = L.A * L.P;
+        A = L.R * AP;
+        A.makeCompressed();
+        const double scale = A.diagonal().cwiseAbs().maxCoeff();
+        for (Eigen::Index i = 0; i < A.rows(); ++i) {
+            if (std::abs(A.coeff(i, i)) <= 1e-14 * scale) {
+                A.coeffRef(i, i) = 1;
+            }
+        }
+        A.makeCompressed();
+        B = std::move(Bc);
+        bs = static_cast<int>(B.cols());
+    }
+
+    for (auto &L : levels) {
+        L.x.resize(L.A.rows());
+        L.b.resize(L.A.rows());
+        L.r.resize(L.A.rows());
+        L.tmp.resize(L.A.rows());
+    }
+    computed = true;
+}
+
+
+void AMGPreconditioner::apply(const Eigen::VectorXd &b, Eigen::VectorXd &x) const
+{
+    if (!computed) {
+        throw std::runtime_error("AMGPreconditioner: apply() before compute()");
+    }
+    levels[0].b = b;
+    cycle(0);
+    x = levels[0].x;
+}
+
+
+void AMGPreconditioner::smooth(const Level &L, int sweeps) const
+{
+    const int *outer = L.A.outerIndexPtr();
+    const int *inner = L.A.innerIndexPtr();
+    const double *values = L.A.valuePtr();
+    const double w = L.jacobi_weight;
+    for (int s = 0; s < sweeps; ++s) {
+        parallel_rows(L.A.rows(), [&](Eigen::Index i) {
+            double Ax{0};
+            for (int k = outer[i]; k < outer[i + 1]; ++k) {
+                Ax += values[k] * L.x(inner[k]);
+            }
+            L.tmp(i) = L.x(i) + w * L.inverse_diagonal(i) * (L.b(i) - Ax);
+        });
+        L.x.swap(L.tmp);
+    }
+}
+
+
+void AMGPreconditioner::cycle(int level) const
+{
+    const Level &L = levels[level];
+    if (level == nLevels() - 1) {
+        L.x = coarse_solver.solve(L.b);
+        return;
+    }
+
+    L.x.setZero();
+    smooth(L, options.pre_smooth);
+
+    // Restricted residual
+    spmv(L.A, L.x, L.r);
+    L.r = L.b - L.r;
+    const Level &C = levels[level + 1];
+    spmv(L.R, L.r, C.b);
+    cycle(level + 1);
+
+    // Coarse correction
+    spmv(L.P, C.x, L.tmp);
+    L.x += L.tmp;
+    smooth(L, options.post_smooth);
+}
+
+
+double AMGPreconditioner::operatorComplexity() const
+{
+    if (levels.empty()) {
+        return 0;
+    }
+    double total{0};
+    for (auto const &L : levels) {
+        total += static_cast<double>(L.A.nonZeros());
+    }
+    return total / static_cast<double>(levels[0].A.nonZeros());
+}
+
+}//end namespace LinearSolve
+
+YAFEL_NAMESPACE_CLOSE
@@ -0,0 +1,319 @@
+#include "lin_alg/linear_solvers/solvers/PMultigrid.hpp"
+#include "element/ElementFactory.hpp"
+#include "element/ShapeFunctionUtils.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <stdexcept>
+#include <utility>
+
+YAFEL_NAMESPACE_OPEN
+
+namespace LinearSolve {
+
+namespace {
+
+// Values of the shape functions of `coarse` at the local nodes of `fine` (one row per fine node)
+Eigen::MatrixXd local_interpolation(const Element &coarse, const Element &fine)
+{
+    std::vector<Eigen::VectorXd> values;
+    std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>> gradients;
+    auto const &coarse_nodes = coarse.localMesh.getGeometryNodes();
+    auto const &fine_nodes = fine.localMesh.getGeometryNodes();
+    auto const &et = coarse.elementType;
+    if (et.elementTopology == ElementTopology::TensorProduct) {
+        tensor_product_shape_functions(coarse_nodes, fine_nodes, et.topoDim, values, gradients);
+    } else if (et.elementTopology == ElementTopology::Simplex && et.topoDim == 2) {
+        triangle_shape_functions(coarse_nodes, fine_nodes, et.polyOrder, values, gradients);
+    } else if (et.elementTopology == ElementTopology::Simplex && et.topoDim == 3) {
+        tetrahedron_shape_functions(coarse_nodes, fine_nodes, et.polyOrder, values, gradients);
+    } else {
+        throw std::runtime_error("PMultigrid: unsupported element type");
+    }
+
+    Eigen::MatrixXd I(fine_nodes.size(), coarse_nodes.size());
+    for (int a = 0; a < I.rows(); ++a) {
+        I.row(a) = values[a].transpose();
+    }
+    return I;
+}
+
+int mesh_dimension(const DoFManager &dofm)
+{
+    int nsd{0};
+    for (auto et : dofm.element_types) {
+        nsd = std::max(nsd, static_cast<int>(et.topoDim));
+    }
+    return nsd;
+}
+
+}//end anonymous namespace
+
+
+PMultigrid::PMultigrid(const Mesh &M, const DoFManager &dofm)
+{
+    if (dofm.managerType != DoFManager::ManagerType::CG) {
+        throw std::runtime_error("PMultigrid: requires a CG DoFManager");
+    }
+
+    levels.emplace_back();
+    levels[0].dofm = &dofm;
+    for (int p = dofm.polyOrder / 2; p >= 1; p /= 2) {
+        levels.emplace_back();
+        auto &L = levels.back();
+        L.owned_dofm = std::make_unique<DoFManager>(M, DoFManager::ManagerType::CG, p, dofm.dof_per_node);
+        L.owned_dofm->quadratureType = dofm.quadratureType;
+        L.dofm = L.owned_dofm.get();
+    }
+    for (int l = 0; l < nLevels(); ++l) {
+        levels[l].constrained.assign(n_dofs(l), 0);
+    }
+    buildTransfers();
+}
+
+
+void PMultigrid::buildTransfers()
+{
+    const int nsd = mesh_dimension(*levels[0].dofm);
+    ElementFactory EF;
+    std::vector<int> fine_nodes, coarse_nodes;
+
+    for (int l = 0; l + 1 < nLevels(); ++l) {
+        auto const &F = *levels[l].dofm;
+        auto const &C = *levels[l + 1].dofm;
+        auto const &fine_mask = levels[l].constrained;
+        auto const &coarse_mask = levels[l + 1].constrained;
+        const int dpn = F.dof_per_node;
+
+        // Every fine node is interpolated once, from the first element that holds it
+        std::map<ElementType, Eigen::MatrixXd> interpolations;
+        std::vector<char> done(F.nNodes(), 0);
+        std::vector<Eigen::Triplet<double>> triplets;
+        for (int e = 0; e < F.nCells(); ++e) {
+            auto fine_type = F.element_types[e];
+            if (fine_type.topoDim != nsd) {
+                continue;
+            }
+            auto it = interpolations.find(fine_type);
+            if (it == interpolations.end()) {
+                auto const &coarse = EF.getElement(C.element_types[e]);
+                auto const &fine = EF.getElement(fine_type);
+                it = interpolations.emplace(fine_type, local_interpolation(coarse, fine)).first;
+            }
+            auto const &I = it->second;
+
+            F.getGlobalNodes(e, fine_nodes);
+            C.getGlobalNodes(e, coarse_nodes);
+            for (int a = 0; a < static_cast<int>(fine_nodes.size()); ++a) {
+                const int fa = fine_nodes[a];
+                if (done[fa]) {
+                    continue;
+                }
+                done[fa] = 1;
+                for (int b = 0; b < static_cast<int>(coarse_nodes.size()); ++b) {
+                    if (std::abs(I(a, b)) < 1e-13) {
+                        continue;
+                    }
+                    for (int c = 0; c < dpn; ++c) {
+                        const int row = fa * dpn + c;
+                        const int col = coarse_nodes[b] * dpn + c;
+                        if (!fine_mask[row] && !coarse_mask[col]) {
+                            triplets.emplace_back(row, col, I(a, b));
+                        }
+                    }
+                }
+            }
+        }
+
+        auto &L = levels[l];
+        L.P.resize(n_dofs(l), n_dofs(l + 1));
+        L.P.setFromTriplets(triplets.begin(), triplets.end());
+        L.P.makeCompressed();
+        L.R = L.P.transpose();
+        L.R.makeCompressed();
+    }
+}
+
+
+void PMultigrid::setAssembled(int level, matrix_type A)
+{
+    auto &L = levels[level];
+    auto const &mask = L.constrained;
+    if (A.rows() != n_dofs(level) || A.cols() != n_dofs(level)) {
+        throw std::runtime_error("PMultigrid: matrix and DoFManager sizes differ");
+    }
+
+    for (int i = 0; i < A.outerSize(); ++i) {
+        for (matrix_type::InnerIterator it(A, i); it; ++it) {
+            if (mask[it.row()] || mask[it.col()]) {
+                it.valueRef() = 0;
+            }
+        }
+    }
+    A.prune(0.0);
+    std::vector<Eigen::Triplet<double>> identity;
+    for (int i = 0; i < static_cast<int>(mask.size()); ++i) {
+        if (mask[i]) {
+            identity.emplace_back(i, i, 1.0);
+        }
+    }
+    matrix_type I(A.rows(), A.cols());
+    I.setFromTriplets(identity.begin(), identity.end());
+    L.A = A + I;
+    L.A.makeCompressed();
+    L.op = nullptr;
+}
+
+
+void PMultigrid::setupAssembled(matrix_type A)
+{
+    computed = false;
+    setAssembled(0, std::move(A));
+    for (int l = 1; l < nLevels(); ++l) {
+        // Galerkin product
+        matrix_type AP = levels[l - 1].A * levels[l - 1].P;
+        setAssembled(l, levels[l - 1].R * AP);
+    }
+    finishSetup();
+}
+
+
+void PMultigrid::finishSetup()
+{
+    for (int l = 0; l < nLevels(); ++l) {
+        auto &L = levels[l];
+        const Eigen::Index n = n_dofs(l);
+        if (!L.op) {
+            L.inverse_diagonal = L.A.diagonal().cwiseInverse();
+        } else {
+            L.A.resize(0, 0);
+        }
+        L.x.resize(n);
+        L.b.resize(n);
+        L.r.resize(n);
+        L.d.resize(n);
+
+        // Largest eigenvalue of D^{-1}A, by power iterations from a fixed start
+        if (l + 1 < nLevels()) {
+            Eigen::VectorXd &v = L.x;
+            Eigen::VectorXd &Av = L.r;
+            for (Eigen::Index i = 0; i < n; ++i) {
+                v(i) = 1.0 + 0.5 * std::sin(1.7 * i);
+            }
+            v.normalize();
+            double lambda{0};
+            for (int it = 0; it < 20; ++it) {
+                if (L.op) {
+                    L.op(v, Av);
+                } else {
+                    Av.noalias() = L.A * v;
+                }
+                Av.array() *= L.inverse_diagonal.array();
+                lambda = Av.norm();
+                v = Av / lambda;
+            }
+            L.lambda_max = 1.2 * lambda;
+        }
+    }
+
+    auto const &coarse = levels.back();
+    if (coarse.op) {
+        throw std::runtime_error("PMultigrid: the coarsest level must be assembled");
+    }
+    if (options.coarse_solver == PMultigridOptions::CoarseSolver::Direct) {
+        coarse_cholesky.compute(Eigen::SparseMatrix<double>(coarse.A));
+        if (coarse_cholesky.info() != Eigen::Success) {
+            throw std::runtime_error("PMultigrid: coarse factorization failed");
+        }
+    } else {
+        coarse_amg.setBlockSize(coarse.dofm->dof_per_node);
+        coarse_amg.compute(coarse.A);
+    }
+    computed = true;
+}
+
+
+void PMultigrid::apply(const Eigen::VectorXd &b, Eigen::VectorXd &x) const
+{
+    if (!computed) {
+        throw std::runtime_error("PMultigrid: apply() before compute()");
+    }
+    levels[0].b = b;
+    cycle(0);
+    x = levels[0].x;
+}
+
+
+void PMultigrid::smooth(const Level &L, bool zero_guess) const
+{
+    // Chebyshev iteration on D^{-1}A x = D^{-1}b, with eigenvalues in [lambda_max / range, lambda_max]
+    const double upper = L.lambda_max;
+    const double lower = upper / options.smoothing_range;
+    const double theta = 0.5 * (upper + lower);
+    const double delta = 0.5 * (upper - lower);
+    const double sigma = theta / delta;
+    double rho_old = 1.0 / sigma;
+
+    auto residual = [&]() {
+        if (L.op) {
+            L.op(L.x, L.r);
+        } else {
+            L.r.noalias() = L.A * L.x;
+        }
+        L.r = L.inverse_diagonal.cwiseProduct(L.b - L.r);
+    };
+
+    if (zero_guess) {
+        L.r = L.inverse_diagonal.cwiseProduct(L.b);
+        L.x.setZero();
+    } else {
+        residual();
+    }
+    L.d = L.r / theta;
+    for (int k = 0; k < options.chebyshev_degree; ++k) {
+        L.x += L.d;
+        if (k + 1 == options.chebyshev_degree) {
+            break;
+        }
+        residual();
+        const double rho = 1.0 / (2.0 * sigma - rho_old);
+        L.d = (rho * rho_old) * L.d + (2.0 * rho / delta) * L.r;
+        rho_old = rho;
+    }
+}
+
+
+void PMultigrid::cycle(int level) const
+{
+    const Level &L = levels[level];
+    if (level == nLevels() - 1) {
+        if (options.coarse_solver == PMultigridOptions::CoarseSolver::Direct) {
+            L.x = coarse_cholesky.solve(L.b);
+        } else {
+            coarse_amg.apply(L.b, L.x);
+        }
+        return;
+    }
+
+    smooth(L, true);
+
+    // Restricted residual
+    if (L.op) {
+        L.op(L.x, L.r);
+    } else {
+        L.r.noalias() = L.A * L.x;
+    }
+    L.r = L.b - L.r;
+    const Level &C = levels[level + 1];
+    C.b.noalias() = L.R * L.r;
+    cycle(level + 1);
+
+    // Coarse correction
+    L.x.noalias() += L.P * C.x;
+    smooth(L, false);
+}
+
+}//end namespace LinearSolve
+
+YAFEL_NAMESPACE_CLOSE
@@ -0,0 +1,417 @@
+#include "lin_alg/linear_solvers/solvers/ParallelKrylov.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+YAFEL_NAMESPACE_OPEN
+
+namespace LinearSolve {
+
+namespace {
+
+// Nonzeros below which a block is not worth a task
+constexpr Eigen::Index min_block_nonzeros = 8192;
+
+void check_sizes(const ParallelCSRMatrix &A, const Eigen::VectorXd &b, Eigen::VectorXd &x)
+{
+    if (A.rows() != A.cols() || A.rows() != b.rows()) {
+        throw std::runtime_error("ParallelKrylov: incorrect linear system dimensions");
+    }
+    if (x.rows() != A.rows()) {
+        x = A.vector();
+    }
+}
+
+int max_iterations(int requested, const ParallelCSRMatrix &A)
+{
+    return requested < 0 ? static_cast<int>(2 * A.rows()) : requested;
+}
+
+}//end anonymous namespace
+
+
+void ParallelCSRMatrix::assign(const matrix_type &A, int nBlocks)
+{
+    if (!A.isCompressed()) {
+        matrix_type compressed(A);
+        compressed.makeCompressed();
+        assign(compressed, nBlocks);
+        return;
+    }
+
+    n_rows = A.rows();
+    n_cols = A.cols();
+    const index_type *outer = A.outerIndexPtr();
+    const index_type *inner = A.innerIndexPtr();
+    const double *a_values = A.valuePtr();
+    const Eigen::Index nnz = A.nonZeros();
+
+    // Contiguous blocks of about the same number of nonzeros (plus one per row)
+    if (nBlocks <= 0) {
+        nBlocks = static_cast<int>(std::min<Eigen::Index>(config::num_cores, nnz / min_block_nonzeros));
+    }
+    nBlocks = static_cast<int>(std::max<Eigen::Index>(1, std::min<Eigen::Index>(nBlocks, n_rows)));
+    const Eigen::Index work = nnz + n_rows;
+    block_start.assign(nBlocks + 1, n_rows);
+    block_start[0] = 0;
+    Eigen::Index row = 0;
+    for (int k = 1; k < nBlocks; ++k) {
+        const Eigen::Index target = (work * k) / nBlocks;
+        while (row < n_rows && outer[row] + row < target) {
+            ++row;
+        }
+        block_start[k] = row;
+    }
+
+    // Uninitialized storage, first written by the block that owns it
+    row_ptr.resize(n_rows + 1);
+    col_index.resize(nnz);
+    values.resize(nnz);
+    inverse_diagonal.resize(n_rows);
+    forBlocks([&](int, Eigen::Index begin, Eigen::Index end) {
+        for (Eigen::Index i = begin; i < end; ++i) {
+            row_ptr(i) = outer[i];
+            double diagonal{0};
+            for (index_type k = outer[i]; k < outer[i + 1]; ++k) {
+                col_index(k) = inner[k];
+                values(k) = a_values[k];
+                if (inner[k] == i) {
+                    diagonal += a_values[k];
+                }
+            }
+            inverse_diagonal(i) = (diagonal == 0) ? 1.0 : 1.0 / diagonal;
+        }
+    });
+    row_ptr(n_rows) = outer[n_rows];
+}
+
+
+Eigen::VectorXd ParallelCSRMatrix::vector() const
+{
+    Eigen::VectorXd v(n_rows);
+    forBlocks([&v](int, Eigen::Index begin, Eigen::Index end) { v.segment(begin, end - begin).setZero(); });
+    return v;
+}
+
+
+void ParallelCSRMatrix::multiply(const Eigen::VectorXd &x, Eigen::VectorXd &y) const
+{
+    y.resize(n_rows);
+    forBlocks([&](int, Eigen::Index begin, Eigen::Index end) { multiplyRows(x, y, begin, end); });
+}
+
+
+double ParallelCSRMatrix::multiplyDot(const Eigen::VectorXd &x, Eigen::VectorXd &y, const Eigen::VectorXd &w) const
+{
+    y.resize(n_rows);
+    return reduceBlocks([&](Eigen::Index begin, Eigen::Index end) {
+        multiplyRows(x, y, begin, end);
+        return w.segment(begin, end - begin).dot(y.segment(begin, end - begin));
+    });
+}
+
+
+double ParallelCSRMatrix::residual(const Eigen::VectorXd &b, const Eigen::VectorXd &x, Eigen::VectorXd &r) const
+{
+    r.resize(n_rows);
+    return reduceBlocks([&](Eigen::Index begin, Eigen::Index end) {
+        multiplyRows(x, r, begin, end);
+        auto rs = r.segment(begin, end - begin);
+        rs = b.segment(begin, end - begin) - rs;
+        return rs.squaredNorm();
+    });
+}
+
+
+double ParallelCSRMatrix::axpyNorm(double a, const Eigen::VectorXd &x, Eigen::VectorXd &y) const
+{
+    return reduceBlocks([&](Eigen::Index begin, Eigen::Index end) {
+        auto ys = y.segment(begin, end - begin);
+        ys += a * x.segment(begin, end - begin);
+        return ys.squaredNorm();
+    });
+}
+
+
+double ParallelCSRMatrix::dot(const Eigen::VectorXd &x, const Eigen::VectorXd &y) const
+{
+    return reduceBlocks([&](Eigen::Index begin, Eigen::Index end) {
+        return x.segment(begin, end - begin).dot(y.segment(begin, end - begin));
+    });
+}
+
+
+double ParallelCSRMatrix::norm(const Eigen::VectorXd &x) const
+{
+    return std::sqrt(reduceBlocks([&](Eigen::Index begin, Eigen::Index end) {
+        return x.segment(begin, end - begin).squaredNorm();
+    }));
+}
+
+
+namespace detail {
+
+void parallel_solve(const ParallelCSRMatrix &A, const Eigen::VectorXd &b, Eigen::VectorXd &x,
+                    ParallelConjugateGradientTag &tag)
+{
+    check_sizes(A, b, x);
+    const int iteration_limit = max_iterations(tag.max_iterations, A);
+    auto const &dinv = A.inverseDiagonal();
+    tag.iterations = 0;
+    tag.error = 0;
+
+    const double b_norm = A.norm(b);
+    if (b_norm == 0) {
+        x = A.vector();
+        return;
+    }
+    const double threshold = tag.tolerance * b_norm;
+
+    Eigen::VectorXd r = A.vector(), z = A.vector(), p = A.vector(), q = A.vector();
+    double r_norm2 = A.residual(b, x, r);
+    double rz = A.reduceBlocks([&](Eigen::Index begin, Eigen::Index end) {
+        const Eigen::Index len = end - begin;
+        z.segment(begin, len) = dinv.segment(begin, len).cwiseProduct(r.segment(begin, len));
+        p.segment(begin, len) = z.segment(begin, len);
+        return r.segment(begin, len).dot(z.segment(begin, len));
+    });
+
+    while (std::sqrt(r_norm2) > threshold && tag.iterations < iteration_limit) {
+        const double alpha = rz / A.multiplyDot(p, q, p);
+
+        // x += alpha p, r -= alpha q, z = D^{-1} r, with r.r and r.z, in one sweep
+        Eigen::Vector2d sums = A.reduceBlocks([&](Eigen::Index begin, Eigen::Index end) {
+            const Eigen::Index len = end - begin;
+            auto rs = r.segment(begin, len);
+            auto zs = z.segment(begin, len);
+            x.segment(begin, len) += alpha * p.segment(begin, len);
+            rs -= alpha * q.segment(begin, len);
+            zs = dinv.segment(begin, len).cwiseProduct(rs);
+            return Eigen::Vector2d(rs.squaredNorm(), rs.dot(zs));
+        }, Eigen::Vector2d::Zero().eval());
+        ++tag.iterations;
+
+        r_norm2 = sums(0);
+        const double beta = sums(1) / rz;
+        rz = sums(1);
+        A.forBlocks([&](int, Eigen::Index begin, Eigen::Index end) {
+            const Eigen::Index len = end - begin;
+            p.segment(begin, len) = z.segment(begin, len) + beta * p.segment(begin, len);
+        });
+    }
+    tag.error = std::sqrt(r_norm2) / b_norm;
+}
+
+
+void parallel_solve(const ParallelCSRMatrix &A, const Eigen::VectorXd &b, Eigen::VectorXd &x,
+                    ParallelBICGSTABTag &tag)
+{
+    check_sizes(A, b, x);
+    const int iteration_limit = max_iterations(tag.max_iterations, A);
+    auto const &dinv = A.inverseDiagonal();
+    tag.iterations = 0;
+    tag.error = 0;
+
+    const double b_norm = A.norm(b);
+    if (b_norm == 0) {
+        x = A.vector();
+        return;
+    }
+    const double threshold = tag.tolerance * b_norm;
+    const double eps2 = std::numeric_limits<double>::epsilon() * std::numeric_limits<double>::epsilon();
+
+    Eigen::VectorXd r = A.vector(), r0 = A.vector(), p = A.vector(), v = A.vector();
+    Eigen::VectorXd y = A.vector(), s = A.vector(), z = A.vector(), t = A.vector();
+    double r_norm2 = A.residual(b, x, r);
+    auto reset_shadow = [&]() {
+        A.forBlocks([&](int, Eigen::Index begin, Eigen::Index end) {
+            r0.segment(begin, end - begin) = r.segment(begin, end - begin);
+        });
+        return r_norm2;
+    };
+    double r0_norm2 = reset_shadow();
+    double rho{1}, alpha{1}, omega{1};
+
+    while (std::sqrt(r_norm2) > threshold && tag.iterations < iteration_limit) {
+        const double rho_old = rho;
+        rho = A.dot(r0, r);
+        if (std::abs(rho) < eps2 * r0_norm2) {
+            // The shadow residual is (nearly) orthogonal to r: restart from the true residual
+            r_norm2 = A.residual(b, x, r);
+            r0_norm2 = reset_shadow();
+            rho = r0_norm2;
+            alpha = omega = 1;
+            v.setZero();
+            p.setZero();
+        }
+
+        const double beta = (rho / rho_old) * (alpha / omega);
+        A.forBlocks([&](int, Eigen::Index begin, Eigen::Index end) {
+            const Eigen::Index len = end - begin;
+            auto ps = p.segment(begin, len);
+            ps = r.segment(begin, len) + beta * (ps - omega * v.segment(begin, len));
+            y.segment(begin, len) = dinv.segment(begin, len).cwiseProduct(ps);
+        });
+        const double r0v = A.multiplyDot(y, v, r0);
+        if (r0v == 0) {
+            break;
+        }
+        alpha = rho / r0v;
+
+        // s = r - alpha v and z = D^{-1} s, with s.s
+        const double s_norm2 = A.reduceBlocks([&](Eigen::Index begin, Eigen::Index end) {
+            const Eigen::Index len = end - begin;
+            auto ss = s.segment(begin, len);
+            ss = r.segment(begin, len) - alpha * v.segment(begin, len);
+            z.segment(begin, len) = dinv.segment(begin, len).cwiseProduct(ss);
+            return ss.squaredNorm();
+        });
+        ++tag.iterations;
+        if (std::sqrt(s_norm2) <= threshold) {
+            A.forBlocks([&](int, Eigen::Index begin, Eigen::Index end) {
+                x.segment(begin, end - begin) += alpha * y.segment(begin, end - begin);
+                r.segment(begin, end - begin) = s.segment(begin, end - begin);
+            });
+            r_norm2 = s_norm2;
+            break;
+        }
+
+        A.multiply(z, t);
+        Eigen::Vector2d tt_ts = A.reduceBlocks([&](Eigen::Index begin, Eigen::Index end) {
+            auto ts = t.segment(begin, end - begin);
+            return Eigen::Vector2d(ts.squaredNorm(), ts.dot(s.segment(begin, end - begin)));
+        }, Eigen::Vector2d::Zero().eval());
+        omega = (tt_ts(0) > 0) ? tt_ts(1) / tt_ts(0) : 0.0;
+
+        // x += alpha y + omega z and r = s - omega t, with r.r
+        r_norm2 = A.reduceBlocks([&](Eigen::Index begin, Eigen::Index end) {
+            const Eigen::Index len = end - begin;
+            auto rs = r.segment(begin, len);
+            x.segment(begin, len) += alpha * y.segment(begin, len) + omega * z.segment(begin, len);
+            rs = s.segment(begin, len) - omega * t.segment(begin, len);
+            return rs.squaredNorm();
+        });
+        if (omega == 0) {
+            break;
+        }
+    }
+    tag.error = std::sqrt(r_norm2) / b_norm;
+}
+
+
+void parallel_solve(const ParallelCSRMatrix &A, const Eigen::VectorXd &b, Eigen::VectorXd &x,
+                    ParallelGMRESTag &tag)
+{
+    check_sizes(A, b, x);
+    const int iteration_limit = max_iterations(tag.max_iterations, A);
+    auto const &dinv = A.inverseDiagonal();
+    tag.iterations = 0;
+    tag.error = 0;
+
+    const double b_norm = A.norm(b);
+    if (b_norm == 0) {
+        x = A.vector();
+        return;
+    }
+    const double threshold = tag.tolerance * b_norm;
+
+    const int m = static_cast<int>(std::max<Eigen::Index>(1, std::min<Eigen::Index>(tag.restart, A.rows())));
+    std::vector<Eigen::VectorXd> V;
+    V.reserve(m + 1);
+    for (int i = 0; i <= m; ++i) {
+        V.push_back(A.vector());
+    }
+    Eigen::VectorXd r = A.vector(), z = A.vector();
+    Eigen::MatrixXd H(m + 1, m);
+    Eigen::VectorXd cs(m), sn(m), g(m + 1);
+
+    double r_norm = std::sqrt(A.residual(b, x, r));
+    while (r_norm > threshold && tag.iterations < iteration_limit) {
+        A.forBlocks([&](int, Eigen::Index begin, Eigen::Index end) {
+            V[0].segment(begin, end - begin) = r.segment(begin, end - begin) / r_norm;
+        });
+        H.setZero();
+        g.setZero();
+        g(0) = r_norm;
+
+        int k = 0;
+        while (k < m && tag.iterations < iteration_limit) {
+            A.forBlocks([&](int, Eigen::Index begin, Eigen::Index end) {
+                z.segment(begin, end - begin) = dinv.segment(begin, end - begin).cwiseProduct(V[k].segment(begin, end - begin));
+            });
+            Eigen::VectorXd &w = V[k + 1];
+            A.multiply(z, w);
+
+            // Two passes of classical Gram-Schmidt against V[0..k]
+            Eigen::VectorXd h = Eigen::VectorXd::Zero(k + 1);
+            double w_norm2{0};
+            for (int pass = 0; pass < 2; ++pass) {
+                Eigen::VectorXd c = A.reduceBlocks([&](Eigen::Index begin, Eigen::Index end) {
+                    const Eigen::Index len = end - begin;
+                    Eigen::VectorXd d(k + 1);
+                    for (int i = 0; i <= k; ++i) {
+                        d(i) = V[i].segment(begin, len).dot(w.segment(begin, len));
+                    }
+                    return d;
+                }, Eigen::VectorXd::Zero(k + 1).eval());
+                w_norm2 = A.reduceBlocks([&](Eigen::Index begin, Eigen::Index end) {
+                    const Eigen::Index len = end - begin;
+                    auto ws = w.segment(begin, len);
+                    for (int i = 0; i <= k; ++i) {
+                        ws -= c(i) * V[i].segment(begin, len);
+                    }
+                    return ws.squaredNorm();
+                });
+                h += c;
+            }
+            const double h_next = std::sqrt(w_norm2);
+            if (h_next > 0) {
+                A.forBlocks([&](int, Eigen::Index begin, Eigen::Index end) {
+                    w.segment(begin, end - begin) /= h_next;
+                });
+            }
+
+            // Least squares problem by Givens rotations of the Hessenberg column
+            H.col(k).head(k + 1) = h;
+            H(k + 1, k) = h_next;
+            for (int i = 0; i < k; ++i) {
+                const double upper = cs(i) * H(i, k) + sn(i) * H(i + 1, k);
+                H(i + 1, k) = -sn(i) * H(i, k) + cs(i) * H(i + 1, k);
+                H(i, k) = upper;
+            }
+            const double denom = std::hypot(H(k, k), H(k + 1, k));
+            cs(k) = (denom > 0) ? H(k, k) / denom : 1.0;
+            sn(k) = (denom > 0) ? H(k + 1, k) / denom : 0.0;
+            H(k, k) = denom;
+            H(k + 1, k) = 0;
+            g(k + 1) = -sn(k) * g(k);
+            g(k) = cs(k) * g(k);
+            ++k;
+            ++tag.iterations;
+            if (std::abs(g(k)) <= threshold || h_next == 0) {
+                break;
+            }
+        }
+
+        // x += D^{-1} V y, with y the least squares solution
+        Eigen::VectorXd y = H.topLeftCorner(k, k).triangularView<Eigen::Upper>().solve(g.head(k));
+        A.forBlocks([&](int, Eigen::Index begin, Eigen::Index end) {
+            const Eigen::Index len = end - begin;
+            Eigen::VectorXd update = y(0) * V[0].segment(begin, len);
+            for (int i = 1; i < k; ++i) {
+                update += y(i) * V[i].segment(begin, len);
+            }
+            x.segment(begin, len) += dinv.segment(begin, len).cwiseProduct(update);
+        });
+        r_norm = std::sqrt(A.residual(b, x, r));
+    }
+    tag.error = r_norm / b_norm;
+}
+
+}//end namespace detail
+
+}//end namespace LinearSolve
+
+YAFEL_NAMESPACE_CLOSE
@@ -6,7 +6,7 @@
 
 YAFEL_NAMESPACE_OPEN
 
-DGRK4::DGRK4(double dt) : dt(dt) {}
+DGRK4::DGRK4(double dt) : ExplicitRK(dt) {}
 
 
 YAFEL_NAMESPACE_CLOSE
\ No newline at end of file
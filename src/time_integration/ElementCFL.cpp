@@ -0,0 +1,70 @@
+#include "time_integration/ElementCFL.hpp"
+#include "element/ElementFactory.hpp"
+
+#include <stdexcept>
+
+YAFEL_NAMESPACE_OPEN
+
+template<int NSD>
+static void element_volumes(const DoFManager &dofm, const GeometryCache *geometry, std::vector<double> &volume)
+{
+#pragma omp parallel
+    {
+        ElementFactory EF(1, 2, dofm.quadratureType);
+#pragma omp for
+        for (int elnum = 0; elnum < dofm.nCells(); ++elnum) {
+            auto et = dofm.element_types[elnum];
+            if (et.topoDim != NSD) {
+                continue;
+            }
+            auto &E = EF.getElement(et);
+            double v{0};
+            for (int qpi = 0; qpi < E.nQP(); ++qpi) {
+                E.update<NSD>(elnum, qpi, dofm, geometry);
+                v += E.jxw;
+            }
+            volume[elnum] = v;
+        }
+    }
+}
+
+
+std::vector<double> elementLengths(FESystem &feSystem, int nsd)
+{
+    auto &dofm = feSystem.getDoFManager();
+    std::vector<double> volume(dofm.nCells(), 0.0);
+    switch (nsd) {
+        case 2:
+            element_volumes<2>(dofm, feSystem.getGeometryCache(2), volume);
+            break;
+        case 3:
+            element_volumes<3>(dofm, feSystem.getGeometryCache(3), volume);
+            break;
+        default:
+            throw std::runtime_error("elementLengths: Invalid nsd");
+    }
+
+    // Surface measures, from both sides of every face
+    auto const &faces = feSystem.getFaceGeometryCache(nsd);
+    std::vector<double> surface(dofm.nCells(), 0.0);
+    for (int f = 0; f < faces.nFaces(); ++f) {
+        auto const &F = dofm.interior_faces[f];
+        const int left = F.left >= 0 ? F.left : F.right;
+        for (int q = 0; q < faces.nFaceQP(f); ++q) {
+            surface[left] += faces.jxwLeft(f, q);
+            if (!faces.isBoundary(f)) {
+                surface[F.right] += faces.jxwRight(f, q);
+            }
+        }
+    }
+
+    std::vector<double> h(dofm.nCells(), std::numeric_limits<double>::infinity());
+    for (int elnum = 0; elnum < dofm.nCells(); ++elnum) {
+        if (dofm.element_types[elnum].topoDim == nsd && surface[elnum] > 0) {
+            h[elnum] = 2 * nsd * volume[elnum] / surface[elnum];
+        }
+    }
+    return h;
+}
+
+YAFEL_NAMESPACE_CLOSE
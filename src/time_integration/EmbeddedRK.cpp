@@ -0,0 +1,57 @@
+#include "time_integration/EmbeddedRK.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+YAFEL_NAMESPACE_OPEN
+
+BogackiShampine23::BogackiShampine23(double dt, double rtol, double atol)
+        : ExplicitRK(dt), rtol(rtol), atol(atol)
+{
+    if (!(rtol >= 0 && atol >= 0 && rtol + atol > 0)) {
+        throw std::runtime_error("BogackiShampine23: tolerances must be nonnegative, and not both zero");
+    }
+}
+
+
+void BogackiShampine23::reject(FESystem &feSystem)
+{
+    auto &U = feSystem.getSolution();
+    if (U0.rows() != U.rows()) {
+        throw std::runtime_error("BogackiShampine23: no step to reject");
+    }
+    parassign(U, U0);
+    feSystem.currentTime() = time0;
+}
+
+
+double BogackiShampine23::weighted_error_norm(const Eigen::VectorXd &U) const
+{
+    const Eigen::Index n = U.rows();
+    if (n == 0) {
+        return 0;
+    }
+    // Partial sums over fixed blocks, added in order: the norm does not depend on the thread count
+    constexpr Eigen::Index block = 4096;
+    const Eigen::Index nBlocks = (n + block - 1) / block;
+    std::vector<double> partial(nBlocks, 0.0);
+#pragma omp parallel for
+    for (Eigen::Index b = 0; b < nBlocks; ++b) {
+        double s{0};
+        for (Eigen::Index i = b * block; i < std::min(n, (b + 1) * block); ++i) {
+            const double scale = atol + rtol * std::max(std::abs(U0(i)), std::abs(U(i)));
+            const double e = Err(i) / scale;
+            s += e * e;
+        }
+        partial[b] = s;
+    }
+    double sum{0};
+    for (double s : partial) {
+        sum += s;
+    }
+    return std::sqrt(sum / n);
+}
+
+YAFEL_NAMESPACE_CLOSE
@@ -0,0 +1,61 @@
+#include "time_integration/IMEXRK.hpp"
+
+#include <cmath>
+#include <stdexcept>
+
+YAFEL_NAMESPACE_OPEN
+
+IMEXRK::IMEXRK(double dt, Scheme scheme)
+        : dt(dt)
+{
+    switch (scheme) {
+        case Scheme::ARS111:
+            A_explicit = {0.0, 0.0,
+                          1.0, 0.0};
+            A_implicit = {0.0, 0.0,
+                          0.0, 1.0};
+            c = {0.0, 1.0};
+            scheme_order = 1;
+            break;
+        case Scheme::ARS222: {
+            const double gamma = 1.0 - 1.0 / std::sqrt(2.0);
+            const double delta = 1.0 - 1.0 / (2.0 * gamma);
+            A_explicit = {0.0, 0.0, 0.0,
+                          gamma, 0.0, 0.0,
+                          delta, 1.0 - delta, 0.0};
+            A_implicit = {0.0, 0.0, 0.0,
+                          0.0, gamma, 0.0,
+                          0.0, 1.0 - gamma, gamma};
+            c = {0.0, gamma, 1.0};
+            scheme_order = 2;
+            break;
+        }
+        case Scheme::ARS443:
+            A_explicit = {0.0, 0.0, 0.0, 0.0, 0.0,
+                          1.0 / 2.0, 0.0, 0.0, 0.0, 0.0,
+                          11.0 / 18.0, 1.0 / 18.0, 0.0, 0.0, 0.0,
+                          5.0 / 6.0, -5.0 / 6.0, 1.0 / 2.0, 0.0, 0.0,
+                          1.0 / 4.0, 7.0 / 4.0, 3.0 / 4.0, -7.0 / 4.0, 0.0};
+            A_implicit = {0.0, 0.0, 0.0, 0.0, 0.0,
+                          0.0, 1.0 / 2.0, 0.0, 0.0, 0.0,
+                          0.0, 1.0 / 6.0, 1.0 / 2.0, 0.0, 0.0,
+                          0.0, -1.0 / 2.0, 1.0 / 2.0, 1.0 / 2.0, 0.0,
+                          0.0, 3.0 / 2.0, -3.0 / 2.0, 1.0 / 2.0, 1.0 / 2.0};
+            c = {0.0, 1.0 / 2.0, 2.0 / 3.0, 1.0 / 2.0, 1.0};
+            scheme_order = 3;
+            break;
+        default:
+            throw std::runtime_error("IMEXRK: unknown scheme");
+    }
+}
+
+
+void IMEXRK::setNewtonIterations(int iterations)
+{
+    if (iterations < 1) {
+        throw std::runtime_error("IMEXRK: at least one Newton iteration per stage");
+    }
+    newton_iterations = iterations;
+}
+
+YAFEL_NAMESPACE_CLOSE
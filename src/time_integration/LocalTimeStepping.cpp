@@ -0,0 +1,111 @@
+#include "time_integration/LocalTimeStepping.hpp"
+#include "utils/DoFManager.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+YAFEL_NAMESPACE_OPEN
+
+LocalTimeStepping::LocalTimeStepping(const DoFManager &dofm, const std::vector<double> &element_dt, int maxLevels)
+        : ExplicitRK(0)
+{
+    const int nCells = dofm.nCells();
+    if (static_cast<int>(element_dt.size()) != nCells || maxLevels < 1) {
+        throw std::runtime_error("LocalTimeStepping: need one time step per element and at least one level");
+    }
+
+    double dt0 = std::numeric_limits<double>::infinity();
+    for (double h : element_dt) {
+        if (!(h > 0)) {
+            throw std::runtime_error("LocalTimeStepping: element time steps must be positive");
+        }
+        dt0 = std::min(dt0, h);
+    }
+    if (!std::isfinite(dt0)) {
+        throw std::runtime_error("LocalTimeStepping: no element has a finite time step");
+    }
+
+    // Largest level whose step fits in the element's step. The levels are those of
+    // the elements with a finite step: the others go on the coarsest one of these,
+    // so that cells without faces (of another dimension) add no empty levels.
+    element_level.assign(nCells, 0);
+    int coarsest{0};
+    for (int e = 0; e < nCells; ++e) {
+        if (std::isfinite(element_dt[e])) {
+            int l = std::min(maxLevels - 1, static_cast<int>(std::floor(std::log2(element_dt[e] / dt0))));
+            element_level[e] = std::max(l, 0);
+            coarsest = std::max(coarsest, element_level[e]);
+        }
+    }
+    for (int e = 0; e < nCells; ++e) {
+        if (!std::isfinite(element_dt[e])) {
+            element_level[e] = coarsest;
+        }
+    }
+
+    // Face neighbors differ by at most one level
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (auto const &F : dofm.interior_faces) {
+            if (F.left < 0 || F.right < 0) {
+                continue;
+            }
+            int &a = element_level[F.left];
+            int &b = element_level[F.right];
+            if (a > b + 1) {
+                a = b + 1;
+                changed = true;
+            } else if (b > a + 1) {
+                b = a + 1;
+                changed = true;
+            }
+        }
+    }
+
+    const int nLev = 1 + *std::max_element(element_level.begin(), element_level.end());
+    std::vector<std::vector<int>> level_elements(nLev);
+    for (int e = 0; e < nCells; ++e) {
+        level_elements[element_level[e]].push_back(e);
+    }
+
+    // Coarser neighbors of each level, through its faces
+    coarse_halo.resize(nLev);
+    coarse_halo_elements.resize(nLev);
+    for (auto const &F : dofm.interior_faces) {
+        if (F.left < 0 || F.right < 0) {
+            continue;
+        }
+        const int a = element_level[F.left];
+        const int b = element_level[F.right];
+        if (a + 1 == b) {
+            coarse_halo_elements[a].push_back(F.right);
+        } else if (b + 1 == a) {
+            coarse_halo_elements[b].push_back(F.left);
+        }
+    }
+    std::vector<int> element_dofs;
+    for (int l = 0; l < nLev; ++l) {
+        auto &elements = coarse_halo_elements[l];
+        std::sort(elements.begin(), elements.end());
+        elements.erase(std::unique(elements.begin(), elements.end()), elements.end());
+        for (int e : elements) {
+            dofm.getGlobalDofs(e, element_dofs);
+            coarse_halo[l].insert(coarse_halo[l].end(), element_dofs.begin(), element_dofs.end());
+        }
+    }
+
+    // Level l writes the coarse side of its faces with level l+1 to the flux register,
+    // and leaves its faces with level l-1 to that level
+    for (int l = 0; l < nLev; ++l) {
+        levels.emplace_back(dofm, level_elements[l], coarse_halo_elements[l],
+                            l > 0 ? level_elements[l - 1] : std::vector<int>());
+    }
+
+    level_start.assign(nLev, 0.0);
+    dt = dt0 * (1 << (nLev - 1));
+}
+
+YAFEL_NAMESPACE_CLOSE
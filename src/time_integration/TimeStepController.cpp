@@ -0,0 +1,48 @@
+#include "time_integration/TimeStepController.hpp"
+
+#include <stdexcept>
+
+YAFEL_NAMESPACE_OPEN
+
+TimeStepController::TimeStepController(FESystem &feSystem, int nsd, double cfl, int interval)
+        : lengths(yafel::elementLengths(feSystem, nsd)), cfl(cfl), interval(interval)
+{
+    if (!(cfl > 0) || interval < 1) {
+        throw std::runtime_error("TimeStepController: need a positive CFL number and update interval");
+    }
+}
+
+
+void TimeStepController::setStepFactors(double new_safety, double new_min_factor, double new_max_factor)
+{
+    if (!(new_safety > 0 && new_safety <= 1 && new_min_factor > 0 && new_min_factor < 1 && new_max_factor > 1)) {
+        throw std::runtime_error("TimeStepController: need 0 < safety <= 1, 0 < min_factor < 1 < max_factor");
+    }
+    safety = new_safety;
+    min_factor = new_min_factor;
+    max_factor = new_max_factor;
+}
+
+
+double TimeStepController::clip(double h, double t, double t_end)
+{
+    const double remaining = t_end - t;
+    if (!(remaining > 0)) {
+        throw std::runtime_error("TimeStepController: already at the end time");
+    }
+    if (remaining <= h * (1 + 1e-12)) {
+        return remaining;
+    }
+    // Two equal steps rather than a full one and a sliver
+    return remaining < 2 * h ? remaining / 2 : h;
+}
+
+
+void TimeStepController::land(FESystem &feSystem, double t0, double h, double t_end)
+{
+    if (h == t_end - t0) {
+        feSystem.currentTime() = t_end;
+    }
+}
+
+YAFEL_NAMESPACE_CLOSE
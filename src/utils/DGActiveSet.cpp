@@ -0,0 +1,61 @@
+#include "utils/DGActiveSet.hpp"
+#include "utils/DoFManager.hpp"
+#include "utils/FaceColoring.hpp"
+#include "utils/Range.hpp"
+
+#include <algorithm>
+#include <utility>
+
+YAFEL_NAMESPACE_OPEN
+
+DGActiveSet::DGActiveSet(const DoFManager &dofm, std::vector<int> elements, const std::vector<int> &registered,
+                         const std::vector<int> &skipped)
+        : active_elements(std::move(elements))
+{
+    std::sort(active_elements.begin(), active_elements.end());
+    active_elements.erase(std::unique(active_elements.begin(), active_elements.end()), active_elements.end());
+
+    // Role of every element: 0 outside the set, 1 active, 2 registered, 3 skipped
+    std::vector<char> role(dofm.nCells(), 0);
+    std::vector<int> element_dofs;
+    for (int e : active_elements) {
+        role[e] = 1;
+        dofm.getGlobalDofs(e, element_dofs);
+        active_dofs.insert(active_dofs.end(), element_dofs.begin(), element_dofs.end());
+    }
+    for (int e : registered) {
+        if (role[e] == 0) {
+            role[e] = 2;
+            dofm.getGlobalDofs(e, element_dofs);
+            register_dofs.insert(register_dofs.end(), element_dofs.begin(), element_dofs.end());
+        }
+    }
+    for (int e : skipped) {
+        if (role[e] == 0) {
+            role[e] = 3;
+        }
+    }
+
+    // Faces with an active side and no skipped one, color by color
+    auto const &coloring = dofm.getFaceColoring();
+    color_offsets.assign(coloring.nColors() + 1, 0);
+    for (auto c : IRange(0, coloring.nColors())) {
+        for (int i = 0; i < coloring.nFaces(c); ++i) {
+            int f = coloring.faces(c)[i];
+            auto const &F = dofm.interior_faces[f];
+            int left = F.left >= 0 ? F.left : F.right;
+            int right = F.left >= 0 ? F.right : -1;
+
+            const char role_left = role[left];
+            const char role_right = right >= 0 ? role[right] : 0;
+            if ((role_left != 1 && role_right != 1) || role_left == 3 || role_right == 3) {
+                continue;
+            }
+            color_faces.push_back(f);
+            face_sides.push_back((role_left != 0 ? 1 : 0) | (role_right != 0 ? 2 : 0));
+        }
+        color_offsets[c + 1] = static_cast<int>(color_faces.size());
+    }
+}
+
+YAFEL_NAMESPACE_CLOSE
@@ -36,6 +36,18 @@ DoFManager::DoFManager(const Mesh &M,
 }
 
 
+ElementColoring const &DoFManager::getElementColoring(int topoDim) const
+{
+    return element_colorings.get(topoDim, [&]() { return std::make_unique<ElementColoring>(*this, topoDim); });
+}
+
+
+FaceColoring const &DoFManager::getFaceColoring() const
+{
+    return face_coloring.get(0, [&]() { return std::make_unique<FaceColoring>(*this); });
+}
+
+
 void DoFManager::getGlobalDofs(int elnum, std::vector<int> &container) const
 {
     int n_dofs = dof_per_node * (element_offsets[elnum + 1] - element_offsets[elnum]);
@@ -89,6 +101,36 @@ void DoFManager::getGlobalFaceDofs(int fnum, std::vector<int> &container) const
     }
 }
 
+void DoFManager::getFaceTraces(int fnum, std::vector<int> &left, std::vector<int> &right) const
+{
+    auto const &F = interior_faces[fnum];
+    const bool boundary = (F.left < 0 || F.right < 0);
+    const int e_left = F.left >= 0 ? F.left : F.right;
+
+    std::vector<int> local_nodes, nodes;
+    if (F.left >= 0) {
+        getLeftFaceNodes(fnum, local_nodes);
+    } else {
+        getRightFaceNodes(fnum, local_nodes);
+    }
+    getGlobalNodes(e_left, nodes);
+    left.clear();
+    for (auto n : local_nodes) {
+        left.push_back(nodes[n]);
+    }
+
+    if (boundary) {
+        right = left;
+    } else {
+        getRightFaceNodes(fnum, local_nodes);
+        getGlobalNodes(F.right, nodes);
+        right.clear();
+        for (auto n : local_nodes) {
+            right.push_back(nodes[n]);
+        }
+    }
+}
+
 void DoFManager::getLocalFaceNodes(
         int fnum,
         std::vector<int> &container,
@@ -157,6 +199,15 @@ void DoFManager::make_cg_dofs(const Mesh &M)
         this->element_types.resize(M.nCells());
         for(int i=0; i<M.nCells(); ++i) {
             element_types[i] = CellType_to_ElementType(M.getCellType(i), polyOrder);
+
+            // Mesh cells list the corners of quads and hexes counter-clockwise, while the
+            // tensor product elements number their nodes lexicographically
+            auto ct = M.getCellType(i);
+            if (ct == CellType::Quad4 || ct == CellType::Hex8) {
+                for (int c = element_offsets[i]; c < element_offsets[i + 1]; c += 4) {
+                    std::swap(elements[c + 2], elements[c + 3]);
+                }
+            }
         }
     } else {
         throw std::runtime_error("DoFManager: Invalid polynomial order");
@@ -0,0 +1,90 @@
+#include "utils/ElementColoring.hpp"
+#include "utils/DoFManager.hpp"
+#include "utils/Range.hpp"
+
+YAFEL_NAMESPACE_OPEN
+
+ElementColoring::ElementColoring(const DoFManager &dofm, int topoDim)
+        : topo_dim(topoDim)
+{
+    const int nCells = dofm.nCells();
+    const int nNodes = dofm.nNodes();
+
+    auto included = [&dofm, topoDim](int elnum) {
+        return dofm.element_types[elnum].topoDim == topoDim;
+    };
+
+    // Build node -> element adjacency in compressed format
+    std::vector<int> node_element_offsets(nNodes + 1, 0);
+    for (auto e : IRange(0, nCells)) {
+        if (!included(e)) {
+            continue;
+        }
+        for (auto idx : IRange(dofm.element_offsets[e], dofm.element_offsets[e + 1])) {
+            ++node_element_offsets[dofm.elements[idx] + 1];
+        }
+    }
+    for (auto n : IRange(0, nNodes)) {
+        node_element_offsets[n + 1] += node_element_offsets[n];
+    }
+
+    std::vector<int> node_elements(node_element_offsets[nNodes]);
+    {
+        std::vector<int> fill(node_element_offsets.begin(), node_element_offsets.end() - 1);
+        for (auto e : IRange(0, nCells)) {
+            if (!included(e)) {
+                continue;
+            }
+            for (auto idx : IRange(dofm.element_offsets[e], dofm.element_offsets[e + 1])) {
+                node_elements[fill[dofm.elements[idx]]++] = e;
+            }
+        }
+    }
+
+    // Greedy coloring. color_used[c] == e marks color c as taken by a neighbor of e.
+    std::vector<int> element_color(nCells, -1);
+    std::vector<int> color_used;
+    std::vector<int> color_counts;
+    for (auto e : IRange(0, nCells)) {
+        if (!included(e)) {
+            continue;
+        }
+        for (auto idx : IRange(dofm.element_offsets[e], dofm.element_offsets[e + 1])) {
+            int n = dofm.elements[idx];
+            for (auto nidx : IRange(node_element_offsets[n], node_element_offsets[n + 1])) {
+                int c = element_color[node_elements[nidx]];
+                if (c >= 0) {
+                    color_used[c] = e;
+                }
+            }
+        }
+
+        int color{0};
+        while (color < static_cast<int>(color_used.size()) && color_used[color] == e) {
+            ++color;
+        }
+        if (color == static_cast<int>(color_used.size())) {
+            color_used.push_back(-1);
+            color_counts.push_back(0);
+        }
+        element_color[e] = color;
+        ++color_counts[color];
+    }
+
+    // Bucket elements by color, preserving element order within each color
+    const int nColors = static_cast<int>(color_counts.size());
+    color_offsets.assign(nColors + 1, 0);
+    for (auto c : IRange(0, nColors)) {
+        color_offsets[c + 1] = color_offsets[c] + color_counts[c];
+    }
+
+    color_elements.resize(color_offsets[nColors]);
+    std::vector<int> fill(color_offsets.begin(), color_offsets.end() - 1);
+    for (auto e : IRange(0, nCells)) {
+        if (element_color[e] >= 0) {
+            color_elements[fill[element_color[e]]++] = e;
+        }
+    }
+}
+
+YAFEL_NAMESPACE_CLOSE
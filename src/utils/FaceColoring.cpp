@@ -0,0 +1,58 @@
+#include "utils/FaceColoring.hpp"
+#include "utils/DoFManager.hpp"
+#include "utils/Range.hpp"
+
+YAFEL_NAMESPACE_OPEN
+
+FaceColoring::FaceColoring(const DoFManager &dofm)
+{
+    const int nFaces = static_cast<int>(dofm.interior_faces.size());
+
+    // Greedy coloring. element_colors[e] lists the colors already given to faces of e;
+    // color_used[c] == f marks color c as taken by a face sharing an element with f.
+    std::vector<std::vector<int>> element_colors(dofm.nCells());
+    std::vector<int> face_color(nFaces, -1);
+    std::vector<int> color_used;
+    std::vector<int> color_counts;
+    for (auto f : IRange(0, nFaces)) {
+        auto const &F = dofm.interior_faces[f];
+        for (int e : {F.left, F.right}) {
+            if (e >= 0) {
+                for (int c : element_colors[e]) {
+                    color_used[c] = f;
+                }
+            }
+        }
+
+        int color{0};
+        while (color < static_cast<int>(color_used.size()) && color_used[color] == f) {
+            ++color;
+        }
+        if (color == static_cast<int>(color_used.size())) {
+            color_used.push_back(-1);
+            color_counts.push_back(0);
+        }
+        face_color[f] = color;
+        ++color_counts[color];
+        for (int e : {F.left, F.right}) {
+            if (e >= 0) {
+                element_colors[e].push_back(color);
+            }
+        }
+    }
+
+    // Bucket faces by color, preserving face order within each color
+    const int nColors = static_cast<int>(color_counts.size());
+    color_offsets.assign(nColors + 1, 0);
+    for (auto c : IRange(0, nColors)) {
+        color_offsets[c + 1] = color_offsets[c] + color_counts[c];
+    }
+
+    color_faces.resize(color_offsets[nColors]);
+    std::vector<int> fill(color_offsets.begin(), color_offsets.end() - 1);
+    for (auto f : IRange(0, nFaces)) {
+        color_faces[fill[face_color[f]]++] = f;
+    }
+}
+
+YAFEL_NAMESPACE_CLOSE
@@ -0,0 +1,228 @@
+#include "yafel_globals.hpp"
+#include "assembly/CGAssembly.hpp"
+#include "boundary_conditions/DirichletBC.hpp"
+#include "lin_alg/linear_solvers/solvers/AMGPreconditioner.hpp"
+#include "lin_alg/linear_solvers/solvers/EigenConjugateGradient.hpp"
+#include "test_meshes.hpp"
+
+#include <Eigen/Core>
+#include <Eigen/Sparse>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+using namespace yafel;
+
+/*
+ * Smoothed aggregation AMG as the preconditioner of CG: the solutions must match a
+ * direct solve, and the iteration counts must stay nearly flat under mesh refinement
+ * (for Poisson, and for elasticity with the rigid body modes), while plain Jacobi CG
+ * keeps growing.
+ */
+
+template<int NSD>
+struct Poisson
+{
+    static constexpr int nsd() { return NSD; }
+
+    template<typename ElementT, typename PointT, typename VectorT, typename MatrixT>
+    static void LocalTangent(const ElementT &E, int, PointT &, double, VectorT &, MatrixT &K_el)
+    {
+        K_el += E.shapeGrad * E.shapeGrad.transpose() * E.jxw;
+    }
+
+    template<typename ElementT, typename PointT, typename VectorT>
+    static void LocalResidual(const ElementT &, int, PointT &, double, VectorT &, VectorT &)
+    {}
+};
+
+// Plane strain, local dofs node-major
+struct Elasticity
+{
+    static constexpr int nsd() { return 2; }
+
+    static constexpr double lambda = 1.0;
+    static constexpr double mu = 0.5;
+
+    template<typename ElementT, typename PointT, typename VectorT, typename MatrixT>
+    static void LocalTangent(const ElementT &E, int, PointT &, double, VectorT &, MatrixT &K_el)
+    {
+        const int n = static_cast<int>(E.shapeGrad.rows());
+        for (int a = 0; a < n; ++a) {
+            for (int b = 0; b < n; ++b) {
+                const double GaGb = E.shapeGrad.row(a).dot(E.shapeGrad.row(b));
+                for (int i = 0; i < 2; ++i) {
+                    for (int k = 0; k < 2; ++k) {
+                        K_el(2 * a + i, 2 * b + k) += (lambda * E.shapeGrad(a, i) * E.shapeGrad(b, k)
+                                                       + mu * E.shapeGrad(a, k) * E.shapeGrad(b, i)
+                                                       + (i == k ? mu * GaGb : 0.0)) * E.jxw;
+                    }
+                }
+            }
+        }
+    }
+
+    template<typename ElementT, typename PointT, typename VectorT>
+    static void LocalResidual(const ElementT &, int, PointT &, double, VectorT &, VectorT &)
+    {}
+};
+
+
+struct Problem
+{
+    Eigen::SparseMatrix<double> K;
+    Eigen::VectorXd rhs;
+    Eigen::VectorXd reference;
+};
+
+// -laplace(u) = 1 on the unit square, u = 0 on the boundary
+Problem poisson_problem(DoFManager &dofm)
+{
+    FESystem feSystem(dofm, 2);
+    CGAssembly<Poisson<2>>(feSystem, {AssemblyRequirement::Tangent});
+    Problem P{feSystem.getGlobalTangent(), Eigen::VectorXd::Constant(dofm.nNodes(), 1.0 / dofm.nNodes()), {}};
+    DirichletBC bc(dofm, 0.0);
+    bc.selectByFunction([](auto x) {
+        return x(0) < 1.0e-12 || x(0) > 1 - 1.0e-12 || x(1) < 1.0e-12 || x(1) > 1 - 1.0e-12;
+    });
+    bc.apply(P.K, P.rhs);
+    P.reference = Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>>(P.K).solve(P.rhs);
+    return P;
+}
+
+// Cantilever clamped at x = 0, with a uniform downward load
+Problem elasticity_problem(DoFManager &dofm)
+{
+    FESystem feSystem(dofm, 2);
+    CGAssembly<Elasticity>(feSystem, {AssemblyRequirement::Tangent});
+    const int n = 2 * static_cast<int>(dofm.dof_nodes.size());
+    Problem P{feSystem.getGlobalTangent(), Eigen::VectorXd::Zero(n), {}};
+    for (int i = 1; i < n; i += 2) {
+        P.rhs(i) = -2.0 / n;
+    }
+    auto clamped = [](auto x) { return x(0) < 1.0e-12; };
+    DirichletBC bc_x(dofm, 0.0, 0), bc_y(dofm, 0.0, 1);
+    bc_x.selectByFunction(clamped);
+    bc_y.selectByFunction(clamped);
+    bc_x.apply(P.K, P.rhs);
+    bc_y.apply(P.K, P.rhs);
+    P.reference = Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>>(P.K).solve(P.rhs);
+    return P;
+}
+
+// Small coarsest level, so that the small meshes also get a hierarchy
+LinearSolve::AMGOptions small_coarse_options()
+{
+    LinearSolve::AMGOptions options;
+    options.coarse_size = 50;
+    return options;
+}
+
+bool matches(const Eigen::VectorXd &u, const Problem &P)
+{
+    return (u - P.reference).norm() < 1.0e-8 * P.reference.norm();
+}
+
+
+// Poisson on distorted quads: flat AMG iteration counts, growing Jacobi ones
+bool test_1()
+{
+    bool good = true;
+    std::vector<int> amg_its, jacobi_its;
+    for (int n : {16, 32, 64}) {
+        DoFManager dofm(test_meshes::quadMesh(n, 1.0, 0.2), DoFManager::ManagerType::CG, 1, 1);
+        auto P = poisson_problem(dofm);
+
+        LinearSolve::AMGConjugateGradientTag amg;
+        amg.amg.setOptions(small_coarse_options());
+        Eigen::VectorXd u = Eigen::VectorXd::Zero(P.rhs.rows());
+        LinearSolve::detail::solve_impl(u, P.K, P.rhs, amg);
+        good = good && matches(u, P) && amg.amg.nLevels() >= 2 && amg.amg.operatorComplexity() < 2;
+        amg_its.push_back(amg.iterations);
+
+        Eigen::ConjugateGradient<Eigen::SparseMatrix<double>, Eigen::Lower | Eigen::Upper> cg;
+        cg.setTolerance(1.0e-12);
+        cg.compute(P.K);
+        u = cg.solve(P.rhs);
+        jacobi_its.push_back(static_cast<int>(cg.iterations()));
+    }
+    return good && amg_its.back() <= amg_its.front() + 5 && amg_its.back() < 30
+           && jacobi_its.back() > 3 * amg_its.back();
+}
+
+
+// Elasticity with the rigid body modes as near-nullspace
+bool test_2()
+{
+    bool good = true;
+    std::vector<int> its;
+    for (int n : {8, 16, 32}) {
+        DoFManager dofm(test_meshes::quadMesh(n, 1.0, 0.2), DoFManager::ManagerType::CG, 1, 2);
+        auto P = elasticity_problem(dofm);
+
+        LinearSolve::AMGConjugateGradientTag amg;
+        amg.amg.setOptions(small_coarse_options());
+        amg.amg.setNearNullspace(LinearSolve::AMGPreconditioner::rigidBodyModes(dofm.dof_nodes, 2), 2);
+        Eigen::VectorXd u = Eigen::VectorXd::Zero(P.rhs.rows());
+        LinearSolve::detail::solve_impl(u, P.K, P.rhs, amg);
+        good = good && matches(u, P) && amg.amg.nLevels() >= 2;
+        its.push_back(amg.iterations);
+    }
+    return good && its.back() <= its.front() + 10 && its.back() < 50;
+}
+
+
+// With Reuse::Hierarchy the tag keeps the hierarchy between solves, and compute()
+// rebuilds it for new values; by default every solve rebuilds it
+bool test_3()
+{
+    DoFManager dofm(test_meshes::quadMesh(24, 1.2, 0.1), DoFManager::ManagerType::CG, 2, 1);
+    auto P = poisson_problem(dofm);
+
+    LinearSolve::AMGConjugateGradientTag tag;
+    tag.reuse = LinearSolve::AMGConjugateGradientTag::Reuse::Hierarchy;
+    Eigen::VectorXd u1 = Eigen::VectorXd::Zero(P.rhs.rows());
+    LinearSolve::detail::solve_impl(u1, P.K, P.rhs, tag);
+    const auto *hierarchy = &tag.amg.levelMatrix(tag.amg.nLevels() - 1);
+    const int its = tag.iterations;
+
+    Eigen::VectorXd u2 = Eigen::VectorXd::Zero(P.rhs.rows());
+    LinearSolve::detail::solve_impl(u2, P.K, P.rhs, tag);
+    bool good = matches(u1, P) && u1 == u2 && tag.iterations == its
+                && hierarchy == &tag.amg.levelMatrix(tag.amg.nLevels() - 1);
+
+    // Twice the matrix, half the solution
+    Eigen::SparseMatrix<double> K2 = 2.0 * P.K;
+    tag.amg.compute(K2);
+    Eigen::VectorXd u3 = Eigen::VectorXd::Zero(P.rhs.rows());
+    LinearSolve::detail::solve_impl(u3, K2, P.rhs, tag);
+    good = good && (2.0 * u3 - P.reference).norm() < 1.0e-8 * P.reference.norm();
+
+    // The coarsest operator of K2 is twice that of K
+    LinearSolve::AMGConjugateGradientTag rebuilt;
+    LinearSolve::detail::solve_impl(u1, P.K, P.rhs, rebuilt);
+    const double coarse_norm = rebuilt.amg.levelMatrix(rebuilt.amg.nLevels() - 1).norm();
+    LinearSolve::detail::solve_impl(u3, K2, P.rhs, rebuilt);
+    return good && std::abs(rebuilt.amg.levelMatrix(rebuilt.amg.nLevels() - 1).norm() - 2 * coarse_norm)
+                   < 1.0e-12 * coarse_norm;
+}
+
+
+int main()
+{
+    int retval = 0;
+    if (!test_1()) {
+        std::cerr << "Failed test_1()" << std::endl;
+        retval |= 1 << 0;
+    }
+    if (!test_2()) {
+        std::cerr << "Failed test_2()" << std::endl;
+        retval |= 1 << 1;
+    }
+    if (!test_3()) {
+        std::cerr << "Failed test_3()" << std::endl;
+        retval |= 1 << 2;
+    }
+
+    return retval;
+}
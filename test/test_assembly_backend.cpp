@@ -0,0 +1,148 @@
+#include "yafel_globals.hpp"
+#include "assembly/CGAssembly.hpp"
+#include "utils/parallel/TaskScheduler.hpp"
+#include "utils/parallel/wait_all.hpp"
+#include "test_meshes.hpp"
+
+#include <Eigen/Core>
+#include <Eigen/Sparse>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <numeric>
+#include <thread>
+
+using namespace yafel;
+
+/*
+ * CGAssembly on the TaskScheduler backend must give the same tangent and residual as
+ * the OpenMP backend, also while other tasks occupy the global scheduler, and both
+ * must report per-worker load statistics that account for every element.
+ */
+
+template<int NSD>
+struct Diffusion
+{
+    static constexpr int nsd() { return NSD; }
+
+    template<typename ElementT, typename PointT, typename VectorT>
+    static void LocalResidual(const ElementT &E, int qpi, PointT &x, double, VectorT &u_el, VectorT &R_el)
+    {
+        double u = E.shapeValues[qpi].dot(u_el);
+        R_el += (x(0) + u * u) * E.shapeValues[qpi] * E.jxw;
+    }
+
+    template<typename ElementT, typename PointT, typename VectorT, typename MatrixT>
+    static void LocalTangent(const ElementT &E, int qpi, PointT &, double, VectorT &u_el, MatrixT &K_el)
+    {
+        double u = E.shapeValues[qpi].dot(u_el);
+        K_el += (1 + u * u) * E.shapeGrad * E.shapeGrad.transpose() * E.jxw;
+    }
+};
+
+// Number of elements of dimension topoDim
+int n_elements(const DoFManager &dofm, int topoDim)
+{
+    int n{0};
+    for (int e = 0; e < dofm.nCells(); ++e) {
+        n += (dofm.element_types[e].topoDim == topoDim);
+    }
+    return n;
+}
+
+// Statistics describe one worker per thread, and every element exactly once
+bool statistics_valid(const AssemblyStatistics &stats, AssemblyBackend backend, int nElements)
+{
+    int counted = std::accumulate(stats.elements.begin(), stats.elements.end(), 0);
+    return stats.backend == backend
+           && stats.nWorkers() > 0
+           && static_cast<int>(stats.elements.size()) == stats.nWorkers()
+           && static_cast<int>(stats.chunks.size()) == stats.nWorkers()
+           && counted == nElements
+           && stats.imbalance() >= 1 - 1.0e-12
+           && stats.wall_seconds > 0;
+}
+
+// OpenMP and TaskScheduler assemblies agree, for a given task chunk size
+template<typename Physics>
+bool backends_match(const Mesh &M, int polyOrder, int chunkSize)
+{
+    DoFManager dofm(M, DoFManager::ManagerType::CG, polyOrder, 1);
+    FESystem ompSystem(dofm, Physics::nsd());
+    FESystem taskSystem(dofm, Physics::nsd());
+    taskSystem.setAssemblyBackend(AssemblyBackend::TaskScheduler, chunkSize);
+    Eigen::VectorXd U = Eigen::VectorXd::Random(ompSystem.getSolution().rows());
+    ompSystem.getSolution() = U;
+    taskSystem.getSolution() = U;
+
+    bool good = true;
+    for (int repeat = 0; repeat < 2; ++repeat) {
+        CGAssembly<Physics>(ompSystem);
+        CGAssembly<Physics>(taskSystem);
+
+        Eigen::SparseMatrix<double> dK = taskSystem.getGlobalTangent() - ompSystem.getGlobalTangent();
+        Eigen::VectorXd dR = taskSystem.getGlobalResidual() - ompSystem.getGlobalResidual();
+        good = good && dK.norm() <= 1.0e-12 * ompSystem.getGlobalTangent().norm()
+               && dR.norm() <= 1.0e-12 * ompSystem.getGlobalResidual().norm();
+
+        ompSystem.getGlobalResidual().setZero();
+        taskSystem.getGlobalResidual().setZero();
+    }
+
+    int nElements = n_elements(dofm, Physics::nsd());
+    return good
+           && statistics_valid(ompSystem.getAssemblyStatistics(), AssemblyBackend::OpenMP, nElements)
+           && statistics_valid(taskSystem.getAssemblyStatistics(), AssemblyBackend::TaskScheduler, nElements)
+           && taskSystem.getAssemblyStatistics().nWorkers() == getGlobalScheduler().count + 1;
+}
+
+
+// Quads, mixed quads/triangles and hexes; automatic and fixed chunk sizes
+bool test_1()
+{
+    return backends_match<Diffusion<2>>(test_meshes::quadMesh(8, 1.2, 0.2), 2, 0)
+           && backends_match<Diffusion<2>>(test_meshes::quadMesh(8, 1.2, 0.2), 3, 5)
+           && backends_match<Diffusion<2>>(test_meshes::mixedMesh(10), 1, 0)
+           && backends_match<Diffusion<2>>(test_meshes::mixedMesh(10), 2, 3)
+           && backends_match<Diffusion<3>>(test_meshes::hexMesh(4, 1.3), 1, 0);
+}
+
+
+// The task backend shares the global scheduler with other running tasks
+bool test_2()
+{
+    auto &scheduler = getGlobalScheduler();
+    std::atomic<bool> stop{false};
+    std::vector<std::future<void>> background;
+    for (int i = 0; i < scheduler.count / 2 + 1; ++i) {
+        auto [task, fut] = scheduler.createTask([&stop]() {
+            while (!stop) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        });
+        scheduler.enqueue(task);
+        background.push_back(std::move(fut));
+    }
+
+    bool good = backends_match<Diffusion<2>>(test_meshes::mixedMesh(12), 2, 0);
+
+    stop = true;
+    wait_all(background);
+    return good;
+}
+
+
+int main()
+{
+    int retval = 0;
+    if (!test_1()) {
+        std::cerr << "Failed test_1()" << std::endl;
+        retval |= 1 << 0;
+    }
+    if (!test_2()) {
+        std::cerr << "Failed test_2()" << std::endl;
+        retval |= 1 << 1;
+    }
+
+    return retval;
+}
@@ -0,0 +1,244 @@
+#include "yafel_globals.hpp"
+#include "assembly/CGAssembly.hpp"
+#include "assembly/DGAssembly.hpp"
+#include "test_meshes.hpp"
+
+#include <Eigen/Core>
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+#include <iostream>
+
+using namespace yafel;
+
+/*
+ * CGAssembly and DGAssembly with a compile-time AssemblyRequirementSet give the same
+ * result as with the equivalent runtime requirements, and only produce the outputs
+ * in the set, on the dynamic (p = 3), fixed-size (p = 2) and batched (p = 1) paths.
+ */
+
+static_assert(AssemblyRequirements<AssemblyRequirement::Residual, AssemblyRequirement::Tangent>::residual()
+              && AssemblyRequirements<AssemblyRequirement::Residual, AssemblyRequirement::Tangent>::tangent()
+              && !AssemblyRequirements<AssemblyRequirement::Residual>::matrix()
+              && AssemblyRequirements<AssemblyRequirement::LumpedDtMassInverse>::dtMass()
+              && AssemblyRequirements<AssemblyRequirement::DtDtMass>::matrix()
+              && AssemblyRequirements<>::mask() == 0,
+              "AssemblyRequirementSet");
+
+// Nonlinear diffusion with a source, with batch kernels for p = 1
+template<int NSD>
+struct Diffusion
+{
+    static constexpr int nsd() { return NSD; }
+
+    static constexpr int batchWidth() { return 4; }
+
+    template<typename ElementT, typename PointT, typename VectorT>
+    static void LocalResidual(const ElementT &E, int qpi, PointT &x, double, VectorT &u_el, VectorT &R_el)
+    {
+        double u = E.shapeValues[qpi].dot(u_el);
+        R_el += (x(0) + u * u) * E.shapeValues[qpi] * E.jxw;
+    }
+
+    template<typename ElementT, typename PointT, typename VectorT, typename MatrixT>
+    static void LocalTangent(const ElementT &E, int qpi, PointT &, double, VectorT &u_el, MatrixT &K_el)
+    {
+        double u = E.shapeValues[qpi].dot(u_el);
+        K_el += (1 + u * u) * E.shapeGrad * E.shapeGrad.transpose() * E.jxw;
+    }
+
+    template<typename B>
+    static typename B::Lanes interpolate(const B &batch, int qpi, const typename B::LocalVector &u_el)
+    {
+        typename B::Lanes u = B::Lanes::Zero();
+        for (int A = 0; A < B::n_nodes; ++A) {
+            u += batch.shapeValue(qpi, A) * u_el[A];
+        }
+        return u;
+    }
+
+    template<typename B>
+    static void LocalResidualBatch(const B &batch, int qpi, const typename B::Point &x, double,
+                                   const typename B::LocalVector &u_el, typename B::LocalVector &R_el)
+    {
+        typename B::Lanes u = interpolate(batch, qpi, u_el);
+        typename B::Lanes s = (x[0] + u * u) * batch.jxw;
+        for (int A = 0; A < B::n_nodes; ++A) {
+            R_el[A] += batch.shapeValue(qpi, A) * s;
+        }
+    }
+
+    template<typename B>
+    static void LocalTangentBatch(const B &batch, int qpi, const typename B::Point &, double,
+                                  const typename B::LocalVector &u_el, typename B::LocalMatrix &K_el)
+    {
+        typename B::Lanes c = (1 + interpolate(batch, qpi, u_el).square()) * batch.jxw;
+        for (int A = 0; A < B::n_nodes; ++A) {
+            for (int Bn = 0; Bn < B::n_nodes; ++Bn) {
+                typename B::Lanes g = batch.grad(A, 0) * batch.grad(Bn, 0);
+                for (int d = 1; d < NSD; ++d) {
+                    g += batch.grad(A, d) * batch.grad(Bn, d);
+                }
+                K_el[A * B::n_nodes + Bn] += g * c;
+            }
+        }
+    }
+};
+
+// Constant-velocity advection for DGAssembly
+struct Advection
+{
+    InverseMassOperator inverse_mass;
+
+    static constexpr int nsd() { return 2; }
+
+    static Tensor<2, 1> velocity() { return {1.0, 0.5}; }
+
+    template<typename TU, typename TR>
+    static void LocalResidual(const Element &E, int qpi, coordinate<> &, double,
+                              Eigen::MatrixBase<TU> &U_el, Eigen::MatrixBase<TR> &R_el)
+    {
+        double U = E.shapeValues[qpi].dot(U_el);
+        for (int i = 0; i < R_el.rows(); ++i) {
+            auto gradW = make_TensorMap<2, 1>(&E.shapeGrad(i, 0));
+            R_el(i) += U * dot(gradW, velocity()) * E.jxw;
+        }
+    }
+
+    template<typename T>
+    static void LocalMass(const Element &E, int qpi, double, Eigen::MatrixBase<T> &M_el)
+    {
+        M_el += (E.jxw * E.shapeValues[qpi]) * E.shapeValues[qpi].transpose();
+    }
+
+    static double BoundaryFlux(Tensor<2, 1> n, coordinate<>, double, double U)
+    {
+        return std::max(0.0, dot(n, velocity())) * U;
+    }
+
+    static double Flux(Tensor<2, 1> n, coordinate<>, double, double Uplus, double Uminus)
+    {
+        double vdotn = dot(n, velocity());
+        return 0.5 * (vdotn * (Uplus + Uminus) + std::abs(vdotn) * (Uplus - Uminus));
+    }
+};
+
+
+// CGAssembly with the set Requirements against the runtime list, on a fresh FESystem each
+template<typename Requirements>
+bool cg_matches(int polyOrder, const std::vector<AssemblyRequirement> &requirements)
+{
+    using Physics = Diffusion<2>;
+    DoFManager dofm(test_meshes::quadMesh(5, 1.2, 0.2), DoFManager::ManagerType::CG, polyOrder, 1);
+    FESystem staticSystem(dofm, 2);
+    FESystem runtimeSystem(dofm, 2);
+    Eigen::VectorXd U = Eigen::VectorXd::Random(staticSystem.getSolution().rows());
+    staticSystem.getSolution() = U;
+    runtimeSystem.getSolution() = U;
+
+    CGAssembly<Physics, Requirements>(staticSystem);
+    CGAssembly<Physics>(runtimeSystem, requirements);
+
+    auto const &K = staticSystem.getGlobalTangent();
+    auto const &R = staticSystem.getGlobalResidual();
+    Eigen::SparseMatrix<double> dK = K - runtimeSystem.getGlobalTangent();
+    Eigen::VectorXd dR = R - runtimeSystem.getGlobalResidual();
+
+    // Outputs outside of the set are left alone (the tangent stays empty, the residual zero)
+    bool outputs = (K.nonZeros() > 0) == Requirements::matrix()
+                   && (K.norm() > 0) == Requirements::tangent()
+                   && (R.norm() > 0) == Requirements::residual();
+
+    return outputs && dK.norm() == 0 && dR.norm() == 0;
+}
+
+
+// Residual-only, tangent-only, both, and the mass requirements, on every element path
+bool test_1()
+{
+    using R = AssemblyRequirement;
+    bool good = true;
+    for (int p : {1, 2, 3}) {
+        good = good
+               && cg_matches<AssemblyRequirements<R::Residual>>(p, {R::Residual})
+               && cg_matches<AssemblyRequirements<R::Tangent>>(p, {R::Tangent})
+               && cg_matches<AssemblyRequirements<R::Residual, R::Tangent>>(p, {R::Tangent, R::Residual})
+               && cg_matches<AssemblyRequirements<R::Residual, R::DtMass>>(p, {R::Residual, R::DtDtMass});
+    }
+    return good;
+}
+
+
+// Compile-time sets with CGAssemblyIncremental
+bool test_2()
+{
+    using Physics = Diffusion<2>;
+    using Requirements = AssemblyRequirements<AssemblyRequirement::Residual, AssemblyRequirement::Tangent>;
+    DoFManager dofm(test_meshes::quadMesh(6), DoFManager::ManagerType::CG, 2, 1);
+    FESystem incrementalSystem(dofm, 2);
+    FESystem fullSystem(dofm, 2);
+    incrementalSystem.enableElementCache();
+
+    incrementalSystem.getSolution() = Eigen::VectorXd::Random(fullSystem.getSolution().rows());
+    CGAssembly<Physics, Requirements>(incrementalSystem);
+
+    // Node 0 only belongs to element 0
+    incrementalSystem.getSolution()(0) += 1.0;
+    CGAssemblyIncremental<Physics, Requirements>(incrementalSystem, {0});
+
+    fullSystem.getSolution() = incrementalSystem.getSolution();
+    CGAssembly<Physics>(fullSystem);
+
+    Eigen::SparseMatrix<double> dK = incrementalSystem.getGlobalTangent() - fullSystem.getGlobalTangent();
+    Eigen::VectorXd dR = incrementalSystem.getGlobalResidual() - fullSystem.getGlobalResidual();
+    return dK.norm() <= 1e-12 * fullSystem.getGlobalTangent().norm()
+           && dR.norm() <= 1e-12 * fullSystem.getGlobalResidual().norm();
+}
+
+
+// DGAssembly: compile-time and runtime requirements, with the mass built on the first call only
+bool test_3()
+{
+    using Requirements = AssemblyRequirements<AssemblyRequirement::Residual, AssemblyRequirement::DtMass>;
+    Mesh M = test_meshes::quadMesh(4);
+    M.buildInternalFaces();
+    DoFManager dofm(M, DoFManager::ManagerType::DG, 2, 1);
+
+    FESystem staticSystem(dofm, 2);
+    FESystem runtimeSystem(dofm, 2);
+    Eigen::VectorXd U = Eigen::VectorXd::Random(staticSystem.getSolution().rows());
+    staticSystem.getSolution() = U;
+    runtimeSystem.getSolution() = U;
+
+    Advection staticPhysics;
+    Advection runtimePhysics;
+    bool good = true;
+    for (int step = 0; step < 2; ++step) {
+        DGAssembly<Advection, Requirements>(staticSystem, staticPhysics);
+        DGAssembly(runtimeSystem, runtimePhysics, {AssemblyRequirement::Residual, AssemblyRequirement::DtMass});
+        good = good && staticPhysics.inverse_mass.isBuilt()
+               && staticPhysics.inverse_mass.nScaledElements() == dofm.nCells()
+               && staticSystem.getGlobalResidual().norm() > 0
+               && (staticSystem.getGlobalResidual() - runtimeSystem.getGlobalResidual()).norm() == 0;
+    }
+    return good;
+}
+
+
+int main()
+{
+    int retval = 0;
+    if (!test_1()) {
+        std::cerr << "Failed test_1()" << std::endl;
+        retval |= 1 << 0;
+    }
+    if (!test_2()) {
+        std::cerr << "Failed test_2()" << std::endl;
+        retval |= 1 << 1;
+    }
+    if (!test_3()) {
+        std::cerr << "Failed test_3()" << std::endl;
+        retval |= 1 << 2;
+    }
+
+    return retval;
+}
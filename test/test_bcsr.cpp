@@ -0,0 +1,229 @@
+#include "yafel_globals.hpp"
+#include "assembly/CGAssembly.hpp"
+#include "boundary_conditions/DirichletBC.hpp"
+#include "lin_alg/BCSRMatrix.hpp"
+#include "lin_alg/linear_solvers/solvers/BCSRSolvers.hpp"
+#include "test_meshes.hpp"
+
+#include <Eigen/Core>
+#include <Eigen/Sparse>
+#include <iostream>
+#include <stdexcept>
+
+using namespace yafel;
+
+/*
+ * CGAssembly into a BCSRMatrix must give the same tangent as the scalar assembly into
+ * the FESystem, and the block kernels (products, Dirichlet conditions, the iterative
+ * solver tags) must agree with their Eigen::SparseMatrix counterparts.
+ */
+
+// Plane strain, local dofs node-major
+struct Elasticity
+{
+    static constexpr int nsd() { return 2; }
+
+    static constexpr double lambda = 1.0;
+    static constexpr double mu = 0.5;
+
+    template<typename ElementT, typename PointT, typename VectorT, typename MatrixT>
+    static void LocalTangent(const ElementT &E, int, PointT &, double, VectorT &, MatrixT &K_el)
+    {
+        const int n = static_cast<int>(E.shapeGrad.rows());
+        for (int a = 0; a < n; ++a) {
+            for (int b = 0; b < n; ++b) {
+                const double GaGb = E.shapeGrad.row(a).dot(E.shapeGrad.row(b));
+                for (int i = 0; i < 2; ++i) {
+                    for (int k = 0; k < 2; ++k) {
+                        K_el(2 * a + i, 2 * b + k) += (lambda * E.shapeGrad(a, i) * E.shapeGrad(b, k)
+                                                       + mu * E.shapeGrad(a, k) * E.shapeGrad(b, i)
+                                                       + (i == k ? mu * GaGb : 0.0)) * E.jxw;
+                    }
+                }
+            }
+        }
+    }
+
+    // Uniform downward load
+    template<typename ElementT, typename PointT, typename VectorT>
+    static void LocalResidual(const ElementT &E, int qpi, PointT &, double, VectorT &, VectorT &R_el)
+    {
+        const int n = static_cast<int>(E.shapeValues[qpi].rows());
+        for (int a = 0; a < n; ++a) {
+            R_el(2 * a + 1) -= E.shapeValues[qpi](a) * E.jxw;
+        }
+    }
+};
+
+bool close(const Eigen::SparseMatrix<double> &A, const Eigen::SparseMatrix<double> &B)
+{
+    return (A - B).norm() <= 1.0e-13 * B.norm();
+}
+
+// Scalar and block assemblies of the same FESystem agree, also when repeated
+bool assembly_matches(const Mesh &M, int polyOrder)
+{
+    DoFManager dofm(M, DoFManager::ManagerType::CG, polyOrder, 2);
+    FESystem feSystem(dofm, 2);
+    CGAssembly<Elasticity>(feSystem);
+    Eigen::SparseMatrix<double> K = feSystem.getGlobalTangent();
+    Eigen::VectorXd R = feSystem.getGlobalResidual();
+
+    BCSRMatrix<2> KB;
+    bool good = true;
+    for (int k = 0; k < 2; ++k) {
+        // (the residual is accumulated, as in the scalar assembly)
+        feSystem.getGlobalResidual().setZero();
+        CGAssembly<Elasticity>(feSystem, KB);
+        good = good && close(KB.toSparse(), K) && (feSystem.getGlobalResidual() - R).norm() <= 1.0e-13 * R.norm();
+    }
+
+    auto const &pattern = feSystem.getBlockSparsityPattern(2);
+    good = good && KB.matches(pattern) && KB.nBlockRows() == dofm.nNodes()
+           && KB.nonZeros() == 4 * static_cast<Eigen::Index>(pattern.nBlocks())
+           && KB.nonZeros() == K.nonZeros();
+    return good;
+}
+
+
+// Quads (p = 1, 2) and triangles (p = 2), and a block size that is not dof_per_node
+bool test_1()
+{
+    bool good = assembly_matches(test_meshes::quadMesh(6, 1.2, 0.2), 1)
+                && assembly_matches(test_meshes::quadMesh(4, 1.0, 0.1), 2)
+                && assembly_matches(test_meshes::triMesh(4), 2);
+
+    DoFManager dofm(test_meshes::quadMesh(3, 1.0, 0.0), DoFManager::ManagerType::CG, 1, 2);
+    FESystem feSystem(dofm, 2);
+    BCSRMatrix<3> K3;
+    try {
+        CGAssembly<Elasticity>(feSystem, K3);
+        good = false;
+    } catch (std::runtime_error &) {}
+    return good;
+}
+
+
+// Products, coefficients and the round trip through Eigen::SparseMatrix
+bool test_2()
+{
+    DoFManager dofm(test_meshes::quadMesh(5, 1.1, 0.2), DoFManager::ManagerType::CG, 2, 2);
+    FESystem feSystem(dofm, 2);
+    CGAssembly<Elasticity>(feSystem, {AssemblyRequirement::Tangent});
+    Eigen::SparseMatrix<double> K = feSystem.getGlobalTangent();
+
+    BCSRMatrix<2> KB(K);
+    Eigen::VectorXd x = Eigen::VectorXd::LinSpaced(K.rows(), -1.0, 2.0);
+    Eigen::VectorXd Kx = K * x;
+
+    Eigen::VectorXd y;
+    KB.apply(x, y);
+    Eigen::VectorXd z = Eigen::VectorXd::Ones(K.rows());
+    z += 2.0 * (KB * x);
+
+    bool good = close(KB.toSparse(), K)
+                && (y - Kx).norm() <= 1.0e-13 * Kx.norm()
+                && (z - Eigen::VectorXd::Ones(K.rows()) - 2.0 * Kx).norm() <= 1.0e-13 * Kx.norm()
+                && (KB.diagonal() - K.diagonal()).norm() <= 1.0e-13 * K.diagonal().norm();
+    for (int k = 0; k < K.outerSize(); ++k) {
+        for (Eigen::SparseMatrix<double>::InnerIterator it(K, k); it; ++it) {
+            good = good && KB.coeff(it.row(), it.col()) == it.value();
+        }
+    }
+    return good;
+}
+
+
+// Cantilever clamped at x = 0, with a prescribed vertical displacement at x = 1
+struct Problem
+{
+    Eigen::SparseMatrix<double> K;
+    BCSRMatrix<2> KB;
+    Eigen::VectorXd rhs;
+    Eigen::VectorXd rhsB;
+};
+
+Problem cantilever(DoFManager &dofm)
+{
+    FESystem feSystem(dofm, 2);
+    Problem P;
+    CGAssembly<Elasticity>(feSystem, P.KB, {AssemblyRequirement::Tangent});
+    CGAssembly<Elasticity>(feSystem);
+    P.K = feSystem.getGlobalTangent();
+    P.rhs = feSystem.getGlobalResidual();
+    P.rhsB = P.rhs;
+
+    auto clamped = [](auto x) { return x(0) < 1.0e-12; };
+    auto loaded = [](auto x) { return x(0) > 1 - 1.0e-12; };
+    DirichletBC bc_x(dofm, 0.0, 0), bc_y(dofm, 0.0, 1), bc_tip(dofm, -0.1, 1);
+    bc_x.selectByFunction(clamped);
+    bc_y.selectByFunction(clamped);
+    bc_tip.selectByFunction(loaded);
+    for (auto bc : {&bc_x, &bc_y, &bc_tip}) {
+        bc->apply(P.K, P.rhs);
+        bc->apply(P.KB, P.rhsB);
+    }
+    return P;
+}
+
+
+// Dirichlet conditions on the blocks match those on the scalar matrix
+bool test_3()
+{
+    DoFManager dofm(test_meshes::quadMesh(6, 1.2, 0.2), DoFManager::ManagerType::CG, 1, 2);
+    auto P = cantilever(dofm);
+    return close(P.KB.toSparse(), P.K) && (P.rhsB - P.rhs).norm() <= 1.0e-13 * P.rhs.norm();
+}
+
+
+// The iterative solver tags on the BCSR matrix match a direct solve of the scalar one
+bool test_4()
+{
+    DoFManager dofm(test_meshes::quadMesh(8, 1.0, 0.2), DoFManager::ManagerType::CG, 1, 2);
+    auto P = cantilever(dofm);
+    Eigen::VectorXd reference = Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>>(P.K).solve(P.rhs);
+    auto matches = [&reference](const Eigen::VectorXd &u) {
+        return (u - reference).norm() < 1.0e-8 * reference.norm();
+    };
+
+    bool good = true;
+    Eigen::VectorXd u = Eigen::VectorXd::Zero(P.rhs.rows());
+    LinearSolve::detail::solve_impl(u, P.KB, P.rhsB, LinearSolve::EigenConjugateGradientTag());
+    good = good && matches(u);
+
+    u.setZero();
+    LinearSolve::EigenBICGSTABTag bicgstab;
+    LinearSolve::detail::solve_impl(u, P.KB, P.rhsB, bicgstab);
+    good = good && matches(u);
+
+    u.setZero();
+    LinearSolve::ParallelConjugateGradientTag pcg;
+    LinearSolve::detail::solve_impl(u, P.KB, P.rhsB, pcg);
+    good = good && matches(u);
+    return good;
+}
+
+
+int main()
+{
+    int retval = 0;
+
+    if (!test_1()) {
+        std::cerr << "Failed test_1()" << std::endl;
+        retval |= 1 << 0;
+    }
+    if (!test_2()) {
+        std::cerr << "Failed test_2()" << std::endl;
+        retval |= 1 << 1;
+    }
+    if (!test_3()) {
+        std::cerr << "Failed test_3()" << std::endl;
+        retval |= 1 << 2;
+    }
+    if (!test_4()) {
+        std::cerr << "Failed test_4()" << std::endl;
+        retval |= 1 << 3;
+    }
+
+    return retval;
+}
@@ -0,0 +1,173 @@
+#include "yafel_globals.hpp"
+#include "assembly/CGAssembly.hpp"
+#include "boundary_conditions/DirichletBC.hpp"
+#include "lin_alg/linear_solvers/solvers/CachedSolvers.hpp"
+#include "lin_alg/linear_solvers/solvers/EigenCholesky.hpp"
+#include "test_meshes.hpp"
+
+#include <Eigen/Core>
+#include <Eigen/Sparse>
+#include <iostream>
+
+using namespace yafel;
+
+/*
+ * CachedSolverTag keeps the symbolic analysis while the sparsity pattern stays the
+ * same, and the factorization too with Reuse::Factorization, and redoes them when
+ * the pattern (or, for iterative solvers, the matrix storage) changes. Every solve
+ * must still match a fresh solver.
+ */
+
+struct Diffusion
+{
+    static constexpr int nsd() { return 2; }
+
+    template<typename ElementT, typename PointT, typename VectorT, typename MatrixT>
+    static void LocalTangent(const ElementT &E, int qpi, PointT &, double, VectorT &, MatrixT &K_el)
+    {
+        K_el += E.shapeGrad * E.shapeGrad.transpose() * E.jxw
+                + 0.1 * E.shapeValues[qpi] * E.shapeValues[qpi].transpose() * E.jxw;
+    }
+
+    template<typename ElementT, typename PointT, typename VectorT>
+    static void LocalResidual(const ElementT &, int, PointT &, double, VectorT &, VectorT &)
+    {}
+};
+
+Eigen::SparseMatrix<double> tangent(const Mesh &M, int polyOrder)
+{
+    DoFManager dofm(M, DoFManager::ManagerType::CG, polyOrder, 1);
+    FESystem feSystem(dofm, 2);
+    CGAssembly<Diffusion>(feSystem, {AssemblyRequirement::Tangent});
+    Eigen::SparseMatrix<double> K = feSystem.getGlobalTangent();
+    Eigen::VectorXd rhs = Eigen::VectorXd::Zero(K.rows());
+    DirichletBC bc(dofm, 0.0);
+    bc.selectByFunction([](auto x) { return x(0) < 1.0e-12; });
+    bc.apply(K, rhs);
+    return K;
+}
+
+Eigen::VectorXd rhs_of(Eigen::Index n, double phase)
+{
+    Eigen::VectorXd b(n);
+    for (Eigen::Index i = 0; i < n; ++i) {
+        b(i) = std::sin(phase + 0.37 * i);
+    }
+    return b;
+}
+
+Eigen::VectorXd fresh_solve(const Eigen::SparseMatrix<double> &K, const Eigen::VectorXd &b)
+{
+    Eigen::VectorXd x(b.rows());
+    LinearSolve::detail::solve_impl(x, K, b, LinearSolve::EigenCholeskyLDLT());
+    return x;
+}
+
+bool close(const Eigen::VectorXd &x, const Eigen::VectorXd &y, double tol)
+{
+    return (x - y).norm() < tol * y.norm();
+}
+
+
+// Reuse::Pattern: one analysis while the pattern holds, a factorization per solve
+bool test_1()
+{
+    auto K = tangent(test_meshes::quadMesh(6, 1.2, 0.2), 2);
+    LinearSolve::CachedCholeskyLDLTTag tag;
+    bool good = true;
+    for (int i = 0; i < 3; ++i) {
+        // New values, same pattern
+        for (Eigen::Index k = 0; k < K.nonZeros(); ++k) {
+            K.valuePtr()[k] *= 1.5;
+        }
+        auto b = rhs_of(K.rows(), i);
+        Eigen::VectorXd x(K.rows());
+        LinearSolve::detail::solve_impl(x, K, b, tag);
+        good = good && close(x, fresh_solve(K, b), 1e-12);
+    }
+    good = good && tag.nAnalyses() == 1 && tag.nFactorizations() == 3;
+
+    // New pattern
+    auto K2 = tangent(test_meshes::quadMesh(5, 1.0, 0.1), 3);
+    auto b2 = rhs_of(K2.rows(), 0.5);
+    Eigen::VectorXd x2(K2.rows());
+    LinearSolve::detail::solve_impl(x2, K2, b2, tag);
+    return good && close(x2, fresh_solve(K2, b2), 1e-12) && tag.nAnalyses() == 2 && tag.nFactorizations() == 4;
+}
+
+
+// Reuse::Factorization: right-hand sides only, until refactor() or a new pattern
+bool test_2()
+{
+    using Tag = LinearSolve::CachedSparseLUTag;
+    auto K = tangent(test_meshes::quadMesh(6, 1.2, 0.2), 2);
+    Tag tag(Tag::Reuse::Factorization);
+    bool good = true;
+    for (int i = 0; i < 4; ++i) {
+        auto b = rhs_of(K.rows(), i);
+        Eigen::VectorXd x(K.rows());
+        LinearSolve::detail::solve_impl(x, K, b, tag);
+        good = good && close(x, fresh_solve(K, b), 1e-11);
+    }
+    good = good && tag.nFactorizations() == 1;
+
+    // Stale until refactor()
+    Eigen::SparseMatrix<double> K2 = 2.0 * K;
+    auto b = rhs_of(K.rows(), 0.0);
+    Eigen::VectorXd x(K.rows());
+    LinearSolve::detail::solve_impl(x, K2, b, tag);
+    good = good && close(x, fresh_solve(K, b), 1e-11);
+    tag.refactor(K2);
+    LinearSolve::detail::solve_impl(x, K2, b, tag);
+    good = good && close(2.0 * x, fresh_solve(K, b), 1e-11) && tag.nAnalyses() == 1 && tag.nFactorizations() == 2;
+
+    auto K3 = tangent(test_meshes::quadMesh(4), 2);
+    auto b3 = rhs_of(K3.rows(), 1.0);
+    Eigen::VectorXd x3(K3.rows());
+    LinearSolve::detail::solve_impl(x3, K3, b3, tag);
+    return good && close(x3, fresh_solve(K3, b3), 1e-11) && tag.nAnalyses() == 2;
+}
+
+
+// Iterative solvers keep the preconditioner, and redo it for a matrix stored elsewhere
+bool test_3()
+{
+    using Tag = LinearSolve::CachedBICGSTABILUTTag;
+    auto K = tangent(test_meshes::quadMesh(6, 1.2, 0.2), 2);
+    Tag tag(Tag::Reuse::Factorization);
+    tag.solver().setTolerance(1e-13);
+    bool good = true;
+    for (int i = 0; i < 3; ++i) {
+        auto b = rhs_of(K.rows(), i);
+        Eigen::VectorXd x = Eigen::VectorXd::Zero(K.rows());
+        LinearSolve::detail::solve_impl(x, K, b, tag);
+        good = good && close(x, fresh_solve(K, b), 1e-9);
+    }
+    good = good && tag.nFactorizations() == 1;
+
+    Eigen::SparseMatrix<double> copy = K;
+    auto b = rhs_of(K.rows(), 3.0);
+    Eigen::VectorXd x = Eigen::VectorXd::Zero(K.rows());
+    LinearSolve::detail::solve_impl(x, copy, b, tag);
+    return good && close(x, fresh_solve(K, b), 1e-9) && tag.nFactorizations() == 2 && tag.nAnalyses() == 1;
+}
+
+
+int main()
+{
+    int retval = 0;
+    if (!test_1()) {
+        std::cerr << "Failed test_1()" << std::endl;
+        retval |= 1 << 0;
+    }
+    if (!test_2()) {
+        std::cerr << "Failed test_2()" << std::endl;
+        retval |= 1 << 1;
+    }
+    if (!test_3()) {
+        std::cerr << "Failed test_3()" << std::endl;
+        retval |= 1 << 2;
+    }
+
+    return retval;
+}
@@ -0,0 +1,215 @@
+#include "yafel_globals.hpp"
+#include "assembly/CGAssembly.hpp"
+#include "element/ElementFactory.hpp"
+#include "test_meshes.hpp"
+
+#include <Eigen/Core>
+#include <Eigen/Sparse>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+using namespace yafel;
+
+/*
+ * CGAssembly scatters straight into the value array of the FESystem's cached sparsity
+ * pattern. The result must equal a plain triplet assembly of the same local tangents,
+ * on every call: repeated assemblies on the same FESystem zero and refill the values.
+ */
+
+template<int NSD>
+struct ScaledDiffusion
+{
+    static constexpr int nsd() { return NSD; }
+
+    template<typename ElementT, typename PointT, typename VectorT>
+    static void LocalResidual(const ElementT &E, int qpi, PointT &, double, VectorT &, VectorT &R_el)
+    {
+        R_el += E.shapeValues[qpi] * E.jxw;
+    }
+
+    template<typename ElementT, typename PointT, typename VectorT, typename MatrixT>
+    static void LocalTangent(const ElementT &E, int, PointT &, double, VectorT &u_el, MatrixT &K_el)
+    {
+        K_el += (1 + u_el.squaredNorm()) * E.shapeGrad * E.shapeGrad.transpose() * E.jxw;
+    }
+};
+
+using Physics = ScaledDiffusion<2>;
+
+// Global tangent from triplets of the local tangents, element by element
+Eigen::SparseMatrix<double> reference_tangent(FESystem &feSystem)
+{
+    auto &dofm = feSystem.getDoFManager();
+    auto const &U = feSystem.getSolution();
+    ElementFactory EF;
+    std::vector<Eigen::Triplet<double>> triplets;
+    std::vector<int> dofs;
+    coordinate<> x;
+    for (int e = 0; e < dofm.nCells(); ++e) {
+        auto &E = EF.getElement(dofm.element_types[e]);
+        dofm.getGlobalDofs(e, dofs);
+        const int n = static_cast<int>(dofs.size());
+        Eigen::VectorXd u_el(n);
+        for (int A = 0; A < n; ++A) {
+            u_el(A) = U(dofs[A]);
+        }
+        Eigen::MatrixXd K_el = Eigen::MatrixXd::Zero(n, n);
+        for (int qpi = 0; qpi < E.nQP(); ++qpi) {
+            E.update<Physics::nsd()>(e, qpi, dofm);
+            Physics::LocalTangent(E, qpi, x, 0.0, u_el, K_el);
+        }
+        for (int A = 0; A < n; ++A) {
+            for (int B = 0; B < n; ++B) {
+                triplets.emplace_back(dofs[A], dofs[B], K_el(A, B));
+            }
+        }
+    }
+    Eigen::SparseMatrix<double> K(U.rows(), U.rows());
+    K.setFromTriplets(triplets.begin(), triplets.end());
+    return K;
+}
+
+// Whether a few assemblies of a changing state, on one FESystem, all match the reference
+bool assembly_matches(const Mesh &M, int polyOrder)
+{
+    DoFManager dofm(M, DoFManager::ManagerType::CG, polyOrder, 1);
+    FESystem feSystem(dofm, Physics::nsd());
+
+    bool good = true;
+    for (int k = 0; k < 3; ++k) {
+        feSystem.getSolution().setLinSpaced(feSystem.getSolution().rows(), 0.0, 0.5 * k);
+        CGAssembly<Physics>(feSystem, {AssemblyRequirement::Tangent});
+        Eigen::SparseMatrix<double> K_ref = reference_tangent(feSystem);
+        auto const &K = feSystem.getGlobalTangent();
+        good = good && (K - K_ref).norm() < 1.0e-13 * K_ref.norm();
+    }
+    return good;
+}
+
+
+// Quads, p = 1..3
+bool test_1()
+{
+    bool good = true;
+    for (int p = 1; p <= 3; ++p) {
+        good = good && assembly_matches(test_meshes::quadMesh(6, 1.2, 0.2), p);
+    }
+    return good;
+}
+
+
+// Triangles, p = 1..3
+bool test_2()
+{
+    bool good = true;
+    for (int p = 1; p <= 3; ++p) {
+        good = good && assembly_matches(test_meshes::triMesh(6), p);
+    }
+    return good;
+}
+
+
+/*
+ * Patch test at p = 1: with a zero solution the tangent is the Laplacian, which must
+ * annihilate a linear field at every interior node. Returns the largest such entry,
+ * relative to the largest entry of the product.
+ */
+template<int NSD>
+double p1_patch_test_error(const Mesh &M)
+{
+    DoFManager dofm(M, DoFManager::ManagerType::CG, 1, 1);
+    FESystem feSystem(dofm, NSD);
+    CGAssembly<ScaledDiffusion<NSD>>(feSystem, {AssemblyRequirement::Tangent});
+    auto const &K = feSystem.getGlobalTangent();
+
+    const double slope[3] = {2.0, -3.0, 0.5};
+    Eigen::VectorXd u(dofm.nNodes());
+    for (int i = 0; i < dofm.nNodes(); ++i) {
+        u(i) = 1.0;
+        for (int j = 0; j < NSD; ++j) {
+            u(i) += slope[j] * dofm.dof_nodes[i](j);
+        }
+    }
+    Eigen::VectorXd Ku = K * u;
+
+    double interior_max = 0;
+    for (int i = 0; i < dofm.nNodes(); ++i) {
+        bool interior = true;
+        for (int j = 0; j < NSD; ++j) {
+            double x = dofm.dof_nodes[i](j);
+            interior = interior && x > 1.0e-12 && x < 1 - 1.0e-12;
+        }
+        if (interior) {
+            interior_max = std::max(interior_max, std::abs(Ku(i)));
+        }
+    }
+    return interior_max / Ku.lpNorm<Eigen::Infinity>();
+}
+
+
+// Linear quads (distorted) and hexes (graded) pass the patch test
+bool test_3()
+{
+    return p1_patch_test_error<2>(test_meshes::quadMesh(6, 1.2, 0.2)) < 1.0e-12
+           && p1_patch_test_error<3>(test_meshes::hexMesh(3, 1.3)) < 1.0e-12;
+}
+
+
+/*
+ * The DoFManager colorings and the FESystem patterns are cached per topoDim: requesting
+ * another dimension must not invalidate a reference handed out earlier, and concurrent
+ * first requests must all get the same object.
+ */
+bool test_4()
+{
+    DoFManager dofm(test_meshes::quadMesh(6, 1.2, 0.2), DoFManager::ManagerType::CG, 1, 1);
+    FESystem feSystem(dofm, 2);
+
+    auto const &coloring = dofm.getElementColoring(2);
+    auto const &pattern = feSystem.getSparsityPattern(2);
+    const int nColors = coloring.nColors();
+    const int nnz = pattern.nonZeros();
+    dofm.getElementColoring(1);
+    feSystem.getSparsityPattern(1);
+
+    bool good = &dofm.getElementColoring(2) == &coloring && coloring.nColors() == nColors
+                && &feSystem.getSparsityPattern(2) == &pattern && pattern.nonZeros() == nnz;
+
+    DoFManager dofm2(test_meshes::quadMesh(6, 1.2, 0.2), DoFManager::ManagerType::CG, 1, 1);
+    std::vector<const ElementColoring *> seen(8, nullptr);
+#pragma omp parallel for num_threads(8)
+    for (int i = 0; i < 8; ++i) {
+        seen[i] = &dofm2.getElementColoring(2);
+    }
+    for (auto c : seen) {
+        good = good && c == seen[0];
+    }
+    return good;
+}
+
+
+int main()
+{
+    int retval = 0;
+
+    if (!test_1()) {
+        std::cerr << "Failed test_1()" << std::endl;
+        retval |= 1 << 0;
+    }
+    if (!test_2()) {
+        std::cerr << "Failed test_2()" << std::endl;
+        retval |= 1 << 1;
+    }
+    if (!test_3()) {
+        std::cerr << "Failed test_3()" << std::endl;
+        retval |= 1 << 2;
+    }
+    if (!test_4()) {
+        std::cerr << "Failed test_4()" << std::endl;
+        retval |= 1 << 3;
+    }
+
+    return retval;
+}
@@ -0,0 +1,147 @@
+#include "yafel_globals.hpp"
+#include "assembly/DGAssembly.hpp"
+#include "test_meshes.hpp"
+
+#include <Eigen/Core>
+#include <cmath>
+#include <iostream>
+
+using namespace yafel;
+
+/*
+ * With DoFManager::quadratureType = GAUSS_LOBATTO, tensor-product elements integrate on
+ * their own nodes: the shape values are unit vectors, the mass matrix is diagonal, and
+ * DGAssembly reads face traces without interpolation. The collocated scheme (DGSEM)
+ * still reproduces the exact time derivative of a linear advected field.
+ */
+
+// Constant-velocity advection, with the exact field imposed at the inflow
+struct Advection
+{
+    InverseMassOperator inverse_mass;
+
+    static constexpr int nsd() { return 2; }
+
+    static Tensor<2, 1> velocity() { return {1.0, 0.5}; }
+
+    static double exact(const coordinate<> &x) { return 1 + 2 * x(0) - x(1); }
+
+    template<typename TU, typename TR>
+    static void LocalResidual(const Element &E, int qpi, coordinate<> &, double,
+                              Eigen::MatrixBase<TU> &U_el, Eigen::MatrixBase<TR> &R_el)
+    {
+        double U = E.shapeValues[qpi].dot(U_el);
+        for (int i = 0; i < R_el.rows(); ++i) {
+            auto gradW = make_TensorMap<2, 1>(&E.shapeGrad(i, 0));
+            R_el(i) += U * dot(gradW, velocity()) * E.jxw;
+        }
+    }
+
+    template<typename T>
+    static void LocalMass(const Element &E, int qpi, double, Eigen::MatrixBase<T> &M_el)
+    {
+        M_el += (E.jxw * E.shapeValues[qpi]) * E.shapeValues[qpi].transpose();
+    }
+
+    static double Flux(Tensor<2, 1> n, coordinate<>, double, double Uplus, double Uminus)
+    {
+        double vdotn = dot(n, velocity());
+        return 0.5 * (vdotn * (Uplus + Uminus) + std::abs(vdotn) * (Uplus - Uminus));
+    }
+
+    static double BoundaryFlux(Tensor<2, 1> n, coordinate<> x, double t, double U)
+    {
+        return Flux(n, x, t, U, exact(x));
+    }
+};
+
+
+// Collocated elements: one quadrature point per node, unit shape values
+bool test_1()
+{
+    bool good = true;
+    for (int p : {1, 2, 4}) {
+        for (int dim : {2, 3}) {
+            Element E({ElementTopology::TensorProduct, dim, p}, 1, 2, QuadratureRule::QuadratureType::GAUSS_LOBATTO);
+            good = good && E.isCollocated() && E.nQP() == E.localMesh.nNodes()
+                   && E.nFQP() == static_cast<int>(E.boundaryNodes.size());
+            for (int q = 0; q < E.nQP(); ++q) {
+                good = good && (E.shapeValues[q] - Eigen::VectorXd::Unit(E.nQP(), q)).norm() < 1e-13;
+            }
+            for (int q = 0; q < E.nFQP(); ++q) {
+                good = good && (E.boundaryShapeValues[q] - Eigen::VectorXd::Unit(E.nFQP(), q)).norm() < 1e-13;
+            }
+        }
+    }
+
+    // Simplices keep their own rules
+    Element T({ElementTopology::Simplex, 2, 2}, 1, 2, QuadratureRule::QuadratureType::GAUSS_LOBATTO);
+    return good && !T.isCollocated();
+}
+
+
+// Diagonal mass, on curved elements too, and collocated faces
+bool test_2()
+{
+    Mesh M = test_meshes::quadMesh(5, 1.0, 0.2);
+    M.buildInternalFaces();
+    DoFManager dofm(M, DoFManager::ManagerType::DG, 3, 1);
+    dofm.quadratureType = QuadratureRule::QuadratureType::GAUSS_LOBATTO;
+    FESystem feSystem(dofm, 2);
+
+    InverseMassOperator Minv;
+    Minv.build<Advection>(dofm);
+    auto const &faces = feSystem.getFaceGeometryCache(2);
+    bool good = Minv.nDiagonalElements() == dofm.nCells();
+    for (int f = 0; f < faces.nFaces(); ++f) {
+        good = good && faces.isCollocated(f) && faces.nFaceQP(f) == faces.nTraceNodes(f);
+    }
+    return good;
+}
+
+
+// dU/dt = -v . grad(U) for a linear U, on graded quads, with and without collocation
+bool linear_field_exact(QuadratureRule::QuadratureType quadratureType, int polyOrder)
+{
+    Mesh M = test_meshes::quadMesh(4, 1.4);
+    M.buildInternalFaces();
+    DoFManager dofm(M, DoFManager::ManagerType::DG, polyOrder, 1);
+    dofm.quadratureType = quadratureType;
+    FESystem feSystem(dofm, 2);
+    auto &U = feSystem.getSolution();
+    for (int i = 0; i < U.rows(); ++i) {
+        U(i) = Advection::exact(dofm.dof_nodes[i]);
+    }
+
+    Advection physics;
+    DGAssembly(feSystem, physics, {AssemblyRequirement::Residual, AssemblyRequirement::DtMass});
+    Eigen::VectorXd dUdt = feSystem.getGlobalResidual();
+    return (dUdt + Eigen::VectorXd::Constant(dUdt.rows(), 1.5)).lpNorm<Eigen::Infinity>() < 1e-10;
+}
+
+bool test_3()
+{
+    return linear_field_exact(QuadratureRule::QuadratureType::GAUSS_LOBATTO, 2)
+           && linear_field_exact(QuadratureRule::QuadratureType::GAUSS_LOBATTO, 4)
+           && linear_field_exact(QuadratureRule::QuadratureType::GAUSS_LEGENDRE, 2);
+}
+
+
+int main()
+{
+    int retval = 0;
+    if (!test_1()) {
+        std::cerr << "Failed test_1()" << std::endl;
+        retval |= 1 << 0;
+    }
+    if (!test_2()) {
+        std::cerr << "Failed test_2()" << std::endl;
+        retval |= 1 << 1;
+    }
+    if (!test_3()) {
+        std::cerr << "Failed test_3()" << std::endl;
+        retval |= 1 << 2;
+    }
+
+    return retval;
+}
@@ -0,0 +1,98 @@
+#include "yafel_globals.hpp"
+#include "assembly/DGAssembly.hpp"
+#include "test_meshes.hpp"
+#include "test_physics.hpp"
+
+#include <Eigen/Core>
+#include <Eigen/Dense>
+#include <omp.h>
+#include <algorithm>
+#include <iostream>
+
+using namespace yafel;
+
+/*
+ * DGAssembly runs its face loop color by color (FaceColoring) and its element loop
+ * in parallel. No two faces of a color may share an element, and the residual must
+ * be bitwise identical for any number of threads.
+ */
+
+// Rotating advection, so that the fluxes differ from face to face
+using Advection = test_physics::RotatingAdvection;
+
+
+// No two faces of one color share an element, and every face has exactly one color
+bool coloring_valid(const DoFManager &dofm)
+{
+    auto const &coloring = dofm.getFaceColoring();
+    std::vector<int> face_seen(dofm.interior_faces.size(), 0);
+    std::vector<int> element_color(dofm.nCells(), -1);
+    for (int c = 0; c < coloring.nColors(); ++c) {
+        for (int i = 0; i < coloring.nFaces(c); ++i) {
+            int f = coloring.faces(c)[i];
+            ++face_seen[f];
+            for (int e : {dofm.interior_faces[f].left, dofm.interior_faces[f].right}) {
+                if (e < 0) {
+                    continue;
+                }
+                if (element_color[e] == c) {
+                    return false;
+                }
+                element_color[e] = c;
+            }
+        }
+    }
+    return std::all_of(face_seen.begin(), face_seen.end(), [](int n) { return n == 1; });
+}
+
+// DG residual with the given number of threads
+Eigen::VectorXd dg_residual(DoFManager &dofm, const Eigen::VectorXd &U, int nThreads)
+{
+    int previous = omp_get_max_threads();
+    omp_set_num_threads(nThreads);
+
+    FESystem feSystem(dofm, 2);
+    feSystem.getSolution() = U;
+    Advection physics;
+    DGAssembly(feSystem, physics, {AssemblyRequirement::Residual, AssemblyRequirement::DtMass});
+
+    omp_set_num_threads(previous);
+    return feSystem.getGlobalResidual();
+}
+
+bool reproducible(Mesh M, int polyOrder)
+{
+    M.buildInternalFaces();
+    DoFManager dofm(M, DoFManager::ManagerType::DG, polyOrder, 1);
+    Eigen::VectorXd U = Eigen::VectorXd::Random(dofm.nNodes());
+
+    Eigen::VectorXd R1 = dg_residual(dofm, U, 1);
+    bool good = coloring_valid(dofm) && dofm.getFaceColoring().nColors() > 1 && R1.norm() > 0;
+    for (int nThreads : {2, 3, 4}) {
+        Eigen::VectorXd R = dg_residual(dofm, U, nThreads);
+        good = good && std::equal(R.data(), R.data() + R.size(), R1.data());
+    }
+    return good;
+}
+
+
+// Quads and triangles, p = 1 and 3
+bool test_1()
+{
+    return reproducible(test_meshes::quadMesh(6, 1.2, 0.2), 1)
+           && reproducible(test_meshes::quadMesh(5), 3)
+           && reproducible(test_meshes::triMesh(5), 1)
+           && reproducible(test_meshes::triMesh(4), 3);
+}
+
+
+int main()
+{
+    int retval = 0;
+    if (!test_1()) {
+        std::cerr << "Failed test_1()" << std::endl;
+        retval |= 1 << 0;
+    }
+
+    return retval;
+}
@@ -0,0 +1,314 @@
+#include "yafel_globals.hpp"
+#include "assembly/DGAssembly.hpp"
+#include "test_meshes.hpp"
+
+#include <Eigen/Core>
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+
+using namespace yafel;
+
+/*
+ * Systems of conservation laws in DGAssembly: a Physics with dofPerNode() > 1 has
+ * Flux and BoundaryFlux on Tensor<NC, 1> states, over a DoFManager with as many
+ * dofs per node. A decoupled system must reproduce independent scalar runs, and a
+ * coupled hyperbolic system the exact time derivative of a linear state.
+ */
+
+// Scalar upwind advection with velocity velocity(k)
+template<int k>
+struct ScalarAdvection
+{
+    InverseMassOperator inverse_mass;
+
+    static constexpr int nsd() { return 2; }
+
+    static Tensor<2, 1> velocity()
+    {
+        return k == 0 ? Tensor<2, 1>{1.0, 0.5} : Tensor<2, 1>{-0.3, 0.8};
+    }
+
+    static double inflow(const coordinate<> &x) { return std::sin(x(0) + 2 * x(1) + k); }
+
+    template<typename TU, typename TR>
+    static void LocalResidual(const Element &E, int qpi, coordinate<> &, double,
+                              Eigen::MatrixBase<TU> &U_el, Eigen::MatrixBase<TR> &R_el)
+    {
+        double U = E.shapeValues[qpi].dot(U_el);
+        for (int i = 0; i < R_el.rows(); ++i) {
+            auto gradW = make_TensorMap<2, 1>(&E.shapeGrad(i, 0));
+            R_el(i) += U * dot(gradW, velocity()) * E.jxw;
+        }
+    }
+
+    template<typename T>
+    static void LocalMass(const Element &E, int qpi, double, Eigen::MatrixBase<T> &M_el)
+    {
+        M_el += (E.jxw * E.shapeValues[qpi]) * E.shapeValues[qpi].transpose();
+    }
+
+    static double Flux(Tensor<2, 1> n, coordinate<>, double, double Uplus, double Uminus)
+    {
+        double vdotn = dot(n, velocity());
+        return 0.5 * (vdotn * (Uplus + Uminus) + std::abs(vdotn) * (Uplus - Uminus));
+    }
+
+    static double BoundaryFlux(Tensor<2, 1> n, coordinate<> x, double t, double U)
+    {
+        return Flux(n, x, t, U, inflow(x));
+    }
+};
+
+// Both scalar advections at once, as a two-component system
+struct AdvectionSystem
+{
+    InverseMassOperator inverse_mass;
+
+    static constexpr int nsd() { return 2; }
+
+    static constexpr int dofPerNode() { return 2; }
+
+    template<typename TU, typename TR>
+    static void LocalResidual(const Element &E, int qpi, coordinate<> &, double,
+                              Eigen::MatrixBase<TU> &U_el, Eigen::MatrixBase<TR> &R_el)
+    {
+        const int nNodes = E.localMesh.nNodes();
+        Tensor<2, 1> U;
+        for (int A = 0; A < nNodes; ++A) {
+            U(0) += E.shapeValues[qpi](A) * U_el(2 * A);
+            U(1) += E.shapeValues[qpi](A) * U_el(2 * A + 1);
+        }
+        for (int A = 0; A < nNodes; ++A) {
+            auto gradW = make_TensorMap<2, 1>(&E.shapeGrad(A, 0));
+            R_el(2 * A) += U(0) * dot(gradW, ScalarAdvection<0>::velocity()) * E.jxw;
+            R_el(2 * A + 1) += U(1) * dot(gradW, ScalarAdvection<1>::velocity()) * E.jxw;
+        }
+    }
+
+    template<typename T>
+    static void LocalMass(const Element &E, int qpi, double, Eigen::MatrixBase<T> &M_el)
+    {
+        const int nNodes = E.localMesh.nNodes();
+        for (int A = 0; A < nNodes; ++A) {
+            for (int B = 0; B < nNodes; ++B) {
+                double m = E.jxw * E.shapeValues[qpi](A) * E.shapeValues[qpi](B);
+                M_el(2 * A, 2 * B) += m;
+                M_el(2 * A + 1, 2 * B + 1) += m;
+            }
+        }
+    }
+
+    static Tensor<2, 1> Flux(Tensor<2, 1> n, coordinate<> x, double t,
+                             const Tensor<2, 1> &Uplus, const Tensor<2, 1> &Uminus)
+    {
+        return {ScalarAdvection<0>::Flux(n, x, t, Uplus(0), Uminus(0)),
+                ScalarAdvection<1>::Flux(n, x, t, Uplus(1), Uminus(1))};
+    }
+
+    static Tensor<2, 1> BoundaryFlux(Tensor<2, 1> n, coordinate<> x, double t, const Tensor<2, 1> &U)
+    {
+        return {ScalarAdvection<0>::BoundaryFlux(n, x, t, U(0)),
+                ScalarAdvection<1>::BoundaryFlux(n, x, t, U(1))};
+    }
+};
+
+
+// Linear acoustics, U = (p, u, v): p_t + c div(u, v) = 0, (u, v)_t + c grad(p) = 0, Rusanov fluxes
+struct Acoustics
+{
+    InverseMassOperator inverse_mass;
+
+    static constexpr double c = 2.0;
+
+    static constexpr int nsd() { return 2; }
+
+    static constexpr int dofPerNode() { return 3; }
+
+    static Tensor<3, 1> exact(const coordinate<> &x) { return {1 + x(0) - 2 * x(1), 2 * x(0) + x(1), x(0) - x(1)}; }
+
+    // dU/dt of the exact state
+    static Tensor<3, 1> exactRate() { return {-c * (2 - 1), -c * 1, -c * (-2)}; }
+
+    // Physical flux in direction n
+    static Tensor<3, 1> normalFlux(const Tensor<2, 1> &n, const Tensor<3, 1> &U)
+    {
+        return {c * (U(1) * n(0) + U(2) * n(1)), c * U(0) * n(0), c * U(0) * n(1)};
+    }
+
+    template<typename TU, typename TR>
+    static void LocalResidual(const Element &E, int qpi, coordinate<> &, double,
+                              Eigen::MatrixBase<TU> &U_el, Eigen::MatrixBase<TR> &R_el)
+    {
+        const int nNodes = E.localMesh.nNodes();
+        Tensor<3, 1> U;
+        for (int A = 0; A < nNodes; ++A) {
+            for (int k = 0; k < 3; ++k) {
+                U(k) += E.shapeValues[qpi](A) * U_el(3 * A + k);
+            }
+        }
+        for (int A = 0; A < nNodes; ++A) {
+            auto gradW = make_TensorMap<2, 1>(&E.shapeGrad(A, 0));
+            auto F = normalFlux(gradW, U);
+            for (int k = 0; k < 3; ++k) {
+                R_el(3 * A + k) += F(k) * E.jxw;
+            }
+        }
+    }
+
+    template<typename T>
+    static void LocalMass(const Element &E, int qpi, double, Eigen::MatrixBase<T> &M_el)
+    {
+        const int nNodes = E.localMesh.nNodes();
+        for (int A = 0; A < nNodes; ++A) {
+            for (int B = 0; B < nNodes; ++B) {
+                double m = E.jxw * E.shapeValues[qpi](A) * E.shapeValues[qpi](B);
+                for (int k = 0; k < 3; ++k) {
+                    M_el(3 * A + k, 3 * B + k) += m;
+                }
+            }
+        }
+    }
+
+    static Tensor<3, 1> Flux(Tensor<2, 1> n, coordinate<>, double,
+                             const Tensor<3, 1> &Uplus, const Tensor<3, 1> &Uminus)
+    {
+        Tensor<3, 1> F = normalFlux(n, Uplus) + normalFlux(n, Uminus) + c * (Uplus - Uminus);
+        return 0.5 * F;
+    }
+
+    static Tensor<3, 1> BoundaryFlux(Tensor<2, 1> n, coordinate<> x, double t, const Tensor<3, 1> &U)
+    {
+        return Flux(n, x, t, U, exact(x));
+    }
+};
+
+
+// dU/dt of a scalar physics, for the initial state f
+template<typename Physics, typename F>
+Eigen::VectorXd scalar_rate(DoFManager &dofm, F &&f)
+{
+    FESystem feSystem(dofm, 2);
+    auto &U = feSystem.getSolution();
+    for (int i = 0; i < U.rows(); ++i) {
+        U(i) = f(dofm.dof_nodes[i]);
+    }
+    Physics physics;
+    DGAssembly(feSystem, physics, {AssemblyRequirement::Residual, AssemblyRequirement::DtMass});
+    return feSystem.getGlobalResidual();
+}
+
+// The decoupled system equals the two scalar advections, component by component
+bool decoupled_system(QuadratureRule::QuadratureType quadratureType)
+{
+    Mesh M = test_meshes::quadMesh(4, 1.3, 0.1);
+    M.buildInternalFaces();
+    auto f0 = [](const coordinate<> &x) { return std::cos(3 * x(0)) * x(1); };
+    auto f1 = [](const coordinate<> &x) { return std::exp(x(0) - x(1)); };
+
+    DoFManager scalar_dofm(M, DoFManager::ManagerType::DG, 3, 1);
+    scalar_dofm.quadratureType = quadratureType;
+    Eigen::VectorXd R0 = scalar_rate<ScalarAdvection<0>>(scalar_dofm, f0);
+    Eigen::VectorXd R1 = scalar_rate<ScalarAdvection<1>>(scalar_dofm, f1);
+
+    DoFManager dofm(M, DoFManager::ManagerType::DG, 3, 2);
+    dofm.quadratureType = quadratureType;
+    FESystem feSystem(dofm, 2);
+    auto &U = feSystem.getSolution();
+    for (int n = 0; n < dofm.nNodes(); ++n) {
+        U(2 * n) = f0(dofm.dof_nodes[n]);
+        U(2 * n + 1) = f1(dofm.dof_nodes[n]);
+    }
+    AdvectionSystem physics;
+    DGAssembly(feSystem, physics, {AssemblyRequirement::Residual, AssemblyRequirement::DtMass});
+    auto const &R = feSystem.getGlobalResidual();
+
+    if (dofm.nNodes() != scalar_dofm.nNodes() || R.rows() != 2 * R0.rows()) {
+        return false;
+    }
+    double err{0};
+    for (int n = 0; n < dofm.nNodes(); ++n) {
+        err = std::max(err, std::abs(R(2 * n) - R0(n)));
+        err = std::max(err, std::abs(R(2 * n + 1) - R1(n)));
+    }
+    return err < 1e-11 * (R0.lpNorm<Eigen::Infinity>() + R1.lpNorm<Eigen::Infinity>());
+}
+
+bool test_1()
+{
+    return decoupled_system(QuadratureRule::QuadratureType::GAUSS_LEGENDRE)
+           && decoupled_system(QuadratureRule::QuadratureType::GAUSS_LOBATTO);
+}
+
+
+// Coupled acoustics reproduce the exact rate of a linear state, on graded and curved meshes
+bool acoustics_exact(Mesh M, int polyOrder, QuadratureRule::QuadratureType quadratureType)
+{
+    M.buildInternalFaces();
+    DoFManager dofm(M, DoFManager::ManagerType::DG, polyOrder, 3);
+    dofm.quadratureType = quadratureType;
+    FESystem feSystem(dofm, 2);
+    auto &U = feSystem.getSolution();
+    for (int n = 0; n < dofm.nNodes(); ++n) {
+        auto Ux = Acoustics::exact(dofm.dof_nodes[n]);
+        for (int k = 0; k < 3; ++k) {
+            U(3 * n + k) = Ux(k);
+        }
+    }
+    Acoustics physics;
+    DGAssembly(feSystem, physics, {AssemblyRequirement::Residual, AssemblyRequirement::DtMass});
+    auto const &R = feSystem.getGlobalResidual();
+
+    auto rate = Acoustics::exactRate();
+    double err{0};
+    for (int n = 0; n < dofm.nNodes(); ++n) {
+        for (int k = 0; k < 3; ++k) {
+            err = std::max(err, std::abs(R(3 * n + k) - rate(k)));
+        }
+    }
+    return err < 1e-10;
+}
+
+bool test_2()
+{
+    return acoustics_exact(test_meshes::quadMesh(4, 1.4, 0.15), 2, QuadratureRule::QuadratureType::GAUSS_LEGENDRE)
+           && acoustics_exact(test_meshes::quadMesh(4, 1.4), 3, QuadratureRule::QuadratureType::GAUSS_LOBATTO)
+           && acoustics_exact(test_meshes::quadMesh(3, 1.0, 0.2), 1, QuadratureRule::QuadratureType::GAUSS_LEGENDRE);
+}
+
+
+// A DoFManager whose dof_per_node differs from the physics' components is rejected
+bool test_3()
+{
+    Mesh M = test_meshes::quadMesh(2);
+    M.buildInternalFaces();
+    DoFManager dofm(M, DoFManager::ManagerType::DG, 1, 2);
+    FESystem feSystem(dofm, 2);
+    Acoustics physics;
+    try {
+        DGAssembly(feSystem, physics, {AssemblyRequirement::Residual});
+    } catch (std::runtime_error &) {
+        return true;
+    }
+    return false;
+}
+
+
+int main()
+{
+    int retval = 0;
+    if (!test_1()) {
+        std::cerr << "Failed test_1()" << std::endl;
+        retval |= 1 << 0;
+    }
+    if (!test_2()) {
+        std::cerr << "Failed test_2()" << std::endl;
+        retval |= 1 << 1;
+    }
+    if (!test_3()) {
+        std::cerr << "Failed test_3()" << std::endl;
+        retval |= 1 << 2;
+    }
+
+    return retval;
+}
@@ -0,0 +1,258 @@
+#include "yafel_globals.hpp"
+#include "assembly/CGAssembly.hpp"
+#include "element/ElementBatch.hpp"
+#include "test_meshes.hpp"
+
+#include <Eigen/Core>
+#include <Eigen/Sparse>
+#include <atomic>
+#include <iostream>
+
+using namespace yafel;
+
+/*
+ * With a Physics that declares batchWidth() and batch kernels, CGAssembly evaluates
+ * blocks of same-type elements on SIMD lanes (ElementBatch), including partially
+ * filled blocks at the end of each color. The result must match the per-element
+ * kernels of the same Physics without batching.
+ */
+
+std::atomic<int> batch_calls{0};
+
+// Nonlinear scalar diffusion with a source; Width = 0 disables batching
+template<int NSD, int Width>
+struct Diffusion
+{
+    static constexpr int nsd() { return NSD; }
+
+    template<typename ElementT, typename PointT, typename VectorT>
+    static void LocalResidual(const ElementT &E, int qpi, PointT &x, double, VectorT &u_el, VectorT &R_el)
+    {
+        double u = E.shapeValues[qpi].dot(u_el);
+        R_el += (x(0) + u * u) * E.shapeValues[qpi] * E.jxw;
+    }
+
+    template<typename ElementT, typename PointT, typename VectorT, typename MatrixT>
+    static void LocalTangent(const ElementT &E, int qpi, PointT &, double, VectorT &u_el, MatrixT &K_el)
+    {
+        double u = E.shapeValues[qpi].dot(u_el);
+        K_el += (1 + u * u) * E.shapeGrad * E.shapeGrad.transpose() * E.jxw;
+    }
+};
+
+template<int NSD, int Width>
+struct BatchedDiffusion : Diffusion<NSD, Width>
+{
+    static constexpr int batchWidth() { return Width; }
+
+    template<typename B>
+    static typename B::Lanes interpolate(const B &batch, int qpi, const typename B::LocalVector &u_el)
+    {
+        typename B::Lanes u = B::Lanes::Zero();
+        for (int A = 0; A < B::n_nodes; ++A) {
+            u += batch.shapeValue(qpi, A) * u_el[A];
+        }
+        return u;
+    }
+
+    template<typename B>
+    static void LocalResidualBatch(const B &batch, int qpi, const typename B::Point &x, double,
+                                   const typename B::LocalVector &u_el, typename B::LocalVector &R_el)
+    {
+        ++batch_calls;
+        typename B::Lanes u = interpolate(batch, qpi, u_el);
+        typename B::Lanes s = (x[0] + u * u) * batch.jxw;
+        for (int A = 0; A < B::n_nodes; ++A) {
+            R_el[A] += batch.shapeValue(qpi, A) * s;
+        }
+    }
+
+    template<typename B>
+    static void LocalTangentBatch(const B &batch, int qpi, const typename B::Point &, double,
+                                  const typename B::LocalVector &u_el, typename B::LocalMatrix &K_el)
+    {
+        typename B::Lanes u = interpolate(batch, qpi, u_el);
+        typename B::Lanes c = (1 + u * u) * batch.jxw;
+        for (int A = 0; A < B::n_nodes; ++A) {
+            for (int Bn = 0; Bn < B::n_nodes; ++Bn) {
+                typename B::Lanes g = batch.grad(A, 0) * batch.grad(Bn, 0);
+                for (int d = 1; d < NSD; ++d) {
+                    g += batch.grad(A, d) * batch.grad(Bn, d);
+                }
+                K_el[A * B::n_nodes + Bn] += g * c;
+            }
+        }
+    }
+};
+
+// Isotropic linear elasticity, NSD dofs per node
+template<int NSD>
+struct Elasticity
+{
+    static constexpr int nsd() { return NSD; }
+
+    static constexpr int dofPerNode() { return NSD; }
+
+    static constexpr double lambda{1.7};
+    static constexpr double mu{0.8};
+
+    template<typename ElementT, typename PointT, typename VectorT>
+    static void LocalResidual(const ElementT &E, int qpi, PointT &x, double, VectorT &, VectorT &R_el)
+    {
+        const int nNodes = static_cast<int>(E.shapeValues[qpi].rows());
+        for (int A = 0; A < nNodes; ++A) {
+            for (int i = 0; i < NSD; ++i) {
+                R_el(A * NSD + i) += E.shapeValues[qpi](A) * x(i) * E.jxw;
+            }
+        }
+    }
+
+    template<typename ElementT, typename PointT, typename VectorT, typename MatrixT>
+    static void LocalTangent(const ElementT &E, int, PointT &, double, VectorT &, MatrixT &K_el)
+    {
+        const int nNodes = static_cast<int>(E.shapeGrad.rows());
+        for (int A = 0; A < nNodes; ++A) {
+            for (int B = 0; B < nNodes; ++B) {
+                double gAgB = E.shapeGrad.row(A).dot(E.shapeGrad.row(B));
+                for (int i = 0; i < NSD; ++i) {
+                    for (int k = 0; k < NSD; ++k) {
+                        K_el(A * NSD + i, B * NSD + k) += (lambda * E.shapeGrad(A, i) * E.shapeGrad(B, k)
+                                                           + mu * E.shapeGrad(A, k) * E.shapeGrad(B, i)
+                                                           + mu * (i == k) * gAgB) * E.jxw;
+                    }
+                }
+            }
+        }
+    }
+};
+
+template<int NSD, int Width>
+struct BatchedElasticity : Elasticity<NSD>
+{
+    static constexpr int batchWidth() { return Width; }
+
+    template<typename B>
+    static void LocalResidualBatch(const B &batch, int qpi, const typename B::Point &x, double,
+                                   const typename B::LocalVector &, typename B::LocalVector &R_el)
+    {
+        ++batch_calls;
+        for (int A = 0; A < B::n_nodes; ++A) {
+            for (int i = 0; i < NSD; ++i) {
+                R_el[A * NSD + i] += batch.shapeValue(qpi, A) * x[i] * batch.jxw;
+            }
+        }
+    }
+
+    template<typename B>
+    static void LocalTangentBatch(const B &batch, int, const typename B::Point &, double,
+                                  const typename B::LocalVector &, typename B::LocalMatrix &K_el)
+    {
+        constexpr double lambda = Elasticity<NSD>::lambda;
+        constexpr double mu = Elasticity<NSD>::mu;
+        for (int A = 0; A < B::n_nodes; ++A) {
+            for (int Bn = 0; Bn < B::n_nodes; ++Bn) {
+                typename B::Lanes gAgB = batch.grad(A, 0) * batch.grad(Bn, 0);
+                for (int d = 1; d < NSD; ++d) {
+                    gAgB += batch.grad(A, d) * batch.grad(Bn, d);
+                }
+                for (int i = 0; i < NSD; ++i) {
+                    for (int k = 0; k < NSD; ++k) {
+                        typename B::Lanes K = lambda * batch.grad(A, i) * batch.grad(Bn, k)
+                                              + mu * batch.grad(A, k) * batch.grad(Bn, i);
+                        if (i == k) {
+                            K += mu * gAgB;
+                        }
+                        K_el[(A * NSD + i) * B::n_dofs + Bn * NSD + k] += K * batch.jxw;
+                    }
+                }
+            }
+        }
+    }
+};
+
+
+// Batched and per-element assembly agree, and whether the batch kernels were used
+template<typename Batched, typename Reference>
+bool batched_matches(const Mesh &M, int polyOrder, int dofPerNode, bool expect_batched = true)
+{
+    DoFManager dofm(M, DoFManager::ManagerType::CG, polyOrder, dofPerNode);
+
+    FESystem batchedSystem(dofm, Batched::nsd());
+    FESystem referenceSystem(dofm, Reference::nsd());
+    Eigen::VectorXd U = Eigen::VectorXd::Random(batchedSystem.getSolution().rows());
+    batchedSystem.getSolution() = U;
+    referenceSystem.getSolution() = U;
+
+    batch_calls = 0;
+    CGAssembly<Batched>(batchedSystem);
+    bool used_batches = batch_calls > 0;
+    CGAssembly<Reference>(referenceSystem);
+
+    Eigen::SparseMatrix<double> dK = batchedSystem.getGlobalTangent() - referenceSystem.getGlobalTangent();
+    Eigen::VectorXd dR = batchedSystem.getGlobalResidual() - referenceSystem.getGlobalResidual();
+    double Knorm = referenceSystem.getGlobalTangent().norm();
+    double Rnorm = referenceSystem.getGlobalResidual().norm();
+
+    return used_batches == expect_batched && Knorm > 0 && Rnorm > 0
+           && dK.norm() <= 1.0e-12 * Knorm && dR.norm() <= 1.0e-12 * Rnorm;
+}
+
+
+// Scalar physics, 4 and 8 lanes: triangles and quads (p = 1, 2), hexes (p = 1)
+bool test_1()
+{
+    using Ref2 = Diffusion<2, 0>;
+    using Ref3 = Diffusion<3, 0>;
+    return batched_matches<BatchedDiffusion<2, 4>, Ref2>(test_meshes::triMesh(5), 1, 1)
+           && batched_matches<BatchedDiffusion<2, 8>, Ref2>(test_meshes::triMesh(5), 2, 1)
+           && batched_matches<BatchedDiffusion<2, 4>, Ref2>(test_meshes::quadMesh(5, 1.2, 0.2), 1, 1)
+           && batched_matches<BatchedDiffusion<2, 8>, Ref2>(test_meshes::quadMesh(5, 1.2, 0.2), 2, 1)
+           && batched_matches<BatchedDiffusion<3, 4>, Ref3>(test_meshes::hexMesh(3, 1.3), 1, 1)
+           && batched_matches<BatchedDiffusion<3, 8>, Ref3>(test_meshes::hexMesh(3, 1.3), 1, 1);
+}
+
+
+// Elasticity (NSD dofs per node): quads, triangles and hexes
+bool test_2()
+{
+    return batched_matches<BatchedElasticity<2, 4>, Elasticity<2>>(test_meshes::quadMesh(5, 1.2, 0.2), 1, 2)
+           && batched_matches<BatchedElasticity<2, 8>, Elasticity<2>>(test_meshes::triMesh(4), 2, 2)
+           && batched_matches<BatchedElasticity<3, 4>, Elasticity<3>>(test_meshes::hexMesh(3, 1.3), 1, 3);
+}
+
+
+// Cached geometry gives the same batched result, and unbatchable orders fall back per element
+bool test_3()
+{
+    using Physics = BatchedDiffusion<2, 4>;
+    DoFManager dofm(test_meshes::quadMesh(6, 1.2, 0.2), DoFManager::ManagerType::CG, 2, 1);
+    FESystem cachedSystem(dofm, 2);
+    FESystem directSystem(dofm, 2);
+    directSystem.setGeometryCacheBudget(0);
+    CGAssembly<Physics>(cachedSystem);
+    CGAssembly<Physics>(directSystem);
+    Eigen::SparseMatrix<double> dK = cachedSystem.getGlobalTangent() - directSystem.getGlobalTangent();
+    bool good = dK.norm() <= 1.0e-12 * directSystem.getGlobalTangent().norm();
+
+    return good && batched_matches<Physics, Diffusion<2, 0>>(test_meshes::quadMesh(3), 3, 1, false);
+}
+
+
+int main()
+{
+    int retval = 0;
+    if (!test_1()) {
+        std::cerr << "Failed test_1()" << std::endl;
+        retval |= 1 << 0;
+    }
+    if (!test_2()) {
+        std::cerr << "Failed test_2()" << std::endl;
+        retval |= 1 << 1;
+    }
+    if (!test_3()) {
+        std::cerr << "Failed test_3()" << std::endl;
+        retval |= 1 << 2;
+    }
+
+    return retval;
+}
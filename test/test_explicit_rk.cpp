@@ -0,0 +1,117 @@
+#include "yafel_globals.hpp"
+#include "time_integration/DGRK4.hpp"
+#include "time_integration/LowStorageRK.hpp"
+#include "time_integration/SSPRK.hpp"
+#include "test_meshes.hpp"
+
+#include <cmath>
+#include <iostream>
+
+using namespace yafel;
+
+/*
+ * The explicit integrators advance dU/dt = cos(t) - U, written as a DG physics without
+ * fluxes (the mass-inverted residual is exactly cos(t) - U at every node). Halving the
+ * step must divide the error by 2^order, which also checks the stage times.
+ */
+
+struct Relaxation
+{
+    InverseMassOperator inverse_mass;
+
+    static constexpr int nsd() { return 2; }
+
+    static double exact(double t, double u0) { return (u0 - 0.5) * std::exp(-t) + 0.5 * (std::cos(t) + std::sin(t)); }
+
+    template<typename TU, typename TR>
+    static void LocalResidual(const Element &E, int qpi, coordinate<> &, double t,
+                              Eigen::MatrixBase<TU> &U_el, Eigen::MatrixBase<TR> &R_el)
+    {
+        double U = E.shapeValues[qpi].dot(U_el);
+        for (int i = 0; i < R_el.rows(); ++i) {
+            R_el(i) += (std::cos(t) - U) * E.shapeValues[qpi](i) * E.jxw;
+        }
+    }
+
+    template<typename T>
+    static void LocalMass(const Element &E, int qpi, double, Eigen::MatrixBase<T> &M_el)
+    {
+        M_el += (E.jxw * E.shapeValues[qpi]) * E.shapeValues[qpi].transpose();
+    }
+
+    static double BoundaryFlux(Tensor<2, 1>, coordinate<>, double, double) { return 0; }
+
+    static double Flux(Tensor<2, 1>, coordinate<>, double, double, double) { return 0; }
+};
+
+
+// Largest nodal error at t = 1, with the initial value u0 = 1 + x
+template<typename Integrator, typename... Args>
+double final_error(int nSteps, Args... args)
+{
+    Mesh M = test_meshes::quadMesh(2);
+    M.buildInternalFaces();
+    DoFManager dofm(M, DoFManager::ManagerType::DG, 1, 1);
+    FESystem feSystem(dofm, 2);
+    auto &U = feSystem.getSolution();
+    for (int i = 0; i < U.rows(); ++i) {
+        U(i) = 1 + dofm.dof_nodes[i](0);
+    }
+
+    Relaxation physics;
+    Integrator integrator(1.0 / nSteps, args...);
+    for (int n = 0; n < nSteps; ++n) {
+        integrator.step(feSystem, physics);
+    }
+
+    double error{0};
+    for (int i = 0; i < U.rows(); ++i) {
+        error = std::max(error, std::abs(U(i) - Relaxation::exact(1.0, 1 + dofm.dof_nodes[i](0))));
+    }
+    return std::abs(feSystem.currentTime() - 1.0) < 1e-12 ? error : 1.0;
+}
+
+// Observed order of convergence, from 10 and 20 steps
+template<typename Integrator, typename... Args>
+bool converges(int order, Args... args)
+{
+    double e1 = final_error<Integrator>(10, args...);
+    double e2 = final_error<Integrator>(20, args...);
+    return e2 < e1 && std::log2(e1 / e2) > order - 0.3;
+}
+
+
+// 2N-storage schemes
+bool test_1()
+{
+    LowStorageRK w3(0.1, LowStorageRK::Scheme::Williamson3);
+    LowStorageRK ck4(0.1);
+    return w3.nStages() == 3 && w3.order() == 3 && ck4.nStages() == 5 && ck4.order() == 4
+           && converges<LowStorageRK>(3, LowStorageRK::Scheme::Williamson3)
+           && converges<LowStorageRK>(4, LowStorageRK::Scheme::CarpenterKennedy4);
+}
+
+
+// SSP schemes and the classical RK4
+bool test_2()
+{
+    return converges<SSPRK3>(SSPRK3::order())
+           && converges<SSPRK54>(SSPRK54::order())
+           && converges<DGRK4>(DGRK4::order());
+}
+
+
+int main()
+{
+    int retval = 0;
+    if (!test_1()) {
+        std::cerr << "Failed test_1()" << std::endl;
+        retval |= 1 << 0;
+    }
+    if (!test_2()) {
+        std::cerr << "Failed test_2()" << std::endl;
+        retval |= 1 << 1;
+    }
+
+    return retval;
+}
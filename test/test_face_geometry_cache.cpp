@@ -0,0 +1,143 @@
+#include "yafel_globals.hpp"
+#include "element/ElementFactory.hpp"
+#include "fe_system/FESystem.hpp"
+#include "test_meshes.hpp"
+
+#include <cmath>
+#include <iostream>
+
+using namespace yafel;
+
+/*
+ * FaceGeometryCache holds, for every face quadrature point, what Element::face_update
+ * computes on both sides of the face, plus the point and the traces. Checked against
+ * face_update itself, and against the surface measures of the unit square and cube.
+ */
+
+// Every cached value equals the one computed by Element::face_update
+template<int NSD>
+bool matches_face_update(Mesh M, int polyOrder)
+{
+    M.buildInternalFaces();
+    DoFManager dofm(M, DoFManager::ManagerType::DG, polyOrder, 1);
+    FESystem feSystem(dofm, NSD);
+    auto const &cache = feSystem.getFaceGeometryCache(NSD);
+
+    ElementFactory EF_L, EF_R;
+    std::vector<int> left_local, right_local, left_nodes, right_nodes;
+    bool good = cache.nFaces() == static_cast<int>(dofm.interior_faces.size()) && cache.memoryUsage() > 0;
+    for (int f = 0; good && f < cache.nFaces(); ++f) {
+        auto const &F = dofm.interior_faces[f];
+        int el = F.left >= 0 ? F.left : F.right;
+        int er = F.left >= 0 ? F.right : -1;
+        if (F.left >= 0) {
+            dofm.getLeftFaceNodes(f, left_local);
+        } else {
+            dofm.getRightFaceNodes(f, left_local);
+        }
+        dofm.getGlobalNodes(el, left_nodes);
+        good = good && cache.isBoundary(f) == (er < 0)
+               && cache.nTraceNodes(f) == static_cast<int>(left_local.size());
+
+        if (er >= 0) {
+            dofm.getRightFaceNodes(f, right_local);
+            dofm.getGlobalNodes(er, right_nodes);
+        }
+        for (int i = 0; good && i < cache.nTraceNodes(f); ++i) {
+            good = cache.leftTrace(f)[i] == left_nodes[left_local[i]];
+            // Both traces list coincident nodes in the same order
+            if (er >= 0) {
+                good = good && cache.rightTrace(f)[i] == right_nodes[right_local[i]]
+                       && norm(dofm.dof_nodes[cache.leftTrace(f)[i]] - dofm.dof_nodes[cache.rightTrace(f)[i]]) < 1e-14;
+            }
+        }
+
+        auto &EL = EF_L.getElement(dofm.element_types[el]);
+        good = good && cache.nFaceQP(f) == EL.nFQP();
+        for (int q = 0; good && q < cache.nFaceQP(f); ++q) {
+            auto n = EL.face_update<NSD>(el, q, left_local, dofm);
+            coordinate<> x;
+            for (int i = 0; i < cache.nTraceNodes(f); ++i) {
+                x += dofm.dof_nodes[cache.leftTrace(f)[i]] * EL.boundaryShapeValues[q](i);
+                good = good && cache.shapeValues(f, q)[i] == EL.boundaryShapeValues[q](i);
+            }
+            good = good && norm(n - cache.template normal<NSD>(f, q)) == 0
+                   && cache.jxwLeft(f, q) == EL.jxw
+                   && norm(x - cache.xqp(f, q)) == 0;
+            if (er >= 0) {
+                auto &ER = EF_R.getElement(dofm.element_types[er]);
+                ER.face_update<NSD>(er, q, right_local, dofm);
+                good = good && cache.jxwRight(f, q) == ER.jxw;
+            }
+        }
+    }
+    return good;
+}
+
+// Boundary measure, interior measure and the integral of the boundary normal
+template<int NSD>
+bool measures(Mesh M, int polyOrder, double boundary_measure, double interior_measure)
+{
+    M.buildInternalFaces();
+    DoFManager dofm(M, DoFManager::ManagerType::DG, polyOrder, 1);
+    FESystem feSystem(dofm, NSD);
+    auto const &cache = feSystem.getFaceGeometryCache(NSD);
+
+    double boundary{0}, interior{0};
+    Tensor<NSD, 1> normal_integral(0);
+    bool outward = true;
+    for (int f = 0; f < cache.nFaces(); ++f) {
+        for (int q = 0; q < cache.nFaceQP(f); ++q) {
+            auto n = cache.template normal<NSD>(f, q);
+            if (cache.isBoundary(f)) {
+                boundary += cache.jxwLeft(f, q);
+                normal_integral += n * cache.jxwLeft(f, q);
+                // The domain is the unit square/cube, centered at 1/2
+                double outer{0};
+                for (int i = 0; i < NSD; ++i) {
+                    outer += n(i) * (cache.xqp(f, q)(i) - 0.5);
+                }
+                outward = outward && outer > 0;
+            } else {
+                interior += cache.jxwLeft(f, q);
+            }
+        }
+    }
+    return outward && std::abs(boundary - boundary_measure) < 1e-12
+           && std::abs(interior - interior_measure) < 1e-12
+           && norm(normal_integral) < 1e-12;
+}
+
+
+// Quads, triangles and hexes against face_update
+bool test_1()
+{
+    return matches_face_update<2>(test_meshes::quadMesh(4, 1.2, 0.2), 2)
+           && matches_face_update<2>(test_meshes::triMesh(4), 3)
+           && matches_face_update<3>(test_meshes::hexMesh(2, 1.3), 2);
+}
+
+
+// Measures of the unit square (boundary 4) and cube (boundary 6), and of their interior faces
+bool test_2()
+{
+    return measures<2>(test_meshes::quadMesh(5), 2, 4.0, 8.0)
+           && measures<2>(test_meshes::triMesh(4), 1, 4.0, 6.0 + 4 * std::sqrt(2.0))
+           && measures<3>(test_meshes::hexMesh(3), 1, 6.0, 6.0);
+}
+
+
+int main()
+{
+    int retval = 0;
+    if (!test_1()) {
+        std::cerr << "Failed test_1()" << std::endl;
+        retval |= 1 << 0;
+    }
+    if (!test_2()) {
+        std::cerr << "Failed test_2()" << std::endl;
+        retval |= 1 << 1;
+    }
+
+    return retval;
+}
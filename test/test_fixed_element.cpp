@@ -0,0 +1,192 @@
+#include "yafel_globals.hpp"
+#include "assembly/CGAssembly.hpp"
+#include "element/FixedElement.hpp"
+#include "test_meshes.hpp"
+
+#include <Eigen/Core>
+#include <Eigen/Sparse>
+#include <atomic>
+#include <iostream>
+#include <type_traits>
+
+using namespace yafel;
+
+/*
+ * CGAssembly sends linear/quadratic elements of a generically written Physics through
+ * the fixed-size FixedElement kernels. Those must give the same tangent and residual
+ * as the dynamic Element path, which is forced here by a Physics that only accepts
+ * Element and dynamic Eigen maps.
+ */
+
+std::atomic<int> fixed_calls{0};
+
+// Nonlinear scalar diffusion with a source
+template<int NSD>
+struct ScalarPhysics
+{
+    static constexpr int nsd() { return NSD; }
+
+    template<typename ElementT, typename PointT, typename VectorT>
+    static void LocalResidual(const ElementT &E, int qpi, PointT &x, double, VectorT &u_el, VectorT &R_el)
+    {
+        if constexpr (!std::is_same<ElementT, Element>::value) {
+            ++fixed_calls;
+        }
+        double u = E.shapeValues[qpi].dot(u_el);
+        R_el += (x(0) + u * u) * E.shapeValues[qpi] * E.jxw;
+    }
+
+    template<typename ElementT, typename PointT, typename VectorT, typename MatrixT>
+    static void LocalTangent(const ElementT &E, int qpi, PointT &, double, VectorT &u_el, MatrixT &K_el)
+    {
+        double u = E.shapeValues[qpi].dot(u_el);
+        K_el += (1 + u * u) * E.shapeGrad * E.shapeGrad.transpose() * E.jxw;
+    }
+};
+
+// Vector Laplacian with a grad-div coupling, NSD dofs per node
+template<int NSD>
+struct VectorPhysics
+{
+    static constexpr int nsd() { return NSD; }
+
+    static constexpr int dofPerNode() { return NSD; }
+
+    template<typename ElementT, typename PointT, typename VectorT>
+    static void LocalResidual(const ElementT &E, int qpi, PointT &x, double, VectorT &u_el, VectorT &R_el)
+    {
+        if constexpr (!std::is_same<ElementT, Element>::value) {
+            ++fixed_calls;
+        }
+        const int nNodes = static_cast<int>(E.shapeValues[qpi].rows());
+        for (int i = 0; i < NSD; ++i) {
+            double u{0};
+            for (int B = 0; B < nNodes; ++B) {
+                u += E.shapeValues[qpi](B) * u_el(B * NSD + i);
+            }
+            for (int A = 0; A < nNodes; ++A) {
+                R_el(A * NSD + i) += E.shapeValues[qpi](A) * (x(i) + u) * E.jxw;
+            }
+        }
+    }
+
+    template<typename ElementT, typename PointT, typename VectorT, typename MatrixT>
+    static void LocalTangent(const ElementT &E, int, PointT &, double, VectorT &, MatrixT &K_el)
+    {
+        const int nNodes = static_cast<int>(E.shapeGrad.rows());
+        for (int A = 0; A < nNodes; ++A) {
+            for (int B = 0; B < nNodes; ++B) {
+                double gAgB = E.shapeGrad.row(A).dot(E.shapeGrad.row(B));
+                for (int i = 0; i < NSD; ++i) {
+                    K_el(A * NSD + i, B * NSD + i) += gAgB * E.jxw;
+                    for (int j = 0; j < NSD; ++j) {
+                        K_el(A * NSD + i, B * NSD + j) += E.shapeGrad(A, i) * E.shapeGrad(B, j) * E.jxw;
+                    }
+                }
+            }
+        }
+    }
+};
+
+// Same kernels, only callable with the dynamic Element and Eigen maps
+template<typename Physics>
+struct DynamicOnly
+{
+    using VectorMap = Eigen::Map<Eigen::Matrix<double, Eigen::Dynamic, 1>>;
+    using MatrixMap = Eigen::Map<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>>;
+
+    static constexpr int nsd() { return Physics::nsd(); }
+
+    static void LocalResidual(const Element &E, int qpi, coordinate<> &x, double t, VectorMap &u_el,
+                              VectorMap &R_el)
+    {
+        Physics::LocalResidual(E, qpi, x, t, u_el, R_el);
+    }
+
+    static void LocalTangent(const Element &E, int qpi, coordinate<> &x, double t, VectorMap &u_el,
+                             MatrixMap &K_el)
+    {
+        Physics::LocalTangent(E, qpi, x, t, u_el, K_el);
+    }
+};
+
+
+// Fixed and dynamic assembly agree on the mesh, and the fixed kernels were used
+template<typename Physics>
+bool fixed_matches_dynamic(const Mesh &M, int polyOrder, int dofPerNode)
+{
+    DoFManager dofm(M, DoFManager::ManagerType::CG, polyOrder, dofPerNode);
+
+    FESystem fixedSystem(dofm, Physics::nsd());
+    FESystem dynamicSystem(dofm, Physics::nsd());
+    Eigen::VectorXd U = Eigen::VectorXd::Random(fixedSystem.getSolution().rows());
+    fixedSystem.getSolution() = U;
+    dynamicSystem.getSolution() = U;
+
+    fixed_calls = 0;
+    CGAssembly<Physics>(fixedSystem);
+    bool used_fixed = fixed_calls > 0;
+    CGAssembly<DynamicOnly<Physics>>(dynamicSystem);
+    bool used_dynamic = fixed_calls > 0;
+    fixed_calls = 0;
+
+    Eigen::SparseMatrix<double> dK = fixedSystem.getGlobalTangent() - dynamicSystem.getGlobalTangent();
+    Eigen::VectorXd dR = fixedSystem.getGlobalResidual() - dynamicSystem.getGlobalResidual();
+    double Knorm = dynamicSystem.getGlobalTangent().norm();
+    double Rnorm = dynamicSystem.getGlobalResidual().norm();
+
+    return used_fixed && used_dynamic && Knorm > 0 && Rnorm > 0
+           && dK.norm() <= 1.0e-12 * Knorm && dR.norm() <= 1.0e-12 * Rnorm;
+}
+
+
+// Scalar physics: triangles and quads (p = 1, 2), hexes (p = 1, 2)
+bool test_1()
+{
+    return fixed_matches_dynamic<ScalarPhysics<2>>(test_meshes::triMesh(4), 1, 1)
+           && fixed_matches_dynamic<ScalarPhysics<2>>(test_meshes::triMesh(4), 2, 1)
+           && fixed_matches_dynamic<ScalarPhysics<2>>(test_meshes::quadMesh(4, 1.2, 0.2), 1, 1)
+           && fixed_matches_dynamic<ScalarPhysics<2>>(test_meshes::quadMesh(4, 1.2, 0.2), 2, 1)
+           && fixed_matches_dynamic<ScalarPhysics<3>>(test_meshes::hexMesh(2, 1.3), 1, 1)
+           && fixed_matches_dynamic<ScalarPhysics<3>>(test_meshes::hexMesh(2, 1.3), 2, 1);
+}
+
+
+// Vector physics (NSD dofs per node): quads, triangles and hexes
+bool test_2()
+{
+    return fixed_matches_dynamic<VectorPhysics<2>>(test_meshes::quadMesh(4, 1.2, 0.2), 2, 2)
+           && fixed_matches_dynamic<VectorPhysics<2>>(test_meshes::triMesh(3), 1, 2)
+           && fixed_matches_dynamic<VectorPhysics<3>>(test_meshes::hexMesh(2, 1.3), 1, 3);
+}
+
+
+// Higher orders are not fixed: assembly falls back to the dynamic path
+bool test_3()
+{
+    DoFManager dofm(test_meshes::quadMesh(3), DoFManager::ManagerType::CG, 3, 1);
+    FESystem feSystem(dofm, 2);
+    fixed_calls = 0;
+    CGAssembly<ScalarPhysics<2>>(feSystem);
+    return fixed_calls == 0 && feSystem.getGlobalResidual().norm() > 0;
+}
+
+
+int main()
+{
+    int retval = 0;
+    if (!test_1()) {
+        std::cerr << "Failed test_1()" << std::endl;
+        retval |= 1 << 0;
+    }
+    if (!test_2()) {
+        std::cerr << "Failed test_2()" << std::endl;
+        retval |= 1 << 1;
+    }
+    if (!test_3()) {
+        std::cerr << "Failed test_3()" << std::endl;
+        retval |= 1 << 2;
+    }
+
+    return retval;
+}
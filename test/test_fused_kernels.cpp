@@ -0,0 +1,251 @@
+#include "yafel_globals.hpp"
+#include "assembly/CGAssembly.hpp"
+#include "test_meshes.hpp"
+
+#include <Eigen/Core>
+#include <Eigen/Sparse>
+#include <atomic>
+#include <cmath>
+#include <iostream>
+
+using namespace yafel;
+
+/*
+ * A Physics with LocalResidualAndTangent gets one fused call per quadrature point
+ * when both the tangent and the residual are required, and its separate kernels
+ * otherwise, with the same result as a Physics without the fused kernel. With
+ * needsXqp() == false the quadrature point coordinates are not interpolated.
+ * Checked on the dynamic (p = 3), fixed-size (p = 2) and batched (p = 1) paths.
+ */
+
+std::atomic<int> separate_calls{0};
+std::atomic<int> fused_calls{0};
+std::atomic<int> nonzero_xqp{0};
+
+// Nonlinear diffusion with a source
+template<int NSD>
+struct Diffusion
+{
+    static constexpr int nsd() { return NSD; }
+
+    template<typename ElementT, typename PointT, typename VectorT>
+    static void LocalResidual(const ElementT &E, int qpi, PointT &x, double, VectorT &u_el, VectorT &R_el)
+    {
+        ++separate_calls;
+        double u = E.shapeValues[qpi].dot(u_el);
+        R_el += (x(0) + u * u) * E.shapeValues[qpi] * E.jxw;
+    }
+
+    template<typename ElementT, typename PointT, typename VectorT, typename MatrixT>
+    static void LocalTangent(const ElementT &E, int qpi, PointT &, double, VectorT &u_el, MatrixT &K_el)
+    {
+        ++separate_calls;
+        double u = E.shapeValues[qpi].dot(u_el);
+        K_el += (1 + u * u) * E.shapeGrad * E.shapeGrad.transpose() * E.jxw;
+    }
+};
+
+// Same physics, with the solution at the quadrature point evaluated once for both
+template<int NSD>
+struct FusedDiffusion : Diffusion<NSD>
+{
+    template<typename ElementT, typename PointT, typename VectorT, typename MatrixT>
+    static void LocalResidualAndTangent(const ElementT &E, int qpi, PointT &x, double, VectorT &u_el,
+                                        VectorT &R_el, MatrixT &K_el)
+    {
+        ++fused_calls;
+        double u = E.shapeValues[qpi].dot(u_el);
+        R_el += (x(0) + u * u) * E.shapeValues[qpi] * E.jxw;
+        K_el += (1 + u * u) * E.shapeGrad * E.shapeGrad.transpose() * E.jxw;
+    }
+};
+
+// Batched kernels for FusedDiffusion, separate and fused
+template<int NSD>
+struct BatchedFusedDiffusion : FusedDiffusion<NSD>
+{
+    static constexpr int batchWidth() { return 4; }
+
+    template<typename B>
+    static typename B::Lanes interpolate(const B &batch, int qpi, const typename B::LocalVector &u_el)
+    {
+        typename B::Lanes u = B::Lanes::Zero();
+        for (int A = 0; A < B::n_nodes; ++A) {
+            u += batch.shapeValue(qpi, A) * u_el[A];
+        }
+        return u;
+    }
+
+    template<typename B>
+    static void residual(const B &batch, int qpi, const typename B::Point &x,
+                         const typename B::Lanes &u, typename B::LocalVector &R_el)
+    {
+        typename B::Lanes s = (x[0] + u * u) * batch.jxw;
+        for (int A = 0; A < B::n_nodes; ++A) {
+            R_el[A] += batch.shapeValue(qpi, A) * s;
+        }
+    }
+
+    template<typename B>
+    static void tangent(const B &batch, const typename B::Lanes &u, typename B::LocalMatrix &K_el)
+    {
+        typename B::Lanes c = (1 + u * u) * batch.jxw;
+        for (int A = 0; A < B::n_nodes; ++A) {
+            for (int Bn = 0; Bn < B::n_nodes; ++Bn) {
+                typename B::Lanes g = batch.grad(A, 0) * batch.grad(Bn, 0);
+                for (int d = 1; d < NSD; ++d) {
+                    g += batch.grad(A, d) * batch.grad(Bn, d);
+                }
+                K_el[A * B::n_nodes + Bn] += g * c;
+            }
+        }
+    }
+
+    template<typename B>
+    static void LocalResidualBatch(const B &batch, int qpi, const typename B::Point &x, double,
+                                   const typename B::LocalVector &u_el, typename B::LocalVector &R_el)
+    {
+        ++separate_calls;
+        residual(batch, qpi, x, interpolate(batch, qpi, u_el), R_el);
+    }
+
+    template<typename B>
+    static void LocalTangentBatch(const B &batch, int qpi, const typename B::Point &, double,
+                                  const typename B::LocalVector &u_el, typename B::LocalMatrix &K_el)
+    {
+        ++separate_calls;
+        tangent(batch, interpolate(batch, qpi, u_el), K_el);
+    }
+
+    template<typename B>
+    static void LocalResidualAndTangentBatch(const B &batch, int qpi, const typename B::Point &x, double,
+                                             const typename B::LocalVector &u_el,
+                                             typename B::LocalVector &R_el, typename B::LocalMatrix &K_el)
+    {
+        ++fused_calls;
+        typename B::Lanes u = interpolate(batch, qpi, u_el);
+        residual(batch, qpi, x, u, R_el);
+        tangent(batch, u, K_el);
+    }
+};
+
+// Records whether any quadrature point coordinates were nonzero
+template<int NSD, bool NeedsXqp>
+struct XqpProbe
+{
+    static constexpr int nsd() { return NSD; }
+
+    static constexpr bool needsXqp() { return NeedsXqp; }
+
+    template<typename ElementT, typename PointT, typename VectorT>
+    static void LocalResidual(const ElementT &E, int qpi, PointT &x, double, VectorT &, VectorT &R_el)
+    {
+        if (std::abs(x(0)) + std::abs(x(1)) > 0) {
+            ++nonzero_xqp;
+        }
+        R_el += E.shapeValues[qpi] * E.jxw;
+    }
+
+    template<typename ElementT, typename PointT, typename VectorT, typename MatrixT>
+    static void LocalTangent(const ElementT &E, int, PointT &, double, VectorT &, MatrixT &K_el)
+    {
+        K_el += E.shapeGrad * E.shapeGrad.transpose() * E.jxw;
+    }
+};
+
+
+// Fused and separate kernels assemble the same system, and the fused one is used
+template<typename Fused, typename Reference>
+bool fused_matches(const Mesh &M, int polyOrder)
+{
+    DoFManager dofm(M, DoFManager::ManagerType::CG, polyOrder, 1);
+    FESystem fusedSystem(dofm, Fused::nsd());
+    FESystem referenceSystem(dofm, Reference::nsd());
+    Eigen::VectorXd U = Eigen::VectorXd::Random(fusedSystem.getSolution().rows());
+    fusedSystem.getSolution() = U;
+    referenceSystem.getSolution() = U;
+
+    separate_calls = 0;
+    fused_calls = 0;
+    CGAssembly<Fused>(fusedSystem);
+    bool only_fused = fused_calls > 0 && separate_calls == 0;
+    CGAssembly<Reference>(referenceSystem);
+
+    Eigen::SparseMatrix<double> dK = fusedSystem.getGlobalTangent() - referenceSystem.getGlobalTangent();
+    Eigen::VectorXd dR = fusedSystem.getGlobalResidual() - referenceSystem.getGlobalResidual();
+    return only_fused
+           && dK.norm() <= 1.0e-12 * referenceSystem.getGlobalTangent().norm()
+           && dR.norm() <= 1.0e-12 * referenceSystem.getGlobalResidual().norm();
+}
+
+
+// Dynamic, fixed-size and batched paths; triangles, quads and hexes
+bool test_1()
+{
+    return fused_matches<FusedDiffusion<2>, Diffusion<2>>(test_meshes::quadMesh(5, 1.2, 0.2), 3)
+           && fused_matches<FusedDiffusion<2>, Diffusion<2>>(test_meshes::quadMesh(5, 1.2, 0.2), 2)
+           && fused_matches<FusedDiffusion<2>, Diffusion<2>>(test_meshes::triMesh(5), 2)
+           && fused_matches<BatchedFusedDiffusion<2>, Diffusion<2>>(test_meshes::quadMesh(5, 1.2, 0.2), 1)
+           && fused_matches<BatchedFusedDiffusion<3>, Diffusion<3>>(test_meshes::hexMesh(3, 1.3), 1);
+}
+
+
+// With only one of tangent and residual required, the separate kernels are called
+bool test_2()
+{
+    bool good = true;
+    for (int p : {1, 2, 3}) {
+        DoFManager dofm(test_meshes::quadMesh(4), DoFManager::ManagerType::CG, p, 1);
+        FESystem feSystem(dofm, 2);
+
+        separate_calls = 0;
+        fused_calls = 0;
+        CGAssembly<BatchedFusedDiffusion<2>>(feSystem, {AssemblyRequirement::Residual});
+        good = good && fused_calls == 0 && separate_calls > 0;
+
+        separate_calls = 0;
+        CGAssembly<FusedDiffusion<2>>(feSystem, {AssemblyRequirement::Tangent});
+        good = good && fused_calls == 0 && separate_calls > 0;
+    }
+    return good;
+}
+
+
+// needsXqp() == false leaves the quadrature point coordinates at zero
+bool test_3()
+{
+    bool good = true;
+    for (int p : {1, 2, 3}) {
+        DoFManager dofm(test_meshes::quadMesh(4), DoFManager::ManagerType::CG, p, 1);
+        FESystem feSystem(dofm, 2);
+
+        nonzero_xqp = 0;
+        CGAssembly<XqpProbe<2, true>>(feSystem);
+        good = good && nonzero_xqp > 0;
+
+        nonzero_xqp = 0;
+        CGAssembly<XqpProbe<2, false>>(feSystem);
+        good = good && nonzero_xqp == 0;
+    }
+    return good;
+}
+
+
+int main()
+{
+    int retval = 0;
+    if (!test_1()) {
+        std::cerr << "Failed test_1()" << std::endl;
+        retval |= 1 << 0;
+    }
+    if (!test_2()) {
+        std::cerr << "Failed test_2()" << std::endl;
+        retval |= 1 << 1;
+    }
+    if (!test_3()) {
+        std::cerr << "Failed test_3()" << std::endl;
+        retval |= 1 << 2;
+    }
+
+    return retval;
+}
@@ -0,0 +1,165 @@
+#include "yafel_globals.hpp"
+#include "assembly/CGAssembly.hpp"
+#include "element/ElementFactory.hpp"
+#include "fe_system/GeometryCache.hpp"
+#include "test_meshes.hpp"
+
+#include <Eigen/Core>
+#include <Eigen/Sparse>
+#include <iostream>
+#include <stdexcept>
+
+using namespace yafel;
+
+/*
+ * Element::update with a GeometryCache must reproduce the on-the-fly evaluation, for
+ * cached elements as well as for the elements left out by a small memory budget.
+ */
+
+template<int NSD>
+struct Diffusion
+{
+    static constexpr int nsd() { return NSD; }
+
+    template<typename ElementT, typename PointT, typename VectorT>
+    static void LocalResidual(const ElementT &E, int qpi, PointT &, double, VectorT &, VectorT &R_el)
+    {
+        R_el += E.shapeValues[qpi] * E.jxw;
+    }
+
+    template<typename ElementT, typename PointT, typename VectorT, typename MatrixT>
+    static void LocalTangent(const ElementT &E, int, PointT &, double, VectorT &, MatrixT &K_el)
+    {
+        K_el += E.shapeGrad * E.shapeGrad.transpose() * E.jxw;
+    }
+};
+
+
+// Cached and on-the-fly element values agree for every element and quadrature point
+template<int NSD>
+bool update_matches(const DoFManager &dofm, std::size_t budget)
+{
+    GeometryCache cache(dofm, NSD, budget);
+    if (cache.memoryUsage() > budget) {
+        return false;
+    }
+
+    ElementFactory EF_cached;
+    ElementFactory EF_direct;
+    bool good = true;
+    for (int e = 0; e < dofm.nCells(); ++e) {
+        // elements are cached in order, up to the budget
+        good = good && (cache.contains(e) == (e < cache.nCachedElements()));
+
+        auto &Ec = EF_cached.getElement(dofm.element_types[e]);
+        auto &Ed = EF_direct.getElement(dofm.element_types[e]);
+        for (int qpi = 0; qpi < Ec.nQP(); ++qpi) {
+            Ec.update<NSD>(e, qpi, dofm, &cache);
+            Ed.update<NSD>(e, qpi, dofm);
+            good = good && Ec.jxw == Ed.jxw && Ec.shapeGrad == Ed.shapeGrad && Ec.globalNodes == Ed.globalNodes;
+        }
+    }
+    return good;
+}
+
+
+// Full and partial caches, quads/triangles (p = 2) and hexes (p = 1)
+bool test_1()
+{
+    DoFManager dofm_quad(test_meshes::quadMesh(5, 1.2, 0.2), DoFManager::ManagerType::CG, 2, 1);
+    DoFManager dofm_tri(test_meshes::triMesh(5), DoFManager::ManagerType::CG, 2, 1);
+    DoFManager dofm_hex(test_meshes::hexMesh(3, 1.3), DoFManager::ManagerType::CG, 1, 1);
+
+    return update_matches<2>(dofm_quad, GeometryCache::default_memory_budget)
+           && update_matches<2>(dofm_quad, 20000)
+           && update_matches<2>(dofm_tri, GeometryCache::default_memory_budget)
+           && update_matches<2>(dofm_tri, 5000)
+           && update_matches<3>(dofm_hex, GeometryCache::default_memory_budget)
+           && update_matches<3>(dofm_hex, 10000)
+           && update_matches<3>(dofm_hex, 0);
+}
+
+
+// CGAssembly gives the same tangent and residual with the cache disabled, partial or full
+bool test_2()
+{
+    using Physics = Diffusion<2>;
+    DoFManager dofm(test_meshes::quadMesh(6, 1.2, 0.2), DoFManager::ManagerType::CG, 2, 1);
+
+    Eigen::SparseMatrix<double> K_ref;
+    Eigen::VectorXd R_ref;
+    bool good = true;
+    for (std::size_t budget : {std::size_t(0), std::size_t(30000), GeometryCache::default_memory_budget}) {
+        FESystem feSystem(dofm, Physics::nsd());
+        feSystem.setGeometryCacheBudget(budget);
+        good = good && ((budget == 0) == (feSystem.getGeometryCache(2) == nullptr));
+
+        CGAssembly<Physics>(feSystem);
+        Eigen::SparseMatrix<double> K = feSystem.getGlobalTangent();
+        Eigen::VectorXd R = feSystem.getGlobalResidual();
+        if (budget == 0) {
+            K_ref = K;
+            R_ref = R;
+        } else {
+            good = good && (K - K_ref).norm() == 0 && (R - R_ref).norm() == 0;
+        }
+    }
+    return good;
+}
+
+
+/*
+ * Same with Gauss-Lobatto quadrature on the DoFManager (p = 1..3, where the Lobatto and
+ * Legendre rules have the same number of points for p = 1, 2): the cache is built with
+ * the DoFManager's rule, so the assembly elements must be too. An element of the other
+ * rule is rejected by Element::update.
+ */
+bool test_3()
+{
+    using Physics = Diffusion<2>;
+    bool good = true;
+    for (int p = 1; p <= 3; ++p) {
+        DoFManager dofm(test_meshes::quadMesh(5, 1.2, 0.2), DoFManager::ManagerType::CG, p, 1);
+        dofm.quadratureType = QuadratureRule::QuadratureType::GAUSS_LOBATTO;
+
+        FESystem uncached(dofm, Physics::nsd());
+        uncached.setGeometryCacheBudget(0);
+        CGAssembly<Physics>(uncached);
+
+        FESystem cached(dofm, Physics::nsd());
+        CGAssembly<Physics>(cached);
+
+        auto const &K_ref = uncached.getGlobalTangent();
+        auto const &R_ref = uncached.getGlobalResidual();
+        good = good && cached.getGeometryCache(2) != nullptr
+               && (cached.getGlobalTangent() - K_ref).norm() <= 1.0e-13 * K_ref.norm()
+               && (cached.getGlobalResidual() - R_ref).norm() <= 1.0e-13 * R_ref.norm();
+
+        ElementFactory EF_legendre;
+        try {
+            EF_legendre.getElement(dofm.element_types[0]).update<2>(0, 0, dofm, cached.getGeometryCache(2));
+            good = false;
+        } catch (std::runtime_error &) {}
+    }
+    return good;
+}
+
+
+int main()
+{
+    int retval = 0;
+    if (!test_1()) {
+        std::cerr << "Failed test_1()" << std::endl;
+        retval |= 1 << 0;
+    }
+    if (!test_2()) {
+        std::cerr << "Failed test_2()" << std::endl;
+        retval |= 1 << 1;
+    }
+    if (!test_3()) {
+        std::cerr << "Failed test_3()" << std::endl;
+        retval |= 1 << 2;
+    }
+
+    return retval;
+}
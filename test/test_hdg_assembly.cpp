@@ -0,0 +1,211 @@
+#include "yafel_globals.hpp"
+#include "assembly/HDGAssembly.hpp"
+#include "fe_system/HDGSystem.hpp"
+#include "test_meshes.hpp"
+
+#include <Eigen/SparseLU>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+using namespace yafel;
+
+/*
+ * HDGAssembly condenses an LDG-H discretization of -div(grad u) = f onto the face
+ * traces. Solving the skeleton system and recovering the element interiors must be
+ * exact for a quadratic solution when p >= 2, converge for a smooth one, and leave a
+ * skeleton system much smaller than the volume one.
+ */
+
+// u = x^2 + 2 y^2
+struct Quadratic
+{
+    static double u(const coordinate<> &x) { return x(0) * x(0) + 2 * x(1) * x(1); }
+
+    static Tensor<2, 1> q(const coordinate<> &x) { return {-2 * x(0), -4 * x(1)}; }
+
+    static double f(const coordinate<> &) { return -6; }
+};
+
+// u = sin(pi x) sin(pi y)
+struct Smooth
+{
+    static constexpr double pi = 3.14159265358979323846;
+
+    static double u(const coordinate<> &x) { return std::sin(pi * x(0)) * std::sin(pi * x(1)); }
+
+    static Tensor<2, 1> q(const coordinate<> &x)
+    {
+        return {-pi * std::cos(pi * x(0)) * std::sin(pi * x(1)), -pi * std::sin(pi * x(0)) * std::cos(pi * x(1))};
+    }
+
+    static double f(const coordinate<> &x) { return 2 * pi * pi * u(x); }
+};
+
+// Unknowns per node: u, q_x, q_y; q + grad(u) = 0, div(q) = f, qhat.n = q.n + tau (u - uhat)
+template<typename Solution>
+struct LDGHPoisson
+{
+    static constexpr double tau = 1.0;
+
+    static constexpr int nsd() { return 2; }
+
+    static constexpr int dofPerNode() { return 3; }
+
+    static double BoundaryTrace(const coordinate<> &x, double) { return Solution::u(x); }
+
+    template<typename TA, typename TF>
+    static void LocalVolume(const Element &E, int qpi, const coordinate<> &x, double,
+                            Eigen::MatrixBase<TA> &A, Eigen::MatrixBase<TF> &F)
+    {
+        const auto &N = E.shapeValues[qpi];
+        for (int a = 0; a < N.rows(); ++a) {
+            F(3 * a) += Solution::f(x) * N(a) * E.jxw;
+            for (int b = 0; b < N.rows(); ++b) {
+                for (int i = 0; i < 2; ++i) {
+                    A(3 * a + 1 + i, 3 * b + 1 + i) += N(a) * N(b) * E.jxw;
+                    A(3 * a + 1 + i, 3 * b) -= E.shapeGrad(a, i) * N(b) * E.jxw;
+                    A(3 * a, 3 * b + 1 + i) -= E.shapeGrad(a, i) * N(b) * E.jxw;
+                }
+            }
+        }
+    }
+
+    template<typename TA, typename TB, typename TC, typename TD>
+    static void LocalFace(const Element &E, int fqpi, const std::vector<int> &face_nodes,
+                          const Tensor<2, 1> &n, const coordinate<> &, double,
+                          Eigen::MatrixBase<TA> &A, Eigen::MatrixBase<TB> &B,
+                          Eigen::MatrixBase<TC> &C, Eigen::MatrixBase<TD> &D)
+    {
+        const auto &N = E.boundaryShapeValues[fqpi];
+        for (int a = 0; a < static_cast<int>(face_nodes.size()); ++a) {
+            const int ua = 3 * face_nodes[a];
+            for (int b = 0; b < static_cast<int>(face_nodes.size()); ++b) {
+                const int ub = 3 * face_nodes[b];
+                const double NN = N(a) * N(b) * E.jxw;
+                for (int i = 0; i < 2; ++i) {
+                    B(ua + 1 + i, b) += NN * n(i);
+                    A(ua, ub + 1 + i) += NN * n(i);
+                    C(a, ub + 1 + i) += NN * n(i);
+                }
+                A(ua, ub) += tau * NN;
+                B(ua, b) -= tau * NN;
+                C(a, ub) += tau * NN;
+                D(a, b) -= tau * NN;
+            }
+        }
+    }
+};
+
+
+// Assemble, solve the skeleton system, recover; max nodal errors in u and q
+template<typename Solution>
+void hdg_solve(Mesh &M, int p, double &u_error, double &q_error, int &n_skeleton, int &n_volume)
+{
+    DoFManager dofm(M, DoFManager::ManagerType::DG, p, 3);
+    FESystem feSystem(dofm, 2);
+    HDGSystem hdg(feSystem, 2);
+    LDGHPoisson<Solution> physics;
+    HDGAssembly(hdg, physics);
+
+    Eigen::SparseMatrix<double> K = hdg.getGlobalTangent();
+    Eigen::SparseLU<Eigen::SparseMatrix<double>> solver;
+    solver.compute(K);
+    hdg.recover(solver.solve(hdg.getGlobalResidual()));
+
+    auto const &U = feSystem.getSolution();
+    u_error = 0;
+    q_error = 0;
+    for (int i = 0; i < dofm.nNodes(); ++i) {
+        auto const &x = dofm.dof_nodes[i];
+        u_error = std::max(u_error, std::abs(U(3 * i) - Solution::u(x)));
+        for (int d = 0; d < 2; ++d) {
+            q_error = std::max(q_error, std::abs(U(3 * i + 1 + d) - Solution::q(x)(d)));
+        }
+    }
+    n_skeleton = hdg.nSkeletonDofs();
+    n_volume = static_cast<int>(U.rows());
+}
+
+
+// Quadratic solutions are reproduced for p = 2, 3, and the skeleton is the smaller system
+bool test_1()
+{
+    Mesh M = test_meshes::quadMesh(3, 1.3);
+    M.buildInternalFaces();
+    bool good = true;
+    for (int p : {2, 3}) {
+        double u_error, q_error;
+        int n_skeleton, n_volume;
+        hdg_solve<Quadratic>(M, p, u_error, q_error, n_skeleton, n_volume);
+        good = good && u_error < 1e-10 && q_error < 1e-9 && 3 * n_skeleton < n_volume;
+    }
+    return good;
+}
+
+
+// Convergence under refinement, for a smooth solution
+bool test_2()
+{
+    double errors[2];
+    for (int r = 0; r < 2; ++r) {
+        Mesh M = test_meshes::quadMesh(4 << r);
+        M.buildInternalFaces();
+        double q_error;
+        int n_skeleton, n_volume;
+        hdg_solve<Smooth>(M, 1, errors[r], q_error, n_skeleton, n_volume);
+    }
+    return std::log2(errors[0] / errors[1]) > 1.7;
+}
+
+
+// The boundary traces are prescribed, and recover() writes them back with the skeleton solution
+bool test_3()
+{
+    Mesh M = test_meshes::quadMesh(2);
+    M.buildInternalFaces();
+    DoFManager dofm(M, DoFManager::ManagerType::DG, 2, 3);
+    FESystem feSystem(dofm, 2);
+    HDGSystem hdg(feSystem, 2);
+    LDGHPoisson<Quadratic> physics;
+    HDGAssembly(hdg, physics);
+
+    Eigen::VectorXd lambda = Eigen::VectorXd::Constant(hdg.nSkeletonDofs(), 1.5);
+    hdg.recover(lambda);
+    auto const &trace = hdg.getTraceSolution();
+    bool good = trace.head(hdg.nSkeletonDofs()) == lambda && trace.rows() > hdg.nSkeletonDofs();
+    for (int d = hdg.nSkeletonDofs(); d < trace.rows(); ++d) {
+        good = good && trace(d) >= 0 && trace(d) <= 3;
+    }
+
+    // A Physics whose layout differs from the DoFManager's is refused
+    DoFManager scalar_dofm(M, DoFManager::ManagerType::DG, 2, 1);
+    FESystem scalar_system(scalar_dofm, 2);
+    HDGSystem scalar_hdg(scalar_system, 2);
+    try {
+        HDGAssembly(scalar_hdg, physics);
+        return false;
+    } catch (std::runtime_error &) {
+        return good;
+    }
+}
+
+
+int main()
+{
+    int retval = 0;
+    if (!test_1()) {
+        std::cerr << "Failed test_1()" << std::endl;
+        retval |= 1 << 0;
+    }
+    if (!test_2()) {
+        std::cerr << "Failed test_2()" << std::endl;
+        retval |= 1 << 1;
+    }
+    if (!test_3()) {
+        std::cerr << "Failed test_3()" << std::endl;
+        retval |= 1 << 2;
+    }
+
+    return retval;
+}
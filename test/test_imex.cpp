@@ -0,0 +1,411 @@
+#include "yafel_globals.hpp"
+#include "assembly/DGAssembly.hpp"
+#include "time_integration/DGRK4.hpp"
+#include "time_integration/IMEXRK.hpp"
+#include "test_meshes.hpp"
+
+#include <Eigen/Core>
+#include <cmath>
+#include <iostream>
+
+using namespace yafel;
+
+/*
+ * DG tangent assembly and the IMEX Runge-Kutta integrators. The tangent of a linear
+ * DG physics, with its face-neighbor blocks, maps any increment of the solution to the
+ * increment of the residual. IMEXRK converges at its order on a split ODE, and keeps
+ * large steps stable when a stiff relaxation is treated implicitly, where an explicit
+ * integrator with the same step blows up.
+ */
+
+// Upwind advection with a constant velocity, and an affine inflow state
+struct Advection
+{
+    InverseMassOperator inverse_mass;
+
+    static constexpr int nsd() { return 2; }
+
+    static Tensor<2, 1> velocity() { return {1.0, 0.5}; }
+
+    static double inflow(const coordinate<> &x) { return 1 + x(0) + 2 * x(1); }
+
+    template<typename TU, typename TR>
+    static void LocalResidual(const Element &E, int qpi, coordinate<> &, double,
+                              Eigen::MatrixBase<TU> &U_el, Eigen::MatrixBase<TR> &R_el)
+    {
+        double U = E.shapeValues[qpi].dot(U_el);
+        for (int i = 0; i < R_el.rows(); ++i) {
+            auto gradW = make_TensorMap<2, 1>(&E.shapeGrad(i, 0));
+            R_el(i) += U * dot(gradW, velocity()) * E.jxw;
+        }
+    }
+
+    template<typename TU, typename TK>
+    static void LocalTangent(const Element &E, int qpi, coordinate<> &, double,
+                             Eigen::MatrixBase<TU> &, Eigen::MatrixBase<TK> &K_el)
+    {
+        for (int i = 0; i < K_el.rows(); ++i) {
+            auto gradW = make_TensorMap<2, 1>(&E.shapeGrad(i, 0));
+            K_el.row(i) += (dot(gradW, velocity()) * E.jxw) * E.shapeValues[qpi].transpose();
+        }
+    }
+
+    template<typename T>
+    static void LocalMass(const Element &E, int qpi, double, Eigen::MatrixBase<T> &M_el)
+    {
+        M_el += (E.jxw * E.shapeValues[qpi]) * E.shapeValues[qpi].transpose();
+    }
+
+    static double Flux(Tensor<2, 1> n, coordinate<>, double, double Uplus, double Uminus)
+    {
+        double vdotn = dot(n, velocity());
+        return 0.5 * (vdotn * (Uplus + Uminus) + std::abs(vdotn) * (Uplus - Uminus));
+    }
+
+    static double BoundaryFlux(Tensor<2, 1> n, coordinate<> x, double t, double U)
+    {
+        return Flux(n, x, t, U, inflow(x));
+    }
+
+    static void FluxJacobian(Tensor<2, 1> n, coordinate<>, double, double, double,
+                             double &dF_dUplus, double &dF_dUminus)
+    {
+        double vdotn = dot(n, velocity());
+        dF_dUplus = 0.5 * (vdotn + std::abs(vdotn));
+        dF_dUminus = 0.5 * (vdotn - std::abs(vdotn));
+    }
+
+    static void BoundaryFluxJacobian(Tensor<2, 1> n, coordinate<> x, double t, double U, double &dF_dU)
+    {
+        double unused;
+        FluxJacobian(n, x, t, U, inflow(x), dF_dU, unused);
+    }
+};
+
+// Two components advected in opposite directions, with Tensor<2, 1> states
+struct CounterAdvection
+{
+    static constexpr int nsd() { return 2; }
+
+    static constexpr int dofPerNode() { return 2; }
+
+    template<typename TU, typename TR>
+    static void LocalResidual(const Element &E, int qpi, coordinate<> &, double,
+                              Eigen::MatrixBase<TU> &U_el, Eigen::MatrixBase<TR> &R_el)
+    {
+        for (int c = 0; c < 2; ++c) {
+            double U{0};
+            for (int A = 0; A < E.localMesh.nNodes(); ++A) {
+                U += E.shapeValues[qpi](A) * U_el(2 * A + c);
+            }
+            for (int i = 0; i < E.localMesh.nNodes(); ++i) {
+                auto gradW = make_TensorMap<2, 1>(&E.shapeGrad(i, 0));
+                R_el(2 * i + c) += (c == 0 ? 1 : -1) * U * dot(gradW, Advection::velocity()) * E.jxw;
+            }
+        }
+    }
+
+    template<typename TU, typename TK>
+    static void LocalTangent(const Element &E, int qpi, coordinate<> &, double,
+                             Eigen::MatrixBase<TU> &, Eigen::MatrixBase<TK> &K_el)
+    {
+        for (int c = 0; c < 2; ++c) {
+            for (int i = 0; i < E.localMesh.nNodes(); ++i) {
+                auto gradW = make_TensorMap<2, 1>(&E.shapeGrad(i, 0));
+                for (int A = 0; A < E.localMesh.nNodes(); ++A) {
+                    K_el(2 * i + c, 2 * A + c) += (c == 0 ? 1 : -1) * E.shapeValues[qpi](A)
+                                                  * dot(gradW, Advection::velocity()) * E.jxw;
+                }
+            }
+        }
+    }
+
+    static Tensor<2, 1> Flux(Tensor<2, 1> n, coordinate<> x, double t,
+                             const Tensor<2, 1> &Uplus, const Tensor<2, 1> &Uminus)
+    {
+        return {Advection::Flux(n, x, t, Uplus(0), Uminus(0)), Advection::Flux(-1.0 * n, x, t, Uplus(1), Uminus(1))};
+    }
+
+    static Tensor<2, 1> BoundaryFlux(Tensor<2, 1> n, coordinate<> x, double t, const Tensor<2, 1> &U)
+    {
+        return {Advection::BoundaryFlux(n, x, t, U(0)), Advection::BoundaryFlux(-1.0 * n, x, t, U(1))};
+    }
+
+    static void FluxJacobian(Tensor<2, 1> n, coordinate<> x, double t, const Tensor<2, 1> &Uplus,
+                             const Tensor<2, 1> &Uminus, Tensor<2, 2> &dF_dUplus, Tensor<2, 2> &dF_dUminus)
+    {
+        Advection::FluxJacobian(n, x, t, Uplus(0), Uminus(0), dF_dUplus(0, 0), dF_dUminus(0, 0));
+        Advection::FluxJacobian(-1.0 * n, x, t, Uplus(1), Uminus(1), dF_dUplus(1, 1), dF_dUminus(1, 1));
+    }
+
+    static void BoundaryFluxJacobian(Tensor<2, 1> n, coordinate<> x, double t, const Tensor<2, 1> &U,
+                                     Tensor<2, 2> &dF_dU)
+    {
+        Advection::BoundaryFluxJacobian(n, x, t, U(0), dF_dU(0, 0));
+        Advection::BoundaryFluxJacobian(-1.0 * n, x, t, U(1), dF_dU(1, 1));
+    }
+};
+
+// Relaxation -k (U - g) towards the inflow state g, without fluxes
+template<int k>
+struct Relaxation
+{
+    static constexpr int nsd() { return 2; }
+
+    template<typename TU, typename TR>
+    static void LocalResidual(const Element &E, int qpi, coordinate<> &x, double,
+                              Eigen::MatrixBase<TU> &U_el, Eigen::MatrixBase<TR> &R_el)
+    {
+        double U = E.shapeValues[qpi].dot(U_el);
+        R_el -= (k * (U - Advection::inflow(x)) * E.jxw) * E.shapeValues[qpi];
+    }
+
+    template<typename TU, typename TK>
+    static void LocalTangent(const Element &E, int qpi, coordinate<> &, double,
+                             Eigen::MatrixBase<TU> &, Eigen::MatrixBase<TK> &K_el)
+    {
+        K_el -= (k * E.jxw * E.shapeValues[qpi]) * E.shapeValues[qpi].transpose();
+    }
+
+    template<typename T>
+    static void LocalMass(const Element &E, int qpi, double, Eigen::MatrixBase<T> &M_el)
+    {
+        Advection::LocalMass(E, qpi, 0.0, M_el);
+    }
+
+    static double Flux(Tensor<2, 1>, coordinate<>, double, double, double) { return 0; }
+
+    static double BoundaryFlux(Tensor<2, 1>, coordinate<>, double, double) { return 0; }
+
+    static void FluxJacobian(Tensor<2, 1>, coordinate<>, double, double, double, double &dF_dUplus,
+                             double &dF_dUminus)
+    {
+        dF_dUplus = 0;
+        dF_dUminus = 0;
+    }
+
+    static void BoundaryFluxJacobian(Tensor<2, 1>, coordinate<>, double, double, double &dF_dU) { dF_dU = 0; }
+};
+
+// Both terms in one physics, for the fully implicit and the explicit steps
+template<int k>
+struct AdvectionRelaxation : Advection
+{
+    template<typename TU, typename TR>
+    static void LocalResidual(const Element &E, int qpi, coordinate<> &x, double t,
+                              Eigen::MatrixBase<TU> &U_el, Eigen::MatrixBase<TR> &R_el)
+    {
+        Advection::LocalResidual(E, qpi, x, t, U_el, R_el);
+        Relaxation<k>::LocalResidual(E, qpi, x, t, U_el, R_el);
+    }
+
+    template<typename TU, typename TK>
+    static void LocalTangent(const Element &E, int qpi, coordinate<> &x, double t,
+                             Eigen::MatrixBase<TU> &U_el, Eigen::MatrixBase<TK> &K_el)
+    {
+        Advection::LocalTangent(E, qpi, x, t, U_el, K_el);
+        Relaxation<k>::LocalTangent(E, qpi, x, t, U_el, K_el);
+    }
+};
+
+
+// R(U + V) - R(U) = K V for linear physics, with the face-neighbor blocks in K
+// (Gauss-Lobatto: the collocated face path)
+template<typename Physics>
+bool tangent_check(int dof_per_node,
+                   QuadratureRule::QuadratureType quadratureType = QuadratureRule::QuadratureType::GAUSS_LEGENDRE)
+{
+    Mesh M = test_meshes::quadMesh(3, 1.0, 0.2);
+    M.buildInternalFaces();
+    DoFManager dofm(M, DoFManager::ManagerType::DG, 2, dof_per_node);
+    dofm.quadratureType = quadratureType;
+    FESystem feSystem(dofm, 2);
+    Physics physics;
+    using ResidualAndTangent = AssemblyRequirements<AssemblyRequirement::Residual, AssemblyRequirement::Tangent>;
+
+    auto &U = feSystem.getSolution();
+    for (int i = 0; i < U.rows(); ++i) {
+        U(i) = std::sin(0.7 * i);
+    }
+    DGAssembly<Physics, ResidualAndTangent>(feSystem, physics);
+    Eigen::VectorXd R0 = feSystem.getGlobalResidual();
+    Eigen::SparseMatrix<double> K = feSystem.getGlobalTangent();
+
+    Eigen::VectorXd V(U.rows());
+    for (int i = 0; i < V.rows(); ++i) {
+        V(i) = std::cos(1.3 * i);
+    }
+    U += V;
+    DGAssembly<Physics, AssemblyRequirements<AssemblyRequirement::Residual>>(feSystem, physics);
+    Eigen::VectorXd dR = feSystem.getGlobalResidual() - R0;
+
+    // Element blocks alone hold nCells * (9 dof_per_node)^2 entries
+    const int n_local = 9 * dof_per_node;
+    return (dR - K * V).norm() < 1e-12 * dR.norm() && K.nonZeros() > dofm.nCells() * n_local * n_local;
+}
+
+bool test_1()
+{
+    return tangent_check<Advection>(1) && tangent_check<CounterAdvection>(2)
+           && tangent_check<Advection>(1, QuadratureRule::QuadratureType::GAUSS_LOBATTO)
+           && tangent_check<CounterAdvection>(2, QuadratureRule::QuadratureType::GAUSS_LOBATTO);
+}
+
+
+// dU/dt = cos(t) - U at every node: cos(t) explicit, -U implicit
+struct Forcing
+{
+    static constexpr int nsd() { return 2; }
+
+    template<typename TU, typename TR>
+    static void LocalResidual(const Element &E, int qpi, coordinate<> &, double t,
+                              Eigen::MatrixBase<TU> &, Eigen::MatrixBase<TR> &R_el)
+    {
+        R_el += (std::cos(t) * E.jxw) * E.shapeValues[qpi];
+    }
+
+    static double Flux(Tensor<2, 1>, coordinate<>, double, double, double) { return 0; }
+
+    static double BoundaryFlux(Tensor<2, 1>, coordinate<>, double, double) { return 0; }
+};
+
+struct Decay : Relaxation<1>
+{
+    template<typename TU, typename TR>
+    static void LocalResidual(const Element &E, int qpi, coordinate<> &, double,
+                              Eigen::MatrixBase<TU> &U_el, Eigen::MatrixBase<TR> &R_el)
+    {
+        R_el -= (E.shapeValues[qpi].dot(U_el) * E.jxw) * E.shapeValues[qpi];
+    }
+};
+
+double split_error(IMEXRK::Scheme scheme, int nSteps)
+{
+    Mesh M = test_meshes::quadMesh(2);
+    M.buildInternalFaces();
+    DoFManager dofm(M, DoFManager::ManagerType::DG, 1, 1);
+    FESystem feSystem(dofm, 2);
+    feSystem.getSolution().setConstant(2.0);
+    Forcing forcing;
+    Decay decay;
+    IMEXRK imex(1.0 / nSteps, scheme);
+    for (int n = 0; n < nSteps; ++n) {
+        imex.step(feSystem, forcing, decay);
+    }
+    const double exact = 1.5 * std::exp(-1.0) + 0.5 * (std::cos(1.0) + std::sin(1.0));
+    return (feSystem.getSolution().array() - exact).abs().maxCoeff();
+}
+
+// Convergence at the order of each scheme
+bool test_2()
+{
+    bool good = true;
+    for (auto scheme : {IMEXRK::Scheme::ARS111, IMEXRK::Scheme::ARS222, IMEXRK::Scheme::ARS443}) {
+        const double rate = std::log2(split_error(scheme, 10) / split_error(scheme, 20));
+        good = good && rate > IMEXRK(1.0, scheme).order() - 0.3;
+    }
+    return good;
+}
+
+
+// Stiff relaxation (k = 1e5): steps 100x over the explicit limit 2.8/k stay stable and relax to g
+bool test_3()
+{
+    Mesh M = test_meshes::quadMesh(8);
+    M.buildInternalFaces();
+    DoFManager dofm(M, DoFManager::ManagerType::DG, 1, 1);
+    const double dt = 0.01;
+    const int nSteps = 20;
+    bool good = dt > 100 * 2.8e-5;
+
+    auto relaxation_error = [&dofm](const Eigen::VectorXd &U) {
+        double error{0};
+        for (int i = 0; i < U.rows(); ++i) {
+            error = std::max(error, std::abs(U(i) - Advection::inflow(dofm.dof_nodes[i])));
+        }
+        return error;
+    };
+
+    // IMEX: advection explicit, relaxation implicit
+    {
+        FESystem feSystem(dofm, 2);
+        Advection advection;
+        Relaxation<100000> relaxation;
+        IMEXRK imex(dt);
+        for (int n = 0; n < nSteps; ++n) {
+            imex.step(feSystem, advection, relaxation);
+        }
+        good = good && relaxation_error(feSystem.getSolution()) < 1e-3;
+    }
+
+    // Fully implicit, both terms in one physics
+    {
+        FESystem feSystem(dofm, 2);
+        AdvectionRelaxation<100000> physics;
+        IMEXRK dirk(dt, IMEXRK::Scheme::ARS443);
+        for (int n = 0; n < nSteps; ++n) {
+            dirk.step(feSystem, physics);
+        }
+        good = good && relaxation_error(feSystem.getSolution()) < 1e-3
+               && std::abs(feSystem.currentTime() - nSteps * dt) < 1e-12;
+    }
+
+    // Explicit RK4 with the same step
+    {
+        FESystem feSystem(dofm, 2);
+        AdvectionRelaxation<100000> physics;
+        DGRK4 rk(dt);
+        for (int n = 0; n < 5; ++n) {
+            rk.step(feSystem, physics);
+        }
+        good = good && !(relaxation_error(feSystem.getSolution()) < 1e3);
+    }
+    return good;
+}
+
+
+// A cached LU tag factors the (linear, fixed dt) stage matrix once for all stages and steps
+bool test_4()
+{
+    Mesh M = test_meshes::quadMesh(6);
+    M.buildInternalFaces();
+    DoFManager dofm(M, DoFManager::ManagerType::DG, 2, 1);
+    AdvectionRelaxation<100> physics;
+    const double dt = 0.02;
+
+    FESystem reference(dofm, 2);
+    FESystem cached(dofm, 2);
+    IMEXRK dirk_reference(dt, IMEXRK::Scheme::ARS443);
+    IMEXRK dirk_cached(dt, IMEXRK::Scheme::ARS443);
+    LinearSolve::CachedSparseLUTag tag(LinearSolve::CachedSparseLUTag::Reuse::Factorization);
+    for (int n = 0; n < 5; ++n) {
+        dirk_reference.step<LinearSolve::EigenBICGSTABTag>(reference, physics);
+        dirk_cached.step(cached, physics, tag);
+    }
+    auto const &U = reference.getSolution();
+    return (cached.getSolution() - U).norm() < 1e-8 * U.norm() && tag.nAnalyses() == 1 && tag.nFactorizations() == 1;
+}
+
+
+int main()
+{
+    int retval = 0;
+    if (!test_1()) {
+        std::cerr << "Failed test_1()" << std::endl;
+        retval |= 1 << 0;
+    }
+    if (!test_2()) {
+        std::cerr << "Failed test_2()" << std::endl;
+        retval |= 1 << 1;
+    }
+    if (!test_3()) {
+        std::cerr << "Failed test_3()" << std::endl;
+        retval |= 1 << 2;
+    }
+    if (!test_4()) {
+        std::cerr << "Failed test_4()" << std::endl;
+        retval |= 1 << 3;
+    }
+
+    return retval;
+}
@@ -0,0 +1,258 @@
+#include "yafel_globals.hpp"
+#include "assembly/CGAssembly.hpp"
+#include "boundary_conditions/DirichletBC.hpp"
+#include "test_meshes.hpp"
+
+#include <Eigen/Core>
+#include <Eigen/Sparse>
+#include <iostream>
+#include <stdexcept>
+
+using namespace yafel;
+
+/*
+ * After the solution changes at a few nodes, CGAssemblyIncremental over the elements
+ * touching those nodes must bring the assembled tangent and residual to what a full
+ * CGAssembly of the new state gives, on every element path (dynamic, fixed-size and
+ * batched) and on both backends. Boundary conditions go on copies of the assembled
+ * system; applied to it in place, they make the next incremental assembly throw.
+ */
+
+// Nonlinear diffusion with a source
+template<int NSD>
+struct Diffusion
+{
+    static constexpr int nsd() { return NSD; }
+
+    template<typename ElementT, typename PointT, typename VectorT>
+    static void LocalResidual(const ElementT &E, int qpi, PointT &x, double, VectorT &u_el, VectorT &R_el)
+    {
+        double u = E.shapeValues[qpi].dot(u_el);
+        R_el += (x(0) + u * u) * E.shapeValues[qpi] * E.jxw;
+    }
+
+    template<typename ElementT, typename PointT, typename VectorT, typename MatrixT>
+    static void LocalTangent(const ElementT &E, int qpi, PointT &, double, VectorT &u_el, MatrixT &K_el)
+    {
+        double u = E.shapeValues[qpi].dot(u_el);
+        K_el += (1 + u * u) * E.shapeGrad * E.shapeGrad.transpose() * E.jxw;
+    }
+};
+
+// Same physics, evaluated on batches of 4 elements
+template<int NSD>
+struct BatchedDiffusion : Diffusion<NSD>
+{
+    static constexpr int batchWidth() { return 4; }
+
+    template<typename B>
+    static typename B::Lanes interpolate(const B &batch, int qpi, const typename B::LocalVector &u_el)
+    {
+        typename B::Lanes u = B::Lanes::Zero();
+        for (int A = 0; A < B::n_nodes; ++A) {
+            u += batch.shapeValue(qpi, A) * u_el[A];
+        }
+        return u;
+    }
+
+    template<typename B>
+    static void LocalResidualBatch(const B &batch, int qpi, const typename B::Point &x, double,
+                                   const typename B::LocalVector &u_el, typename B::LocalVector &R_el)
+    {
+        typename B::Lanes u = interpolate(batch, qpi, u_el);
+        typename B::Lanes s = (x[0] + u * u) * batch.jxw;
+        for (int A = 0; A < B::n_nodes; ++A) {
+            R_el[A] += batch.shapeValue(qpi, A) * s;
+        }
+    }
+
+    template<typename B>
+    static void LocalTangentBatch(const B &batch, int qpi, const typename B::Point &, double,
+                                  const typename B::LocalVector &u_el, typename B::LocalMatrix &K_el)
+    {
+        typename B::Lanes u = interpolate(batch, qpi, u_el);
+        typename B::Lanes c = (1 + u * u) * batch.jxw;
+        for (int A = 0; A < B::n_nodes; ++A) {
+            for (int Bn = 0; Bn < B::n_nodes; ++Bn) {
+                typename B::Lanes g = batch.grad(A, 0) * batch.grad(Bn, 0);
+                for (int d = 1; d < NSD; ++d) {
+                    g += batch.grad(A, d) * batch.grad(Bn, d);
+                }
+                K_el[A * B::n_nodes + Bn] += g * c;
+            }
+        }
+    }
+};
+
+
+// Change the solution at the given nodes, and return the elements that touch them
+std::vector<int> perturb(DoFManager &dofm, Eigen::VectorXd &U, const std::vector<int> &nodes)
+{
+    std::vector<char> moved(dofm.dof_nodes.size(), 0);
+    for (auto n : nodes) {
+        U(n) += 0.5;
+        moved[n] = 1;
+    }
+
+    std::vector<int> changed;
+    for (int e = 0; e < dofm.nCells(); ++e) {
+        for (int i = dofm.element_offsets[e]; i < dofm.element_offsets[e + 1]; ++i) {
+            if (moved[dofm.elements[i]]) {
+                changed.push_back(e);
+                break;
+            }
+        }
+    }
+    return changed;
+}
+
+// Incremental updates after a few perturbations match a full assembly of the final state
+template<typename Physics>
+bool incremental_matches(const Mesh &M, int polyOrder, AssemblyBackend backend,
+                         ElementContributionCache::Storage storage, double tol)
+{
+    DoFManager dofm(M, DoFManager::ManagerType::CG, polyOrder, 1);
+    FESystem incrementalSystem(dofm, Physics::nsd());
+    FESystem fullSystem(dofm, Physics::nsd());
+    incrementalSystem.enableElementCache(storage);
+    incrementalSystem.setAssemblyBackend(backend);
+
+    Eigen::VectorXd U = Eigen::VectorXd::Random(fullSystem.getSolution().rows());
+    incrementalSystem.getSolution() = U;
+    CGAssembly<Physics>(incrementalSystem);
+
+    bool good = true;
+    std::size_t nChanged{0};
+    for (int step = 0; step < 3; ++step) {
+        auto changed = perturb(dofm, incrementalSystem.getSolution(), {3 * step, 3 * step + 1, 10 + 7 * step});
+        nChanged = changed.size();
+        CGAssemblyIncremental<Physics>(incrementalSystem, changed);
+        good = good && incrementalSystem.getAssemblyStatistics().elements.size() > 0;
+    }
+
+    fullSystem.getSolution() = incrementalSystem.getSolution();
+    CGAssembly<Physics>(fullSystem);
+
+    Eigen::SparseMatrix<double> dK = incrementalSystem.getGlobalTangent() - fullSystem.getGlobalTangent();
+    Eigen::VectorXd dR = incrementalSystem.getGlobalResidual() - fullSystem.getGlobalResidual();
+    return good && nChanged > 0 && static_cast<int>(nChanged) < dofm.nCells()
+           && dK.norm() <= tol * fullSystem.getGlobalTangent().norm()
+           && dR.norm() <= tol * fullSystem.getGlobalResidual().norm();
+}
+
+
+// Fixed-size (p = 2), dynamic (p = 3) and batched (p = 1) element paths; mixed mesh; hexes
+bool test_1()
+{
+    using Storage = ElementContributionCache::Storage;
+    auto omp = AssemblyBackend::OpenMP;
+    return incremental_matches<Diffusion<2>>(test_meshes::quadMesh(6, 1.2, 0.2), 2, omp, Storage::Double, 1e-12)
+           && incremental_matches<Diffusion<2>>(test_meshes::quadMesh(6, 1.2, 0.2), 3, omp, Storage::Double, 1e-12)
+           && incremental_matches<BatchedDiffusion<2>>(test_meshes::quadMesh(6), 1, omp, Storage::Double, 1e-12)
+           && incremental_matches<Diffusion<2>>(test_meshes::mixedMesh(8), 2, omp, Storage::Double, 1e-12)
+           && incremental_matches<BatchedDiffusion<3>>(test_meshes::hexMesh(3, 1.3), 1, omp, Storage::Double, 1e-12);
+}
+
+
+// TaskScheduler backend, and single-precision storage (to rounding of the recorded values)
+bool test_2()
+{
+    using Storage = ElementContributionCache::Storage;
+    auto tasks = AssemblyBackend::TaskScheduler;
+    auto omp = AssemblyBackend::OpenMP;
+    return incremental_matches<Diffusion<2>>(test_meshes::mixedMesh(8), 2, tasks, Storage::Double, 1e-12)
+           && incremental_matches<BatchedDiffusion<2>>(test_meshes::quadMesh(6), 1, tasks, Storage::Double, 1e-12)
+           && incremental_matches<Diffusion<2>>(test_meshes::quadMesh(6, 1.2, 0.2), 2, omp, Storage::Single, 1e-6);
+}
+
+
+// Incremental assembly without recorded contributions is an error
+bool test_3()
+{
+    DoFManager dofm(test_meshes::quadMesh(3), DoFManager::ManagerType::CG, 1, 1);
+    FESystem feSystem(dofm, 2);
+    bool threw_disabled{false};
+    try {
+        CGAssembly<Diffusion<2>>(feSystem);
+        CGAssemblyIncremental<Diffusion<2>>(feSystem, {0});
+    } catch (std::runtime_error &) {
+        threw_disabled = true;
+    }
+
+    bool threw_residual_only{false};
+    feSystem.enableElementCache();
+    try {
+        CGAssembly<Diffusion<2>>(feSystem, {AssemblyRequirement::Residual});
+        CGAssemblyIncremental<Diffusion<2>>(feSystem, {0});
+    } catch (std::runtime_error &) {
+        threw_residual_only = true;
+    }
+
+    return threw_disabled && threw_residual_only;
+}
+
+
+// Assemble, constrain, update incrementally and constrain again, against a full reassembly
+bool test_4()
+{
+    DoFManager dofm(test_meshes::quadMesh(6, 1.2, 0.2), DoFManager::ManagerType::CG, 2, 1);
+    FESystem feSystem(dofm, 2);
+    FESystem fullSystem(dofm, 2);
+    feSystem.enableElementCache();
+    feSystem.getSolution() = Eigen::VectorXd::Random(feSystem.getSolution().rows());
+    DirichletBC bc(dofm, 1.0);
+    bc.selectByFunction([](auto x) { return x(0) < 1.0e-12; });
+
+    CGAssembly<Diffusion<2>>(feSystem);
+    Eigen::SparseMatrix<double> K = feSystem.getGlobalTangent();
+    Eigen::VectorXd R = feSystem.getGlobalResidual();
+    bc.apply(K, R);
+
+    auto changed = perturb(dofm, feSystem.getSolution(), {5, 17, 30});
+    CGAssemblyIncremental<Diffusion<2>>(feSystem, changed);
+    K = feSystem.getGlobalTangent();
+    R = feSystem.getGlobalResidual();
+    bc.apply(K, R);
+
+    fullSystem.getSolution() = feSystem.getSolution();
+    CGAssembly<Diffusion<2>>(fullSystem);
+    bc.apply(fullSystem);
+    bool good = (K - fullSystem.getGlobalTangent()).norm() <= 1e-12 * K.norm()
+                && (R - fullSystem.getGlobalResidual()).norm() <= 1e-12 * R.norm();
+
+    // In place, the constrained system can no longer be updated, until a full assembly
+    bc.apply(feSystem);
+    bool threw{false};
+    try {
+        CGAssemblyIncremental<Diffusion<2>>(feSystem, changed);
+    } catch (std::runtime_error &) {
+        threw = true;
+    }
+    CGAssembly<Diffusion<2>>(feSystem);
+    CGAssemblyIncremental<Diffusion<2>>(feSystem, changed);
+    return good && threw;
+}
+
+
+int main()
+{
+    int retval = 0;
+    if (!test_1()) {
+        std::cerr << "Failed test_1()" << std::endl;
+        retval |= 1 << 0;
+    }
+    if (!test_2()) {
+        std::cerr << "Failed test_2()" << std::endl;
+        retval |= 1 << 1;
+    }
+    if (!test_3()) {
+        std::cerr << "Failed test_3()" << std::endl;
+        retval |= 1 << 2;
+    }
+    if (!test_4()) {
+        std::cerr << "Failed test_4()" << std::endl;
+        retval |= 1 << 3;
+    }
+
+    return retval;
+}
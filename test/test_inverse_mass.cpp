@@ -0,0 +1,183 @@
+#include "yafel_globals.hpp"
+#include "assembly/DGAssembly.hpp"
+#include "fe_system/InverseMassOperator.hpp"
+#include "test_meshes.hpp"
+#include "test_physics.hpp"
+
+#include <Eigen/Core>
+#include <Eigen/Dense>
+#include <omp.h>
+#include <algorithm>
+#include <iostream>
+
+using namespace yafel;
+
+/*
+ * InverseMassOperator stores one reference inverse per element type for the elements
+ * whose mass is a multiple of it, and dense inverses for the others. Applied to a
+ * vector, it must agree with a factorization of each element's mass matrix.
+ */
+
+// Mass with a unit density, or one that depends on the element size
+template<int NSD, bool VariableDensity = false>
+struct MassPhysics
+{
+    static constexpr int nsd() { return NSD; }
+
+    template<typename T>
+    static void LocalMass(const Element &E, int qpi, double, Eigen::MatrixBase<T> &M_el)
+    {
+        double rho{1};
+        if constexpr (VariableDensity) {
+            rho = 1 + 100 * E.jxw;
+        }
+        M_el += (rho * E.jxw * E.shapeValues[qpi]) * E.shapeValues[qpi].transpose();
+    }
+};
+
+// Rotating advection, shared with test_dg_assembly
+using Advection = test_physics::RotatingAdvection;
+
+
+// blockdiag(M)^{-1} x, one factorization per element
+template<typename Physics>
+Eigen::VectorXd reference_inverse(const DoFManager &dofm, const Eigen::VectorXd &x)
+{
+    constexpr int NSD = Physics::nsd();
+    Eigen::VectorXd y = x;
+    ElementFactory EF(dofm.dof_per_node);
+    std::vector<int> dofs;
+    for (int elnum = 0; elnum < dofm.nCells(); ++elnum) {
+        auto et = dofm.element_types[elnum];
+        if (et.topoDim != NSD) {
+            continue;
+        }
+        auto &E = EF.getElement(et);
+        dofm.getGlobalDofs(elnum, dofs);
+        const int n = static_cast<int>(dofs.size());
+        Eigen::MatrixXd M = Eigen::MatrixXd::Zero(n, n);
+        Eigen::VectorXd v(n);
+        for (int qpi = 0; qpi < E.nQP(); ++qpi) {
+            E.update<NSD>(elnum, qpi, dofm);
+            Physics::LocalMass(E, qpi, 0, M);
+        }
+        for (int i = 0; i < n; ++i) {
+            v(i) = x(dofs[i]);
+        }
+        Eigen::VectorXd w = M.partialPivLu().solve(v);
+        for (int i = 0; i < n; ++i) {
+            y(dofs[i]) = w(i);
+        }
+    }
+    return y;
+}
+
+// Operator against per-element factorizations, with the expected number of dense elements
+template<typename Physics>
+bool matches_reference(Mesh M, int polyOrder, bool expect_dense)
+{
+    M.buildInternalFaces();
+    DoFManager dofm(M, DoFManager::ManagerType::DG, polyOrder, 1);
+    InverseMassOperator Minv;
+    Minv.build<Physics>(dofm);
+
+    Eigen::VectorXd x = Eigen::VectorXd::Random(dofm.nNodes());
+    Eigen::VectorXd y_ref = reference_inverse<Physics>(dofm, x);
+    Eigen::VectorXd y = x;
+    Minv.apply(y);
+
+    return Minv.isBuilt() && Minv.memoryUsage() > 0
+           && Minv.nScaledElements() + Minv.nDenseElements() == dofm.nCells()
+           && (Minv.nDenseElements() > 0) == expect_dense
+           && (y - y_ref).norm() <= 1e-10 * y_ref.norm();
+}
+
+
+// Affine meshes are entirely scaled, and agree with per-element factorizations
+bool test_1()
+{
+    return matches_reference<MassPhysics<2>>(test_meshes::quadMesh(5), 2, false)
+           && matches_reference<MassPhysics<2>>(test_meshes::quadMesh(9, 1.3), 1, false)
+           && matches_reference<MassPhysics<2>>(test_meshes::triMesh(4), 3, false)
+           && matches_reference<MassPhysics<2>>(test_meshes::mixedMesh(4), 2, false)
+           && matches_reference<MassPhysics<3>>(test_meshes::hexMesh(3, 1.2), 2, false);
+}
+
+
+// Distorted elements and varying densities get dense inverses
+bool test_2()
+{
+    return matches_reference<MassPhysics<2>>(test_meshes::quadMesh(6, 1.0, 0.2), 2, true)
+           && matches_reference<MassPhysics<2, true>>(test_meshes::quadMesh(9, 1.3), 2, true);
+}
+
+
+// DGAssembly with DtMass gives blockdiag(M)^{-1} of the residual assembled without it
+bool test_3()
+{
+    Mesh M = test_meshes::quadMesh(6, 1.2, 0.2);
+    M.buildInternalFaces();
+    DoFManager dofm(M, DoFManager::ManagerType::DG, 2, 1);
+    Eigen::VectorXd U = Eigen::VectorXd::Random(dofm.nNodes());
+
+    FESystem feSystem(dofm, 2);
+    feSystem.getSolution() = U;
+    Advection physics;
+    DGAssembly(feSystem, physics, {AssemblyRequirement::Residual});
+    Eigen::VectorXd R = feSystem.getGlobalResidual();
+    DGAssembly(feSystem, physics, {AssemblyRequirement::Residual, AssemblyRequirement::DtMass});
+    Eigen::VectorXd dUdt = reference_inverse<Advection>(dofm, R);
+
+    return physics.inverse_mass.isBuilt() && R.norm() > 0
+           && (feSystem.getGlobalResidual() - dUdt).norm() <= 1e-10 * dUdt.norm();
+}
+
+
+// The applied inverse does not depend on the number of threads
+bool test_4()
+{
+    Mesh M = test_meshes::mixedMesh(12);
+    M.buildInternalFaces();
+    DoFManager dofm(M, DoFManager::ManagerType::DG, 2, 1);
+    InverseMassOperator Minv;
+    Minv.build<MassPhysics<2>>(dofm);
+    Eigen::VectorXd x = Eigen::VectorXd::Random(dofm.nNodes());
+
+    int previous = omp_get_max_threads();
+    omp_set_num_threads(1);
+    Eigen::VectorXd y1 = x;
+    Minv.apply(y1);
+    bool good = true;
+    for (int nThreads : {2, 3, 4}) {
+        omp_set_num_threads(nThreads);
+        Eigen::VectorXd y = x;
+        Minv.apply(y);
+        good = good && std::equal(y.data(), y.data() + y.size(), y1.data());
+    }
+    omp_set_num_threads(previous);
+    return good;
+}
+
+
+int main()
+{
+    int retval = 0;
+    if (!test_1()) {
+        std::cerr << "Failed test_1()" << std::endl;
+        retval |= 1 << 0;
+    }
+    if (!test_2()) {
+        std::cerr << "Failed test_2()" << std::endl;
+        retval |= 1 << 1;
+    }
+    if (!test_3()) {
+        std::cerr << "Failed test_3()" << std::endl;
+        retval |= 1 << 2;
+    }
+    if (!test_4()) {
+        std::cerr << "Failed test_4()" << std::endl;
+        retval |= 1 << 3;
+    }
+
+    return retval;
+}
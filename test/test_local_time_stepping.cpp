@@ -0,0 +1,290 @@
+#include "yafel_globals.hpp"
+#include "assembly/DGAssembly.hpp"
+#include "element/ElementFactory.hpp"
+#include "time_integration/ElementCFL.hpp"
+#include "time_integration/LocalTimeStepping.hpp"
+#include "time_integration/SSPRK.hpp"
+#include "test_meshes.hpp"
+#include "test_physics.hpp"
+
+#include <Eigen/Core>
+#include <cmath>
+#include <iostream>
+
+using namespace yafel;
+
+/*
+ * LocalTimeStepping puts the elements of a graded mesh on power-of-two time-step levels
+ * and advances each level through DGAssembly restricted to a DGActiveSet. The restricted
+ * residual must match the full one, the multirate solution must converge at second
+ * order to the solution of the same semi-discretization, and the flux register of the
+ * level interfaces must conserve the total mass.
+ */
+
+// Rotating advection (test_physics.hpp)
+using Advection = test_physics::RotatingAdvection;
+
+using Requirements = AssemblyRequirements<AssemblyRequirement::Residual, AssemblyRequirement::DtMass>;
+
+// A smooth bump, centered off the axis of rotation
+void initialize(DoFManager &dofm, Eigen::VectorXd &U)
+{
+    for (int i = 0; i < U.rows(); ++i) {
+        auto const &x = dofm.dof_nodes[i];
+        U(i) = std::exp(-20 * ((x(0) - 0.3) * (x(0) - 0.3) + (x(1) - 0.4) * (x(1) - 0.4)));
+    }
+}
+
+
+// The residual restricted to the elements of every level equals the full residual on them,
+// and the level sets leave the faces with the finer level out
+bool test_1()
+{
+    Mesh M = test_meshes::quadMesh(8, 2.0, 0.1);
+    M.buildInternalFaces();
+    DoFManager dofm(M, DoFManager::ManagerType::DG, 2, 1);
+    FESystem feSystem(dofm, 2);
+    Eigen::VectorXd U = Eigen::VectorXd::Random(dofm.nNodes());
+    feSystem.getSolution() = U;
+
+    Advection physics;
+    DGAssembly<Advection, Requirements>(feSystem, physics);
+    Eigen::VectorXd R = feSystem.getGlobalResidual();
+
+    LocalTimeStepping lts(dofm, elementTimeSteps<Advection>(feSystem, 0.5));
+    bool good = lts.nLevels() > 2;
+    for (int l = 0; l < lts.nLevels(); ++l) {
+        DGActiveSet level(dofm, lts.levelSet(l).elements());
+        feSystem.getGlobalResidual().setConstant(1e30);
+        DGAssembly<Advection, Requirements>(feSystem, physics, level);
+        for (int d : level.dofs()) {
+            good = good && std::abs(feSystem.getGlobalResidual()(d) - R(d)) <= 1e-12 * R.lpNorm<Eigen::Infinity>();
+        }
+        int skipped_faces{0};
+        for (int c = 0; c < level.nColors(); ++c) {
+            skipped_faces += level.nFaces(c) - lts.levelSet(l).nFaces(c);
+        }
+        good = good && level.registerDofs().empty() && (l == 0) == (skipped_faces == 0);
+    }
+    return good;
+}
+
+
+// Quads of quadMesh(n, grading), followed by its bottom edge as Line2 cells, as parse_gmsh reads boundaries
+Mesh with_boundary_lines(int n, double grading)
+{
+    Mesh Q = test_meshes::quadMesh(n, grading);
+    std::vector<int> cells = Q.getCellVector();
+    std::vector<int> offsets = Q.getOffsetVector();
+    std::vector<CellType> types(Q.nCells(), CellType::Quad4);
+    for (int i = 0; i < n; ++i) {
+        cells.insert(cells.end(), {i, i + 1});
+        offsets.push_back(static_cast<int>(cells.size()));
+        types.push_back(CellType::Line2);
+    }
+    return Mesh(Mesh::DefinitionScheme::Explicit, Q.getGeometryNodes(), cells, offsets, types);
+}
+
+// Levels: every element's step fits its level, face neighbors differ by at most one level,
+// and cells of another dimension (with an infinite step) add no levels
+bool test_2()
+{
+    Mesh M = test_meshes::quadMesh(8, 2.5);
+    M.buildInternalFaces();
+    DoFManager dofm(M, DoFManager::ManagerType::DG, 1, 1);
+    FESystem feSystem(dofm, 2);
+
+    auto element_dt = elementTimeSteps<Advection>(feSystem, 0.5);
+    LocalTimeStepping lts(dofm, element_dt);
+
+    bool good = lts.nLevels() > 2;
+    int counted{0};
+    for (int l = 0; l < lts.nLevels(); ++l) {
+        counted += lts.levelSet(l).nElements();
+        for (int e : lts.levelSet(l).elements()) {
+            good = good && lts.level(e) == l && lts.levelTimeStep(l) <= element_dt[e] * (1 + 1e-12);
+        }
+    }
+    for (auto const &F : dofm.interior_faces) {
+        if (F.left >= 0 && F.right >= 0) {
+            good = good && std::abs(lts.level(F.left) - lts.level(F.right)) <= 1;
+        }
+    }
+    good = good && counted == dofm.nCells();
+
+    Mesh ML = with_boundary_lines(8, 2.5);
+    ML.buildInternalFaces();
+    DoFManager dofmL(ML, DoFManager::ManagerType::DG, 1, 1);
+    FESystem feSystemL(dofmL, 2);
+    LocalTimeStepping ltsL(dofmL, elementTimeSteps<Advection>(feSystemL, 0.5));
+    return good && lts.nLevels() < 8 && ltsL.nLevels() == lts.nLevels()
+           && std::abs(ltsL.timeStep() - lts.timeStep()) <= 1e-14 * lts.timeStep()
+           && ltsL.level(dofmL.nCells() - 1) == lts.nLevels() - 1;
+}
+
+
+// Solution at t = 0.5, with the stable steps divided by about `refinement`, and the evaluations per coarse step
+Eigen::VectorXd lts_solution(DoFManager &dofm, int refinement, long &evaluations, int &nLevels)
+{
+    FESystem feSystem(dofm, 2);
+    initialize(dofm, feSystem.getSolution());
+    Advection physics;
+
+    // Scale the stable steps so that the coarse step divides 0.5
+    auto element_dt = elementTimeSteps<Advection>(feSystem, 0.5);
+    LocalTimeStepping probe(dofm, element_dt);
+    const int nSteps = refinement * static_cast<int>(std::ceil(0.5 / probe.timeStep()));
+    const double scale = 0.5 / (nSteps * probe.timeStep());
+    for (auto &h : element_dt) {
+        h *= scale;
+    }
+
+    LocalTimeStepping lts(dofm, element_dt);
+    for (int n = 0; n < nSteps; ++n) {
+        lts.step(feSystem, physics);
+    }
+    evaluations = lts.elementEvaluations() / nSteps;
+    nLevels = lts.nLevels();
+    return std::abs(feSystem.currentTime() - 0.5) < 1e-12 ? feSystem.getSolution() : Eigen::VectorXd();
+}
+
+// Second-order convergence to a fine single-rate solution, at a fraction of the single-rate work
+bool test_3()
+{
+    Mesh M = test_meshes::quadMesh(8, 2.0);
+    M.buildInternalFaces();
+    DoFManager dofm(M, DoFManager::ManagerType::DG, 1, 1);
+
+    // Reference: SSPRK54 (4th order) with half the smallest element step
+    FESystem reference(dofm, 2);
+    initialize(dofm, reference.getSolution());
+    Advection physics;
+    auto element_dt = elementTimeSteps<Advection>(reference, 0.5);
+    double dt_min = *std::min_element(element_dt.begin(), element_dt.end());
+    const int nRef = 2 * static_cast<int>(std::ceil(0.5 / dt_min));
+    SSPRK54 rk(0.5 / nRef);
+    for (int n = 0; n < nRef; ++n) {
+        rk.step(reference, physics);
+    }
+    Eigen::VectorXd U_ref = reference.getSolution();
+
+    long work1, work2;
+    int nLevels;
+    Eigen::VectorXd U1 = lts_solution(dofm, 1, work1, nLevels);
+    Eigen::VectorXd U2 = lts_solution(dofm, 2, work2, nLevels);
+    if (U1.size() == 0 || U2.size() == 0) {
+        return false;
+    }
+    double e1 = (U1 - U_ref).lpNorm<Eigen::Infinity>();
+    double e2 = (U2 - U_ref).lpNorm<Eigen::Infinity>();
+
+    // Heun on the finest step everywhere: 2 evaluations per element and fine step
+    long single_rate = 2L * dofm.nCells() * (1L << (nLevels - 1));
+    return nLevels > 2 && std::log2(e1 / e2) > 1.7 && 2 * work1 < single_rate;
+}
+
+
+// Cellular flow, tangent to the boundary of the unit square: no mass crosses it
+struct CellularFlow
+{
+    InverseMassOperator inverse_mass;
+
+    static constexpr int nsd() { return 2; }
+
+    static Tensor<2, 1> velocity(const coordinate<> &x)
+    {
+        return {std::sin(M_PI * x(0)) * std::cos(M_PI * x(1)), -std::cos(M_PI * x(0)) * std::sin(M_PI * x(1))};
+    }
+
+    static double WaveSpeed(const coordinate<> &x, double) { return norm(velocity(x)); }
+
+    template<typename TU, typename TR>
+    static void LocalResidual(const Element &E, int qpi, coordinate<> &x, double,
+                              Eigen::MatrixBase<TU> &U_el, Eigen::MatrixBase<TR> &R_el)
+    {
+        double U = E.shapeValues[qpi].dot(U_el);
+        for (int i = 0; i < R_el.rows(); ++i) {
+            auto gradW = make_TensorMap<2, 1>(&E.shapeGrad(i, 0));
+            R_el(i) += U * dot(gradW, velocity(x)) * E.jxw;
+        }
+    }
+
+    template<typename T>
+    static void LocalMass(const Element &E, int qpi, double, Eigen::MatrixBase<T> &M_el)
+    {
+        M_el += (E.jxw * E.shapeValues[qpi]) * E.shapeValues[qpi].transpose();
+    }
+
+    static double BoundaryFlux(Tensor<2, 1>, coordinate<>, double, double) { return 0; }
+
+    static double Flux(Tensor<2, 1> n, coordinate<> x, double, double Uplus, double Uminus)
+    {
+        double vdotn = dot(n, velocity(x));
+        return 0.5 * (vdotn * (Uplus + Uminus) + std::abs(vdotn) * (Uplus - Uminus));
+    }
+};
+
+double total_mass(DoFManager &dofm, const Eigen::VectorXd &U)
+{
+    ElementFactory EF(dofm);
+    std::vector<int> dofs;
+    double mass{0};
+    for (int e = 0; e < dofm.nCells(); ++e) {
+        auto &E = EF.getElement(dofm.element_types[e]);
+        dofm.getGlobalDofs(e, dofs);
+        for (int qpi = 0; qpi < E.nQP(); ++qpi) {
+            E.update<2>(e, qpi, dofm);
+            for (int A = 0; A < static_cast<int>(dofs.size()); ++A) {
+                mass += E.shapeValues[qpi](A) * U(dofs[A]) * E.jxw;
+            }
+        }
+    }
+    return mass;
+}
+
+// Mass conservation across the level interfaces of a graded mesh, for p = 1, 2
+bool test_4()
+{
+    bool good = true;
+    for (int p : {1, 2}) {
+        Mesh M = test_meshes::quadMesh(8, 2.0, 0.1);
+        M.buildInternalFaces();
+        DoFManager dofm(M, DoFManager::ManagerType::DG, p, 1);
+        FESystem feSystem(dofm, 2);
+        initialize(dofm, feSystem.getSolution());
+        CellularFlow physics;
+
+        LocalTimeStepping lts(dofm, elementTimeSteps<CellularFlow>(feSystem, 0.5));
+        const double mass0 = total_mass(dofm, feSystem.getSolution());
+        for (int n = 0; n < 10; ++n) {
+            lts.step(feSystem, physics);
+        }
+        const double mass = total_mass(dofm, feSystem.getSolution());
+        good = good && lts.nLevels() > 2 && std::abs(mass - mass0) < 1e-13 * mass0;
+    }
+    return good;
+}
+
+
+int main()
+{
+    int retval = 0;
+    if (!test_1()) {
+        std::cerr << "Failed test_1()" << std::endl;
+        retval |= 1 << 0;
+    }
+    if (!test_2()) {
+        std::cerr << "Failed test_2()" << std::endl;
+        retval |= 1 << 1;
+    }
+    if (!test_3()) {
+        std::cerr << "Failed test_3()" << std::endl;
+        retval |= 1 << 2;
+    }
+    if (!test_4()) {
+        std::cerr << "Failed test_4()" << std::endl;
+        retval |= 1 << 3;
+    }
+
+    return retval;
+}
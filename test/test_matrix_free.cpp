@@ -0,0 +1,139 @@
+#include "yafel_globals.hpp"
+#include "assembly/CGAssembly.hpp"
+#include "assembly/MatrixFreeOperator.hpp"
+#include "boundary_conditions/DirichletBC.hpp"
+#include "lin_alg/linear_solvers/solvers/MatrixFreeSolvers.hpp"
+#include "test_meshes.hpp"
+
+#include <Eigen/Core>
+#include <Eigen/Sparse>
+#include <iostream>
+
+using namespace yafel;
+
+/*
+ * MatrixFreeOperator must reproduce the product with the tangent assembled by CGAssembly,
+ * for the same (linear) physics: variable-coefficient diffusion plus a reaction term.
+ */
+
+template<int NSD>
+struct DiffusionReaction
+{
+    static constexpr int nsd() { return NSD; }
+
+    static double kappa(const coordinate<> &x) { return 1 + x(0) + 2 * x(1) * x(1); }
+
+    static constexpr double reaction = 0.5;
+
+    template<typename ElementT, typename VectorT, typename MatrixT>
+    static void LocalTangent(const ElementT &E, int qpi, coordinate<> &xqp, double, VectorT &, MatrixT &K_el)
+    {
+        K_el += kappa(xqp) * E.shapeGrad * E.shapeGrad.transpose() * E.jxw
+                + reaction * E.shapeValues[qpi] * E.shapeValues[qpi].transpose() * E.jxw;
+    }
+
+    template<typename ElementT, typename VectorT>
+    static void LocalResidual(const ElementT &, int, coordinate<> &, double, VectorT &, VectorT &)
+    {}
+
+    static void PointwiseOperator(const coordinate<> &xqp, double, double u, const Tensor<NSD, 1> &grad_u,
+                                  double &s, Tensor<NSD, 1> &flux)
+    {
+        s = reaction * u;
+        flux = kappa(xqp) * grad_u;
+    }
+};
+
+
+template<int NSD>
+bool product_matches(const Mesh &M, int polyOrder)
+{
+    using Physics = DiffusionReaction<NSD>;
+    DoFManager dofm(M, DoFManager::ManagerType::CG, polyOrder, 1);
+    FESystem feSystem(dofm, NSD);
+    CGAssembly<Physics>(feSystem, {AssemblyRequirement::Tangent});
+    Eigen::SparseMatrix<double> K = feSystem.getGlobalTangent();
+
+    MatrixFreeOperator<Physics> A(dofm);
+    Eigen::VectorXd x = Eigen::VectorXd::Random(dofm.nNodes());
+    Eigen::VectorXd y_ref = K * x;
+    Eigen::VectorXd y = A * x;
+    Eigen::VectorXd diag_ref = K.diagonal();
+
+    return (y - y_ref).norm() < 1.0e-12 * y_ref.norm()
+           && (A.diagonal() - diag_ref).norm() < 1.0e-12 * diag_ref.norm();
+}
+
+
+// Products and diagonals on distorted quads, p = 1..4
+bool test_1()
+{
+    bool good = true;
+    for (int p = 1; p <= 4; ++p) {
+        good = good && product_matches<2>(test_meshes::quadMesh(5, 1.2, 0.2), p);
+    }
+    return good;
+}
+
+
+// Products and diagonals on graded hexes, p = 1..3
+bool test_2()
+{
+    bool good = true;
+    for (int p = 1; p <= 3; ++p) {
+        good = good && product_matches<3>(test_meshes::hexMesh(3, 1.3), p);
+    }
+    return good;
+}
+
+
+// CG solve with Dirichlet conditions, matrix-free vs. assembled (p = 3 quads)
+bool test_3()
+{
+    using Physics = DiffusionReaction<2>;
+    auto M = test_meshes::quadMesh(6, 1.2, 0.2);
+    DoFManager dofm(M, DoFManager::ManagerType::CG, 3, 1);
+    auto on_boundary = [](auto x) { return x(0) < 1.0e-12 || x(0) > 1 - 1.0e-12; };
+    auto bc_value = [](coordinate<> x, double) { return 1 + x(1); };
+
+    FESystem feSystem(dofm, 2);
+    CGAssembly<Physics>(feSystem, {AssemblyRequirement::Tangent});
+    Eigen::SparseMatrix<double> K = feSystem.getGlobalTangent();
+    Eigen::VectorXd rhs_ref = Eigen::VectorXd::Constant(dofm.nNodes(), 0.0);
+    DirichletBC bc_ref(dofm, bc_value);
+    bc_ref.selectByFunction(on_boundary);
+    bc_ref.apply(K, rhs_ref);
+    Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>> ldlt(K);
+    Eigen::VectorXd u_ref = ldlt.solve(rhs_ref);
+
+    MatrixFreeOperator<Physics> A(dofm);
+    Eigen::VectorXd rhs = Eigen::VectorXd::Constant(dofm.nNodes(), 0.0);
+    DirichletBC bc(dofm, bc_value);
+    bc.selectByFunction(on_boundary);
+    bc.apply(A, rhs);
+    Eigen::VectorXd u = Eigen::VectorXd::Constant(dofm.nNodes(), 0.0);
+    LinearSolve::detail::solve_impl(u, A, rhs, LinearSolve::EigenConjugateGradientTag());
+
+    return (rhs - rhs_ref).norm() < 1.0e-12 * rhs_ref.norm()
+           && (u - u_ref).norm() < 1.0e-8 * u_ref.norm();
+}
+
+
+int main()
+{
+    int retval = 0;
+    if (!test_1()) {
+        std::cerr << "Failed test_1()" << std::endl;
+        retval |= 1 << 0;
+    }
+    if (!test_2()) {
+        std::cerr << "Failed test_2()" << std::endl;
+        retval |= 1 << 1;
+    }
+    if (!test_3()) {
+        std::cerr << "Failed test_3()" << std::endl;
+        retval |= 1 << 2;
+    }
+
+    return retval;
+}
@@ -0,0 +1,146 @@
+#ifndef YAFEL_TEST_MESHES_HPP
+#define YAFEL_TEST_MESHES_HPP
+
+#include "yafel_globals.hpp"
+#include "mesh/Mesh.hpp"
+
+#include <cmath>
+#include <vector>
+
+/**
+ * \file
+ *
+ * Small structured meshes of the unit square/cube for the standalone checks in test/.
+ * Cells list their corners the way Gmsh does (counter-clockwise quad faces).
+ */
+
+namespace yafel {
+namespace test_meshes {
+
+// Graded 1D node positions on [0, 1]: node i sits at (i/n)^grading
+inline double graded(int i, int n, double grading)
+{
+    return std::pow(double(i) / n, grading);
+}
+
+/**
+ * n x n quads on the unit square. Interior nodes are shifted by `distortion` (relative to
+ * the spacing) in a fixed pattern, which makes the elements non-affine.
+ */
+inline Mesh quadMesh(int n, double grading = 1.0, double distortion = 0.0)
+{
+    std::vector<coordinate<>> nodes;
+    for (int j = 0; j <= n; ++j) {
+        for (int i = 0; i <= n; ++i) {
+            double x = graded(i, n, grading);
+            double y = graded(j, n, grading);
+            if (i > 0 && i < n && j > 0 && j < n) {
+                x += distortion / n * (((i + 2 * j) % 3) - 1);
+                y += distortion / n * (((2 * i + j) % 3) - 1);
+            }
+            nodes.push_back(coordinate<>{x, y, 0});
+        }
+    }
+
+    std::vector<int> cells, offsets{0};
+    std::vector<CellType> types;
+    for (int j = 0; j < n; ++j) {
+        for (int i = 0; i < n; ++i) {
+            int n0 = j * (n + 1) + i;
+            cells.insert(cells.end(), {n0, n0 + 1, n0 + n + 2, n0 + n + 1});
+            offsets.push_back(static_cast<int>(cells.size()));
+            types.push_back(CellType::Quad4);
+        }
+    }
+    return Mesh(Mesh::DefinitionScheme::Explicit, nodes, cells, offsets, types);
+}
+
+// n x n squares on the unit square, each split into two triangles
+inline Mesh triMesh(int n)
+{
+    std::vector<coordinate<>> nodes;
+    for (int j = 0; j <= n; ++j) {
+        for (int i = 0; i <= n; ++i) {
+            nodes.push_back(coordinate<>{double(i) / n, double(j) / n, 0});
+        }
+    }
+
+    std::vector<int> cells, offsets{0};
+    std::vector<CellType> types;
+    for (int j = 0; j < n; ++j) {
+        for (int i = 0; i < n; ++i) {
+            int n0 = j * (n + 1) + i;
+            cells.insert(cells.end(), {n0, n0 + 1, n0 + n + 2});
+            offsets.push_back(static_cast<int>(cells.size()));
+            cells.insert(cells.end(), {n0, n0 + n + 2, n0 + n + 1});
+            offsets.push_back(static_cast<int>(cells.size()));
+            types.insert(types.end(), {CellType::Tri3, CellType::Tri3});
+        }
+    }
+    return Mesh(Mesh::DefinitionScheme::Explicit, nodes, cells, offsets, types);
+}
+
+// n x n squares on the unit square: quads in the left half, pairs of triangles in the right half
+inline Mesh mixedMesh(int n)
+{
+    std::vector<coordinate<>> nodes;
+    for (int j = 0; j <= n; ++j) {
+        for (int i = 0; i <= n; ++i) {
+            nodes.push_back(coordinate<>{double(i) / n, double(j) / n, 0});
+        }
+    }
+
+    std::vector<int> cells, offsets{0};
+    std::vector<CellType> types;
+    for (int j = 0; j < n; ++j) {
+        for (int i = 0; i < n; ++i) {
+            int n0 = j * (n + 1) + i;
+            if (2 * i < n) {
+                cells.insert(cells.end(), {n0, n0 + 1, n0 + n + 2, n0 + n + 1});
+                offsets.push_back(static_cast<int>(cells.size()));
+                types.push_back(CellType::Quad4);
+            } else {
+                cells.insert(cells.end(), {n0, n0 + 1, n0 + n + 2});
+                offsets.push_back(static_cast<int>(cells.size()));
+                cells.insert(cells.end(), {n0, n0 + n + 2, n0 + n + 1});
+                offsets.push_back(static_cast<int>(cells.size()));
+                types.insert(types.end(), {CellType::Tri3, CellType::Tri3});
+            }
+        }
+    }
+    return Mesh(Mesh::DefinitionScheme::Explicit, nodes, cells, offsets, types);
+}
+
+// n x n x n graded hexes on the unit cube
+inline Mesh hexMesh(int n, double grading = 1.0)
+{
+    std::vector<coordinate<>> nodes;
+    for (int k = 0; k <= n; ++k) {
+        for (int j = 0; j <= n; ++j) {
+            for (int i = 0; i <= n; ++i) {
+                nodes.push_back(coordinate<>{graded(i, n, grading), graded(j, n, grading), graded(k, n, grading)});
+            }
+        }
+    }
+
+    auto idx = [n](int i, int j, int k) { return (k * (n + 1) + j) * (n + 1) + i; };
+    std::vector<int> cells, offsets{0};
+    std::vector<CellType> types;
+    for (int k = 0; k < n; ++k) {
+        for (int j = 0; j < n; ++j) {
+            for (int i = 0; i < n; ++i) {
+                cells.insert(cells.end(), {idx(i, j, k), idx(i + 1, j, k), idx(i + 1, j + 1, k), idx(i, j + 1, k),
+                                           idx(i, j, k + 1), idx(i + 1, j, k + 1), idx(i + 1, j + 1, k + 1),
+                                           idx(i, j + 1, k + 1)});
+                offsets.push_back(static_cast<int>(cells.size()));
+                types.push_back(CellType::Hex8);
+            }
+        }
+    }
+    return Mesh(Mesh::DefinitionScheme::Explicit, nodes, cells, offsets, types);
+}
+
+} // end namespace test_meshes
+} // end namespace yafel
+
+#endif //YAFEL_TEST_MESHES_HPP
@@ -0,0 +1,205 @@
+#include "yafel_globals.hpp"
+#include "assembly/CGAssembly.hpp"
+#include "boundary_conditions/DirichletBC.hpp"
+#include "lin_alg/linear_solvers/solvers/ParallelKrylov.hpp"
+#include "test_meshes.hpp"
+
+#include <Eigen/Core>
+#include <Eigen/Sparse>
+#include <Eigen/SparseLU>
+#include <iostream>
+
+using namespace yafel;
+
+/*
+ * The row-partitioned kernels match Eigen's, and the parallel CG, BiCGSTAB and
+ * GMRES match direct solves, on one block and on many, with results that do not
+ * depend on the scheduling.
+ */
+
+// Diffusion, plus advection along (1, 0.5) scaled by `advection` (nonsymmetric if nonzero)
+struct AdvectionDiffusion
+{
+    static constexpr int nsd() { return 2; }
+
+    static double advection;
+
+    template<typename ElementT, typename PointT, typename VectorT, typename MatrixT>
+    static void LocalTangent(const ElementT &E, int qpi, PointT &, double, VectorT &, MatrixT &K_el)
+    {
+        Eigen::Vector2d c(1.0, 0.5);
+        K_el += E.shapeGrad * E.shapeGrad.transpose() * E.jxw
+                + advection * E.shapeValues[qpi] * (E.shapeGrad * c).transpose() * E.jxw;
+    }
+
+    template<typename ElementT, typename PointT, typename VectorT>
+    static void LocalResidual(const ElementT &, int, PointT &, double, VectorT &, VectorT &)
+    {}
+};
+
+double AdvectionDiffusion::advection = 0;
+
+Eigen::SparseMatrix<double> tangent(int n, int polyOrder, double advection)
+{
+    AdvectionDiffusion::advection = advection;
+    auto M = test_meshes::quadMesh(n, 1.2, 0.2);
+    DoFManager dofm(M, DoFManager::ManagerType::CG, polyOrder, 1);
+    FESystem feSystem(dofm, 2);
+    CGAssembly<AdvectionDiffusion>(feSystem, {AssemblyRequirement::Tangent});
+    Eigen::SparseMatrix<double> K = feSystem.getGlobalTangent();
+    Eigen::VectorXd rhs = Eigen::VectorXd::Zero(K.rows());
+    DirichletBC bc(dofm, 0.0);
+    bc.selectByFunction([](auto x) { return x(0) < 1.0e-12; });
+    bc.apply(K, rhs);
+    return K;
+}
+
+Eigen::VectorXd rhs_of(Eigen::Index n)
+{
+    Eigen::VectorXd b(n);
+    for (Eigen::Index i = 0; i < n; ++i) {
+        b(i) = 1.0 + std::sin(0.37 * i);
+    }
+    return b;
+}
+
+bool close(const Eigen::VectorXd &x, const Eigen::VectorXd &y, double tol)
+{
+    return (x - y).norm() < tol * y.norm();
+}
+
+
+// Kernels against Eigen, on one block and on many
+bool test_1()
+{
+    auto K = tangent(8, 2, 1.0);
+    const Eigen::Index n = K.rows();
+    Eigen::VectorXd x = rhs_of(n), w = x.cwiseProduct(x);
+    Eigen::VectorXd Kx = K * x;
+    bool good = true;
+    for (int blocks : {1, 7, 16}) {
+        LinearSolve::ParallelCSRMatrix A(K, blocks);
+        good = good && A.nBlocks() == blocks && A.blockStart(0) == 0 && A.blockStart(blocks) == n
+               && A.nonZeros() == K.nonZeros();
+
+        Eigen::VectorXd y, r;
+        A.multiply(x, y);
+        good = good && close(y, Kx, 1e-14);
+        double wy = A.multiplyDot(x, y, w);
+        good = good && std::abs(wy - w.dot(Kx)) < 1e-12 * std::abs(w.dot(Kx));
+        double rr = A.residual(w, x, r);
+        good = good && close(r, w - Kx, 1e-14) && std::abs(rr - r.squaredNorm()) < 1e-12 * rr;
+        double yy = A.axpyNorm(-2.0, w, y);
+        good = good && close(y, Kx - 2.0 * w, 1e-14) && std::abs(yy - y.squaredNorm()) < 1e-12 * yy;
+        good = good && std::abs(A.dot(x, w) - x.dot(w)) < 1e-12 * x.dot(w)
+               && std::abs(A.norm(x) - x.norm()) < 1e-12 * x.norm();
+        good = good && close(A.inverseDiagonal(), K.diagonal().cwiseInverse(), 1e-14)
+               && A.vector().rows() == n && A.vector().isZero(0);
+    }
+    return good;
+}
+
+
+// CG on an SPD matrix, bitwise repeatable for a given partition
+bool test_2()
+{
+    auto K = tangent(20, 2, 0.0);
+    auto b = rhs_of(K.rows());
+    Eigen::VectorXd u = Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>>(K).solve(b);
+
+    LinearSolve::ParallelCSRMatrix A(K, 6);
+    LinearSolve::ParallelConjugateGradientTag tag;
+    Eigen::VectorXd x1 = Eigen::VectorXd::Zero(K.rows());
+    LinearSolve::detail::solve_impl(x1, A, b, tag);
+    bool good = close(x1, u, 1e-9) && tag.error <= tag.tolerance && tag.iterations > 0;
+
+    Eigen::VectorXd x2 = Eigen::VectorXd::Zero(K.rows());
+    LinearSolve::detail::solve_impl(x2, A, b, tag);
+    good = good && x1 == x2;
+
+    // The ColMajor matrix directly, on the automatic partition
+    Eigen::VectorXd x3 = Eigen::VectorXd::Zero(K.rows());
+    LinearSolve::detail::solve_impl(x3, K, b, tag);
+    return good && close(x3, u, 1e-9) && LinearSolve::ParallelCSRMatrix(K).nBlocks() <= config::num_cores;
+}
+
+
+// BiCGSTAB and GMRES on a nonsymmetric matrix
+bool test_3()
+{
+    auto K = tangent(12, 2, 5.0);
+    auto b = rhs_of(K.rows());
+    Eigen::SparseLU<Eigen::SparseMatrix<double>> lu(K);
+    Eigen::VectorXd u = lu.solve(b);
+
+    bool good = true;
+    for (int blocks : {1, 4}) {
+        LinearSolve::ParallelCSRMatrix A(K, blocks);
+
+        LinearSolve::ParallelBICGSTABTag bicgstab;
+        Eigen::VectorXd x = Eigen::VectorXd::Zero(K.rows());
+        LinearSolve::detail::solve_impl(x, A, b, bicgstab);
+        good = good && close(x, u, 1e-8) && bicgstab.error <= bicgstab.tolerance;
+
+        // Full GMRES, and restarted
+        for (int restart : {1000, 20}) {
+            LinearSolve::ParallelGMRESTag gmres;
+            gmres.restart = restart;
+            x.setZero();
+            LinearSolve::detail::solve_impl(x, A, b, gmres);
+            good = good && close(x, u, 1e-8) && gmres.error <= gmres.tolerance;
+        }
+    }
+    return good;
+}
+
+
+// Zero rhs, iteration limits and initial guesses
+bool test_4()
+{
+    auto K = tangent(8, 2, 1.0);
+    LinearSolve::ParallelCSRMatrix A(K, 12);
+    auto b = rhs_of(K.rows());
+
+    LinearSolve::ParallelGMRESTag gmres;
+    Eigen::VectorXd x = Eigen::VectorXd::Constant(K.rows(), 3.0);
+    LinearSolve::detail::solve_impl(x, A, Eigen::VectorXd::Zero(K.rows()).eval(), gmres);
+    bool good = x.isZero(0) && gmres.iterations == 0;
+
+    LinearSolve::ParallelBICGSTABTag bicgstab;
+    bicgstab.max_iterations = 3;
+    x.setZero();
+    LinearSolve::detail::solve_impl(x, A, b, bicgstab);
+    good = good && bicgstab.iterations == 3 && bicgstab.error > bicgstab.tolerance;
+
+    // Starting from the solution takes no iterations
+    Eigen::VectorXd u = Eigen::SparseLU<Eigen::SparseMatrix<double>>(K).solve(b);
+    gmres.tolerance = 1e-8;
+    x = u;
+    LinearSolve::detail::solve_impl(x, A, b, gmres);
+    return good && gmres.iterations == 0 && x == u;
+}
+
+
+int main()
+{
+    int retval = 0;
+    if (!test_1()) {
+        std::cerr << "Failed test_1()" << std::endl;
+        retval |= 1 << 0;
+    }
+    if (!test_2()) {
+        std::cerr << "Failed test_2()" << std::endl;
+        retval |= 1 << 1;
+    }
+    if (!test_3()) {
+        std::cerr << "Failed test_3()" << std::endl;
+        retval |= 1 << 2;
+    }
+    if (!test_4()) {
+        std::cerr << "Failed test_4()" << std::endl;
+        retval |= 1 << 3;
+    }
+
+    return retval;
+}
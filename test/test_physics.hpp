@@ -0,0 +1,69 @@
+#ifndef YAFEL_TEST_PHYSICS_HPP
+#define YAFEL_TEST_PHYSICS_HPP
+
+#include "yafel_globals.hpp"
+#include "element/Element.hpp"
+#include "fe_system/InverseMassOperator.hpp"
+#include "lin_alg/tensor/tensors.hpp"
+
+#include <Eigen/Core>
+#include <algorithm>
+#include <cmath>
+
+/**
+ * \file
+ *
+ * Physics shared by the standalone DG checks in test/.
+ */
+
+namespace yafel {
+namespace test_physics {
+
+/**
+ * Scalar advection by a rotation about (0.5, 0.5), with upwind fluxes and outflow on
+ * the boundary: the fluxes differ from face to face, and the wave speed from element
+ * to element.
+ */
+struct RotatingAdvection
+{
+    InverseMassOperator inverse_mass;
+
+    static constexpr int nsd() { return 2; }
+
+    static Tensor<2, 1> velocity(const coordinate<> &x) { return {0.5 - x(1), x(0) - 0.5}; }
+
+    static double WaveSpeed(const coordinate<> &x, double) { return norm(velocity(x)); }
+
+    template<typename TU, typename TR>
+    static void LocalResidual(const Element &E, int qpi, coordinate<> &x, double,
+                              Eigen::MatrixBase<TU> &U_el, Eigen::MatrixBase<TR> &R_el)
+    {
+        double U = E.shapeValues[qpi].dot(U_el);
+        for (int i = 0; i < R_el.rows(); ++i) {
+            auto gradW = make_TensorMap<2, 1>(&E.shapeGrad(i, 0));
+            R_el(i) += U * dot(gradW, velocity(x)) * E.jxw;
+        }
+    }
+
+    template<typename T>
+    static void LocalMass(const Element &E, int qpi, double, Eigen::MatrixBase<T> &M_el)
+    {
+        M_el += (E.jxw * E.shapeValues[qpi]) * E.shapeValues[qpi].transpose();
+    }
+
+    static double BoundaryFlux(Tensor<2, 1> n, coordinate<> x, double, double U)
+    {
+        return std::max(0.0, dot(n, velocity(x))) * U;
+    }
+
+    static double Flux(Tensor<2, 1> n, coordinate<> x, double, double Uplus, double Uminus)
+    {
+        double vdotn = dot(n, velocity(x));
+        return 0.5 * (vdotn * (Uplus + Uminus) + std::abs(vdotn) * (Uplus - Uminus));
+    }
+};
+
+} // end namespace test_physics
+} // end namespace yafel
+
+#endif //YAFEL_TEST_PHYSICS_HPP
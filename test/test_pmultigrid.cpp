@@ -0,0 +1,226 @@
+#include "yafel_globals.hpp"
+#include "assembly/CGAssembly.hpp"
+#include "assembly/MatrixFreeOperator.hpp"
+#include "boundary_conditions/DirichletBC.hpp"
+#include "lin_alg/linear_solvers/solvers/MatrixFreeSolvers.hpp"
+#include "lin_alg/linear_solvers/solvers/PMultigrid.hpp"
+#include "test_meshes.hpp"
+
+#include <Eigen/Core>
+#include <Eigen/Sparse>
+#include <iostream>
+
+using namespace yafel;
+
+/*
+ * p-multigrid on the orders p, p/2, ..., 1: the transfers interpolate exactly, and
+ * as the preconditioner of CG it matches a direct solve in a few iterations, for
+ * assembled and matrix-free fine operators, with both coarse solvers.
+ */
+
+template<int NSD>
+struct DiffusionReaction
+{
+    static constexpr int nsd() { return NSD; }
+
+    static double kappa(const coordinate<> &x) { return 1 + x(0) + 2 * x(1) * x(1); }
+
+    static constexpr double reaction = 0.5;
+
+    template<typename ElementT, typename VectorT, typename MatrixT>
+    static void LocalTangent(const ElementT &E, int qpi, coordinate<> &xqp, double, VectorT &, MatrixT &K_el)
+    {
+        K_el += kappa(xqp) * E.shapeGrad * E.shapeGrad.transpose() * E.jxw
+                + reaction * E.shapeValues[qpi] * E.shapeValues[qpi].transpose() * E.jxw;
+    }
+
+    template<typename ElementT, typename VectorT>
+    static void LocalResidual(const ElementT &, int, coordinate<> &, double, VectorT &, VectorT &)
+    {}
+
+    static void PointwiseOperator(const coordinate<> &xqp, double, double u, const Tensor<NSD, 1> &grad_u,
+                                  double &s, Tensor<NSD, 1> &flux)
+    {
+        s = reaction * u;
+        flux = kappa(xqp) * grad_u;
+    }
+};
+
+using Physics = DiffusionReaction<2>;
+
+auto on_boundary = [](auto x) { return x(0) < 1.0e-12 || x(0) > 1 - 1.0e-12; };
+auto bc_value = [](coordinate<> x, double) { return 1 + x(1); };
+
+
+// Prolongations of the nodal values of a linear function are its nodal values
+// (up to the snapping of DoFManager::dof_nodes, 1e-6 of the mesh size)
+bool transfers_exact(const Mesh &M, int polyOrder, int expected_levels)
+{
+    DoFManager dofm(M, DoFManager::ManagerType::CG, polyOrder, 1);
+    LinearSolve::PMultigrid pmg(M, dofm);
+    auto f = [](const coordinate<> &x) { return 1 + x(0) - 2 * x(1); };
+    auto nodal = [&f](const DoFManager &D) {
+        Eigen::VectorXd u(D.nNodes());
+        for (int i = 0; i < D.nNodes(); ++i) {
+            u(i) = f(D.dof_nodes[i]);
+        }
+        return u;
+    };
+
+    bool good = pmg.nLevels() == expected_levels && pmg.levelOrder(pmg.nLevels() - 1) == 1;
+    for (int l = 0; l + 1 < pmg.nLevels(); ++l) {
+        Eigen::VectorXd fine = nodal(pmg.levelDoFManager(l));
+        Eigen::VectorXd prolonged = pmg.prolongation(l) * nodal(pmg.levelDoFManager(l + 1));
+        good = good && (prolonged - fine).lpNorm<Eigen::Infinity>() < 1.0e-6 * fine.lpNorm<Eigen::Infinity>();
+    }
+    return good;
+}
+
+
+// Tangent with the boundary conditions, its direct solution, and the matching rhs
+struct Reference
+{
+    Eigen::SparseMatrix<double> K;
+    Eigen::VectorXd rhs;
+    Eigen::VectorXd u;
+};
+
+Reference reference(DoFManager &dofm)
+{
+    FESystem feSystem(dofm, 2);
+    CGAssembly<Physics>(feSystem, {AssemblyRequirement::Tangent});
+    Reference R{feSystem.getGlobalTangent(), Eigen::VectorXd::Constant(dofm.nNodes(), 1.0 / dofm.nNodes()), {}};
+    DirichletBC bc(dofm, bc_value);
+    bc.selectByFunction(on_boundary);
+    bc.apply(R.K, R.rhs);
+    R.u = Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>>(R.K).solve(R.rhs);
+    return R;
+}
+
+
+// Interpolation on distorted quads, triangles, and mixed triangles and quads
+bool test_1()
+{
+    return transfers_exact(test_meshes::quadMesh(4, 1.2, 0.2), 8, 4)
+           && transfers_exact(test_meshes::quadMesh(4, 1.2, 0.2), 3, 2)
+           && transfers_exact(test_meshes::triMesh(4), 4, 3)
+           && transfers_exact(test_meshes::mixedMesh(4), 4, 3);
+}
+
+
+// Assembled operator: few iterations for p = 2, 4, 8, far fewer than Jacobi CG
+bool test_2()
+{
+    bool good = true;
+    for (int p : {2, 4, 8}) {
+        auto M = test_meshes::quadMesh(6, 1.2, 0.2);
+        DoFManager dofm(M, DoFManager::ManagerType::CG, p, 1);
+        auto R = reference(dofm);
+
+        LinearSolve::PMultigrid pmg(M, dofm);
+        pmg.constrainByFunction(on_boundary);
+        LinearSolve::PMultigridConjugateGradientTag tag{pmg};
+        Eigen::VectorXd u = Eigen::VectorXd::Zero(R.rhs.rows());
+        LinearSolve::detail::solve_impl(u, R.K, R.rhs, tag);
+
+        Eigen::ConjugateGradient<Eigen::SparseMatrix<double>, Eigen::Lower | Eigen::Upper> cg;
+        cg.setTolerance(1.0e-12);
+        cg.compute(R.K);
+        Eigen::VectorXd u_jacobi = cg.solve(R.rhs);
+
+        good = good && (u - R.u).norm() < 1.0e-8 * R.u.norm() && (u_jacobi - R.u).norm() < 1.0e-8 * R.u.norm()
+               && tag.iterations < 20 && 4 * tag.iterations < cg.iterations();
+    }
+    return good;
+}
+
+
+// Matrix-free operator (p = 6), with the direct and the AMG coarse solvers
+bool test_3()
+{
+    auto M = test_meshes::quadMesh(6, 1.2, 0.2);
+    DoFManager dofm(M, DoFManager::ManagerType::CG, 6, 1);
+    auto R = reference(dofm);
+
+    MatrixFreeOperator<Physics> A(dofm);
+    Eigen::VectorXd rhs = Eigen::VectorXd::Constant(dofm.nNodes(), 1.0 / dofm.nNodes());
+    DirichletBC bc(dofm, bc_value);
+    bc.selectByFunction(on_boundary);
+    bc.apply(A, rhs);
+
+    bool good = true;
+    for (auto coarse : {LinearSolve::PMultigridOptions::CoarseSolver::Direct,
+                        LinearSolve::PMultigridOptions::CoarseSolver::AMG}) {
+        LinearSolve::PMultigrid pmg(M, dofm);
+        LinearSolve::PMultigridOptions options;
+        options.coarse_solver = coarse;
+        pmg.setOptions(options);
+        pmg.constrainByFunction(on_boundary);
+        LinearSolve::PMultigridConjugateGradientTag tag{pmg};
+        Eigen::VectorXd u = Eigen::VectorXd::Zero(rhs.rows());
+        LinearSolve::detail::solve_impl(u, A, rhs, tag);
+        good = good && pmg.nLevels() == 3 && (u - R.u).norm() < 1.0e-8 * R.u.norm() && tag.iterations < 20;
+    }
+    return good;
+}
+
+
+// By default every solve sets the p-multigrid up again; Reuse::Hierarchy keeps the first setup
+bool test_4()
+{
+    auto M = test_meshes::quadMesh(6, 1.2, 0.2);
+    DoFManager dofm(M, DoFManager::ManagerType::CG, 4, 1);
+    auto R = reference(dofm);
+    Eigen::SparseMatrix<double> K2 = 2.0 * R.K;
+
+    LinearSolve::PMultigrid pmg_K(M, dofm), pmg_K2(M, dofm);
+    pmg_K.constrainByFunction(on_boundary);
+    pmg_K2.constrainByFunction(on_boundary);
+    pmg_K.compute(R.K);
+    pmg_K2.compute(K2);
+    Eigen::VectorXd vcycle_K = pmg_K.solve(R.rhs);
+    Eigen::VectorXd vcycle_K2 = pmg_K2.solve(R.rhs);
+
+    bool good = true;
+    for (auto reuse : {LinearSolve::PMultigridConjugateGradientTag::Reuse::None,
+                       LinearSolve::PMultigridConjugateGradientTag::Reuse::Hierarchy}) {
+        LinearSolve::PMultigrid pmg(M, dofm);
+        pmg.constrainByFunction(on_boundary);
+        LinearSolve::PMultigridConjugateGradientTag tag{pmg};
+        tag.reuse = reuse;
+        Eigen::VectorXd u = Eigen::VectorXd::Zero(R.rhs.rows());
+        LinearSolve::detail::solve_impl(u, R.K, R.rhs, tag);
+        u.setZero();
+        LinearSolve::detail::solve_impl(u, K2, R.rhs, tag);
+
+        auto const &expected = reuse == LinearSolve::PMultigridConjugateGradientTag::Reuse::None ? vcycle_K2
+                                                                                                : vcycle_K;
+        good = good && (2.0 * u - R.u).norm() < 1.0e-8 * R.u.norm()
+               && (pmg.solve(R.rhs) - expected).norm() < 1.0e-12 * expected.norm();
+    }
+    return good;
+}
+
+
+int main()
+{
+    int retval = 0;
+    if (!test_1()) {
+        std::cerr << "Failed test_1()" << std::endl;
+        retval |= 1 << 0;
+    }
+    if (!test_2()) {
+        std::cerr << "Failed test_2()" << std::endl;
+        retval |= 1 << 1;
+    }
+    if (!test_3()) {
+        std::cerr << "Failed test_3()" << std::endl;
+        retval |= 1 << 2;
+    }
+    if (!test_4()) {
+        std::cerr << "Failed test_4()" << std::endl;
+        retval |= 1 << 3;
+    }
+
+    return retval;
+}
@@ -0,0 +1,224 @@
+#include "yafel_globals.hpp"
+#include "time_integration/DGRK4.hpp"
+#include "time_integration/EmbeddedRK.hpp"
+#include "time_integration/TimeStepController.hpp"
+#include "test_meshes.hpp"
+#include "test_physics.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <iostream>
+
+using namespace yafel;
+
+/*
+ * TimeStepController reduces the element CFL steps to a stable global step, refreshed
+ * every `interval` steps, and lands exactly on the end time. With the embedded
+ * BogackiShampine23 pair, adaptiveStep follows the local error estimate instead,
+ * and the error at the end time follows the tolerance.
+ */
+
+// Rotating advection (test_physics.hpp)
+using Advection = test_physics::RotatingAdvection;
+
+// The same, with a state-dependent (over)estimate of the wave speed
+struct StateAdvection : Advection
+{
+    static double WaveSpeed(const coordinate<> &x, double, const Tensor<1, 1> &U)
+    {
+        return norm(velocity(x)) * (1 + std::abs(U(0)));
+    }
+};
+
+// dU/dt = cos(t) - U at every node, as in test_explicit_rk; counts its residual evaluations
+struct Relaxation
+{
+    InverseMassOperator inverse_mass;
+
+    static std::atomic<long> element_evaluations;
+
+    static constexpr int nsd() { return 2; }
+
+    static double exact(double t, double u0) { return (u0 - 0.5) * std::exp(-t) + 0.5 * (std::cos(t) + std::sin(t)); }
+
+    static double WaveSpeed(const coordinate<> &, double) { return 0; }
+
+    template<typename TU, typename TR>
+    static void LocalResidual(const Element &E, int qpi, coordinate<> &, double t,
+                              Eigen::MatrixBase<TU> &U_el, Eigen::MatrixBase<TR> &R_el)
+    {
+        if (qpi == 0) {
+            ++element_evaluations;
+        }
+        double U = E.shapeValues[qpi].dot(U_el);
+        for (int i = 0; i < R_el.rows(); ++i) {
+            R_el(i) += (std::cos(t) - U) * E.shapeValues[qpi](i) * E.jxw;
+        }
+    }
+
+    template<typename T>
+    static void LocalMass(const Element &E, int qpi, double, Eigen::MatrixBase<T> &M_el)
+    {
+        M_el += (E.jxw * E.shapeValues[qpi]) * E.shapeValues[qpi].transpose();
+    }
+
+    static double BoundaryFlux(Tensor<2, 1>, coordinate<>, double, double) { return 0; }
+
+    static double Flux(Tensor<2, 1>, coordinate<>, double, double, double) { return 0; }
+};
+
+std::atomic<long> Relaxation::element_evaluations{0};
+
+
+// The parallel reduction is the smallest element step, with wave speeds from the state if given
+bool test_1()
+{
+    Mesh M = test_meshes::quadMesh(6, 2.0, 0.1);
+    M.buildInternalFaces();
+    DoFManager dofm(M, DoFManager::ManagerType::DG, 2, 1);
+    FESystem feSystem(dofm, 2);
+    auto lengths = elementLengths(feSystem, 2);
+
+    auto dts = elementTimeSteps<Advection>(feSystem, 0.4);
+    double dt = stableTimeStep<Advection>(feSystem, lengths, 0.4);
+    bool good = dt == *std::min_element(dts.begin(), dts.end());
+
+    // A unit state doubles every wave speed
+    double dt0 = stableTimeStep<StateAdvection>(feSystem, lengths, 0.4);
+    feSystem.getSolution().setConstant(1.0);
+    double dt1 = stableTimeStep<StateAdvection>(feSystem, lengths, 0.4);
+    auto state_dts = elementTimeSteps<StateAdvection>(feSystem, 0.4);
+    return good && dt0 == dt && std::abs(dt1 - dt / 2) < 1e-14 * dt
+           && dt1 == *std::min_element(state_dts.begin(), state_dts.end());
+}
+
+
+// CFL-limited steps, refreshed every `interval` steps, ending exactly at t_end
+bool test_2()
+{
+    Mesh M = test_meshes::quadMesh(6, 2.0);
+    M.buildInternalFaces();
+    DoFManager dofm(M, DoFManager::ManagerType::DG, 1, 1);
+    FESystem feSystem(dofm, 2);
+    StateAdvection physics;
+    DGRK4 rk(0);
+
+    TimeStepController controller(feSystem, 2, 0.5, 3);
+    const double dt0 = stableTimeStep<StateAdvection>(feSystem, controller.elementLengths(), 0.5);
+    double h1 = controller.step(rk, feSystem, physics);
+
+    // Larger wave speeds are only seen at the next reduction, after 3 steps
+    feSystem.getSolution().setConstant(1.0);
+    double h2 = controller.step(rk, feSystem, physics);
+    double h3 = controller.step(rk, feSystem, physics);
+    double h4 = controller.step(rk, feSystem, physics);
+    bool good = h1 == dt0 && h2 == h1 && h3 == h1 && h4 < 0.75 * h1;
+
+    const double t_end = 0.3;
+    int nSteps{0};
+    while (feSystem.currentTime() < t_end) {
+        const double limit = controller.timeStep<StateAdvection>(feSystem);
+        good = good && controller.step(rk, feSystem, physics, t_end) <= limit;
+        ++nSteps;
+    }
+    return good && feSystem.currentTime() == t_end && nSteps < 1000;
+}
+
+
+// Initial value u0 = 1 + x on a small mesh
+void relaxation_setup(DoFManager &dofm, FESystem &feSystem)
+{
+    auto &U = feSystem.getSolution();
+    for (int i = 0; i < U.rows(); ++i) {
+        U(i) = 1 + dofm.dof_nodes[i](0);
+    }
+}
+
+double relaxation_error(DoFManager &dofm, FESystem &feSystem, double t)
+{
+    auto const &U = feSystem.getSolution();
+    double error{0};
+    for (int i = 0; i < U.rows(); ++i) {
+        error = std::max(error, std::abs(U(i) - Relaxation::exact(t, 1 + dofm.dof_nodes[i](0))));
+    }
+    return error;
+}
+
+// Fixed steps: third order, and three evaluations per step after the first
+bool test_3()
+{
+    Mesh M = test_meshes::quadMesh(2);
+    M.buildInternalFaces();
+    DoFManager dofm(M, DoFManager::ManagerType::DG, 1, 1);
+
+    double errors[2];
+    long evaluations[2];
+    for (int r = 0; r < 2; ++r) {
+        const int nSteps = 10 << r;
+        FESystem feSystem(dofm, 2);
+        relaxation_setup(dofm, feSystem);
+        Relaxation physics;
+        BogackiShampine23 rk(1.0 / nSteps);
+        Relaxation::element_evaluations = 0;
+        for (int n = 0; n < nSteps; ++n) {
+            rk.step(feSystem, physics);
+        }
+        errors[r] = relaxation_error(dofm, feSystem, 1.0);
+        evaluations[r] = Relaxation::element_evaluations / dofm.nCells();
+    }
+    return std::log2(errors[0] / errors[1]) > 2.7 && evaluations[0] == 4 + 3 * 9 && evaluations[1] == 4 + 3 * 19;
+}
+
+
+// Error-controlled steps: the error follows the tolerance, and too large a first step is rejected
+double adaptive_error(DoFManager &dofm, double tol, int &nAccepted, int &nRejected)
+{
+    FESystem feSystem(dofm, 2);
+    relaxation_setup(dofm, feSystem);
+    Relaxation physics;
+    BogackiShampine23 rk(1.0, tol, tol);
+    TimeStepController controller(feSystem, 2, 0.5);
+    while (feSystem.currentTime() < 1.0) {
+        controller.adaptiveStep(rk, feSystem, physics, 1.0);
+    }
+    nAccepted = controller.nAccepted();
+    nRejected = controller.nRejected();
+    return feSystem.currentTime() == 1.0 ? relaxation_error(dofm, feSystem, 1.0) : 1.0;
+}
+
+bool test_4()
+{
+    Mesh M = test_meshes::quadMesh(2);
+    M.buildInternalFaces();
+    DoFManager dofm(M, DoFManager::ManagerType::DG, 1, 1);
+
+    int accepted1, rejected1, accepted2, rejected2;
+    double e1 = adaptive_error(dofm, 1e-4, accepted1, rejected1);
+    double e2 = adaptive_error(dofm, 1e-7, accepted2, rejected2);
+    return e1 < 1e-3 && e2 < 1e-6 && e2 < e1 && rejected1 > 0 && accepted2 > accepted1;
+}
+
+
+int main()
+{
+    int retval = 0;
+    if (!test_1()) {
+        std::cerr << "Failed test_1()" << std::endl;
+        retval |= 1 << 0;
+    }
+    if (!test_2()) {
+        std::cerr << "Failed test_2()" << std::endl;
+        retval |= 1 << 1;
+    }
+    if (!test_3()) {
+        std::cerr << "Failed test_3()" << std::endl;
+        retval |= 1 << 2;
+    }
+    if (!test_4()) {
+        std::cerr << "Failed test_4()" << std::endl;
+        retval |= 1 << 3;
+    }
+
+    return retval;
+}